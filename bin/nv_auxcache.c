@@ -0,0 +1,257 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sim.h"
+
+#include <core/event.h>
+#include <subdev/bios.h>
+#include <subdev/i2c/aux.h>
+#include <subdev/i2c/priv.h>
+
+/* Reads a simulated sink's DPCD through an AUX channel while the pad is
+ * being monitored, and checks what the capability cache may answer:
+ *
+ * - reads through nvkm_rdaux() are cached, and come back as they were,
+ * - transactions through nvkm_i2c_aux_xfer(), as drm_dp_aux makes them,
+ *   always go to the sink, and see what's there now,
+ * - an IRQ_HPD from the sink, as well as a plug or unplug, drops what the
+ *   cache had, as does a native write into one of the cached ranges,
+ * - with NvAuxCache=0, nothing is cached at all.
+ *
+ * The steps below are run with the default config and with NvAuxCache=0,
+ * and the table printed at the end says where each read's data came from,
+ * with a '!' where that's not where it should have.
+ */
+
+#define SIM_DPCD 0x100000
+
+static u8 dpcd[SIM_DPCD];
+static u32 hi, lo, rq, tx;
+static u64 reads;
+
+static int
+sim_xfer(struct nvkm_i2c_aux *aux, bool retry, u8 type, u32 addr,
+	 u8 *data, u8 *size)
+{
+	if (addr + *size > SIM_DPCD)
+		return -EIO;
+
+	switch (type) {
+	case 9:
+		memcpy(data, &dpcd[addr], *size);
+		reads++;
+		return 0;
+	case 8:
+		memcpy(&dpcd[addr], data, *size);
+		return 0;
+	default:
+		return -EINVAL;
+	}
+}
+
+static const struct nvkm_i2c_aux_func
+sim_aux = {
+	.xfer = sim_xfer,
+};
+
+static const struct nvkm_i2c_pad_func
+sim_pad = {
+};
+
+static void
+sim_aux_stat(struct nvkm_i2c *i2c, u32 *phi, u32 *plo, u32 *prq, u32 *ptx)
+{
+	*phi = hi;
+	*plo = lo;
+	*prq = rq;
+	*ptx = tx;
+	hi = lo = rq = tx = 0;
+}
+
+static void
+sim_aux_mask(struct nvkm_i2c *i2c, u32 type, u32 mask, u32 data)
+{
+}
+
+static const struct nvkm_i2c_func
+sim_i2c = {
+	.aux = 1,
+	.aux_stat = sim_aux_stat,
+	.aux_mask = sim_aux_mask,
+};
+
+static const struct nvkm_subdev_func
+sim_bios = {
+};
+
+enum sim_event {
+	READ,		/* nvkm_rdaux() */
+	RAW,		/* nvkm_i2c_aux_xfer() instead */
+	IRQ_HPD,	/* sink IRQ before the read */
+	PLUG,		/* plug event before the read */
+	DONE,		/* AUX transaction done IRQ before the read */
+	WRITE,		/* native write into a cached range before the read */
+};
+
+static const struct {
+	const char *name;
+	bool change;	/* sink's capabilities change first */
+	enum sim_event event;
+	u32 addr;
+	bool cached;	/* served from the cache, if there's one */
+} sim_steps[] = {
+	{ "first",   false, READ,    0x000, false },
+	{ "again",   true,  READ,    0x000, true },
+	{ "raw",     false, RAW,     0x000, false },
+	{ "again",   false, READ,    0x000, true },
+	{ "irq_hpd", true,  IRQ_HPD, 0x000, false },
+	{ "plug",    true,  PLUG,    0x000, false },
+	{ "done",    true,  DONE,    0x000, true },
+	{ "write",   true,  WRITE,   0x000, false },
+	{ "span",    false, READ,    0x0f8, false }, /* past the end */
+	{ "span",    false, READ,    0x0f8, false },
+};
+
+static const char *sim_cfgs[] = { "", "NvAuxCache=0" };
+static const char *sim_from[ARRAY_SIZE(sim_cfgs)][ARRAY_SIZE(sim_steps)];
+static bool sim_bad[ARRAY_SIZE(sim_cfgs)][ARRAY_SIZE(sim_steps)];
+
+/* Reads 16 bytes at 'addr', and returns whether they're what the sink has
+ * now, and that it was asked for them, or what it had at 'prev', and that
+ * it wasn't.
+ */
+static const char *
+sim_read(struct nvkm_i2c_aux *aux, bool raw, u32 addr, const u8 *prev)
+{
+	u64 before = reads;
+	u8 data[16], cnt = sizeof(data);
+	int ret;
+
+	if (raw) {
+		ret = nvkm_i2c_aux_acquire(aux);
+		if (ret == 0) {
+			ret = nvkm_i2c_aux_xfer(aux, true, 9, addr, data, &cnt);
+			nvkm_i2c_aux_release(aux);
+		}
+	} else {
+		ret = nvkm_rdaux(aux, addr, data, sizeof(data));
+	}
+
+	if (ret)
+		return "error";
+	if (reads != before)
+		return memcmp(data, &dpcd[addr], cnt) ? "sink?" : "sink";
+	return memcmp(data, &prev[addr], cnt) ? "cache?" : "cache";
+}
+
+static int
+sim_run(struct nvkm_device *device, int c)
+{
+	struct nvkm_i2c_aux *aux = NULL;
+	struct nvkm_i2c_pad *pad = NULL;
+	struct nvkm_subdev *subdev;
+	const struct nvkm_event_func *func;
+	struct nvkm_i2c *i2c;
+	u8 prev[256], data[16];
+	int ret, i;
+
+	device->cfgopt = sim_cfgs[c];
+
+	ret = nvkm_i2c_new_(&sim_i2c, device, NVKM_SUBDEV_I2C, &i2c);
+	if (ret)
+		return ret;
+
+	/* No DCB, so no outputs to size the event by. */
+	func = i2c->event.func;
+	nvkm_event_fini(&i2c->event);
+	ret = nvkm_event_init(func, 4, 1, &i2c->event);
+	if (ret == 0)
+		ret = nvkm_i2c_pad_new_(&sim_pad, i2c, 0, &pad);
+	if (ret == 0)
+		ret = nvkm_i2c_aux_new_(&sim_aux, pad, 0, &aux);
+	if (ret == 0)
+		ret = nvkm_subdev_init(&i2c->subdev);
+	if (ret)
+		return ret;
+	aux->intr = 0x00000001;
+	nvkm_i2c_aux_monitor(aux, true);
+
+	memcpy(prev, dpcd, sizeof(prev));
+	for (i = 0; i < ARRAY_SIZE(sim_steps); i++) {
+		const bool cached = sim_steps[i].cached && !c;
+
+		if (sim_steps[i].change) {
+			memcpy(prev, dpcd, sizeof(prev));
+			dpcd[0x00] ^= 0x01;
+			dpcd[0x0f] ^= 0x10;
+		}
+
+		switch (sim_steps[i].event) {
+		case IRQ_HPD: rq = aux->intr; break;
+		case PLUG   : hi = aux->intr; break;
+		case DONE   : tx = aux->intr; break;
+		case WRITE:
+			memcpy(data, &dpcd[0x20], sizeof(data));
+			nvkm_wraux(aux, 0x00020, data, sizeof(data));
+			break;
+		default:
+			break;
+		}
+
+		if (rq | hi | tx)
+			nvkm_subdev_intr(&i2c->subdev);
+
+		sim_from[c][i] = sim_read(aux, sim_steps[i].event == RAW,
+					  sim_steps[i].addr, prev);
+		sim_bad[c][i] = strcmp(sim_from[c][i],
+				       cached ? "cache" : "sink");
+	}
+
+	nvkm_subdev_fini(&i2c->subdev, false);
+	subdev = &i2c->subdev;
+	nvkm_subdev_del(&subdev);
+	return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	struct nvkm_device device = {};
+	struct nvkm_bios bios = {};
+	int errors = 0, ret, c, i;
+
+	for (i = 0; i < SIM_DPCD; i++)
+		dpcd[i] = i * 0x1d + (i >> 8);
+
+	ret = sim_device_init(&device, "nv_auxcache", NULL,
+			      argc > 1 ? argv[1] : "fatal");
+	if (ret) {
+		fprintf(stderr, "failed to create device: %d\n", ret);
+		return 1;
+	}
+	nvkm_subdev_ctor(&sim_bios, &device, NVKM_SUBDEV_VBIOS, &bios.subdev);
+	device.bios = &bios;
+
+	for (c = 0; c < ARRAY_SIZE(sim_cfgs); c++) {
+		ret = sim_run(&device, c);
+		if (ret) {
+			fprintf(stderr, "failed to run aux: %d\n", ret);
+			return 1;
+		}
+	}
+
+	printf("%-8s %-8s %-13s\n", "", "default", sim_cfgs[1]);
+	for (i = 0; i < ARRAY_SIZE(sim_steps); i++) {
+		printf("%-8s", sim_steps[i].name);
+		for (c = 0; c < ARRAY_SIZE(sim_cfgs); c++) {
+			printf(" %-7s%c", sim_from[c][i],
+			       sim_bad[c][i] ? '!' : ' ');
+			errors += sim_bad[c][i];
+		}
+		printf("\n");
+	}
+
+	sim_device_fini(&device);
+	return errors ? 1 : 0;
+}
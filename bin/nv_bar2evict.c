@@ -0,0 +1,417 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sim.h"
+#include "../lib/priv.h"
+
+#include <core/mm.h>
+#include <subdev/bar/priv.h>
+#include <subdev/fb.h>
+#include <subdev/mmu/vmm.h>
+
+/* Replays instance memory access patterns against NV50's instmem, with a
+ * BAR2 small enough that objects have to be evicted from it, once with
+ * each eviction policy.  The same seed gives the same accesses.
+ *
+ * BAR2 is a single-level page table in simulated VRAM, bootstrapped the
+ * way the real BAR code does it, and an ioremap() of BAR3 is resolved to
+ * the VRAM its PTEs point at.  Eviction cost is counted in PTE writes,
+ * which is what a miss costs on top of a hit, besides the TLB flush.
+ *
+ * Every access checks the object's first and last words, which were
+ * written when it was created, so a mapping that's pointing at the wrong
+ * VRAM, or an access through PRAMIN once BAR2 is up, shows up as a bad
+ * read.
+ */
+
+#define SIM_VRAM (64 << 20)
+#define SIM_BAR3 0xd0000000ULL
+#define SIM_PTES (1 << 12)
+
+static const struct {
+	const char *name;
+	int nr;
+	u32 size;
+} sim_class[] = {
+	{ "hot",  16, 0x001000 },	/* instance blocks, RAMHT */
+	{ "warm", 48, 0x008000 },	/* object/context state */
+	{ "big",   6, 0x080000 },	/* context images, rarely touched */
+};
+
+/* Percentage of accesses to each class.  Scanning patterns walk the
+ * warm and big objects in order, the case plain LRU does worst at.
+ */
+static const struct {
+	const char *name;
+	int pct[ARRAY_SIZE(sim_class)];
+	bool scan;
+} sim_pattern[] = {
+	{ "hot",   { 80, 15,  5 } },
+	{ "mixed", { 34, 33, 33 } },
+	{ "scan",  { 50, 45,  5 }, true },
+};
+
+static u8 *sim_vram;
+static u64 sim_pte[SIM_PTES];
+static u64 sim_pte_writes;
+static u64 sim_evictions;
+static u64 sim_evicted;
+static u64 sim_ioremaps;
+
+static void
+sim_bar2_pte(struct nvkm_vmm *vmm, struct nvkm_mmu_pt *pt,
+	     u32 ptei, u32 ptes, struct nvkm_vmm_map *map, u64 addr)
+{
+	sim_pte_writes += ptes;
+	while (ptes--) {
+		VMM_WO032(pt, vmm, ptei * 4, addr >> 12 | 0x00000001);
+		sim_pte[ptei++] = addr;
+		addr += 0x1000;
+	}
+}
+
+static void
+sim_bar2_pgt_mem(struct nvkm_vmm *vmm, struct nvkm_mmu_pt *pt,
+		 u32 ptei, u32 ptes, struct nvkm_vmm_map *map)
+{
+	VMM_MAP_ITER_MEM(vmm, pt, ptei, ptes, map, sim_bar2_pte);
+}
+
+static void
+sim_bar2_pgt_unmap(struct nvkm_vmm *vmm,
+		   struct nvkm_mmu_pt *pt, u32 ptei, u32 ptes)
+{
+	sim_pte_writes += ptes;
+	sim_evictions++;
+	sim_evicted += ptes << 12;
+	memset(&sim_pte[ptei], 0xff, ptes * sizeof(sim_pte[0]));
+	VMM_FO032(pt, vmm, ptei * 4, 0, ptes);
+}
+
+static const struct nvkm_vmm_desc_func
+sim_bar2_pgt = {
+	.unmap = sim_bar2_pgt_unmap,
+	.mem = sim_bar2_pgt_mem,
+};
+
+static const struct nvkm_vmm_desc
+sim_bar2_desc[] = {
+	{ PGT, 12, 4, 0x1000, &sim_bar2_pgt },
+	{}
+};
+
+static const struct nvkm_vmm_func
+sim_bar2_func = {
+	.valid = nv04_vmm_valid,
+	.page = {
+		{ 12, &sim_bar2_desc[0], NVKM_VMM_PAGE_VRAM },
+		{}
+	}
+};
+
+static struct nvkm_vmm *sim_bar2;
+
+static struct nvkm_vmm *
+sim_bar_bar2_vmm(struct nvkm_bar *bar)
+{
+	return sim_bar2;
+}
+
+static const struct nvkm_bar_func
+sim_bar_func = {
+	.bar2.vmm = sim_bar_bar2_vmm,
+};
+
+static struct nvkm_bar sim_bar = {
+	.func = &sim_bar_func,
+};
+
+/* Only contiguous VRAM can be mapped, as is the case for instobjs. */
+static void __iomem *
+sim_bar3_map(u64 addr, u64 size)
+{
+	const u64 ptei = (addr - SIM_BAR3) >> 12;
+	const u64 ptes = DIV_ROUND_UP((addr & 0xfff) + size, 0x1000);
+	u64 i;
+
+	if (addr < SIM_BAR3 || ptei + ptes > SIM_PTES)
+		return NULL;
+
+	for (i = 0; i < ptes; i++) {
+		if (sim_pte[ptei + i] != sim_pte[ptei] + (i << 12) ||
+		    sim_pte[ptei + i] >= SIM_VRAM)
+			return NULL;
+	}
+
+	sim_ioremaps++;
+	return sim_vram + sim_pte[ptei] + (addr & 0xfff);
+}
+
+static resource_size_t
+sim_resource_addr(struct nvkm_device *device, unsigned bar)
+{
+	return bar == 3 ? SIM_BAR3 : 0;
+}
+
+static const struct nvkm_device_func
+sim_device_func = {
+	.resource_addr = sim_resource_addr,
+};
+
+static struct nvkm_fb fb;
+static struct nvkm_ram ram;
+
+struct sim_obj {
+	struct nvkm_memory *memory;
+	u32 size;
+	u32 sig;
+};
+
+struct sim_run {
+	u64 accesses;
+	u64 misses;
+	u64 evictions;
+	u64 evicted;
+	u64 ptes;
+	u64 ptes_max;
+	s64 time_max;
+	int slow;
+	int bad;
+};
+
+static int
+sim_setup(struct nvkm_device *device, const char *cfg, const char *dbg,
+	  u64 bar2)
+{
+	struct nvkm_subdev *subdev;
+	int ret;
+
+	ret = sim_device_init(device, "nv_bar2evict", cfg, dbg);
+	if (ret)
+		return ret;
+	device->func = &sim_device_func;
+
+	subdev = &device->imem->subdev;
+	nvkm_subdev_del(&subdev);
+
+	mutex_init(&fb.subdev.mutex);
+	fb.ram = &ram;
+	ram.fb = &fb;
+	ram.size = SIM_VRAM;
+	device->fb = &fb;
+	ret = nvkm_mm_init(&ram.vram, NVKM_RAM_MM_NORMAL, 0,
+			   SIM_VRAM >> NVKM_RAM_MM_SHIFT, 1);
+	if (ret == 0) {
+		ret = nv50_instmem_new(device, NVKM_SUBDEV_INSTMEM,
+				       &device->imem);
+	}
+	if (ret == 0)
+		ret = nvkm_subdev_init(&device->imem->subdev);
+	if (ret == 0)
+		ret = nv04_mmu_new(device, NVKM_SUBDEV_MMU, &device->mmu);
+	if (ret)
+		return ret;
+
+	/* Until BAR2 is up, the page table itself is written via PRAMIN. */
+	memset(sim_pte, 0xff, sizeof(sim_pte));
+	device->bar = &sim_bar;
+	ret = nvkm_vmm_new_(&sim_bar2_func, device->mmu, 0, false, 0, bar2,
+			    NULL, "bar2", &sim_bar2);
+	if (ret == 0)
+		ret = nvkm_vmm_boot(sim_bar2);
+	if (ret)
+		return ret;
+	sim_bar.bar2 = true;
+	return 0;
+}
+
+static void
+sim_teardown(struct nvkm_device *device)
+{
+	struct nvkm_subdev *subdev;
+
+	sim_bar.bar2 = false;
+	nvkm_vmm_unref(&sim_bar2);
+	subdev = &device->mmu->subdev;
+	nvkm_subdev_del(&subdev);
+	sim_device_fini(device);
+	nvkm_mm_fini(&ram.vram);
+}
+
+static bool
+sim_check(struct sim_obj *obj)
+{
+	return nvkm_ro32(obj->memory, 0) == obj->sig &&
+	       nvkm_ro32(obj->memory, obj->size - 4) == ~obj->sig;
+}
+
+static int
+sim_replay(int pattern, bool lru, const char *dbg, u64 bar2, int loops,
+	   unsigned int seed, struct sim_run *run)
+{
+	struct nvkm_device device = {};
+	struct sim_obj *objs;
+	int c, i, nr = 0, next = 0, warm = 0;
+	int ret;
+
+	for (c = 0; c < ARRAY_SIZE(sim_class); c++)
+		nr += sim_class[c].nr;
+	if (!(objs = calloc(nr, sizeof(*objs))))
+		return -ENOMEM;
+
+	ret = sim_setup(&device, lru ? "NvInstLRU=1" : NULL, dbg, bar2);
+	if (ret)
+		return ret;
+
+	for (c = 0, i = 0; c < ARRAY_SIZE(sim_class); c++) {
+		int j;
+
+		for (j = 0; j < sim_class[c].nr; j++, i++) {
+			objs[i].size = sim_class[c].size;
+			objs[i].sig = 0xcafe0000 | i;
+			ret = nvkm_instobj_new(device.imem, objs[i].size,
+					       0x1000, true,
+					       NVKM_MEM_TARGET_INST,
+					       &objs[i].memory);
+			if (ret)
+				return ret;
+
+			nvkm_kmap(objs[i].memory);
+			nvkm_wo32(objs[i].memory, 0, objs[i].sig);
+			nvkm_wo32(objs[i].memory, objs[i].size - 4,
+				  ~objs[i].sig);
+			nvkm_done(objs[i].memory);
+		}
+
+		if (c == 0)
+			warm = i;
+	}
+
+	memset(run, 0x00, sizeof(*run));
+	sim_ioremaps = sim_evictions = sim_evicted = 0;
+
+	for (i = 0; i < loops; i++) {
+		struct sim_obj *obj;
+		int pick = rand_r(&seed) % 100;
+		u64 ptes = sim_pte_writes, miss = sim_ioremaps;
+		s64 time;
+
+		for (c = 0; pick >= sim_pattern[pattern].pct[c]; c++)
+			pick -= sim_pattern[pattern].pct[c];
+
+		if (c == 0) {
+			obj = &objs[rand_r(&seed) % sim_class[0].nr];
+		} else
+		if (sim_pattern[pattern].scan) {
+			obj = &objs[warm + next];
+			next = (next + 1) % (nr - warm);
+		} else {
+			int base = warm;
+
+			if (c == 2)
+				base += sim_class[1].nr;
+			obj = &objs[base + rand_r(&seed) % sim_class[c].nr];
+		}
+
+		time = ktime_to_ns(ktime_get());
+		if (!nvkm_kmap(obj->memory))
+			run->slow++;
+		time = ktime_to_ns(ktime_get()) - time;
+		if (!sim_check(obj))
+			run->bad++;
+		nvkm_done(obj->memory);
+
+		run->accesses++;
+		if (sim_ioremaps != miss) {
+			ptes = sim_pte_writes - ptes;
+			run->ptes += ptes;
+			run->ptes_max = max(run->ptes_max, ptes);
+		}
+		run->time_max = max(run->time_max, time);
+	}
+
+	run->misses = sim_ioremaps;
+	run->evictions = sim_evictions;
+	run->evicted = sim_evicted;
+
+	for (i = 0; i < nr; i++)
+		nvkm_memory_unref(&objs[i].memory);
+	free(objs);
+	sim_teardown(&device);
+	return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	const char *dbg = "error";
+	unsigned int seed = 1;
+	u64 bar2 = 2 << 20;
+	int loops = 100000;
+	int errors = 0;
+	int ret, c, p, lru;
+
+	while ((c = getopt(argc, argv, "b:d:n:s:")) != -1) {
+		switch (c) {
+		case 'b': bar2 = strtoull(optarg, NULL, 0) << 10; break;
+		case 'd': dbg = optarg; break;
+		case 'n': loops = strtol(optarg, NULL, 0); break;
+		case 's': seed = strtoul(optarg, NULL, 0); break;
+		default:
+			fprintf(stderr, "usage: %s [-b bar2_KiB] [-n accesses] "
+					"[-s seed] [-d debug]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if (loops < 1 || bar2 < (1 << 20) || bar2 > (u64)SIM_PTES << 12) {
+		fprintf(stderr, "invalid access count/BAR2 size\n");
+		return 1;
+	}
+
+	if (!(sim_vram = calloc(1, SIM_VRAM)))
+		return 1;
+	os_ioremap_sim = sim_bar3_map;
+
+	printf("BAR2 %lluKiB, %d accesses, seed %u\n", bar2 >> 10, loops,
+	       seed);
+	printf("%-5s %-4s  %6s  %8s  %10s  %10s  %8s\n", "", "",
+	       "hit", "evicted", "KiB", "PTEs/miss", "max us");
+
+	for (p = 0; p < ARRAY_SIZE(sim_pattern); p++) {
+		for (lru = 1; lru >= 0; lru--) {
+			struct sim_run run;
+
+			ret = sim_replay(p, lru, dbg, bar2, loops, seed, &run);
+			if (ret) {
+				fprintf(stderr, "%s: replay failed: %d\n",
+					sim_pattern[p].name, ret);
+				return 1;
+			}
+
+			printf("%-5s %-4s  %3llu.%01llu%%  %8llu  %10llu  "
+			       "%5llu/%-4llu  %8lld\n",
+			       sim_pattern[p].name, lru ? "lru" : "size",
+			       (run.accesses - run.misses) * 100 /
+			       run.accesses,
+			       (run.accesses - run.misses) * 1000 /
+			       run.accesses % 10,
+			       run.evictions, run.evicted >> 10,
+			       run.misses ? run.ptes / run.misses : 0,
+			       run.ptes_max, run.time_max / 1000);
+
+			if (run.slow || run.bad) {
+				printf("%-5s %-4s: %d access(es) through "
+				       "PRAMIN, %d bad read(s)\n",
+				       sim_pattern[p].name,
+				       lru ? "lru" : "size", run.slow, run.bad);
+				errors++;
+			}
+		}
+	}
+
+	free(sim_vram);
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,215 @@
+#include <limits.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <nvif/os.h>
+
+#include <core/device.h>
+#include <subdev/bios.h>
+#include <subdev/bios/bit.h>
+#include <subdev/bios/conn.h>
+#include <subdev/bios/dcb.h>
+#include <subdev/bios/perf.h>
+#include <subdev/bios/rammap.h>
+#include <subdev/bios/volt.h>
+
+/* Replays the VBIOS lookups done while bringing up clk/volt/ram/disp
+ * against a dumped image, with and without the parsed table index,
+ * and checks that both give the same answers.  Every answer is folded
+ * into a hash, the two hashes have to be equal.
+ */
+
+static u32
+hash(u32 h, u32 v)
+{
+	int i;
+	for (i = 0; i < 4; i++, v >>= 8)
+		h = (h ^ (v & 0xff)) * 0x01000193;
+	return h;
+}
+
+static u32
+replay(struct nvkm_bios *bios)
+{
+	static const u8 ids[] = { 'i', 'P', 'M', 'p', 'd', 'C', 'I', 'U' };
+	struct nvbios_perfE perfE;
+	struct nvbios_ramcfg ramcfg;
+	struct nvbios_volt volt;
+	struct nvbios_volt_entry voltE;
+	struct dcb_output outp;
+	struct nvbios_connE connE;
+	struct bit_entry bit;
+	u8  ver, hdr, cnt, len;
+	u32 data, h = 0x811c9dc5;
+	int i, t;
+
+	for (i = 0; i < ARRAY_SIZE(ids); i++) {
+		if (!bit_entry(bios, ids[i], &bit)) {
+			h = hash(h, bit.version << 16 | bit.length);
+			h = hash(h, bit.offset);
+		}
+	}
+
+	i = 0;
+	while ((data = nvbios_perfEp(bios, i++, &ver, &hdr, &cnt, &len,
+				     &perfE))) {
+		h = hash(h, data);
+		h = hash(h, perfE.pstate << 8 | perfE.voltage);
+		h = hash(h, perfE.core);
+		h = hash(h, perfE.memory);
+
+		data = nvbios_rammapEm(bios, perfE.memory / 1000, &ver, &hdr,
+				       &cnt, &len, &ramcfg);
+		h = hash(h, data);
+		h = hash(h, ramcfg.rammap_min << 16 | ramcfg.rammap_max);
+	}
+
+	h = hash(h, nvbios_volt_parse(bios, &ver, &hdr, &cnt, &len, &volt));
+	for (i = 0; i < cnt; i++) {
+		h = hash(h, nvbios_volt_entry_parse(bios, i, &ver, &len, &voltE));
+		h = hash(h, voltE.voltage);
+		h = hash(h, voltE.vid);
+	}
+
+	i = 0;
+	while ((data = dcb_outp_parse(bios, i++, &ver, &len, &outp))) {
+		h = hash(h, data);
+		h = hash(h, outp.hasht << 16 | outp.hashm);
+		h = hash(h, outp.i2c_index << 8 | outp.connector);
+	}
+
+	for (t = DCB_OUTPUT_ANALOG; t <= DCB_OUTPUT_DP; t++) {
+		h = hash(h, dcb_outp_match(bios, t, 0x0000, &ver, &len, &outp));
+		h = hash(h, outp.hashm);
+	}
+
+	i = 0;
+	while ((data = nvbios_connEp(bios, i++, &ver, &len, &connE))) {
+		h = hash(h, data);
+		h = hash(h, connE.type << 8 | connE.hpd);
+		h = hash(h, connE.dp << 8 | connE.location);
+	}
+
+	return h;
+}
+
+static s64
+bench(struct nvkm_bios *bios, int loops, u32 *h)
+{
+	s64 time = ktime_to_ns(ktime_get());
+	int i;
+
+	for (i = 0; i < loops; i++)
+		*h = replay(bios);
+	return ktime_to_ns(ktime_get()) - time;
+}
+
+static int
+card_type(u32 chipset)
+{
+	switch (chipset & 0x1f0) {
+	case 0x010: return (0x461 & (1 << (chipset & 0xf))) ? NV_10 : NV_11;
+	case 0x020: return NV_20;
+	case 0x030: return NV_30;
+	case 0x040:
+	case 0x060: return NV_40;
+	case 0x050:
+	case 0x080:
+	case 0x090:
+	case 0x0a0: return NV_50;
+	case 0x0c0:
+	case 0x0d0: return NV_C0;
+	case 0x0e0:
+	case 0x0f0:
+	case 0x100: return NV_E0;
+	case 0x110:
+	case 0x120: return GM100;
+	case 0x130: return GP100;
+	case 0x140: return GV100;
+	case 0x160: return TU100;
+	default:
+		return 0;
+	}
+}
+
+int
+main(int argc, char **argv)
+{
+	static struct device dev = { .name = "nv_biosbench" };
+	struct nvkm_device device = {};
+	struct nvkm_subdev *subdev;
+	struct nvkm_bios *bios;
+	struct nvbios_index *index;
+	const char *dbg = "error";
+	char cfg[PATH_MAX + 16];
+	u32 chipset = 0, hidx, hraw;
+	s64 tidx, traw;
+	int loops = 1000, ret, c;
+	FILE *file;
+	u8 sig[2];
+
+	while ((c = getopt(argc, argv, "c:d:n:")) != -1) {
+		switch (c) {
+		case 'c': chipset = strtoul(optarg, NULL, 16); break;
+		case 'd': dbg = optarg; break;
+		case 'n': loops = strtol(optarg, NULL, 0); break;
+		default:
+			return 1;
+		}
+	}
+
+	if (optind >= argc || !chipset || loops <= 0) {
+		fprintf(stderr, "usage: %s -c <chipset> [-n loops] "
+				"[-d debug] <vbios.rom>\n", argv[0]);
+		return 1;
+	}
+
+	/* A missing or junk image would send shadowing off to probe for
+	 * one in hardware we don't have, check for a ROM signature here.
+	 */
+	if (!(file = fopen(argv[optind], "rb")) ||
+	    fread(sig, 1, 2, file) != 2 || sig[0] != 0x55 || sig[1] != 0xaa) {
+		fprintf(stderr, "%s: not a vbios image\n", argv[optind]);
+		return 1;
+	}
+	fclose(file);
+
+	snprintf(cfg, sizeof(cfg), "NvBios=%s", argv[optind]);
+	device.dev = &dev;
+	device.name = dev.name;
+	device.cfgopt = cfg;
+	device.dbgopt = dbg;
+	device.chipset = chipset;
+	device.card_type = card_type(chipset);
+
+	ret = nvkm_bios_new(&device, NVKM_SUBDEV_VBIOS, &bios);
+	if (ret) {
+		fprintf(stderr, "failed to load vbios: %d\n", ret);
+		return 1;
+	}
+
+	if (!(index = bios->index)) {
+		fprintf(stderr, "vbios index disabled\n");
+		return 1;
+	}
+
+	bios->index = NULL;
+	traw = bench(bios, loops, &hraw);
+	bios->index = index;
+	tidx = bench(bios, loops, &hidx);
+
+	printf("%d replays: parse %lldns/replay, index %lldns/replay (%lld.%02lldx)\n",
+	       loops, traw / loops, tidx / loops,
+	       tidx ? traw / tidx : 0, tidx ? (traw * 100 / tidx) % 100 : 0);
+	if (hraw != hidx) {
+		printf("index gave different answers: hash %08x, %08x without "
+		       "it\n", hidx, hraw);
+	} else {
+		printf("same answers either way, hash %08x\n", hidx);
+	}
+
+	subdev = &bios->subdev;
+	nvkm_subdev_del(&subdev);
+	return hraw == hidx ? 0 : 1;
+}
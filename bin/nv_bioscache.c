@@ -0,0 +1,287 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sim.h"
+
+#include <subdev/bios/priv.h>
+#include <subdev/pci/priv.h>
+
+/* Shadows a made-up VBIOS from simulated PROM, through NvBiosCache, and
+ * checks the image cache round-trips it:
+ *
+ * - the first run has to probe the ROM, and save what it found,
+ * - the next has to use the cache, which it can be told apart from the
+ *   ROM by a change made since outside the header of any image,
+ * - a cache that's been corrupted, or cut short, or that describes a ROM
+ *   laid out differently from the one there now, has to be ignored in
+ *   favour of the ROM,
+ * - a cache hit after an NvBios that didn't work out must not leak what
+ *   that attempt read (run under ASan/LSan to see).
+ *
+ * Then a second, larger, image is put where PRAMIN reads from, and the
+ * concurrent probe has to pick it over PROM every time, as the serial
+ * scan would, even though PROM finishes first.
+ *
+ * Each step below sets things up, shadows the VBIOS with the options
+ * given, and has to come back with the image named.  The last one is
+ * repeated as many times as asked, the concurrent probe being racy.
+ *
+ * Usage: nv_bioscache [parallel probes]
+ */
+
+#define SIM_PROM   0x300000
+#define SIM_PRAMIN 0x700000
+#define SIM_ROM    0x100000
+
+static struct nvkm_device device;
+static u8 *rom, *prev, *pram;
+static u32 pci_cfg[0x40];
+static const char *cache;
+
+static u32
+sim_pci_rd32(struct nvkm_pci *pci, u16 addr)
+{
+	return pci_cfg[addr / 4];
+}
+
+static void
+sim_pci_wr32(struct nvkm_pci *pci, u16 addr, u32 data)
+{
+	pci_cfg[addr / 4] = data;
+}
+
+static const struct nvkm_pci_func
+sim_pci_func = {
+	.rd32 = sim_pci_rd32,
+	.wr32 = sim_pci_wr32,
+};
+
+static struct nvkm_pci sim_pci = {
+	.func = &sim_pci_func,
+};
+
+static const struct nvkm_device_func
+sim_device = {
+};
+
+static const struct nvkm_subdev_func
+sim_bios = {
+};
+
+/* An image with a PCIR structure, and a valid checksum if it's x86. */
+static void
+sim_image(u8 *data, u32 base, u32 size, u8 type, bool last, u8 seed)
+{
+	u8 *image = data + base;
+	u8 sum = 0;
+	u32 i;
+
+	for (i = 0; i < size; i++)
+		image[i] = seed + i * 13 + (i >> 9);
+
+	memset(image, 0x00, 0x80);
+	image[0x00] = 0x55;
+	image[0x01] = 0xaa;
+	image[0x18] = 0x40;
+	memcpy(&image[0x40], "PCIR", 4);
+	image[0x4a] = 0x18;
+	image[0x50] = (size / 512) & 0xff;
+	image[0x51] = (size / 512) >> 8;
+	image[0x54] = type;
+	image[0x55] = last ? 0x80 : 0x00;
+
+	if (type == 0x00) {
+		for (i = 0; i < size - 1; i++)
+			sum += image[i];
+		image[size - 1] = -sum;
+	}
+}
+
+static void
+sim_rom(struct nvkm_device *device, u32 addr, const u8 *data)
+{
+	u32 i;
+
+	for (i = 0; i < SIM_ROM; i += 4)
+		nvkm_wr32(device, addr + i, *(const u32 *)&data[i]);
+}
+
+static int
+sim_shadow(struct nvkm_bios *bios, const char *cfg, const u8 *data)
+{
+	char opts[128];
+	int ret;
+
+	snprintf(opts, sizeof(opts), "%s%sNvBiosCache=%s", cfg,
+		 *cfg ? "," : "", cache);
+	device.cfgopt = opts;
+	ret = nvbios_shadow(bios);
+	device.cfgopt = "";
+
+	if (ret == 0 && (!bios->size || memcmp(bios->data, data, bios->size)))
+		ret = -EINVAL;
+
+	kfree(bios->data);
+	bios->data = NULL;
+	bios->size = 0;
+	return ret;
+}
+
+static void
+sim_cache(long offset, u8 flip, long size)
+{
+	FILE *file = fopen(cache, "r+b");
+	int c;
+
+	if (!file)
+		return;
+
+	if (offset >= 0 && !fseek(file, offset, SEEK_SET) &&
+	    (c = fgetc(file)) != EOF) {
+		fseek(file, offset, SEEK_SET);
+		fputc(c ^ flip, file);
+	}
+
+	fclose(file);
+	if (size >= 0)
+		truncate(cache, size);
+}
+
+/* x86 image, followed by an EFI one. */
+static void
+sim_flash(void)
+{
+	sim_image(rom, 0x00000, 0x10000, 0x00, false, 0x11);
+	sim_image(rom, 0x10000, 0x08000, 0x03, true, 0x22);
+	sim_rom(&device, SIM_PROM, rom);
+}
+
+/* Changed after the header, so only the ROM has it. */
+static void
+sim_change(void)
+{
+	memcpy(prev, rom, SIM_ROM);
+	rom[0x8000] += 1;
+	rom[0x8001] -= 1;
+	sim_rom(&device, SIM_PROM, rom);
+}
+
+static void
+sim_corrupt(void)
+{
+	sim_cache(0x100, 0x01, -1);
+}
+
+static void
+sim_truncate(void)
+{
+	sim_cache(-1, 0x00, 0x1000);
+}
+
+/* Reflashed with a new EFI image, the first 4KiB are the same. */
+static void
+sim_reflash(void)
+{
+	memset(rom + 0x10000, 0x00, SIM_ROM - 0x10000);
+	sim_image(rom, 0x10000, 0x06000, 0x03, true, 0x44);
+	sim_rom(&device, SIM_PROM, rom);
+}
+
+static void
+sim_uncache(void)
+{
+	unlink(cache);
+}
+
+/* PRAMIN comes first, and takes longer, but scores the same. */
+static void
+sim_pramin(void)
+{
+	unlink(cache);
+	sim_image(pram, 0x00000, 0xd0000, 0x00, false, 0x55);
+	sim_image(pram, 0xd0000, 0x08000, 0x03, true, 0x66);
+	sim_rom(&device, SIM_PRAMIN, pram);
+}
+
+static const struct {
+	const char *name;
+	void (*setup)(void);
+	const char *cfg;
+	u8 **expect;
+} sim_steps[] = {
+	{ "probe",     sim_flash,    "",                      &rom },
+	{ "cached",    sim_change,   "",                      &prev },
+	{ "nvbios",    NULL,         "NvBios=PRAMIN",         &prev },
+	{ "corrupt",   sim_corrupt,  "",                      &rom },
+	{ "recached",  NULL,         "",                      &rom },
+	{ "truncated", sim_truncate, "",                      &rom },
+	{ "reflashed", sim_reflash,  "",                      &rom },
+	{ "serial",    sim_pramin,   "",                      &pram },
+	{ "parallel",  sim_uncache,  "NvBiosProbeParallel=1", &pram },
+};
+
+int
+main(int argc, char **argv)
+{
+	struct nvkm_bios bios = {};
+	char name[] = "/tmp/nv_bioscacheXXXXXX";
+	int loops = argc > 1 ? strtol(argv[1], NULL, 0) : 10;
+	int errors = 0, ret, fd, i, j;
+
+	if (loops < 1) {
+		fprintf(stderr, "invalid probe count\n");
+		return 1;
+	}
+
+	if ((fd = mkstemp(name)) < 0) {
+		perror("mkstemp");
+		return 1;
+	}
+	close(fd);
+	unlink(name);
+	cache = name;
+
+	rom = calloc(1, SIM_ROM);
+	prev = calloc(1, SIM_ROM);
+	pram = calloc(1, SIM_ROM);
+	if (!rom || !prev || !pram)
+		return 1;
+
+	ret = sim_device_init(&device, "nv_bioscache", NULL, "fatal");
+	if (ret) {
+		fprintf(stderr, "failed to create device: %d\n", ret);
+		return 1;
+	}
+	device.func = &sim_device;
+	device.pci = &sim_pci;
+	nvkm_subdev_ctor(&sim_bios, &device, NVKM_SUBDEV_VBIOS, &bios.subdev);
+
+	for (i = 0; i < ARRAY_SIZE(sim_steps); i++) {
+		const bool last = i == ARRAY_SIZE(sim_steps) - 1;
+		int bad = 0;
+
+		for (j = 0; j < (last ? loops : 1); j++) {
+			if (sim_steps[i].setup)
+				sim_steps[i].setup();
+			if (sim_shadow(&bios, sim_steps[i].cfg,
+				       *sim_steps[i].expect))
+				bad++;
+		}
+
+		printf("%-9s %-21s %s", sim_steps[i].name, sim_steps[i].cfg,
+		       bad ? "wrong image" : "ok");
+		if (last)
+			printf(", %d of %d", j - bad, j);
+		printf("\n");
+		errors += bad;
+	}
+
+	unlink(cache);
+	sim_device_fini(&device);
+	free(pram);
+	free(prev);
+	free(rom);
+	return errors ? 1 : 0;
+}
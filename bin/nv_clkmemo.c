@@ -0,0 +1,264 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "sim.h"
+
+#include <core/event.h>
+#include <subdev/clk/priv.h>
+
+/* Bounces a simulated clock backend between its pstates at random, via
+ * nvkm_clk_astate(), the way the perfmon and thermal code do.  As on
+ * gf100/gk104, the backend's calc() depends on how the clock tree is set
+ * up when it runs, as well as on the target, so a memoised result is only
+ * right for the state it was computed from.
+ *
+ * Every prog() checks that what it's been given is what calc() would
+ * return for the hardware's current state, whether that came from calc()
+ * or the memo.  This is done without the memo hooks, as it used to be,
+ * with them, and with them and NvClkPrecalc=1.  calc() can be made to
+ * cost time, to stand in for the PLL search.
+ */
+
+#define SIM_CORE 0x137000
+#define SIM_PSTATES 4
+
+struct sim_calc {
+	u32 core;
+	u32 coef;
+};
+
+struct sim_clk {
+	struct nvkm_clk base;
+	struct sim_calc next;
+};
+
+static struct nvkm_pstate pstates[SIM_PSTATES];
+static unsigned long calc_ns;
+static u64 calcs, progs;
+static int errors;
+
+static int
+sim_read(struct nvkm_clk *clk, enum nv_clk_src src)
+{
+	switch (src) {
+	case nv_clk_src_core:
+		return nvkm_rd32(clk->subdev.device, SIM_CORE);
+	case nv_clk_src_mem:
+		return 405000;
+	default:
+		return -EINVAL;
+	}
+}
+
+/* Depends on where the PLL is now, like gf100's read_vco(). */
+static u32
+sim_coef(struct nvkm_clk *clk, u32 core)
+{
+	return core * 3 + nvkm_rd32(clk->subdev.device, SIM_CORE);
+}
+
+static int
+sim_calc(struct nvkm_clk *base, struct nvkm_cstate *cstate)
+{
+	struct sim_clk *clk = container_of(base, typeof(*clk), base);
+
+	clk->next.core = cstate->domain[nv_clk_src_core];
+	clk->next.coef = sim_coef(base, clk->next.core);
+	if (calc_ns)
+		ndelay(calc_ns);
+	calcs++;
+	return 0;
+}
+
+static int
+sim_prog(struct nvkm_clk *base)
+{
+	struct sim_clk *clk = container_of(base, typeof(*clk), base);
+	struct nvkm_device *device = base->subdev.device;
+
+	if (clk->next.coef != sim_coef(base, clk->next.core)) {
+		printf("%d -> %d kHz: coef %d, expected %d\n",
+		       nvkm_rd32(device, SIM_CORE), clk->next.core,
+		       clk->next.coef, sim_coef(base, clk->next.core));
+		errors++;
+	}
+
+	nvkm_wr32(device, SIM_CORE, clk->next.core);
+	progs++;
+	return 0;
+}
+
+static void
+sim_tidy(struct nvkm_clk *base)
+{
+}
+
+static void
+sim_calc_save(struct nvkm_clk *base, void *data)
+{
+	struct sim_clk *clk = container_of(base, typeof(*clk), base);
+	memcpy(data, &clk->next, sizeof(clk->next));
+}
+
+static void
+sim_calc_load(struct nvkm_clk *base, const void *data)
+{
+	struct sim_clk *clk = container_of(base, typeof(*clk), base);
+	memcpy(&clk->next, data, sizeof(clk->next));
+}
+
+#define SIM_DOMAINS                                                            \
+	.domains = {                                                           \
+		{ nv_clk_src_core, 0xff, 0, "core", 1000 },                    \
+		{ nv_clk_src_mem , 0xff, 0, "memory", 1000 },                  \
+		{ nv_clk_src_max }                                             \
+	}
+
+/* What every backend looked like before memoisation. */
+static const struct nvkm_clk_func
+sim_clk_plain = {
+	.read = sim_read,
+	.calc = sim_calc,
+	.prog = sim_prog,
+	.tidy = sim_tidy,
+	.pstates = pstates,
+	.nr_pstates = SIM_PSTATES,
+	SIM_DOMAINS
+};
+
+static const struct nvkm_clk_func
+sim_clk_memo = {
+	.read = sim_read,
+	.calc = sim_calc,
+	.prog = sim_prog,
+	.tidy = sim_tidy,
+	.calc_size = sizeof(struct sim_calc),
+	.calc_save = sim_calc_save,
+	.calc_load = sim_calc_load,
+	.pstates = pstates,
+	.nr_pstates = SIM_PSTATES,
+	SIM_DOMAINS
+};
+
+static int
+sim_event_ctor(struct nvkm_object *object, void *data, u32 size,
+	       struct nvkm_notify *notify)
+{
+	notify->size = 0;
+	notify->types = 1;
+	notify->index = 0;
+	return 0;
+}
+
+static const struct nvkm_event_func
+sim_event = {
+	.ctor = sim_event_ctor,
+};
+
+static const struct {
+	const char *name;
+	const struct nvkm_clk_func *func;
+	const char *cfg;
+} sim_runs[] = {
+	{ "plain", &sim_clk_plain, "NvClkMode=auto" },
+	{ "memo", &sim_clk_memo, "NvClkMode=auto" },
+	{ "precalc", &sim_clk_memo, "NvClkMode=auto,NvClkPrecalc=1" },
+};
+
+static int
+sim_run(struct nvkm_device *device, const struct nvkm_clk_func *func,
+	const char *name, int loops)
+{
+	struct sim_clk *clk;
+	struct nvkm_subdev *subdev;
+	unsigned int seed = 1;
+	s64 time;
+	int ret, i;
+
+	if (!(clk = kzalloc(sizeof(*clk), GFP_KERNEL)))
+		return -ENOMEM;
+
+	calcs = progs = 0;
+	for (i = 0; i < SIM_PSTATES; i++)
+		INIT_LIST_HEAD(&pstates[i].list);
+
+	ret = nvkm_clk_ctor(func, device, NVKM_SUBDEV_CLK, true, &clk->base);
+	if (ret == 0)
+		ret = nvkm_subdev_init(&clk->base.subdev);
+	if (ret) {
+		kfree(clk);
+		return ret;
+	}
+
+	time = ktime_to_ns(ktime_get());
+	for (i = 0; i < loops; i++) {
+		nvkm_clk_astate(&clk->base, rand_r(&seed) % SIM_PSTATES, 0,
+				true);
+	}
+	nvkm_subdev_fini(&clk->base.subdev, false);
+	time = ktime_to_ns(ktime_get()) - time;
+
+	printf("%-8s %8lld %8lld %8lld %8lld\n", name, progs, calcs,
+	       clk->base.memo.hit, time / 1000);
+
+	subdev = &clk->base.subdev;
+	nvkm_subdev_del(&subdev);
+	return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	struct nvkm_device device = {};
+	const char *dbg = "error";
+	int loops = 1000;
+	int ret, c, i;
+
+	while ((c = getopt(argc, argv, "c:d:n:")) != -1) {
+		switch (c) {
+		case 'c': calc_ns = strtol(optarg, NULL, 0); break;
+		case 'd': dbg = optarg; break;
+		case 'n': loops = strtol(optarg, NULL, 0); break;
+		default:
+			fprintf(stderr, "usage: %s [-n loops] [-c ns_per_calc] "
+					"[-d debug]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if (loops < 1) {
+		fprintf(stderr, "invalid loop count\n");
+		return 1;
+	}
+
+	for (i = 0; i < SIM_PSTATES; i++) {
+		pstates[i].pstate = 0x07 + i * 3;
+		pstates[i].base.domain[nv_clk_src_core] = 324000 + i * 216000;
+		pstates[i].base.domain[nv_clk_src_mem] = 405000;
+	}
+
+	ret = sim_device_init(&device, "nv_clkmemo", NULL, dbg);
+	if (ret == 0)
+		ret = nvkm_event_init(&sim_event, 1, 1, &device.event);
+	if (ret) {
+		fprintf(stderr, "failed to create device: %d\n", ret);
+		return 1;
+	}
+
+	printf("%-8s %8s %8s %8s %8s\n", "", "switches", "calcs", "hits", "us");
+	for (i = 0; i < ARRAY_SIZE(sim_runs); i++) {
+		device.cfgopt = sim_runs[i].cfg;
+		ret = sim_run(&device, sim_runs[i].func, sim_runs[i].name,
+			      loops);
+		if (ret) {
+			fprintf(stderr, "%s: failed to run clk: %d\n",
+				sim_runs[i].name, ret);
+			return 1;
+		}
+	}
+
+	nvkm_event_fini(&device.event);
+	sim_device_fini(&device);
+	return errors ? 1 : 0;
+}
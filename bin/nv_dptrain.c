@@ -0,0 +1,319 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sim.h"
+
+#include <core/event.h>
+#include <subdev/bios.h>
+#include <subdev/i2c/aux.h>
+#include <subdev/i2c/priv.h>
+#include <engine/disp/conn.h>
+#include <engine/disp/dp.h>
+#include <engine/disp/ior.h>
+
+/* Trains a DisplayPort link against a simulated sink, which asks for a
+ * particular voltage swing and pre-emphasis on every lane, and only
+ * reports its lanes as done once the source drives them that way.  The
+ * sink's wishes change along the way, as they would with a new cable or
+ * another monitor of the same model, and each step checks how the link
+ * got trained:
+ *
+ *   fast: the last good configuration was tried first, and worked,
+ *   fail: it was tried, failed, and a full search found a new one,
+ *   full: only the full search was done.
+ */
+
+enum sim_step {
+	TRAIN,	/* modeset, link retrained */
+	CABLE,	/* sink wants different drive, no HPD, then TRAIN */
+	REPLUG,	/* unplug, same model plugged back in, then TRAIN */
+	IRQ,	/* sink wants different drive and raises IRQ_HPD */
+};
+
+static const struct {
+	const char *name;
+	enum sim_step step;
+	u8 vs, pe;
+	u32 fast, fail, full;
+} sim_steps[] = {
+	{ "first modeset", TRAIN,  1, 0, 0, 0, 1 },
+	{ "modeset",       TRAIN,  1, 0, 1, 0, 0 },
+	{ "new cable",     CABLE,  2, 1, 0, 1, 1 },
+	{ "modeset",       TRAIN,  2, 1, 1, 0, 0 },
+	{ "replug",        REPLUG, 1, 1, 0, 0, 1 },
+	{ "modeset",       TRAIN,  1, 1, 1, 0, 0 },
+	{ "irq_hpd",       IRQ,    2, 0, 0, 0, 1 },
+	{ "modeset",       TRAIN,  2, 0, 1, 0, 0 },
+};
+
+static u8 dpcd[0x1000];
+static u8 want_vs, want_pe;
+static u32 hi, lo, rq;
+static int errors;
+
+/* Lane status and adjust requests follow from how each lane is driven. */
+static void
+sim_sink_status(void)
+{
+	const int nr = dpcd[0x101] & 0x1f;
+	bool align = nr > 0;
+	int i;
+
+	memset(&dpcd[0x202], 0x00, 6);
+	for (i = 0; i < 4; i++) {
+		const u8 conf = dpcd[0x103 + i];
+		const int shift = (i & 1) * 4;
+		u8 lane = 0;
+
+		if (i < nr && (conf & 0x03) >= want_vs) {
+			lane |= DPCD_LS02_LANE0_CR_DONE;
+			if (((conf & 0x18) >> 3) == want_pe) {
+				lane |= DPCD_LS02_LANE0_CHANNEL_EQ_DONE |
+					DPCD_LS02_LANE0_SYMBOL_LOCKED;
+			}
+		}
+
+		if (i < nr && !(lane & DPCD_LS02_LANE0_SYMBOL_LOCKED))
+			align = false;
+		dpcd[0x202 + (i >> 1)] |= lane << shift;
+		dpcd[0x206 + (i >> 1)] |= ((want_pe << 2) | want_vs) << shift;
+	}
+
+	if (align)
+		dpcd[0x204] |= DPCD_LS04_INTERLANE_ALIGN_DONE;
+}
+
+static int
+sim_xfer(struct nvkm_i2c_aux *aux, bool retry, u8 type, u32 addr,
+	 u8 *data, u8 *size)
+{
+	if (addr + *size > sizeof(dpcd))
+		return -EIO;
+
+	switch (type) {
+	case 9:
+		sim_sink_status();
+		memcpy(data, &dpcd[addr], *size);
+		return 0;
+	case 8:
+		memcpy(&dpcd[addr], data, *size);
+		return 0;
+	default:
+		return -EINVAL;
+	}
+}
+
+static const struct nvkm_i2c_aux_func
+sim_aux = {
+	.xfer = sim_xfer,
+};
+
+static const struct nvkm_i2c_pad_func
+sim_pad = {
+};
+
+static void
+sim_aux_stat(struct nvkm_i2c *i2c, u32 *phi, u32 *plo, u32 *prq, u32 *ptx)
+{
+	*phi = hi;
+	*plo = lo;
+	*prq = rq;
+	*ptx = 0;
+	hi = lo = rq = 0;
+}
+
+static void
+sim_aux_mask(struct nvkm_i2c *i2c, u32 type, u32 mask, u32 data)
+{
+}
+
+static const struct nvkm_i2c_func
+sim_i2c = {
+	.aux = 1,
+	.aux_stat = sim_aux_stat,
+	.aux_mask = sim_aux_mask,
+};
+
+static int
+sim_ior_links(struct nvkm_ior *ior, struct nvkm_i2c_aux *aux)
+{
+	return 0;
+}
+
+static void
+sim_ior_power(struct nvkm_ior *ior, int nr)
+{
+}
+
+static void
+sim_ior_pattern(struct nvkm_ior *ior, int pattern)
+{
+}
+
+static const struct nvkm_ior_func
+sim_ior = {
+	.dp = {
+		.links = sim_ior_links,
+		.power = sim_ior_power,
+		.pattern = sim_ior_pattern,
+	},
+};
+
+static const struct nvkm_subdev_func
+sim_subdev = {
+};
+
+/* Just enough of a VBIOS for nvkm_dp_new() to find the output's entry
+ * in a v4.0 DP table, with no scripts to run and no drive table.
+ */
+static u8 sim_rom[0x100] = {
+	[0x10 + 9] = 6,			/* BIT entry size */
+	[0x10 + 10] = 1,		/* BIT entries */
+	[0x1c] = 'd', 1, 2, 0, 0x40, 0,	/* 'd' v1, 2 bytes at 0x40 */
+	[0x40] = 0x50, 0,		/* DP table */
+	[0x50] = 0x40, 8, 2, 1,		/* version, header, size, count */
+	[0x58] = 0x60, 0,		/* output 0 */
+	[0x60] = 0x46, 0x00, 0xff, 0xff,/* type, mask */
+};
+
+static void
+sim_hpd(struct nvkm_i2c *i2c, struct nvkm_dp *dp, u32 *line)
+{
+	*line = dp->aux->intr;
+	nvkm_subdev_intr(&i2c->subdev);
+	flush_work(&dp->hpd.work);
+}
+
+int
+main(int argc, char **argv)
+{
+	struct nvkm_device device = { .chipset = 0xe4 };
+	struct dcb_output dcbE = {
+		.type = DCB_OUTPUT_DP,
+		.hasht = 0x0046,
+		.hashm = 0x0001,
+		.dpconf.link_nr = 4,
+		.dpconf.link_bw = 0x14,
+	};
+	const struct nvkm_event_func *func;
+	struct nvkm_conn conn = {};
+	struct nvkm_disp disp = {};
+	struct nvkm_bios bios = {};
+	struct nvkm_ior ior = {};
+	struct nvkm_i2c_aux *aux;
+	struct nvkm_i2c_pad *pad;
+	struct nvkm_subdev *subdev;
+	struct nvkm_outp *outp;
+	struct nvkm_i2c *i2c;
+	struct nvkm_dp *dp;
+	bool trained;
+	int ret, i;
+
+	ret = sim_device_init(&device, "nv_dptrain", NULL,
+			      argc > 1 ? argv[1] : "fatal");
+	if (ret) {
+		fprintf(stderr, "failed to create device: %d\n", ret);
+		return 1;
+	}
+
+	nvkm_subdev_ctor(&sim_subdev, &device, NVKM_SUBDEV_VBIOS, &bios.subdev);
+	bios.data = sim_rom;
+	bios.size = sizeof(sim_rom);
+	bios.bit_offset = 0x10;
+	device.bios = &bios;
+
+	ret = nvkm_i2c_new_(&sim_i2c, &device, NVKM_SUBDEV_I2C, &i2c);
+	if (ret == 0) {
+		/* No DCB, so no outputs to size the event by. */
+		func = i2c->event.func;
+		nvkm_event_fini(&i2c->event);
+		ret = nvkm_event_init(func, 4, 1, &i2c->event);
+	}
+	if (ret == 0)
+		ret = nvkm_i2c_pad_new_(&sim_pad, i2c, 0, &pad);
+	if (ret == 0)
+		ret = nvkm_i2c_aux_new_(&sim_aux, pad, 0, &aux);
+	if (ret == 0)
+		ret = nvkm_subdev_init(&i2c->subdev);
+	if (ret) {
+		fprintf(stderr, "failed to create aux: %d\n", ret);
+		return 1;
+	}
+	aux->intr = 0x00000001;
+	device.i2c = i2c;
+
+	nvkm_subdev_ctor(&sim_subdev, &device, NVKM_ENGINE_DISP,
+			 &disp.engine.subdev);
+	INIT_LIST_HEAD(&disp.head);
+	ior.func = &sim_ior;
+	ior.disp = &disp;
+	ior.type = SOR;
+	conn.info.type = DCB_CONNECTOR_DP;
+
+	/* A 4-lane HBR2 sink, with enhanced framing. */
+	dpcd[0x000] = 0x12;
+	dpcd[0x001] = 0x14;
+	dpcd[0x002] = 0x84;
+
+	ret = nvkm_dp_new(&disp, 0, &dcbE, &outp);
+	if (ret) {
+		fprintf(stderr, "failed to create dp: %d\n", ret);
+		return 1;
+	}
+	dp = nvkm_dp(outp);
+	outp->conn = &conn;
+	outp->ior = &ior;
+	outp->func->init(outp);
+
+	for (i = 0; i < ARRAY_SIZE(sim_steps); i++) {
+		const u32 fast = dp->lt.stats.fast;
+		const u32 fail = dp->lt.stats.fast_fail;
+		const u32 full = dp->lt.stats.full;
+
+		want_vs = sim_steps[i].vs;
+		want_pe = sim_steps[i].pe;
+
+		switch (sim_steps[i].step) {
+		case REPLUG:
+			sim_hpd(i2c, dp, &lo);
+			sim_hpd(i2c, dp, &hi);
+			/* fall-through */
+		case CABLE:
+		case TRAIN:
+			outp->func->release(outp);
+			ret = outp->func->acquire(outp);
+			break;
+		case IRQ:
+			sim_hpd(i2c, dp, &rq);
+			ret = 0;
+			break;
+		}
+
+		sim_sink_status();
+		trained = dpcd[0x204] & DPCD_LS04_INTERLANE_ALIGN_DONE;
+		printf("%-13s: vs %d pe %d, fast %u fail %u full %u, %s\n",
+		       sim_steps[i].name, want_vs, want_pe,
+		       dp->lt.stats.fast - fast, dp->lt.stats.fast_fail - fail,
+		       dp->lt.stats.full - full,
+		       trained ? "trained" : "not trained");
+
+		if (ret < 0 || !trained ||
+		    dp->lt.stats.fast - fast != sim_steps[i].fast ||
+		    dp->lt.stats.fast_fail - fail != sim_steps[i].fail ||
+		    dp->lt.stats.full - full != sim_steps[i].full) {
+			printf("%-13s: expected fast %u fail %u full %u\n",
+			       sim_steps[i].name, sim_steps[i].fast,
+			       sim_steps[i].fail, sim_steps[i].full);
+			errors++;
+		}
+	}
+
+	outp->func->fini(outp);
+	nvkm_outp_del(&outp);
+	nvkm_subdev_fini(&i2c->subdev, false);
+	subdev = &i2c->subdev;
+	nvkm_subdev_del(&subdev);
+	sim_device_fini(&device);
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,191 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sim.h"
+
+#include <engine/falcon.h>
+
+/* Times IMEM/DMEM uploads to a simulated PMU falcon, through the PIO
+ * ports and through the falcon's DMA engine, for a range of sizes.  The
+ * simulated DMA engine completes its queue as soon as its status is
+ * polled, and MMIO costs nothing, so the numbers show the CPU side of
+ * each path rather than what the hardware would do.
+ *
+ * After every DMA upload the staging buffer has to hold the payload, the
+ * last DMATRF command has to point at the last block, and the DMA base
+ * register has to be back to what it was before.  A timeout must not
+ * disable DMA, and the falcon's upload counters have to add up at the
+ * end.  The first problem found is printed, and stops the run.
+ *
+ * Usage: nv_falconload [loops]
+ */
+
+#define SIM_FALCON 0x10a000
+#define SIM_DMABASE 0x0000cafe
+
+static struct nvkm_falcon *falcon;
+
+static u64
+sim_dma_read(struct nvkm_timer *tmr)
+{
+	/* Anyone polling the DMA engine finds it idle, and done. */
+	nvkm_falcon_mask(falcon, 0x118, 0x00000003, 0x00000002);
+	return sim_timer_read(tmr);
+}
+
+static const struct nvkm_timer_func
+sim_dma_timer = {
+	.read = sim_dma_read,
+	.alarm_init = sim_timer_alarm_init,
+	.alarm_fini = sim_timer_alarm_fini,
+};
+
+static const struct nvkm_subdev_func
+sim_pmu = {
+};
+
+static int
+check(const u8 *data, u32 start, u32 size, u16 tag, bool imem)
+{
+	const u32 len = imem ? ALIGN(size, 0x100) : size & ~0xff;
+	u8 *temp;
+	int ret = 0;
+
+	if (nvkm_falcon_rd32(falcon, 0x110) != SIM_DMABASE) {
+		printf("DMA base %08x not restored\n",
+		       nvkm_falcon_rd32(falcon, 0x110));
+		return 1;
+	}
+
+	if (nvkm_falcon_rd32(falcon, 0x114) != start + len - 0x100 ||
+	    nvkm_falcon_rd32(falcon, 0x11c) !=
+	    (imem ? tag << 8 : 0) + len - 0x100) {
+		printf("last block at %08x/%08x, expected %08x\n",
+		       nvkm_falcon_rd32(falcon, 0x114),
+		       nvkm_falcon_rd32(falcon, 0x11c), start + len - 0x100);
+		return 1;
+	}
+
+	if (!(temp = malloc(len)))
+		return 1;
+
+	nvkm_kmap(falcon->dma.mem);
+	nvkm_memory_rd(falcon->dma.mem, 0, temp, len);
+	nvkm_done(falcon->dma.mem);
+	if (memcmp(temp, data, len)) {
+		printf("staging buffer doesn't match payload\n");
+		ret = 1;
+	}
+
+	free(temp);
+	return ret;
+}
+
+int
+main(int argc, char **argv)
+{
+	static const u32 sizes[] = { 0x400, 0x1000, 0x4000, 0x10000 };
+	struct nvkm_device device = {};
+	struct nvkm_subdev pmu = {};
+	int loops = argc > 1 ? strtol(argv[1], NULL, 0) : 100, errors = 0;
+	u32 dma = 0, pio = 0;
+	u8 *data;
+	int ret, i, j, k;
+
+	if (loops < 1) {
+		fprintf(stderr, "invalid loop count\n");
+		return 1;
+	}
+
+	if (!(data = malloc(0x10000)))
+		return 1;
+	for (i = 0; i < 0x10000; i++)
+		data[i] = i * 7 + (i >> 8);
+
+	/* The staging buffer lives in VRAM, as it would from NV50 on. */
+	sim_imem_target = NVKM_MEM_TARGET_VRAM;
+
+	ret = sim_device_init(&device, "nv_falconload", NULL, "error");
+	if (ret) {
+		fprintf(stderr, "failed to create device: %d\n", ret);
+		return 1;
+	}
+	device.timer->func = &sim_dma_timer;
+
+	/* 64KiB each of IMEM and DMEM. */
+	nvkm_wr32(&device, SIM_FALCON + 0x108, 0x00020100);
+	nvkm_wr32(&device, SIM_FALCON + 0x110, SIM_DMABASE);
+	nvkm_subdev_ctor(&sim_pmu, &device, NVKM_SUBDEV_PMU, &pmu);
+	ret = nvkm_falcon_v1_new(&pmu, "PMU", SIM_FALCON, &falcon);
+	if (ret) {
+		fprintf(stderr, "failed to create falcon: %d\n", ret);
+		return 1;
+	}
+
+	printf("%8s %-4s %12s %12s %12s %12s\n", "size", "",
+	       "IMEM(us)", "IMEM(MiB/s)", "DMEM(us)", "DMEM(MiB/s)");
+	for (i = 0; i < ARRAY_SIZE(sizes) && !errors; i++) {
+		for (j = 0; j < 2 && !errors; j++) {
+			const u32 size = sizes[i];
+			s64 time[2] = {};
+
+			for (k = 0; k < loops * 2 && !errors; k++) {
+				const bool imem = !(k & 1);
+				s64 t;
+
+				falcon->dma.enable = j;
+				t = ktime_to_ns(ktime_get());
+				if (imem)
+					nvkm_falcon_load_imem(falcon, data, 0,
+							      size, 0x10, 0,
+							      false);
+				else
+					nvkm_falcon_load_dmem(falcon, data, 0,
+							      size, 0);
+				time[!imem] += ktime_to_ns(ktime_get()) - t;
+
+				if (j && !falcon->dma.enable) {
+					printf("DMA disabled after timeout\n");
+					errors++;
+				} else
+				if (j) {
+					errors += check(data, 0, size, 0x10,
+							imem);
+				}
+			}
+
+			if (j)
+				dma += loops * 2;
+			else
+				pio += loops * 2;
+
+			if (errors)
+				break;
+
+			printf("%8d %-4s", size, j ? "DMA" : "PIO");
+			for (k = 0; k < 2; k++) {
+				printf(" %12lld %12lld",
+				       div64_s64(time[k], loops * 1000LL),
+				       div64_s64((s64)size * loops * 1000000000 /
+						 (1 << 20), max_t(s64, time[k], 1)));
+			}
+			printf("\n");
+		}
+	}
+
+	if (!errors) {
+		printf("%d DMA/%d PIO uploads counted", falcon->load.dma,
+		       falcon->load.pio);
+		if (falcon->load.dma != dma || falcon->load.pio != pio) {
+			printf(", expected %d/%d", dma, pio);
+			errors++;
+		}
+		printf("\n");
+	}
+
+	nvkm_falcon_del(&falcon);
+	sim_device_fini(&device);
+	free(data);
+	return errors ? 1 : 0;
+}
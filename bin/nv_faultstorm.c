@@ -0,0 +1,264 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sim.h"
+
+#include <core/notify.h>
+#include <engine/fifo/priv.h>
+#include <subdev/fault/priv.h>
+
+/* Floods a simulated GV100 replayable fault buffer with bursts of faults,
+ * most of them repeats of a handful of distinct ones, as happens when a
+ * channel faults on every access for a while.  Each burst is drained with
+ * the fault subdev's batched handler, and with a copy of the per-entry
+ * loop it replaced.  Faults passed to FIFO can be made to cost time, to
+ * stand in for channel recovery.
+ *
+ * Both drains have to leave GET == PUT, and every distinct fault in the
+ * burst has to reach FIFO.  The per-entry loop has to pass on every entry.
+ *
+ * By default, bursts made of 1, 4, 64, and as many distinct faults as
+ * there are entries are run in turn, one row each, as that's what decides
+ * how much the batched drain can merge.  -u runs just one of them.
+ */
+
+#define SIM_ENTRIES 1024
+#define SIM_ENTRY 32
+
+static unsigned long recover; /* ns per fault passed to FIFO */
+static u8 *seen; /* 1: in the burst, 2: reported too */
+static u64 calls;
+static int uniq;
+
+static void
+sim_fifo_fault(struct nvkm_fifo *fifo, struct nvkm_fault_data *info)
+{
+	if (info->addr >> 12 < uniq)
+		seen[info->addr >> 12] |= 2;
+	else
+		printf("unexpected fault %016llx\n", info->addr);
+	if (recover)
+		ndelay(recover);
+	calls++;
+}
+
+static const struct nvkm_fifo_func
+sim_fifo = {
+	.fault = sim_fifo_fault,
+};
+
+/* The loop gv100_fault_buffer_process() used to run. */
+static void
+old_process(struct nvkm_fault_buffer *buffer)
+{
+	struct nvkm_device *device = buffer->fault->subdev.device;
+	struct nvkm_memory *mem = buffer->mem;
+	u32 get = nvkm_rd32(device, buffer->get);
+	u32 put = nvkm_rd32(device, buffer->put);
+	if (put == get)
+		return;
+
+	nvkm_kmap(mem);
+	while (get != put) {
+		const u32   base = get * SIM_ENTRY;
+		const u32 instlo = nvkm_ro32(mem, base + 0x00);
+		const u32 insthi = nvkm_ro32(mem, base + 0x04);
+		const u32 addrlo = nvkm_ro32(mem, base + 0x08);
+		const u32 addrhi = nvkm_ro32(mem, base + 0x0c);
+		const u32 timelo = nvkm_ro32(mem, base + 0x10);
+		const u32 timehi = nvkm_ro32(mem, base + 0x14);
+		const u32  info0 = nvkm_ro32(mem, base + 0x18);
+		const u32  info1 = nvkm_ro32(mem, base + 0x1c);
+		struct nvkm_fault_data info;
+
+		if (++get == buffer->entries)
+			get = 0;
+		nvkm_wr32(device, buffer->get, get);
+
+		info.addr   = ((u64)addrhi << 32) | addrlo;
+		info.inst   = ((u64)insthi << 32) | instlo;
+		info.time   = ((u64)timehi << 32) | timelo;
+		info.engine = (info0 & 0x000000ff);
+		info.valid  = (info1 & 0x80000000) >> 31;
+		info.gpc    = (info1 & 0x1f000000) >> 24;
+		info.hub    = (info1 & 0x00100000) >> 20;
+		info.access = (info1 & 0x000f0000) >> 16;
+		info.client = (info1 & 0x00007f00) >> 8;
+		info.reason = (info1 & 0x0000001f);
+
+		nvkm_fifo_fault(device->fifo, &info);
+	}
+	nvkm_done(mem);
+}
+
+/* Write a burst of faults at PUT, the way the hardware would. */
+static void
+storm(struct nvkm_fault_buffer *buffer, int burst, unsigned int *seed,
+      u64 *time)
+{
+	struct nvkm_device *device = buffer->fault->subdev.device;
+	u32 put = nvkm_rd32(device, buffer->put);
+	u32 data[SIM_ENTRY / 4];
+	int i;
+
+	memset(seen, 0x00, uniq);
+	nvkm_kmap(buffer->mem);
+	for (i = 0; i < burst; i++) {
+		const u32 id = rand_r(seed) % uniq;
+
+		seen[id] = 1;
+		data[0] = 0x00100000; /* inst */
+		data[1] = 0x00000000;
+		data[2] = id << 12; /* addr */
+		data[3] = 0x00000000;
+		data[4] = lower_32_bits(*time);
+		data[5] = upper_32_bits(*time);
+		data[6] = 0x00000040; /* engine */
+		data[7] = 0x80000000 | (id & 3) << 16 | 0x00000102;
+		*time += 100;
+
+		nvkm_memory_wr(buffer->mem, put * SIM_ENTRY, data, SIM_ENTRY);
+		if (++put == buffer->entries)
+			put = 0;
+	}
+	nvkm_done(buffer->mem);
+	nvkm_wr32(device, buffer->put, put);
+}
+
+/* Everything in the burst should have been consumed and reported. */
+static int
+check(struct nvkm_fault_buffer *buffer, const char *name)
+{
+	struct nvkm_device *device = buffer->fault->subdev.device;
+	int i;
+
+	if (nvkm_rd32(device, buffer->get) != nvkm_rd32(device, buffer->put)) {
+		printf("%s: GET %08x != PUT %08x\n", name,
+		       nvkm_rd32(device, buffer->get),
+		       nvkm_rd32(device, buffer->put));
+		return 1;
+	}
+
+	for (i = 0; i < uniq; i++) {
+		if (seen[i] == 1) {
+			printf("%s: fault %d not reported\n", name, i);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static int
+sweep(struct nvkm_device *device, int burst, int loops)
+{
+	struct nvkm_fault_buffer *buffer = device->fault->buffer[0];
+	static unsigned int seed = 1;
+	static u64 stamp;
+	u64 ncalls[2] = {};
+	s64 time[2] = {};
+	int errors = 0, i, j;
+
+	if (!(seen = calloc(uniq, 1)))
+		return 1;
+
+	for (i = 0; i < loops && !errors; i++) {
+		for (j = 0; j < 2 && !errors; j++) {
+			s64 t;
+
+			storm(buffer, burst, &seed, &stamp);
+			calls = 0;
+			t = ktime_to_ns(ktime_get());
+			if (j)
+				device->fault->nrpfb.func(&device->fault->nrpfb);
+			else
+				old_process(buffer);
+			time[j] += ktime_to_ns(ktime_get()) - t;
+			ncalls[j] += calls;
+			errors += check(buffer, j ? "batched" : "per-entry");
+			if (!j && calls != burst) {
+				printf("per-entry: %lld of %d fault(s) reported\n",
+				       calls, burst);
+				errors++;
+			}
+		}
+	}
+
+	if (!errors) {
+		printf("%6d %10lld %10lld %10lld %10lld\n", uniq,
+		       div64_s64(time[0], (s64)burst * loops),
+		       div64_s64(time[1], (s64)burst * loops),
+		       div64_u64(ncalls[0], loops), div64_u64(ncalls[1], loops));
+	}
+
+	free(seen);
+	return errors;
+}
+
+int
+main(int argc, char **argv)
+{
+	struct nvkm_device device = {};
+	struct nvkm_fifo fifo = { .func = &sim_fifo };
+	struct nvkm_subdev *subdev;
+	const char *dbg = "error";
+	int loops = 1000, burst = 256, errors = 0, only = 0;
+	int ret, c, i;
+
+	while ((c = getopt(argc, argv, "b:d:n:r:u:")) != -1) {
+		switch (c) {
+		case 'b': burst = strtol(optarg, NULL, 0); break;
+		case 'd': dbg = optarg; break;
+		case 'n': loops = strtol(optarg, NULL, 0); break;
+		case 'r': recover = strtol(optarg, NULL, 0); break;
+		case 'u': only = strtol(optarg, NULL, 0); break;
+		default:
+			fprintf(stderr, "usage: %s [-b burst] [-u unique] "
+					"[-n loops] [-r ns_per_recovery] "
+					"[-d debug]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if (burst < 1 || burst >= SIM_ENTRIES || only < 0 || loops < 1) {
+		fprintf(stderr, "invalid burst/unique/loop count\n");
+		return 1;
+	}
+
+	ret = sim_device_init(&device, "nv_faultstorm", NULL, dbg);
+	if (ret == 0) {
+		device.fifo = &fifo;
+		nvkm_wr32(&device, 0x100e34, SIM_ENTRIES);
+		ret = gv100_fault_new(&device, NVKM_SUBDEV_FAULT,
+				      &device.fault);
+	}
+
+	if (ret == 0)
+		ret = nvkm_subdev_init(&device.fault->subdev);
+	if (ret) {
+		fprintf(stderr, "failed to create fault buffer: %d\n", ret);
+		return 1;
+	}
+
+	printf("%d burst(s) of %d fault(s), %lu ns per recovery\n", loops,
+	       burst, recover);
+	printf("%6s %21s %21s\n", "", "ns/fault", "FIFO calls/burst");
+	printf("%6s %10s %10s %10s %10s\n", "unique", "per-entry", "batched",
+	       "per-entry", "batched");
+	for (i = 0; i < 4 && !errors; i++) {
+		const int sizes[] = { 1, 4, 64, burst };
+
+		uniq = only ? only : sizes[i];
+		errors += sweep(&device, burst, loops);
+		if (only)
+			break;
+	}
+
+	subdev = &device.fault->subdev;
+	nvkm_subdev_fini(subdev, false);
+	nvkm_subdev_del(&subdev);
+	sim_device_fini(&device);
+	return errors ? 1 : 0;
+}
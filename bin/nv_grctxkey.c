@@ -0,0 +1,190 @@
+#include <dirent.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <nvif/os.h>
+
+#include <core/device.h>
+#include <engine/gr/ctxgf100.h>
+
+/* The golden context cache is only as good as its key.  Checks that the
+ * key follows what gf100's init packs write, and not where they live, and
+ * that it carries the generator's version.
+ *
+ * Then replaces a cache file with firmware_cache_write(), while a reader
+ * has the previous one open, and checks that the reader still sees the
+ * whole of the old file, the next one sees the new, and that nothing is
+ * left lying around in the cache's directory.
+ *
+ * Each check is reported as a TAP test point.
+ */
+
+static int tests, errors;
+
+static void
+sim_ok(bool ok, const char *fmt, ...)
+{
+	va_list args;
+
+	printf("%sok %d - ", ok ? "" : "not ", ++tests);
+	va_start(args, fmt);
+	vprintf(fmt, args);
+	va_end(args);
+	printf("\n");
+	if (!ok)
+		errors++;
+}
+
+static struct gf100_gr_init
+sim_init[] = {
+	{ 0x404004, 10, 0x04, 0x00000000 },
+	{ 0x404044,  1, 0x04, 0x00000000 },
+	{ 0x404094,  1, 0x04, 0x00000000 },
+	{}
+};
+
+static struct gf100_gr_init
+sim_copy[] = {
+	{ 0x404004, 10, 0x04, 0x00000000 },
+	{ 0x404044,  1, 0x04, 0x00000000 },
+	{ 0x404094,  1, 0x04, 0x00000000 },
+	{}
+};
+
+static const struct gf100_gr_pack
+sim_pack[] = {
+	{ sim_init },
+	{}
+};
+
+static const struct gf100_gr_pack
+sim_pack_copy[] = {
+	{ sim_copy },
+	{}
+};
+
+static struct gf100_grctx_func sim_grctx;
+static struct gf100_gr_func sim_gr;
+
+static void
+sim_key(struct gf100_gr *gr, const char *name,
+	const struct gf100_grctx_key *base, bool same)
+{
+	struct gf100_grctx_key key;
+
+	gf100_grctx_key(gr, &key);
+	sim_ok(!memcmp(&key, base, sizeof(key)) == same, "%s: key %s", name,
+	       same ? "unchanged" : "changed");
+}
+
+static void
+sim_file(const char *path, const char *name, int fd, const char *expect)
+{
+	char data[64] = {};
+	ssize_t size;
+
+	if (fd < 0)
+		fd = open(path, O_RDONLY);
+	size = pread(fd, data, sizeof(data) - 1, 0);
+	close(fd);
+
+	sim_ok(size == strlen(expect) && !strcmp(data, expect),
+	       "%s: reads \"%s\"", name, expect);
+	if (strcmp(data, expect))
+		printf("# read \"%s\"\n", data);
+}
+
+static void
+sim_cache(void)
+{
+	char dir[] = "/tmp/nv_grctxkey.XXXXXX", path[PATH_MAX];
+	const char *old = "old golden context image";
+	const char *new = "new one";
+	struct dirent *ent;
+	DIR *d;
+	int fd, left = 0;
+
+	if (!mkdtemp(dir)) {
+		sim_ok(false, "mkdtemp: %s", strerror(errno));
+		return;
+	}
+	snprintf(path, sizeof(path), "%s/grctx", dir);
+
+	sim_ok(!firmware_cache_write(path, old, strlen(old)), "write");
+	fd = open(path, O_RDONLY);
+	sim_ok(!firmware_cache_write(path, new, strlen(new)),
+	       "rewrite while open");
+	sim_file(path, "open before", fd, old);
+	sim_file(path, "open after", -1, new);
+
+	snprintf(path, sizeof(path), "%s/none/grctx", dir);
+	sim_ok(firmware_cache_write(path, new, strlen(new)) != 0,
+	       "no write into a missing directory");
+
+	if ((d = opendir(dir))) {
+		while ((ent = readdir(d))) {
+			if (ent->d_name[0] == '.')
+				continue;
+			snprintf(path, sizeof(path), "%s/%s", dir,
+				 ent->d_name);
+			if (strcmp(ent->d_name, "grctx")) {
+				printf("# left behind: %s\n", ent->d_name);
+				left++;
+			}
+			unlink(path);
+		}
+		closedir(d);
+	}
+	rmdir(dir);
+
+	sim_ok(d && !left, "nothing left behind");
+}
+
+int
+main(int argc, char **argv)
+{
+	struct nvkm_device device = { .chipset = 0xc0 };
+	struct gf100_grctx_key base;
+	struct gf100_gr gr = {};
+
+	sim_grctx = gf100_grctx;
+	sim_grctx.mthd = sim_pack;
+	sim_gr.grctx = &sim_grctx;
+	sim_gr.fecs.ucode = &gf100_gr_fecs_ucode;
+	sim_gr.gpccs.ucode = &gf100_gr_gpccs_ucode;
+	gr.func = &sim_gr;
+	gr.base.engine.subdev.device = &device;
+
+	gf100_grctx_key(&gr, &base);
+	sim_ok(base.version == GF100_GRCTX_VERSION, "key version %u",
+	       GF100_GRCTX_VERSION);
+	sim_key(&gr, "again", &base, true);
+
+	sim_grctx.mthd = sim_pack_copy;
+	sim_key(&gr, "copy", &base, true);
+
+	sim_copy[1].data = 0x00000001;
+	sim_key(&gr, "data", &base, false);
+	sim_copy[1].data = 0x00000000;
+
+	sim_copy[0].count = 9;
+	sim_key(&gr, "count", &base, false);
+	sim_copy[0].count = 10;
+
+	sim_grctx.icmd = gf119_grctx_pack_icmd;
+	sim_key(&gr, "icmd table", &base, false);
+	sim_grctx.icmd = gf100_grctx.icmd;
+
+	sim_gr.mmio = sim_pack;
+	sim_key(&gr, "mmio table", &base, false);
+	sim_gr.mmio = NULL;
+
+	sim_key(&gr, "restored", &base, true);
+
+	sim_cache();
+
+	printf("1..%d\n", tests);
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,131 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "sim.h"
+
+#include <engine/gr/gf100.h>
+#include <engine/gr/ctxgf100.h>
+
+/* Sizes up the static GR init tables, and times the register writes they
+ * expand to when a golden context is generated, against simulated MMIO.
+ *
+ * For each chipset, "entries" are the table entries the walkers iterate
+ * over, and "writes" the MMIO writes they turn into, context registers
+ * through gf100_gr_mmio(), bundles through gf100_gr_icmd(), and methods
+ * through gf100_gr_mthd().  Tables are shared between chipsets, so the
+ * space they take in the binary is only counted once, at the end.
+ *
+ * Usage: nv_grinit [passes]
+ */
+
+static const struct {
+	const char *name;
+	const struct gf100_grctx_func *grctx;
+} sim_chips[] = {
+	{ "gf100",  &gf100_grctx },
+	{ "gf108",  &gf108_grctx },
+	{ "gf119",  &gf119_grctx },
+	{ "gk104",  &gk104_grctx },
+	{ "gk110",  &gk110_grctx },
+	{ "gk110b", &gk110b_grctx },
+	{ "gk208",  &gk208_grctx },
+	{ "gm107",  &gm107_grctx },
+};
+
+static const struct gf100_gr_init *sim_seen[1024];
+static int sim_seen_nr;
+static u64 sim_bytes;
+
+static void
+sim_count(const struct gf100_gr_pack *p, u32 *entries, u32 *writes)
+{
+	const struct gf100_gr_pack *pack;
+	const struct gf100_gr_init *init;
+	int i;
+
+	for (pack = p; pack && pack->init; pack++) {
+		for (init = pack->init; init->count; init++) {
+			*entries += 1;
+			*writes += init->count;
+		}
+
+		for (i = 0; i < sim_seen_nr; i++) {
+			if (sim_seen[i] == pack->init)
+				break;
+		}
+
+		if (i == sim_seen_nr && i < ARRAY_SIZE(sim_seen)) {
+			sim_seen[sim_seen_nr++] = pack->init;
+			sim_bytes += (init - pack->init + 1) * sizeof(*init);
+		}
+	}
+}
+
+static void
+sim_init(struct gf100_gr *gr, const struct gf100_grctx_func *grctx)
+{
+	gf100_gr_mmio(gr, grctx->hub);
+	gf100_gr_mmio(gr, grctx->gpc_0);
+	gf100_gr_mmio(gr, grctx->gpc_1);
+	gf100_gr_mmio(gr, grctx->zcull);
+	gf100_gr_mmio(gr, grctx->tpc);
+	gf100_gr_mmio(gr, grctx->ppc);
+	gf100_gr_icmd(gr, grctx->icmd);
+	gf100_gr_mthd(gr, grctx->mthd);
+}
+
+static const struct nvkm_subdev_func
+sim_gr = {
+};
+
+int
+main(int argc, char **argv)
+{
+	struct nvkm_device device = {};
+	struct gf100_gr gr = {};
+	int passes = argc > 1 ? strtol(argv[1], NULL, 0) : 1000;
+	int ret, i, j;
+
+	if (passes < 1) {
+		fprintf(stderr, "invalid pass count\n");
+		return 1;
+	}
+
+	ret = sim_device_init(&device, "nv_grinit", NULL, "error");
+	if (ret) {
+		fprintf(stderr, "failed to create device: %d\n", ret);
+		return 1;
+	}
+	nvkm_subdev_ctor(&sim_gr, &device, NVKM_ENGINE_GR,
+			 &gr.base.engine.subdev);
+
+	printf("%-7s %8s %8s %10s\n", "", "entries", "writes", "ns/pass");
+	for (i = 0; i < ARRAY_SIZE(sim_chips); i++) {
+		const struct gf100_grctx_func *grctx = sim_chips[i].grctx;
+		u32 entries = 0, writes = 0;
+		s64 time;
+
+		sim_count(grctx->hub, &entries, &writes);
+		sim_count(grctx->gpc_0, &entries, &writes);
+		sim_count(grctx->gpc_1, &entries, &writes);
+		sim_count(grctx->zcull, &entries, &writes);
+		sim_count(grctx->tpc, &entries, &writes);
+		sim_count(grctx->ppc, &entries, &writes);
+		sim_count(grctx->icmd, &entries, &writes);
+		sim_count(grctx->mthd, &entries, &writes);
+
+		time = ktime_to_ns(ktime_get());
+		for (j = 0; j < passes; j++)
+			sim_init(&gr, grctx);
+		time = ktime_to_ns(ktime_get()) - time;
+
+		printf("%-7s %8u %8u %10lld\n", sim_chips[i].name, entries,
+		       writes, div64_s64(time, passes));
+	}
+
+	printf("%d tables, %llu bytes, %zu bytes per entry\n", sim_seen_nr,
+	       sim_bytes, sizeof(struct gf100_gr_init));
+
+	sim_device_fini(&device);
+	return 0;
+}
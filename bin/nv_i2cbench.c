@@ -0,0 +1,320 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <nvif/os.h>
+
+#include <core/device.h>
+#include <core/option.h>
+#include <subdev/i2c/bus.h>
+
+/* Runs the internal bit-banging i2c engine against a simulated SCL/SDA
+ * pair, with a 256-byte register file behind it, in place of a real GPU
+ * pad.  Useful for checking timing without needing hardware.
+ *
+ * With -p, reads from that many registers in turn, one after another, as
+ * when several sensors on a bus are polled.  As long as there aren't more
+ * of them than the bus keeps compiled programs for, the programs compiled
+ * during the first round have to be the ones still there at the end.
+ */
+
+struct sim {
+	struct nvkm_i2c_bus base;
+
+	u8 m_scl, m_sda;	/* driven by master */
+	u8 s_sda;		/* driven by slave */
+	int stretch;		/* SCL reads held low after each raise */
+	int held;
+
+	enum {
+		IDLE,
+		ADDR,
+		WRITE,
+		SACK,
+		READ,
+		MACK,
+	} state;
+	u8 addr;
+	u8 shift;
+	int bits;
+	bool rd, ptr, nack;
+	u8 reg;
+	u8 mem[256];
+
+	u64 drives, senses;
+};
+
+#define sim(p) container_of((p), struct sim, base)
+
+static void
+sim_load(struct sim *sim)
+{
+	sim->state = READ;
+	sim->shift = sim->mem[sim->reg++];
+	sim->bits = 0;
+	sim->s_sda = !!(sim->shift & 0x80);
+}
+
+static void
+sim_update(struct sim *sim, u8 scl, u8 sda)
+{
+	u8 o_scl = sim->m_scl, o_sda = sim->m_sda & sim->s_sda;
+
+	sim->m_scl = scl;
+	sim->m_sda = sda;
+	sda = sim->m_sda & sim->s_sda;
+
+	if (o_scl && scl && o_sda != sda) {
+		if (!sda) {
+			sim->state = ADDR;
+			sim->shift = 0;
+			sim->bits = 0;
+		} else {
+			sim->state = IDLE;
+		}
+		sim->s_sda = 1;
+		return;
+	}
+
+	if (!o_scl && scl) {
+		switch (sim->state) {
+		case ADDR:
+		case WRITE:
+			sim->shift = (sim->shift << 1) | sda;
+			sim->bits++;
+			break;
+		case MACK:
+			sim->nack = sda;
+			break;
+		default:
+			break;
+		}
+		return;
+	}
+
+	if (o_scl && !scl) {
+		switch (sim->state) {
+		case ADDR:
+			if (sim->bits < 8)
+				break;
+			if ((sim->shift >> 1) != sim->addr) {
+				sim->state = IDLE;
+				break;
+			}
+			sim->rd = sim->shift & 1;
+			sim->ptr = !sim->rd;
+			sim->state = SACK;
+			sim->s_sda = 0;
+			break;
+		case WRITE:
+			if (sim->bits < 8)
+				break;
+			if (sim->ptr)
+				sim->reg = sim->shift;
+			else
+				sim->mem[sim->reg++] = sim->shift;
+			sim->ptr = false;
+			sim->state = SACK;
+			sim->s_sda = 0;
+			break;
+		case SACK:
+			sim->s_sda = 1;
+			if (sim->rd) {
+				sim_load(sim);
+			} else {
+				sim->state = WRITE;
+				sim->shift = 0;
+				sim->bits = 0;
+			}
+			break;
+		case READ:
+			if (++sim->bits < 8) {
+				sim->s_sda = !!(sim->shift & (0x80 >> sim->bits));
+			} else {
+				sim->s_sda = 1;
+				sim->state = MACK;
+			}
+			break;
+		case MACK:
+			if (sim->nack)
+				sim->state = IDLE;
+			else
+				sim_load(sim);
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+static void
+sim_drive_scl(struct nvkm_i2c_bus *bus, int state)
+{
+	struct sim *sim = sim(bus);
+	sim->drives++;
+	sim->held = state ? sim->stretch : 0;
+	sim_update(sim, !!state, sim->m_sda);
+}
+
+static void
+sim_drive_sda(struct nvkm_i2c_bus *bus, int state)
+{
+	struct sim *sim = sim(bus);
+	sim->drives++;
+	sim_update(sim, sim->m_scl, !!state);
+}
+
+static int
+sim_sense_scl(struct nvkm_i2c_bus *bus)
+{
+	struct sim *sim = sim(bus);
+	sim->senses++;
+	if (sim->held) {
+		sim->held--;
+		return 0;
+	}
+	return sim->m_scl;
+}
+
+static int
+sim_sense_sda(struct nvkm_i2c_bus *bus)
+{
+	struct sim *sim = sim(bus);
+	sim->senses++;
+	return sim->m_sda & sim->s_sda;
+}
+
+static const struct nvkm_i2c_bus_func
+sim_func = {
+	.drive_scl = sim_drive_scl,
+	.drive_sda = sim_drive_sda,
+	.sense_scl = sim_sense_scl,
+	.sense_sda = sim_sense_sda,
+	.xfer = nvkm_i2c_bit_xfer,
+};
+
+int
+main(int argc, char **argv)
+{
+	static struct device dev = { .name = "nv_i2cbench" };
+	struct nvkm_device device = {};
+	struct nvkm_i2c i2c = {};
+	struct nvkm_i2c_pad pad = {};
+	struct sim sim = { .m_scl = 1, .m_sda = 1, .s_sda = 1, .addr = 0x50 };
+	struct nvkm_i2c_bus *bus = &sim.base;
+	const char *dbg = "error";
+	struct nvkm_i2c_bit *bit[ARRAY_SIZE(bus->bit)] = {};
+	int loops = 100, len = 2, polls = 1, ret, c, i, j, k;
+	u8 reg = 0x00, addr = 0x50, out[256], poll;
+	s64 time;
+
+	while ((c = getopt(argc, argv, "a:d:l:n:p:r:s:")) != -1) {
+		switch (c) {
+		case 'a': addr = strtol(optarg, NULL, 0); break;
+		case 'd': dbg = optarg; break;
+		case 'l': len = strtol(optarg, NULL, 0); break;
+		case 'n': loops = strtol(optarg, NULL, 0); break;
+		case 'p': polls = strtol(optarg, NULL, 0); break;
+		case 'r': reg = strtol(optarg, NULL, 0); break;
+		case 's': sim.stretch = strtol(optarg, NULL, 0); break;
+		default:
+			fprintf(stderr, "usage: %s [-a addr] [-r reg] [-l len] "
+					"[-n loops] [-p polls] [-s stretch] "
+					"[-d debug]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+
+	if (len < 1 || len > 256 || loops < 1 || polls < 1 || polls > 256) {
+		fprintf(stderr, "invalid length/loop/poll count\n");
+		return 1;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(sim.mem); i++)
+		sim.mem[i] = i * 0x1d + 0x5a;
+
+	device.dev = &dev;
+	device.name = dev.name;
+	device.cfgopt = "";
+	device.dbgopt = dbg;
+	i2c.subdev.device = &device;
+	i2c.subdev.index = NVKM_SUBDEV_I2C;
+	i2c.subdev.debug = nvkm_dbgopt(dbg, "I2C");
+	INIT_LIST_HEAD(&i2c.pad);
+	INIT_LIST_HEAD(&i2c.bus);
+	INIT_LIST_HEAD(&i2c.aux);
+	pad.i2c = &i2c;
+	pad.mode = NVKM_I2C_PAD_I2C;
+	mutex_init(&pad.mutex);
+
+	ret = nvkm_i2c_bus_ctor(&sim_func, &pad, 0, bus);
+	if (ret)
+		return 1;
+	nvkm_i2c_bus_init(bus);
+
+	time = ktime_to_ns(ktime_get());
+	for (i = 0; i < loops; i++) {
+		struct i2c_msg msgs[] = {
+			{ .addr = addr, .flags = 0, .len = 1, .buf = &poll },
+			{ .addr = addr, .flags = I2C_M_RD, .len = len, .buf = out },
+		};
+
+		poll = reg + (i % polls) * len;
+		ret = nvkm_i2c_bus_acquire(bus);
+		if (ret == 0) {
+			ret = bus->func->xfer(bus, msgs, ARRAY_SIZE(msgs));
+			nvkm_i2c_bus_release(bus);
+		}
+
+		if (ret != ARRAY_SIZE(msgs)) {
+			printf("xfer %d failed: %d\n", i, ret);
+			break;
+		}
+
+		for (j = 0; j < len; j++) {
+			if (out[j] != sim.mem[(u8)(poll + j)]) {
+				printf("xfer %d: byte %d read %02x, expected %02x\n",
+				       i, j, out[j], sim.mem[(u8)(poll + j)]);
+				ret = -EIO;
+				break;
+			}
+		}
+
+		if (ret < 0)
+			break;
+
+		if (i == polls - 1)
+			memcpy(bit, bus->bit, sizeof(bit));
+	}
+	time = ktime_to_ns(ktime_get()) - time;
+
+	if (ret >= 0 && i >= polls && polls <= ARRAY_SIZE(bus->bit)) {
+		for (j = 0; j < polls; j++) {
+			for (k = 0; k < polls; k++) {
+				if (bus->bit[k] == bit[j])
+					break;
+			}
+
+			if (k == polls) {
+				printf("program %d of %d recompiled\n", j, polls);
+				ret = -EINVAL;
+			}
+		}
+	}
+
+	if (i) {
+		/* 9 clocks per byte at T_RISEFALL + 2 * T_HOLD each, two
+		 * starts at 2 * T_HOLD and a stop at T_RISEFALL + 2 * T_HOLD.
+		 */
+		int bytes = 1 + 1 + 1 + len;
+		printf("%d xfers of %d bytes from %d register(s): %lldus/xfer (protocol minimum "
+		       "%dus), %llu drives, %llu senses per xfer\n",
+		       i, len, polls, time / i / 1000, bytes * 9 * 11 + 2 * 10 + 11,
+		       sim.drives / i, sim.senses / i);
+	}
+
+	nvkm_i2c_bus_fini(bus);
+	nvkm_i2c_bit_fini(bus);
+	return ret < 0 ? 1 : 0;
+}
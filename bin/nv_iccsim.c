@@ -0,0 +1,323 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "sim.h"
+
+#include <subdev/iccsense/priv.h>
+
+/* Drives the iccsense sampling code against simulated INA3221 sensors
+ * hanging off two i2c adapters, each transfer taking as long as it would
+ * on a 100KHz bus.  Compares the old per-rail reads, one batched sample
+ * per query, and queries served from the sample cache, and checks that
+ * they all agree with the power the simulated sensors should report.
+ *
+ * A bus that fails for a moment has to fail that query only: the next one
+ * has to read the sensors again, however long samples are kept for.  By
+ * default, nothing's kept, each query reads the sensors as it always did.
+ *
+ * Then samples in the background, with the timer's alarms run by hand,
+ * and checks that fini leaves neither the alarm armed nor the work queued,
+ * and that nothing's sampled after.  A work queued by an alarm that went
+ * off while fini was disarming it has to be cancelled by the dtor.
+ *
+ * Each of these is a phase below, which prints what it saw.  The phases
+ * that didn't go as they should are listed at the end.
+ */
+
+#define SIM_SENSORS 2
+#define SIM_RAILS 3
+
+struct sim {
+	struct i2c_adapter adap;
+	u8 addr[SIM_SENSORS];
+	u8 ptr[SIM_SENSORS];
+	u16 regs[SIM_SENSORS][8];
+	u64 xfers;
+	u64 bytes;
+	bool fail;		/* NAK everything */
+};
+
+static int
+sim_xfer(struct i2c_adapter *adap, struct i2c_msg *msgs, int num)
+{
+	struct sim *sim = container_of(adap, struct sim, adap);
+	int bytes = 0, i, j, s;
+
+	if (sim->fail)
+		return -ENXIO;
+
+	for (i = 0; i < num; i++) {
+		struct i2c_msg *msg = &msgs[i];
+
+		for (s = 0; s < SIM_SENSORS; s++) {
+			if (sim->addr[s] == msg->addr)
+				break;
+		}
+
+		if (s == SIM_SENSORS)
+			return -ENXIO;
+
+		if (msg->flags & I2C_M_RD) {
+			u16 data = sim->regs[s][sim->ptr[s] & 7];
+			for (j = 0; j < msg->len; j++)
+				msg->buf[j] = j ? data : data >> 8;
+		} else {
+			sim->ptr[s] = msg->buf[0];
+		}
+
+		bytes += 1 + msg->len;
+	}
+
+	/* 9 clocks per byte at 100KHz, plus start/stop. */
+	udelay(bytes * 90 + 10);
+	sim->xfers++;
+	sim->bytes += bytes;
+	return num;
+}
+
+static const struct i2c_algorithm
+sim_algo = {
+	.master_xfer = sim_xfer,
+};
+
+static s64
+bench(struct nvkm_iccsense *iccsense, int loops, bool sync, int *power)
+{
+	s64 time = ktime_to_ns(ktime_get());
+	int i;
+
+	for (i = 0; i < loops; i++) {
+		if (sync) {
+			struct nvkm_iccsense_rail *rail;
+			*power = 0;
+			list_for_each_entry(rail, &iccsense->rails, head) {
+				int ret = rail->read(iccsense, rail);
+				if (ret < 0) {
+					*power = ret;
+					break;
+				}
+				*power += ret;
+			}
+		} else {
+			*power = nvkm_iccsense_read_all(iccsense);
+		}
+
+		if (*power < 0)
+			break;
+
+		/* Consumers asking every millisecond or so. */
+		usleep(1000);
+	}
+
+	return (ktime_to_ns(ktime_get()) - time) / loops;
+}
+
+static struct nvkm_device device;
+static struct nvkm_iccsense *iccsense;
+static struct sim sim[2];
+static int loops = 100, stale = 20, expect;
+
+static bool
+sim_modes(void)
+{
+	struct nvkm_iccsense_sample hist[NVKM_ICCSENSE_HISTORY];
+	const char *name[] = { "per-rail", "batched", "cached" };
+	int power[3], ret, i;
+	bool ok = true;
+	s64 time;
+	u64 xfers;
+
+	printf("%d rails on %d buses, %d queries, expected power %duW\n",
+	       (int)ARRAY_SIZE(sim) * SIM_SENSORS * SIM_RAILS,
+	       (int)ARRAY_SIZE(sim), loops, expect);
+
+	if (iccsense->sample.stale) {
+		printf("default staleness %dms, expected 0ms\n",
+		       iccsense->sample.stale);
+		ok = false;
+	}
+
+	for (i = 0; i < 3; i++) {
+		u64 before = sim[0].xfers + sim[1].xfers;
+
+		iccsense->sample.stale = i == 2 ? stale : 0;
+		iccsense->sample.count = 0;
+		iccsense->sample.hits = 0;
+		iccsense->sample.misses = 0;
+		time = bench(iccsense, loops, i == 0, &power[i]);
+		xfers = sim[0].xfers + sim[1].xfers - before;
+
+		printf("%-9s %6lldus/query %5llu xfers, %duW", name[i],
+		       time / 1000, xfers, power[i]);
+		if (i == 2) {
+			printf(" (stale %dms, %llu hits, %llu misses)", stale,
+			       iccsense->sample.hits, iccsense->sample.misses);
+		}
+		printf("\n");
+		ok &= power[i] == expect;
+	}
+
+	ret = nvkm_iccsense_history(iccsense, hist, ARRAY_SIZE(hist));
+	for (i = 0; i < ret; i++) {
+		printf("history %2d: %lldus ago, %duW\n", i,
+		       (ktime_to_ns(ktime_get()) - hist[i].time) / 1000,
+		       hist[i].power);
+	}
+
+	return ok;
+}
+
+static bool
+sim_bus_error(void)
+{
+	u32 count = iccsense->sample.count = 0;
+	int err, power;
+
+	iccsense->sample.stale = 1000;
+	sim[1].fail = true;
+	err = nvkm_iccsense_read_all(iccsense);
+	sim[1].fail = false;
+	power = nvkm_iccsense_read_all(iccsense);
+	printf("bus error: %d, then %duW, %u sample(s) kept\n", err, power,
+	       iccsense->sample.count - count);
+	return err < 0 && power == expect &&
+	       iccsense->sample.count == count + 1;
+}
+
+static bool
+sim_periodic(void)
+{
+	bool ok;
+	u32 count;
+	int i;
+
+	/* The sensors are already set up, there's no VBIOS to parse. */
+	iccsense->subdev.oneinit = true;
+	iccsense->sample.period = 1;
+	nvkm_subdev_init(&iccsense->subdev);
+	for (i = 0; i < loops; i++) {
+		nvkm_timer_alarm_trigger(device.timer);
+		usleep(1000);
+	}
+	nvkm_subdev_fini(&iccsense->subdev, false);
+
+	count = iccsense->sample.count;
+	printf("periodic: %u samples, alarm %s, work %s", count,
+	       list_empty(&iccsense->sample.alarm.head) ? "idle" : "armed",
+	       iccsense->sample.work.nvos ? "queued" : "idle");
+	ok = list_empty(&iccsense->sample.alarm.head) &&
+	     !iccsense->sample.work.nvos && count;
+
+	nvkm_timer_alarm_trigger(device.timer);
+	usleep(10000);
+	printf(", %u after fini\n", iccsense->sample.count - count);
+	return ok && iccsense->sample.count == count;
+}
+
+/* As an alarm that went off while fini was disarming it would, then what
+ * nvkm_subdev_del() does, with a look before it's all freed.
+ */
+static bool
+sim_dtor(void)
+{
+	struct nvkm_subdev *subdev;
+	bool ok = true;
+
+	schedule_work(&iccsense->sample.work);
+	subdev = iccsense->subdev.func->dtor(&iccsense->subdev);
+	printf("dtor: work %s\n", iccsense->sample.work.nvos ?
+	       "still queued" : "cancelled");
+	if (iccsense->sample.work.nvos) {
+		flush_work(&iccsense->sample.work);
+		ok = false;
+	}
+	kfree(subdev);
+	iccsense = NULL;
+	return ok;
+}
+
+static const struct {
+	const char *name;
+	bool (*run)(void);
+} sim_phases[] = {
+	{ "modes", sim_modes },
+	{ "bus error", sim_bus_error },
+	{ "periodic", sim_periodic },
+	{ "dtor", sim_dtor },
+};
+
+int
+main(int argc, char **argv)
+{
+	const char *dbg = "error";
+	int failed = 0, ret, c, b, s, r, i;
+
+	while ((c = getopt(argc, argv, "d:n:s:")) != -1) {
+		switch (c) {
+		case 'd': dbg = optarg; break;
+		case 'n': loops = strtol(optarg, NULL, 0); break;
+		case 's': stale = strtol(optarg, NULL, 0); break;
+		default:
+			fprintf(stderr, "usage: %s [-n loops] [-s stale_ms] "
+					"[-d debug]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if (loops < 1 || stale < 0) {
+		fprintf(stderr, "invalid loop count/staleness\n");
+		return 1;
+	}
+
+	ret = sim_device_init(&device, "nv_iccsim", NULL, dbg);
+	if (ret == 0)
+		ret = nvkm_iccsense_new_(&device, NVKM_SUBDEV_ICCSENSE, &iccsense);
+	if (ret)
+		return 1;
+
+	for (b = 0; b < ARRAY_SIZE(sim); b++) {
+		sim[b].adap.algo = &sim_algo;
+		for (s = 0; s < SIM_SENSORS; s++) {
+			struct nvkm_iccsense_sensor *sensor;
+
+			if (!(sensor = kzalloc(sizeof(*sensor), GFP_KERNEL)))
+				return 1;
+			sensor->id = b * SIM_SENSORS + s;
+			sensor->type = NVBIOS_EXTDEV_INA3221;
+			sensor->i2c = &sim[b].adap;
+			sensor->addr = sim[b].addr[s] = 0x40 + s;
+			list_add_tail(&sensor->head, &iccsense->sensors);
+
+			for (r = 0; r < SIM_RAILS; r++) {
+				struct nvkm_iccsense_rail *rail;
+				u16 vshunt = (0x100 + sensor->id * 0x40 + r * 8) << 3;
+				u16 vbus = (0x5dc + r * 0x10) << 3;
+
+				if (!(rail = kzalloc(sizeof(*rail), GFP_KERNEL)))
+					return 1;
+				rail->sensor = sensor;
+				rail->idx = r;
+				rail->mohm = 5;
+				nvkm_iccsense_rail_type(rail, sensor->type);
+				list_add_tail(&rail->head, &iccsense->rails);
+
+				sim[b].regs[s][rail->shunt_reg] = vshunt;
+				sim[b].regs[s][rail->bus_reg] = vbus;
+				expect += (vbus >> 3) * (vshunt >> 3) * 320 / 5;
+			}
+		}
+	}
+
+	for (i = 0; i < ARRAY_SIZE(sim_phases); i++) {
+		if (!sim_phases[i].run()) {
+			printf("%s %s", failed++ ? "," : "failed:",
+			       sim_phases[i].name);
+		}
+	}
+	if (failed)
+		printf("\n");
+
+	sim_device_fini(&device);
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,609 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sim.h"
+
+#include <subdev/bios/priv.h>
+#include <subdev/bios/init.h>
+#include <subdev/devinit/priv.h>
+
+/* Generates VBIOS images full of random init scripts, and runs them on a
+ * simulated pre-NV50 and NV50 board, once with the interpreter alone, and
+ * then with decoded scripts, and with decoded scripts in NvBiosInitCheck
+ * mode.  Each of these starts from the same register state, runs every
+ * script through nvbios_post(), and then again for a few heads/ORs/links
+ * and with execution off, twice over so the second pass finds every block
+ * already decoded.  The registers, VGA ports, and each run's result, exec
+ * state and head, have to come out the same every time, and the check
+ * mode has to pass every script.
+ *
+ * The scripts mix everything the decoder handles with some of what it
+ * leaves to the interpreter: control flow (REPEAT, SUB_DIRECT, JUMP), and
+ * opcodes that read registers to compute what they write.  Condition and
+ * macro tables are filled in, with conditions on registers the scripts
+ * write, so they come out both ways.
+ *
+ * Last, a script is changed after it's been decoded, which the check mode
+ * has to catch, and stop using decoded scripts.
+ *
+ * The first difference stops the run, and gives the seed of the image it
+ * was found in.
+ *
+ * Usage: nv_initx [-s seed] [-n images] [-d debug]
+ */
+
+#define SIM_BIOS    0x10000
+#define SIM_BIT     0x00100
+#define SIM_INIT    0x00200
+#define SIM_SCRIPTS 0x00220
+#define SIM_MACROS  0x00240
+#define SIM_CONDS   0x00300
+#define SIM_IOCONDS 0x00400
+#define SIM_CODE    0x01000
+
+#define SIM_SUBS  6
+#define SIM_MAINS 6
+#define SIM_RUNS  (1 + SIM_MAINS * 4)
+#define SIM_TOP   (SIM_MAINS * 5) /* nvbios_post() runs each too */
+
+struct sim_gen {
+	u8 *data;
+	u32 pos;
+	unsigned int seed;
+	bool nv50;
+	u16 sub[SIM_SUBS];
+	int subs;
+};
+
+struct sim_result {
+	int ret;
+	u8 execute;
+	int head;
+};
+
+static const u32 sim_regs[] = {
+	0x000200, 0x00e100, 0x00e104, 0x00e108, 0x00e10c, 0x100000, 0x101000,
+	0x614100,
+};
+
+/* Only meaningful from NV50, where they select a head, OR and link. */
+static const u32 sim_regs_nv50[] = {
+	0x80610000, 0x40614000, 0x60614000,
+};
+
+static const u8 sim_crtc[] = { 0x10, 0x11, 0x12, 0x44 };
+
+static const struct nvkm_devinit_func
+sim_devinit_func = {
+};
+
+static struct nvkm_devinit sim_devinit = {
+	.func = &sim_devinit_func,
+};
+
+static const struct nvkm_subdev_func
+sim_bios = {
+};
+
+static u8 *mmio_init, *mmio_interp;
+static int errors;
+
+static u32
+sim_rand(struct sim_gen *gen, u32 max)
+{
+	return rand_r(&gen->seed) % max;
+}
+
+static void
+sim_wr08(struct sim_gen *gen, u8 data)
+{
+	gen->data[gen->pos++] = data;
+}
+
+static void
+sim_wr16(struct sim_gen *gen, u16 data)
+{
+	sim_wr08(gen, data);
+	sim_wr08(gen, data >> 8);
+}
+
+static void
+sim_wr32(struct sim_gen *gen, u32 data)
+{
+	sim_wr16(gen, data);
+	sim_wr16(gen, data >> 16);
+}
+
+static u32
+sim_reg(struct sim_gen *gen)
+{
+	if (gen->nv50 && !sim_rand(gen, 4))
+		return sim_regs_nv50[sim_rand(gen, ARRAY_SIZE(sim_regs_nv50))];
+	return sim_regs[sim_rand(gen, ARRAY_SIZE(sim_regs))];
+}
+
+static u32
+sim_val(struct sim_gen *gen)
+{
+	/* Mostly small, so conditions on them go both ways. */
+	if (sim_rand(gen, 2))
+		return sim_rand(gen, 4);
+	return rand_r(&gen->seed);
+}
+
+static u8
+sim_cr(struct sim_gen *gen, u8 *index)
+{
+	*index = sim_crtc[sim_rand(gen, ARRAY_SIZE(sim_crtc))];
+	if (*index == 0x44)
+		return sim_rand(gen, 2) ? 0x03 : 0x00;
+	return sim_rand(gen, 4);
+}
+
+static void sim_op(struct sim_gen *, bool top);
+
+static void
+sim_ops(struct sim_gen *gen, int nr, bool top)
+{
+	while (nr--)
+		sim_op(gen, top);
+}
+
+static void
+sim_op(struct sim_gen *gen, bool top)
+{
+	u32 fixup;
+	u8 index, count, i;
+
+	switch (sim_rand(gen, top ? 32 : 29)) {
+	case 0: /* INIT_NOT */
+		sim_wr08(gen, 0x38);
+		break;
+	case 1: /* INIT_RESUME */
+		sim_wr08(gen, 0x72);
+		break;
+	case 2: /* INIT_GENERIC_CONDITION */
+		sim_wr08(gen, 0x3a);
+		sim_wr08(gen, 7);
+		sim_wr08(gen, 0);
+		break;
+	case 3: /* INIT_CONDITION */
+	case 4:
+		sim_wr08(gen, 0x75);
+		sim_wr08(gen, sim_rand(gen, 16));
+		break;
+	case 5: /* INIT_IO_CONDITION */
+		sim_wr08(gen, 0x76);
+		sim_wr08(gen, sim_rand(gen, 16));
+		break;
+	case 6: /* INIT_STRAP_CONDITION */
+		sim_wr08(gen, 0x73);
+		sim_wr32(gen, 0x00000003);
+		sim_wr32(gen, sim_rand(gen, 4));
+		break;
+	case 7: /* INIT_RAM_CONDITION */
+		sim_wr08(gen, 0x6d);
+		sim_wr08(gen, 0x03);
+		sim_wr08(gen, sim_rand(gen, 4));
+		break;
+	case 8: /* INIT_ANDN_REG */
+	case 9: /* INIT_OR_REG */
+		sim_wr08(gen, sim_rand(gen, 2) ? 0x47 : 0x48);
+		sim_wr32(gen, sim_reg(gen));
+		sim_wr32(gen, sim_val(gen));
+		break;
+	case 10: /* INIT_NV_REG */
+		sim_wr08(gen, 0x6e);
+		sim_wr32(gen, sim_reg(gen));
+		sim_wr32(gen, sim_val(gen));
+		sim_wr32(gen, sim_val(gen));
+		break;
+	case 11: /* INIT_ZM_REG */
+	case 12:
+		sim_wr08(gen, 0x7a);
+		sim_wr32(gen, sim_reg(gen));
+		sim_wr32(gen, sim_val(gen));
+		break;
+	case 13: /* INIT_ZM_REG16 */
+		sim_wr08(gen, 0x77);
+		sim_wr32(gen, sim_reg(gen));
+		sim_wr16(gen, sim_val(gen));
+		break;
+	case 14: /* INIT_ZM_REG_INDIRECT */
+		sim_wr08(gen, 0x5a);
+		sim_wr32(gen, sim_reg(gen));
+		sim_wr16(gen, SIM_MACROS + sim_rand(gen, 32) * 4);
+		break;
+	case 15: /* INIT_ZM_REG_SEQUENCE */
+	case 16: /* INIT_ZM_REG_GROUP */
+		sim_wr08(gen, sim_rand(gen, 2) ? 0x58 : 0x91);
+		sim_wr32(gen, sim_regs[1 + sim_rand(gen, 2)]);
+		sim_wr08(gen, (count = sim_rand(gen, 4)));
+		for (i = 0; i < count; i++)
+			sim_wr32(gen, sim_val(gen));
+		break;
+	case 17: /* INIT_MACRO */
+		sim_wr08(gen, 0x6f);
+		sim_wr08(gen, sim_rand(gen, 16));
+		break;
+	case 18: /* INIT_ZM_CR */
+	case 19:
+		sim_wr08(gen, 0x53);
+		i = sim_cr(gen, &index);
+		sim_wr08(gen, index);
+		sim_wr08(gen, i);
+		break;
+	case 20: /* INIT_ZM_CR_GROUP */
+		sim_wr08(gen, 0x54);
+		sim_wr08(gen, (count = sim_rand(gen, 4)));
+		while (count--) {
+			i = sim_cr(gen, &index);
+			sim_wr08(gen, index);
+			sim_wr08(gen, i);
+		}
+		break;
+	case 21: /* INIT_ZM_INDEX_IO */
+		sim_wr08(gen, 0x62);
+		sim_wr16(gen, sim_rand(gen, 2) ? 0x03d4 : 0x03c4);
+		i = sim_cr(gen, &index);
+		sim_wr08(gen, index);
+		sim_wr08(gen, i);
+		break;
+	case 22: /* INIT_TIME */
+		sim_wr08(gen, 0x74);
+		sim_wr16(gen, sim_rand(gen, 4));
+		break;
+	case 23: /* INIT_RESET_BEGUN/END */
+		sim_wr08(gen, sim_rand(gen, 2) ? 0x8c : 0x8d);
+		break;
+	case 24: /* INIT_COPY */
+		sim_wr08(gen, 0x37);
+		sim_wr32(gen, sim_reg(gen));
+		sim_wr08(gen, sim_rand(gen, 2) ? 0x02 : 0xfe);
+		sim_wr08(gen, 0x0f);
+		sim_wr16(gen, 0x03d4);
+		sim_wr08(gen, sim_crtc[sim_rand(gen, 3)]);
+		sim_wr08(gen, 0xf0);
+		break;
+	case 25: /* INIT_COPY_NV_REG */
+		sim_wr08(gen, 0x5f);
+		sim_wr32(gen, sim_reg(gen));
+		sim_wr08(gen, sim_rand(gen, 8));
+		sim_wr32(gen, sim_val(gen));
+		sim_wr32(gen, sim_val(gen));
+		sim_wr32(gen, sim_reg(gen));
+		sim_wr32(gen, sim_val(gen));
+		break;
+	case 26: /* INIT_ZM_MASK_ADD */
+		sim_wr08(gen, 0x97);
+		sim_wr32(gen, sim_reg(gen));
+		sim_wr32(gen, sim_val(gen));
+		sim_wr32(gen, sim_val(gen));
+		break;
+	case 27: /* INIT_IO */
+		sim_wr08(gen, 0x69);
+		sim_wr16(gen, sim_rand(gen, 2) ? 0x03c2 : 0x03da);
+		sim_wr08(gen, 0xf0);
+		sim_wr08(gen, sim_rand(gen, 16));
+		break;
+	case 28: /* INIT_JUMP, over the next opcode */
+		sim_wr08(gen, 0x5c);
+		fixup = gen->pos;
+		sim_wr16(gen, 0x0000);
+		sim_op(gen, false);
+		gen->data[fixup + 0] = gen->pos;
+		gen->data[fixup + 1] = gen->pos >> 8;
+		break;
+	case 29: /* INIT_SUB_DIRECT */
+	case 30:
+		sim_wr08(gen, 0x5b);
+		sim_wr16(gen, gen->sub[sim_rand(gen, gen->subs)]);
+		break;
+	case 31: /* INIT_REPEAT */
+		sim_wr08(gen, 0x33);
+		sim_wr08(gen, 1 + sim_rand(gen, 3));
+		sim_ops(gen, 1 + sim_rand(gen, 6), false);
+		sim_wr08(gen, 0x36);
+		break;
+	}
+}
+
+static u16
+sim_script(struct sim_gen *gen, bool top)
+{
+	u16 start = gen->pos;
+
+	sim_ops(gen, 4 + sim_rand(gen, 40), top);
+	sim_wr08(gen, 0x71);
+	return start;
+}
+
+static void
+sim_image(struct sim_gen *gen)
+{
+	const u8 bit[] = { 0xff, 0xb8, 'B', 'I', 'T', 0x00, 0x00, 0x01,
+			   0x0c, 0x06, 0x01, 0x00 };
+	int i;
+
+	memset(gen->data, 0x00, SIM_BIOS);
+	memcpy(&gen->data[SIM_BIT], bit, sizeof(bit));
+	gen->pos = SIM_BIT + sizeof(bit);
+	sim_wr08(gen, 'I');
+	sim_wr08(gen, 0x01);
+	sim_wr16(gen, 0x000a);
+	sim_wr16(gen, SIM_INIT);
+
+	gen->pos = SIM_INIT;
+	sim_wr16(gen, SIM_SCRIPTS);
+	sim_wr16(gen, 0x0000);
+	sim_wr16(gen, SIM_MACROS);
+	sim_wr16(gen, SIM_CONDS);
+	sim_wr16(gen, SIM_IOCONDS);
+
+	gen->pos = SIM_MACROS;
+	for (i = 0; i < 16; i++) {
+		sim_wr32(gen, sim_regs[sim_rand(gen, ARRAY_SIZE(sim_regs))]);
+		sim_wr32(gen, sim_val(gen));
+	}
+
+	gen->pos = SIM_CONDS;
+	for (i = 0; i < 16; i++) {
+		sim_wr32(gen, sim_regs[sim_rand(gen, ARRAY_SIZE(sim_regs))]);
+		sim_wr32(gen, 0x00000003);
+		sim_wr32(gen, sim_rand(gen, 4));
+	}
+
+	gen->pos = SIM_IOCONDS;
+	for (i = 0; i < 16; i++) {
+		sim_wr16(gen, 0x03d4);
+		sim_wr08(gen, sim_crtc[sim_rand(gen, 3)]);
+		sim_wr08(gen, 0x03);
+		sim_wr08(gen, sim_rand(gen, 4));
+	}
+
+	gen->pos = SIM_CODE;
+	for (gen->subs = 0; gen->subs < SIM_SUBS; gen->subs++)
+		gen->sub[gen->subs] = sim_script(gen, false);
+
+	for (i = 0; i < SIM_MAINS; i++) {
+		u16 script = sim_script(gen, true);
+		gen->data[SIM_SCRIPTS + i * 2 + 0] = script;
+		gen->data[SIM_SCRIPTS + i * 2 + 1] = script >> 8;
+	}
+}
+
+static int
+sim_initx(struct nvkm_bios *bios, const char *cfg)
+{
+	bios->subdev.device->cfgopt = cfg;
+	nvbios_initx_fini(bios);
+	return nvbios_initx_new(bios);
+}
+
+/* Everything a script's run for, twice over. */
+static s64
+sim_run(struct nvkm_bios *bios, struct sim_result *result)
+{
+	struct nvkm_device *device = bios->subdev.device;
+	s64 time = ktime_to_ns(ktime_get());
+	int pass, i, j, r = 0;
+
+	memset(result, 0x00, sizeof(*result) * SIM_RUNS * 2);
+	memcpy(device->pri, mmio_init, SIM_MMIO_SIZE);
+	for (pass = 0; pass < 2; pass++) {
+		result[r++].ret = nvbios_post(&bios->subdev, true);
+		for (i = 0; i < SIM_MAINS; i++) {
+			for (j = 0; j < 4; j++) {
+				struct nvbios_init init = {
+					.subdev = &bios->subdev,
+					.offset = nvbios_rd16(bios, SIM_SCRIPTS +
+								    i * 2),
+					.or = j < 3 ? j - 1 : 0,
+					.link = j < 3 ? j : 1,
+					.head = j < 3 ? j - 1 : 1,
+					.execute = j < 3,
+				};
+
+				result[r].ret = nvbios_exec(&init);
+				result[r].execute = init.execute;
+				result[r].head = init.head;
+				r++;
+			}
+		}
+	}
+
+	return ktime_to_ns(ktime_get()) - time;
+}
+
+static void
+sim_compare(struct nvkm_device *device, const char *name,
+	    const struct sim_result *result, const struct sim_result *interp)
+{
+	u32 i;
+
+	for (i = 0; i < SIM_RUNS * 2; i++) {
+		if (result[i].ret != interp[i].ret ||
+		    result[i].execute != interp[i].execute ||
+		    result[i].head != interp[i].head) {
+			printf("%s: run %d returned %d/%02x/%d, expected "
+			       "%d/%02x/%d\n", name, i, result[i].ret,
+			       result[i].execute, result[i].head, interp[i].ret,
+			       interp[i].execute, interp[i].head);
+			errors++;
+			return;
+		}
+	}
+
+	for (i = 0; i < SIM_MMIO_SIZE; i += 4) {
+		if (*(u32 *)(device->pri + i) != *(u32 *)(mmio_interp + i)) {
+			printf("%s: %06x = %08x, expected %08x\n", name, i,
+			       *(u32 *)(device->pri + i),
+			       *(u32 *)(mmio_interp + i));
+			errors++;
+			return;
+		}
+	}
+}
+
+static int
+sim_board(struct nvkm_bios *bios, int card_type, unsigned int seed,
+	  int loops, u64 *pass)
+{
+	struct nvkm_device *device = bios->subdev.device;
+	struct sim_result interp[SIM_RUNS * 2], result[SIM_RUNS * 2];
+	struct sim_gen gen = { .data = bios->data };
+	s64 time[3] = {};
+	u32 blocks = 0;
+	unsigned int image = seed;
+	int ret, i, j;
+
+	device->card_type = card_type;
+	device->chipset = card_type;
+	gen.nv50 = card_type >= NV_50;
+
+	for (i = 0; i < loops && !errors; i++) {
+		/* Each image has a seed of its own, to be rerun by itself. */
+		gen.seed = image = seed + i;
+		sim_image(&gen);
+
+		for (j = 0; j < SIM_MMIO_SIZE; j += 4)
+			*(u32 *)(mmio_init + j) = 0;
+		for (j = 0; j < ARRAY_SIZE(sim_regs); j++)
+			*(u32 *)(mmio_init + sim_regs[j]) = sim_rand(&gen, 4);
+		for (j = 0; j < 0x4000; j++) {
+			mmio_init[0x0c0000 + j] = sim_rand(&gen, 4);
+			mmio_init[0x601000 + j] = sim_rand(&gen, 4);
+		}
+
+		if ((ret = sim_initx(bios, "NvBiosInitDecode=0")))
+			return ret;
+		time[0] += sim_run(bios, interp);
+		memcpy(mmio_interp, device->pri, SIM_MMIO_SIZE);
+
+		if ((ret = sim_initx(bios, "NvBiosInitDecode=1")))
+			return ret;
+		time[1] += sim_run(bios, result);
+		sim_compare(device, "decode", result, interp);
+		blocks += bios->initx->stats.blocks;
+
+		if ((ret = sim_initx(bios, "NvBiosInitCheck=1")))
+			return ret;
+		time[2] += sim_run(bios, result);
+		sim_compare(device, "check", result, interp);
+		if (!bios->initx->enable || bios->initx->stats.fail ||
+		    bios->initx->stats.skip ||
+		    bios->initx->stats.pass != SIM_TOP * 2) {
+			printf("check: %u/%u/%u pass/fail/skip, expected "
+			       "%u/0/0\n", bios->initx->stats.pass,
+			       bios->initx->stats.fail,
+			       bios->initx->stats.skip, SIM_TOP * 2);
+			errors++;
+		}
+		*pass += bios->initx->stats.pass;
+	}
+
+	if (errors) {
+		printf("NV%02x: rerun with -s %u -n 1\n", card_type, image);
+		return 0;
+	}
+
+	printf("NV%02x: %d image(s), %u block(s), interp %lldus, decode "
+	       "%lldus, check %lldus\n", card_type, loops, blocks,
+	       time[0] / 1000, time[1] / 1000, time[2] / 1000);
+	return 0;
+}
+
+/* A decoded block that no longer matches its script. */
+static void
+sim_stale(struct nvkm_bios *bios)
+{
+	struct nvkm_device *device = bios->subdev.device;
+	struct sim_gen gen = { .data = bios->data, .pos = SIM_CODE };
+	u16 script = SIM_CODE;
+
+	memset(bios->data + SIM_SCRIPTS, 0x00, 0x20);
+	sim_wr08(&gen, 0x7a);
+	sim_wr32(&gen, 0x00e100);
+	sim_wr32(&gen, 0x00000001);
+	sim_wr08(&gen, 0x71);
+
+	sim_initx(bios, "NvBiosInitCheck=1");
+	nvbios_init(&bios->subdev, script);
+	bios->data[SIM_CODE + 5] = 0x02;
+	nvbios_init(&bios->subdev, script);
+
+	if (bios->initx->enable || bios->initx->stats.fail != 1 ||
+	    nvkm_rd32(device, 0x00e100) != 0x00000002) {
+		printf("stale: check %s, %u failure(s), %08x written\n",
+		       bios->initx->enable ? "enabled" : "disabled",
+		       bios->initx->stats.fail, nvkm_rd32(device, 0x00e100));
+		errors++;
+	}
+}
+
+int
+main(int argc, char **argv)
+{
+	struct nvkm_device device = {};
+	struct nvkm_bios bios = {};
+	const char *dbg = "fatal";
+	unsigned int seed = 1;
+	int loops = 25, ret, c;
+	u64 pass = 0;
+
+	while ((c = getopt(argc, argv, "d:n:s:")) != -1) {
+		switch (c) {
+		case 'd': dbg = optarg; break;
+		case 'n': loops = strtol(optarg, NULL, 0); break;
+		case 's': seed = strtoul(optarg, NULL, 0); break;
+		default:
+			fprintf(stderr, "usage: %s [-s seed] [-n images] "
+					"[-d debug]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if (loops < 1) {
+		fprintf(stderr, "invalid image count\n");
+		return 1;
+	}
+
+	mmio_init = malloc(SIM_MMIO_SIZE);
+	mmio_interp = malloc(SIM_MMIO_SIZE);
+	bios.data = calloc(1, SIM_BIOS);
+	if (!mmio_init || !mmio_interp || !bios.data)
+		return 1;
+	bios.size = SIM_BIOS;
+	bios.bit_offset = SIM_BIT;
+
+	ret = sim_device_init(&device, "nv_initx", NULL, dbg);
+	if (ret) {
+		fprintf(stderr, "failed to create device: %d\n", ret);
+		return 1;
+	}
+	device.bios = &bios;
+	device.devinit = &sim_devinit;
+	nvkm_subdev_ctor(&sim_bios, &device, NVKM_SUBDEV_VBIOS, &bios.subdev);
+
+	ret = sim_board(&bios, NV_40, seed, loops, &pass);
+	if (ret == 0 && !errors)
+		ret = sim_board(&bios, NV_50, seed, loops, &pass);
+	if (ret) {
+		fprintf(stderr, "failed to run scripts: %d\n", ret);
+		return 1;
+	}
+
+	if (!errors) {
+		sim_stale(&bios);
+		printf("%llu script(s) passed the check mode\n", pass);
+	}
+
+	nvbios_initx_fini(&bios);
+	sim_device_fini(&device);
+	free(bios.data);
+	free(mmio_interp);
+	free(mmio_init);
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,174 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sim.h"
+
+/* Takes a simulated instance heap through a few suspend/resume cycles.
+ * Every object's contents are replaced with garbage while "suspended",
+ * as VRAM would be across D3cold, and the cycle is checked to:
+ *
+ * - restore all objects allocated as NVKM_MEM_TARGET_INST,
+ * - neither save nor restore NVKM_MEM_TARGET_INST_SR_LOST objects,
+ * - hold a copy of only what's preserved while suspended, and none at all
+ *   once resumed.
+ *
+ * One row is printed per cycle: the bytes held while suspended, how many
+ * of those belong to regenerable objects, the bytes still held once
+ * resumed, and how many objects of each kind came back wrong.  Anything
+ * but a copy of the preserved bytes while suspended, and zeroes after,
+ * fails the run.
+ */
+
+#define SIM_OBJS 64
+
+struct sim_obj {
+	struct nvkm_memory *memory;
+	bool lost;
+};
+
+static int errors;
+
+static u32
+sim_word(int i, u32 offset)
+{
+	return (i << 24) ^ offset ^ 0x5a5a5a5a;
+}
+
+static u64
+sim_copies(struct sim_obj *objs, u64 *lost)
+{
+	u64 size = 0;
+	int i;
+
+	*lost = 0;
+	for (i = 0; i < SIM_OBJS; i++) {
+		struct nvkm_instobj *iobj =
+			container_of(objs[i].memory, typeof(*iobj), memory);
+
+		if (!iobj->suspend)
+			continue;
+		size += nvkm_memory_size(objs[i].memory);
+		if (objs[i].lost)
+			*lost += nvkm_memory_size(objs[i].memory);
+	}
+	return size;
+}
+
+int
+main(int argc, char **argv)
+{
+	struct nvkm_device device = {};
+	struct sim_obj objs[SIM_OBJS];
+	struct nvkm_subdev *subdev;
+	u64 kept = 0, lost = 0, copy, junk;
+	int ret, cycle, i;
+	u32 o;
+
+	ret = sim_device_init(&device, "nv_instsr", NULL,
+			      argc > 1 ? argv[1] : "error");
+	if (ret) {
+		fprintf(stderr, "failed to create device: %d\n", ret);
+		return 1;
+	}
+	subdev = &device.imem->subdev;
+
+	/* Mostly preserved, with every fourth object one the driver would
+	 * regenerate on resume, like the fault buffers.
+	 */
+	for (i = 0; i < SIM_OBJS; i++) {
+		u32 size = 0x1000 << (i % 5);
+
+		objs[i].lost = (i % 4) == 3;
+		ret = nvkm_memory_new(&device, objs[i].lost ?
+				      NVKM_MEM_TARGET_INST_SR_LOST :
+				      NVKM_MEM_TARGET_INST,
+				      size, 0x1000, true, &objs[i].memory);
+		if (ret) {
+			fprintf(stderr, "failed to allocate: %d\n", ret);
+			return 1;
+		}
+
+		nvkm_kmap(objs[i].memory);
+		for (o = 0; o < size; o += 4)
+			nvkm_wo32(objs[i].memory, o, sim_word(i, o));
+		nvkm_done(objs[i].memory);
+
+		if (objs[i].lost)
+			lost += size;
+		else
+			kept += size;
+	}
+
+	printf("%llu bytes preserved, %llu regenerated\n", kept, lost);
+	printf("%-6s %10s %10s %10s %6s %6s\n", "cycle", "suspended", "of lost",
+	       "resumed", "kept", "lost");
+	for (cycle = 0; cycle < 3; cycle++) {
+		u64 held, junked, wrong[2] = {};
+
+		ret = nvkm_subdev_fini(subdev, true);
+		if (ret) {
+			fprintf(stderr, "failed to suspend: %d\n", ret);
+			return 1;
+		}
+
+		held = sim_copies(objs, &junked);
+		if (held != kept || junked)
+			errors++;
+
+		for (i = 0; i < SIM_OBJS; i++) {
+			const u64 size = nvkm_memory_size(objs[i].memory);
+
+			nvkm_kmap(objs[i].memory);
+			nvkm_memory_fill(objs[i].memory, 0, 0xdeadbeef, size);
+			nvkm_done(objs[i].memory);
+		}
+
+		ret = nvkm_subdev_init(subdev);
+		if (ret) {
+			fprintf(stderr, "failed to resume: %d\n", ret);
+			return 1;
+		}
+
+		copy = sim_copies(objs, &junk);
+		if (copy)
+			errors++;
+
+		for (i = 0; i < SIM_OBJS; i++) {
+			const u64 size = nvkm_memory_size(objs[i].memory);
+			u32 bad = 0;
+
+			nvkm_kmap(objs[i].memory);
+			for (o = 0; o < size; o += 4) {
+				u32 data = nvkm_ro32(objs[i].memory, o);
+
+				if (data != (objs[i].lost ? 0xdeadbeef :
+					     sim_word(i, o)))
+					bad++;
+			}
+			nvkm_done(objs[i].memory);
+
+			if (bad) {
+				wrong[objs[i].lost]++;
+				errors++;
+			}
+
+			/* Rewrite what the driver would have regenerated. */
+			if (objs[i].lost) {
+				nvkm_kmap(objs[i].memory);
+				for (o = 0; o < size; o += 4)
+					nvkm_wo32(objs[i].memory, o,
+						  sim_word(i, o));
+				nvkm_done(objs[i].memory);
+			}
+		}
+
+		printf("%-6d %10llu %10llu %10llu %6llu %6llu\n", cycle, held,
+		       junked, copy, wrong[0], wrong[1]);
+	}
+
+	for (i = 0; i < SIM_OBJS; i++)
+		nvkm_memory_unref(&objs[i].memory);
+	sim_device_fini(&device);
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,251 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "sim.h"
+
+#include <subdev/pmu/priv.h>
+
+/* Runs memory reclocking transitions through the MEMX script cache on a
+ * simulated PMU, which accepts every script and does nothing with it.
+ *
+ * Each transition's script depends on a per-partition register, read the
+ * way gk104_ram_nuts() reads them, and finishes by writing a value derived
+ * from it.  Between transitions, the partition registers are changed at
+ * random.  A cached script must never be replayed once a register it was
+ * built from has changed, so the last word uploaded has to be what a fresh
+ * build would have produced, every time.  This is checked for the current
+ * gk104_ram_nuts(), and for a copy of the loop it replaced, which read the
+ * registers behind memx's back.
+ *
+ * After that, a cached script that no longer fits the PMU's data segment
+ * has to be replaced by the one built in its place, not joined by it, and
+ * shutting the PMU down has to empty the cache.
+ *
+ * Usage: nv_memxcache [transitions]
+ */
+
+#define SIM_PARTS 4
+#define SIM_KEYS 4
+#define SIM_DATA 0x1000
+#define SIM_OUT 0x10f910
+
+static u32 data_size = SIM_DATA;
+static u32 execs;
+
+static int
+sim_send(struct nvkm_pmu *pmu, u32 reply[2], u32 process, u32 message,
+	 u32 data0, u32 data1)
+{
+	if (process != PROC_MEMX)
+		return -EINVAL;
+
+	switch (message) {
+	case MEMX_MSG_INFO:
+		reply[0] = 0x00000800;
+		reply[1] = data_size;
+		return 0;
+	case MEMX_MSG_EXEC:
+		reply[0] = reply[1] = 0;
+		execs++;
+		return 0;
+	default:
+		return -EINVAL;
+	}
+}
+
+static bool
+sim_enabled(struct nvkm_pmu *pmu)
+{
+	return false;
+}
+
+static const struct nvkm_pmu_func
+sim_pmu = {
+	.enabled = sim_enabled,
+	.send = sim_send,
+};
+
+static u32
+sim_part(int i)
+{
+	return 0x110204 + i * 0x1000;
+}
+
+/* The loop gk104_ram_nuts() used to run. */
+static u32
+old_nuts(struct nvkm_memx *memx, struct nvkm_device *device)
+{
+	u32 sum = 0;
+	int i;
+
+	for (i = 0; i < SIM_PARTS; i++) {
+		u32 prev = nvkm_rd32(device, sim_part(i));
+		u32 next = (prev & ~0x3c) | 0x30;
+		nvkm_memx_wr32(memx, sim_part(i), next);
+		sum += next;
+	}
+
+	return sum;
+}
+
+static u32
+new_nuts(struct nvkm_memx *memx, struct nvkm_device *device)
+{
+	u32 sum = 0;
+	int i;
+
+	for (i = 0; i < SIM_PARTS; i++) {
+		u32 prev = nvkm_memx_rd32(memx, sim_part(i));
+		u32 next = (prev & ~0x3c) | 0x30;
+		nvkm_memx_wr32(memx, sim_part(i), next);
+		sum += next;
+	}
+
+	return sum;
+}
+
+/* What a fresh build of the script would finish with. */
+static u32
+sim_expect(struct nvkm_device *device, u32 to)
+{
+	u32 sum = to;
+	int i;
+
+	for (i = 0; i < SIM_PARTS; i++)
+		sum += (nvkm_rd32(device, sim_part(i)) & ~0x3c) | 0x30;
+	return sum;
+}
+
+/* Returns whether the script came from the cache. */
+static int
+sim_transition(struct nvkm_pmu *pmu, u32 to, int words, bool old)
+{
+	struct nvkm_device *device = pmu->subdev.device;
+	struct nvkm_memx_key key = { .from = 0, .to = to };
+	struct nvkm_memx *memx;
+	bool cached;
+	u32 sum;
+	int ret, i;
+
+	ret = nvkm_memx_init(pmu, &memx);
+	if (ret)
+		return ret;
+
+	cached = nvkm_memx_cache(memx, &key);
+	if (!cached) {
+		nvkm_memx_block(memx);
+		for (i = 0; i < words; i++)
+			nvkm_memx_nsec(memx, 1000);
+		sum = old ? old_nuts(memx, device) : new_nuts(memx, device);
+		nvkm_memx_unblock(memx);
+		nvkm_memx_wr32(memx, SIM_OUT, sum + to);
+	}
+
+	ret = nvkm_memx_fini(&memx, true);
+	if (ret)
+		return ret;
+	return cached;
+}
+
+static int
+sim_run(struct nvkm_pmu *pmu, int loops, bool old, int *hits)
+{
+	struct nvkm_device *device = pmu->subdev.device;
+	unsigned int seed = 1;
+	int stale = 0, i, j, ret;
+
+	for (i = 0; i < SIM_PARTS; i++)
+		nvkm_wr32(device, sim_part(i), 0x00000000);
+
+	for (i = 0; i < loops; i++) {
+		const u32 to = 100000 * (1 + rand_r(&seed) % SIM_KEYS);
+		u32 want;
+
+		/* Training results move around now and then. */
+		if (rand_r(&seed) % 4 == 0) {
+			j = rand_r(&seed) % SIM_PARTS;
+			nvkm_mask(device, sim_part(j), 0x00000f00,
+				  (rand_r(&seed) % 16) << 8);
+		}
+
+		want = sim_expect(device, to);
+		ret = sim_transition(pmu, to, 4, old);
+		if (ret < 0) {
+			printf("transition failed: %d\n", ret);
+			return -1;
+		}
+
+		*hits += ret;
+		if (nvkm_rd32(device, 0x10a1c4) != want)
+			stale++;
+	}
+
+	nvkm_memx_cache_fini(pmu);
+	return stale;
+}
+
+int
+main(int argc, char **argv)
+{
+	struct nvkm_device device = {};
+	struct nvkm_subdev *subdev;
+	struct nvkm_pmu *pmu;
+	int loops = argc > 1 ? strtol(argv[1], NULL, 0) : 1000;
+	int errors = 0, hits, nr, ret, i;
+
+	if (loops < 1) {
+		fprintf(stderr, "invalid transition count\n");
+		return 1;
+	}
+
+	ret = sim_device_init(&device, "nv_memxcache", NULL, "error");
+	if (ret == 0)
+		ret = nvkm_pmu_new_(&sim_pmu, &device, NVKM_SUBDEV_PMU, &pmu);
+	if (ret) {
+		fprintf(stderr, "failed to create pmu: %d\n", ret);
+		return 1;
+	}
+
+	/* The old loop is expected to replay stale scripts, and is only
+	 * run to show the checks would catch it.
+	 */
+	printf("%-5s %11s %8s %8s\n", "nuts", "transitions", "cached", "stale");
+	for (i = 0; i < 2; i++) {
+		hits = 0;
+		ret = sim_run(pmu, loops, !i, &hits);
+		printf("%-5s %11d %8d %8d\n", i ? "new" : "old", loops, hits,
+		       ret);
+		if (ret < 0 || (i && ret))
+			errors++;
+	}
+
+	/* A cached script that's outgrown the data segment gets replaced. */
+	for (i = 0; i < SIM_KEYS; i++)
+		sim_transition(pmu, 100000 * (1 + i), 4, false);
+	sim_transition(pmu, 1000000, 64, false);
+	nr = pmu->memx.cache_nr;
+	data_size = 0x100;
+	if ((ret = sim_transition(pmu, 1000000, 4, false)) ||
+	    pmu->memx.cache_nr != nr ||
+	    (ret = sim_transition(pmu, 1000000, 4, false)) != 1) {
+		printf("outgrown script: %d, %d cached script(s), expected "
+		       "%d\n", ret, pmu->memx.cache_nr, nr);
+		errors++;
+	}
+	data_size = SIM_DATA;
+
+	nvkm_subdev_fini(&pmu->subdev, false);
+	if (pmu->memx.cache_nr || !list_empty(&pmu->memx.cache)) {
+		printf("%d script(s) cached after PMU fini\n",
+		       pmu->memx.cache_nr);
+		errors++;
+	}
+
+	printf("%u script(s) executed, %d cached before the PMU was shut "
+	       "down\n", execs, nr);
+
+	subdev = &pmu->subdev;
+	nvkm_subdev_del(&subdev);
+	sim_device_fini(&device);
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,412 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sim.h"
+
+#include <falcon/priv.h>
+#include <falcon/msgqueue.h>
+
+/* Drives the falcon message queue against a simulated PMU, whose DMEM is
+ * host memory, and whose firmware is run by hand between submissions: it
+ * consumes everything between the command queue's TAIL and HEAD, checks
+ * each command, and answers it on the message queue.
+ *
+ * Commands go out alternately in batches, through nvkm_msgqueue_submit(),
+ * and one at a time, through nvkm_msgqueue_post().  Some of the callbacks
+ * post a follow-up command from inside the callback.  Every command has to
+ * reach the firmware intact and in order, have its own callback run with
+ * its own data, and have its completion signalled.  Each batch has to be
+ * published with a single HEAD update, and the queue's statistics have to
+ * add up at the end.  The report splits commands and HEAD updates by how
+ * the commands went out.
+ */
+
+#define SIM_FALCON 0x10a000
+#define SIM_DMEM 0x10000
+
+#define SIM_CMDQ_HEAD 0x4a0
+#define SIM_CMDQ_TAIL 0x4b0
+#define SIM_CMDQ 0x1000
+#define SIM_CMDQ_SIZE 0x1000
+
+#define SIM_MSGQ_HEAD 0x4c8
+#define SIM_MSGQ_TAIL 0x4cc
+#define SIM_MSGQ 0x4000
+#define SIM_MSGQ_SIZE 0x400
+
+#define SIM_UNIT 0x42
+#define SIM_CHAIN 7 /* every seventh command posts a follow-up */
+
+struct sim_cmd {
+	struct nvkm_msgqueue_hdr hdr;
+	u32 tag;
+	u8 data[56];
+};
+
+struct sim_msg {
+	struct nvkm_msgqueue_msg base;
+	u32 tag;
+};
+
+static u8 dmem[SIM_DMEM];
+static struct nvkm_falcon falcon;
+static struct nvkm_msgqueue_queue cmdq, msgq;
+
+static u32 sent, fw_tag, acked, follow;
+static int errors;
+
+static void
+sim_load_dmem(struct nvkm_falcon *falcon, void *data, u32 start, u32 size,
+	      u8 port)
+{
+	memcpy(&dmem[start], data, size);
+}
+
+static void
+sim_read_dmem(struct nvkm_falcon *falcon, u32 start, u32 size, u8 port,
+	      void *data)
+{
+	memcpy(data, &dmem[start], size);
+}
+
+static const struct nvkm_subdev_func
+sim_pmu = {
+};
+
+static const struct nvkm_falcon_func
+sim_falcon = {
+	.load_dmem = sim_load_dmem,
+	.read_dmem = sim_read_dmem,
+};
+
+/* The host only notices the queue has wrapped once HEAD is behind where
+ * it's reading from, so anything left at the end would be lost.  Wait for
+ * the host to catch up before wrapping.
+ */
+static bool
+sim_msg(u32 *head, u32 tail, u8 unit, u8 seq, u32 tag)
+{
+	struct sim_msg msg = {
+		.base.hdr.unit_id = unit,
+		.base.hdr.size = sizeof(msg),
+		.base.hdr.seq_id = seq,
+		.tag = tag,
+	};
+
+	if (*head + sizeof(msg) > SIM_MSGQ + SIM_MSGQ_SIZE) {
+		if (tail != *head)
+			return false;
+		*head = SIM_MSGQ;
+	}
+
+	if (*head < tail && *head + sizeof(msg) >= tail)
+		return false;
+
+	memcpy(&dmem[*head], &msg, sizeof(msg));
+	*head += ALIGN(sizeof(msg), 4);
+	return true;
+}
+
+/* What the firmware would do with the commands posted since it last ran. */
+static void
+sim_firmware(void)
+{
+	u32 head = nvkm_falcon_rd32(&falcon, SIM_CMDQ_HEAD);
+	u32 tail = nvkm_falcon_rd32(&falcon, SIM_CMDQ_TAIL);
+	u32 msgh = nvkm_falcon_rd32(&falcon, SIM_MSGQ_HEAD);
+	u32 msgt = nvkm_falcon_rd32(&falcon, SIM_MSGQ_TAIL);
+	int i;
+
+	while (tail != head) {
+		struct sim_cmd *cmd = (void *)&dmem[tail];
+
+		if (cmd->hdr.unit_id == 0x00) { /* REWIND */
+			tail = SIM_CMDQ;
+			continue;
+		}
+
+		if (cmd->hdr.unit_id != SIM_UNIT || cmd->tag != fw_tag ||
+		    !(cmd->hdr.ctrl_flags & BIT(1))) {
+			printf("fw: unexpected command %02x/%02x tag %d at "
+			       "%04x, expected tag %d\n", cmd->hdr.unit_id,
+			       cmd->hdr.ctrl_flags, cmd->tag, tail, fw_tag);
+			errors++;
+			break;
+		}
+
+		/* No room for the reply, come back once there is. */
+		if (!sim_msg(&msgh, msgt, cmd->hdr.unit_id, cmd->hdr.seq_id,
+			     cmd->tag))
+			break;
+
+		for (i = 8; i < cmd->hdr.size; i++) {
+			if (cmd->data[i - 8] != (u8)(cmd->tag + i)) {
+				printf("fw: command %d corrupt at byte %d\n",
+				       cmd->tag, i);
+				errors++;
+				break;
+			}
+		}
+
+		tail += ALIGN(cmd->hdr.size, 4);
+		fw_tag++;
+	}
+
+	nvkm_falcon_wr32(&falcon, SIM_CMDQ_TAIL, tail);
+	nvkm_falcon_wr32(&falcon, SIM_MSGQ_HEAD, msgh);
+}
+
+static void
+sim_cmd(struct sim_cmd *cmd, unsigned int *seed)
+{
+	int i;
+
+	cmd->hdr.unit_id = SIM_UNIT;
+	cmd->hdr.size = 8 + rand_r(seed) % (sizeof(*cmd) - 8 + 1);
+	cmd->tag = sent++;
+	for (i = 8; i < cmd->hdr.size; i++)
+		cmd->data[i - 8] = cmd->tag + i;
+}
+
+/* Replies have to come back in the order the commands went out. */
+static void
+sim_reply(struct nvkm_msgqueue_hdr *hdr)
+{
+	struct sim_msg *msg = (void *)hdr;
+
+	if (msg->tag != acked) {
+		printf("reply %d, expected %d\n", msg->tag, acked);
+		errors++;
+	}
+	acked++;
+}
+
+static void
+sim_follow_callback(struct nvkm_msgqueue *queue, struct nvkm_msgqueue_hdr *hdr)
+{
+	sim_reply(hdr);
+}
+
+static void
+sim_chain(struct nvkm_msgqueue *queue)
+{
+	static struct sim_cmd cmd[NVKM_MSGQUEUE_NUM_SEQUENCES];
+	static unsigned int seed = 2;
+	static int next;
+	struct sim_cmd *c = &cmd[next++ % ARRAY_SIZE(cmd)];
+	int ret;
+
+	sim_cmd(c, &seed);
+	ret = nvkm_msgqueue_post(queue, MSGQUEUE_MSG_PRIORITY_HIGH, &c->hdr,
+				 sim_follow_callback, NULL, false);
+	if (ret) {
+		printf("follow-up post failed: %d\n", ret);
+		errors++;
+	}
+	follow++;
+}
+
+static void
+sim_callback(struct nvkm_msgqueue *queue, struct nvkm_msgqueue_hdr *hdr)
+{
+	struct sim_msg *msg = (void *)hdr;
+	u32 *tag = nvkm_msgqueue_cmd_data(queue, hdr);
+
+	/* Only batches carry data, posts always went without. */
+	if (tag && *tag != msg->tag) {
+		printf("reply %d: data for %d\n", msg->tag, *tag);
+		errors++;
+	}
+	sim_reply(hdr);
+
+	if (msg->tag % SIM_CHAIN == 0)
+		sim_chain(queue);
+}
+
+static int
+sim_init_callback(struct nvkm_msgqueue *queue, struct nvkm_msgqueue_hdr *hdr)
+{
+	complete_all(&queue->init_done);
+	return 0;
+}
+
+static const struct nvkm_msgqueue_init_func
+sim_init = {
+	.init_callback = sim_init_callback,
+};
+
+static struct nvkm_msgqueue_queue *
+sim_cmd_queue(struct nvkm_msgqueue *queue, enum msgqueue_msg_priority prio)
+{
+	return &cmdq;
+}
+
+static void
+sim_recv(struct nvkm_msgqueue *queue)
+{
+	nvkm_msgqueue_process_msgs(queue, &msgq);
+}
+
+static const struct nvkm_msgqueue_func
+sim_msgqueue = {
+	.init_func = &sim_init,
+	.cmd_queue = sim_cmd_queue,
+	.recv = sim_recv,
+};
+
+/* Let the firmware catch up with everything that's been posted. */
+static void
+sim_run(struct nvkm_msgqueue *queue)
+{
+	do {
+		sim_firmware();
+		nvkm_msgqueue_recv(queue);
+	} while (fw_tag != sent && !errors);
+}
+
+int
+main(int argc, char **argv)
+{
+	struct nvkm_device device = {};
+	struct nvkm_subdev pmu = {};
+	struct nvkm_msgqueue queue = {};
+	struct nvkm_msgqueue_cmd cmds[NVKM_MSGQUEUE_NUM_SEQUENCES];
+	struct sim_cmd cmd[NVKM_MSGQUEUE_NUM_SEQUENCES];
+	struct completion done[NVKM_MSGQUEUE_NUM_SEQUENCES];
+	const char *dbg = "fatal"; /* rewinds are logged as errors */
+	int loops = 1000, batch = 8;
+	unsigned int seed = 1;
+	u32 tags[NVKM_MSGQUEUE_NUM_SEQUENCES], head = SIM_MSGQ;
+	u64 posted[2] = {}, updates[2] = {}, heads, max = 0;
+	int ret, c, i, j, nr;
+
+	while ((c = getopt(argc, argv, "b:d:n:")) != -1) {
+		switch (c) {
+		case 'b': batch = strtol(optarg, NULL, 0); break;
+		case 'd': dbg = optarg; break;
+		case 'n': loops = strtol(optarg, NULL, 0); break;
+		default:
+			fprintf(stderr, "usage: %s [-b batch] [-n loops] "
+					"[-d debug]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	/* Follow-ups need sequences of their own while the batch drains. */
+	if (batch < 1 || batch > NVKM_MSGQUEUE_NUM_SEQUENCES / 2 || loops < 1) {
+		fprintf(stderr, "invalid batch/loop count\n");
+		return 1;
+	}
+
+	ret = sim_device_init(&device, "nv_msgqueue", NULL, dbg);
+	if (ret) {
+		fprintf(stderr, "failed to create device: %d\n", ret);
+		return 1;
+	}
+
+	nvkm_subdev_ctor(&sim_pmu, &device, NVKM_SUBDEV_PMU, &pmu);
+	nvkm_falcon_ctor(&sim_falcon, &pmu, "PMU", SIM_FALCON, &falcon);
+	nvkm_msgqueue_ctor(&sim_msgqueue, &falcon, &queue);
+
+	mutex_init(&cmdq.mutex);
+	cmdq.offset = SIM_CMDQ;
+	cmdq.size = SIM_CMDQ_SIZE;
+	cmdq.head_reg = SIM_CMDQ_HEAD;
+	cmdq.tail_reg = SIM_CMDQ_TAIL;
+	nvkm_falcon_wr32(&falcon, SIM_CMDQ_HEAD, SIM_CMDQ);
+	nvkm_falcon_wr32(&falcon, SIM_CMDQ_TAIL, SIM_CMDQ);
+
+	mutex_init(&msgq.mutex);
+	msgq.index = 1;
+	msgq.offset = SIM_MSGQ;
+	msgq.size = SIM_MSGQ_SIZE;
+	msgq.head_reg = SIM_MSGQ_HEAD;
+	msgq.tail_reg = SIM_MSGQ_TAIL;
+
+	/* The firmware announces itself before anything else. */
+	sim_msg(&head, SIM_MSGQ, 0x0f, 0, 0);
+	nvkm_falcon_wr32(&falcon, SIM_MSGQ_TAIL, SIM_MSGQ);
+	nvkm_falcon_wr32(&falcon, SIM_MSGQ_HEAD, head);
+	nvkm_msgqueue_recv(&queue);
+	if (!completion_done(&queue.init_done)) {
+		printf("init message not handled\n");
+		return 1;
+	}
+
+	for (i = 0; i < loops && !errors; i++) {
+		nr = 1 + rand_r(&seed) % batch;
+		for (j = 0; j < nr; j++) {
+			sim_cmd(&cmd[j], &seed);
+			tags[j] = cmd[j].tag;
+			init_completion(&done[j]);
+			cmds[j] = (struct nvkm_msgqueue_cmd) {
+				.hdr = &cmd[j].hdr,
+				.callback = sim_callback,
+				.completion = &done[j],
+				.data = &tags[j],
+			};
+		}
+
+		if (i & 1) {
+			ret = nvkm_msgqueue_submit(&queue,
+						   MSGQUEUE_MSG_PRIORITY_HIGH,
+						   cmds, nr, true);
+			if (ret != nr) {
+				printf("submit %d: %d\n", nr, ret);
+				errors++;
+			}
+			updates[1]++;
+		} else {
+			for (j = 0; j < nr && !errors; j++) {
+				ret = nvkm_msgqueue_post(&queue,
+						MSGQUEUE_MSG_PRIORITY_HIGH,
+						cmds[j].hdr, sim_callback,
+						cmds[j].completion, true);
+				if (ret) {
+					printf("post: %d\n", ret);
+					errors++;
+				}
+			}
+			updates[0] += nr;
+		}
+		posted[i & 1] += nr;
+		max = max_t(u64, max, nr);
+
+		sim_run(&queue);
+
+		for (j = 0; j < nr && !errors; j++) {
+			if (!completion_done(&done[j])) {
+				printf("command %d not completed\n", cmd[j].tag);
+				errors++;
+			}
+		}
+	}
+
+	/* Every follow-up went out on its own. */
+	heads = updates[0] + updates[1] + follow;
+
+	if (!errors && (acked != sent || queue.stats.cmds != sent ||
+			queue.stats.msgs != sent || queue.stats.heads != heads ||
+			queue.stats.inflight || queue.stats.inflight_max < max ||
+			queue.stats.inflight_max > NVKM_MSGQUEUE_NUM_SEQUENCES)) {
+		printf("stats: %llu cmds, %llu msgs, %llu HEAD updates, "
+		       "%u/%u in flight, expected %u/%u/%llu/0/%llu\n",
+		       queue.stats.cmds, queue.stats.msgs, queue.stats.heads,
+		       queue.stats.inflight, queue.stats.inflight_max,
+		       sent, sent, heads, max);
+		errors++;
+	}
+
+	printf("%-9s %9s %9s\n", "", "commands", "HEADs");
+	printf("%-9s %9llu %9llu\n", "post", posted[0], updates[0]);
+	printf("%-9s %9llu %9llu\n", "submit", posted[1], updates[1]);
+	printf("%-9s %9u %9u\n", "follow-up", follow, follow);
+	printf("max %u in flight, %lluus average latency\n",
+	       queue.stats.inflight_max, queue.stats.msgs ?
+	       div64_u64(queue.stats.latency, queue.stats.msgs) : 0);
+
+	sim_device_fini(&device);
+	return errors ? 1 : 0;
+}
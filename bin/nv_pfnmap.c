@@ -0,0 +1,377 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sim.h"
+#include "../lib/priv.h"
+
+#include <subdev/mmu/vmm.h>
+
+/* Maps 2MiB windows of PFNs into GP100 and GP10B address spaces, the way
+ * SVM does, with the backing memory fragmented to varying degrees, and
+ * counts what it costs: DMA mappings, TLB flushes, VMAs, and how many
+ * of the pages ended up behind 64KiB and 4KiB PTEs.
+ *
+ * The DMA API is backed by a simulated IOMMU, which hands out addresses
+ * with a hole between each mapping, and complains about any unmap that
+ * doesn't match exactly one mapping.  Each window is checked by walking
+ * the page tables, translating through the IOMMU, and comparing against
+ * the PFNs that were mapped, once fully mapped, again after a piece that
+ * doesn't line up with anything is cleared from its middle, and once more
+ * after the whole window is mapped again, over what was left of it.
+ *
+ * Usage: nv_pfnmap [cycles]
+ */
+
+#define SIM_PAGES 512
+#define SIM_HOLE_PAGE 37
+#define SIM_HOLE_SIZE 300
+
+static const struct {
+	const char *name;
+	u32 run;	/* pages per physically contiguous run */
+	u32 skew;	/* pages by which runs miss 64KiB alignment */
+	bool vram;
+} sim_layouts[] = {
+	{ "host 4KiB",       1, 0 },
+	{ "host 8KiB",       2, 0 },
+	{ "host 32KiB",      8, 0 },
+	{ "host 64KiB",     16, 0 },
+	{ "host 64KiB+4K",  16, 1 },
+	{ "host 2MiB",     512, 0 },
+	{ "host 2MiB+4K",  512, 1 },
+	{ "vram 4KiB",       1, 0, true },
+	{ "vram 64KiB",     16, 0, true },
+	{ "vram 2MiB+4K",  512, 1, true },
+};
+
+/* Each mapping gets a 4MiB slot of IOVA space, which leaves a hole after
+ * it, and makes finding it again a matter of a shift.
+ */
+#define SIM_IOVA_BASE (1ULL << 32)
+#define SIM_IOVA_SLOT 22
+
+static struct {
+	dma_addr_t addr;
+	u64 phys;
+	u64 size;
+} sim_iommu[4 * SIM_PAGES];
+static int sim_iommu_nr;
+static u64 sim_iova;
+static u32 sim_maps;
+static u32 sim_flushes;
+static int errors;
+
+static dma_addr_t
+sim_dma_map(u64 phys, u64 size)
+{
+	const u64 slot = sim_iova % ARRAY_SIZE(sim_iommu);
+
+	if (sim_iommu[slot].size || size > (1ULL << (SIM_IOVA_SLOT - 1)))
+		return DMA_MAPPING_ERROR;
+
+	sim_iommu[slot].addr = SIM_IOVA_BASE + (sim_iova++ << SIM_IOVA_SLOT);
+	sim_iommu[slot].phys = phys;
+	sim_iommu[slot].size = size;
+	sim_iommu_nr++;
+	sim_maps++;
+	return sim_iommu[slot].addr;
+}
+
+static int
+sim_iommu_slot(dma_addr_t addr)
+{
+	if (addr < SIM_IOVA_BASE)
+		return -1;
+	return ((addr - SIM_IOVA_BASE) >> SIM_IOVA_SLOT) % ARRAY_SIZE(sim_iommu);
+}
+
+static void
+sim_dma_unmap(dma_addr_t addr, u64 size)
+{
+	int slot = sim_iommu_slot(addr);
+
+	if (slot >= 0 && sim_iommu[slot].addr == addr &&
+	    sim_iommu[slot].size == size) {
+		sim_iommu[slot].size = 0;
+		sim_iommu_nr--;
+		return;
+	}
+
+	printf("dma_unmap_page(%010llx, %llx) doesn't match any mapping\n",
+	       addr, size);
+	errors++;
+}
+
+static bool
+sim_iommu_phys(dma_addr_t addr, u64 *phys)
+{
+	int slot = sim_iommu_slot(addr);
+
+	if (slot >= 0 && addr - sim_iommu[slot].addr < sim_iommu[slot].size) {
+		*phys = sim_iommu[slot].phys + (addr - sim_iommu[slot].addr);
+		return true;
+	}
+
+	return false;
+}
+
+static struct nvkm_vmm *vmm;
+static u64 sim_pfn[SIM_PAGES];
+
+static u64
+sim_rd64(struct nvkm_mmu_pt *pt, u32 ptei)
+{
+	return (u64)nvkm_ro32(pt->memory, pt->base + ptei * 8 + 4) << 32 |
+		    nvkm_ro32(pt->memory, pt->base + ptei * 8 + 0);
+}
+
+/* Look addr up the way the MMU would: the LPTE, unless it's unmapped, in
+ * which case the SPTE decides.  Returns the page size, or 0 on a fault.
+ */
+static int
+sim_translate(u64 addr, u64 *pfn)
+{
+	struct nvkm_vmm_pt *pgt = vmm->pd;
+	u64 data = 0, phys;
+	int shift = 16;
+
+	pgt = pgt->pde[(addr >> 47) & 0x003];
+	if (!NVKM_VMM_PDE_INVALID(pgt))
+		pgt = pgt->pde[(addr >> 38) & 0x1ff];
+	if (!NVKM_VMM_PDE_INVALID(pgt))
+		pgt = pgt->pde[(addr >> 29) & 0x1ff];
+	if (!NVKM_VMM_PDE_INVALID(pgt))
+		pgt = pgt->pde[(addr >> 21) & 0x0ff];
+	if (NVKM_VMM_PDE_INVALID(pgt))
+		return 0;
+
+	if (pgt->pt[0])
+		data = sim_rd64(pgt->pt[0], (addr >> 16) & 0x1f);
+	if (!data && pgt->pt[1]) {
+		data = sim_rd64(pgt->pt[1], (addr >> 12) & 0x1ff);
+		shift = 12;
+	}
+	if (!(data & BIT_ULL(0)))
+		return 0;
+
+	phys  = (data & 0x003fffffffffff00ULL) << 4;
+	phys += addr & ((1ULL << shift) - 1) & ~0xfffULL;
+	if (((data >> 1) & 3) == 0) {
+		*pfn = phys | NVKM_VMM_PFN_VRAM;
+	} else
+	if (sim_iommu_phys(phys, &phys)) {
+		*pfn = phys;
+	} else {
+		printf("%010llx: PTE points at %010llx, which isn't mapped\n",
+		       addr, phys);
+		errors++;
+		return 0;
+	}
+
+	*pfn |= NVKM_VMM_PFN_W | NVKM_VMM_PFN_V;
+	if (data & BIT_ULL(6))
+		*pfn &= ~NVKM_VMM_PFN_W;
+	return shift;
+}
+
+/* Pages from first to first + count are expected to be unmapped, the rest
+ * to be mapped as they were asked to be.
+ */
+static void
+sim_verify(const char *name, const char *what, u64 base, u32 first, u32 count,
+	   u32 *large, u32 *small)
+{
+	u64 pfn;
+	int i, shift;
+
+	*large = *small = 0;
+	for (i = 0; i < SIM_PAGES; i++) {
+		const bool hole = i - first < count;
+
+		shift = sim_translate(base + ((u64)i << 12), &pfn);
+		if (shift == 16)
+			*large += 1;
+		if (shift == 12)
+			*small += 1;
+
+		if (hole ? shift != 0 : (!shift || pfn != sim_pfn[i])) {
+			printf("%s: %s: page %d is %016llx, expected %016llx\n",
+			       name, what, i, shift ? pfn : 0,
+			       hole ? 0 : sim_pfn[i]);
+			errors++;
+			break;
+		}
+	}
+}
+
+static u32
+sim_vmas(u64 base)
+{
+	struct nvkm_vma *vma = nvkm_vmm_node_search(vmm, base);
+	u32 nr = 0;
+
+	list_for_each_entry_from(vma, &vmm->list, head) {
+		if (vma->addr >= base + (SIM_PAGES << 12))
+			break;
+		nr += vma->mapped;
+	}
+
+	return nr;
+}
+
+static void
+sim_layout(int l, u64 base, int cycles, const char *chip)
+{
+	const u32 run = sim_layouts[l].run;
+	u64 phys = 0x40000000 + (sim_layouts[l].skew << 12), pfn[SIM_PAGES];
+	u32 maps, flushes, vmas, large, small, i;
+	s64 time;
+
+	for (i = 0; i < SIM_PAGES; i++) {
+		const u32 chunk = ((i / run) * 37) % (SIM_PAGES / run);
+		sim_pfn[i]  = phys + ((u64)(chunk * run + i % run) << 12);
+		sim_pfn[i] |= NVKM_VMM_PFN_W | NVKM_VMM_PFN_V;
+		if (sim_layouts[l].vram)
+			sim_pfn[i] |= NVKM_VMM_PFN_VRAM;
+	}
+
+	time = ktime_to_ns(ktime_get());
+	for (i = 0; i < cycles; i++) {
+		memcpy(pfn, sim_pfn, sizeof(pfn));
+		mutex_lock(&vmm->mutex);
+		nvkm_vmm_pfn_map(vmm, 12, base, SIM_PAGES << 12, pfn);
+		nvkm_vmm_pfn_unmap(vmm, base, SIM_PAGES << 12);
+		mutex_unlock(&vmm->mutex);
+	}
+	time = ktime_to_ns(ktime_get()) - time;
+
+	sim_maps = sim_flushes = 0;
+	memcpy(pfn, sim_pfn, sizeof(pfn));
+	mutex_lock(&vmm->mutex);
+	nvkm_vmm_pfn_map(vmm, 12, base, SIM_PAGES << 12, pfn);
+	mutex_unlock(&vmm->mutex);
+	maps = sim_maps;
+	flushes = sim_flushes;
+	vmas = sim_vmas(base);
+	sim_verify(chip, sim_layouts[l].name, base, 0, 0, &large, &small);
+
+	printf("%-6s %-14s %6u %6u %6u %6u %6u %10lld\n", chip,
+	       sim_layouts[l].name, maps, flushes, vmas, large, small,
+	       div64_s64(time, cycles));
+
+	mutex_lock(&vmm->mutex);
+	nvkm_vmm_pfn_unmap(vmm, base + (SIM_HOLE_PAGE << 12),
+			   SIM_HOLE_SIZE << 12);
+	mutex_unlock(&vmm->mutex);
+	sim_verify(chip, "cleared", base, SIM_HOLE_PAGE, SIM_HOLE_SIZE,
+		   &large, &small);
+
+	memcpy(pfn, sim_pfn, sizeof(pfn));
+	mutex_lock(&vmm->mutex);
+	nvkm_vmm_pfn_map(vmm, 12, base, SIM_PAGES << 12, pfn);
+	mutex_unlock(&vmm->mutex);
+	sim_verify(chip, "remapped", base, 0, 0, &large, &small);
+
+	mutex_lock(&vmm->mutex);
+	nvkm_vmm_pfn_unmap(vmm, base, SIM_PAGES << 12);
+	mutex_unlock(&vmm->mutex);
+	sim_verify(chip, "unmapped", base, 0, SIM_PAGES, &large, &small);
+
+	if (sim_iommu_nr) {
+		printf("%s: %s: %d DMA mapping(s) left behind\n", chip,
+		       sim_layouts[l].name, sim_iommu_nr);
+		errors++;
+		memset(sim_iommu, 0x00, sizeof(sim_iommu));
+		sim_iommu_nr = 0;
+	}
+}
+
+static void
+sim_flush(struct nvkm_vmm *vmm, int depth)
+{
+	sim_flushes++;
+}
+
+static int
+sim_chip(struct nvkm_device *device, const char *chip, bool tegra, int cycles)
+{
+	struct nvkm_vmm_func *func;
+	struct nvkm_subdev *subdev;
+	struct nvkm_vma *vma;
+	int ret, i;
+
+	if (tegra)
+		ret = gp10b_mmu_new(device, NVKM_SUBDEV_MMU, &device->mmu);
+	else
+		ret = gp100_mmu_new(device, NVKM_SUBDEV_MMU, &device->mmu);
+	if (ret == 0) {
+		ret = device->mmu->func->vmm.ctor(device->mmu, false, 0, 0,
+						  NULL, 0, NULL, chip, &vmm);
+	}
+	if (ret)
+		return ret;
+
+	/* There's no TLB to flush, just count how often it would be. */
+	func = kmemdup(vmm->func, sizeof(*func) + 7 * sizeof(func->page[0]),
+		       GFP_KERNEL);
+	if (!func)
+		return -ENOMEM;
+	func->flush = sim_flush;
+	vmm->func = func;
+
+	ret = nvkm_vmm_get(vmm, 21, 2 * SIM_PAGES << 12, &vma);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < ARRAY_SIZE(sim_layouts); i++) {
+		/* There's no VRAM on Tegra. */
+		if (!tegra || !sim_layouts[i].vram)
+			sim_layout(i, vma->addr + (SIM_PAGES << 12), cycles, chip);
+	}
+
+	nvkm_vmm_put(vmm, &vma);
+	nvkm_vmm_unref(&vmm);
+	kfree(func);
+	nvkm_mmu_ptc_dump(device->mmu);
+	subdev = &device->mmu->subdev;
+	nvkm_subdev_del(&subdev);
+	return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	struct nvkm_device device = { .type = NVKM_DEVICE_PCIE };
+	int cycles = argc > 1 ? strtol(argv[1], NULL, 0) : 200;
+	int ret;
+
+	if (cycles < 1) {
+		fprintf(stderr, "invalid cycle count\n");
+		return 1;
+	}
+
+	os_dma_map_sim = sim_dma_map;
+	os_dma_unmap_sim = sim_dma_unmap;
+
+	/* GP100 page tables live in VRAM. */
+	sim_imem_target = NVKM_MEM_TARGET_VRAM;
+
+	ret = sim_device_init(&device, "nv_pfnmap", NULL, "fatal");
+	if (ret) {
+		fprintf(stderr, "failed to create device: %d\n", ret);
+		return 1;
+	}
+
+	printf("%-6s %-14s %6s %6s %6s %6s %6s %10s\n", "", "", "dma",
+	       "flush", "vmas", "64KiB", "4KiB", "ns/cycle");
+	if ((ret = sim_chip(&device, "gp100", false, cycles)) ||
+	    (ret = sim_chip(&device, "gp10b", true, cycles))) {
+		fprintf(stderr, "failed to create vmm: %d\n", ret);
+		return 1;
+	}
+
+	printf("%d error(s)\n", errors);
+	sim_device_fini(&device);
+	return errors ? 1 : 0;
+}
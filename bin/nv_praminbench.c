@@ -0,0 +1,263 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sim.h"
+
+#include <core/mm.h>
+#include <subdev/fb.h>
+
+/* Measures the throughput of instance memory accesses that go through
+ * PRAMIN, against simulated VRAM, for each of the backends that can run
+ * on the simulated device:
+ *
+ * - nv04: PRAMIN is directly visible in BAR0.
+ * - nv50: objects without a BAR2 mapping, accessed through the 1MiB
+ *         window that's moved around VRAM by 0x001700.
+ *
+ * Each object is written and filled one word at a time, the way it used
+ * to be done, and with the block ops, alternately.  Everything is read
+ * back with the other method, and checked, after every pass, and the
+ * first word that doesn't match is reported.  All backends are run, one
+ * after the other on a fresh device, unless one is picked with -b.
+ *
+ * NV40 accesses objects through an ioremap() of a PCI BAR, which the
+ * simulated device doesn't have.  NV50's BAR2 path needs a BAR too, and
+ * nv_bar2evict sets up a simulated one.
+ */
+
+#define SIM_VRAM (256 << 20)
+
+enum { WR, RD, FILL };
+
+static struct nvkm_fb fb;
+static struct nvkm_ram ram;
+
+static s64
+pass(struct nvkm_memory *memory, u32 *data, u32 size, bool block, int op)
+{
+	s64 time = ktime_to_ns(ktime_get());
+	u32 i;
+
+	nvkm_kmap(memory);
+	if (block) {
+		switch (op) {
+		case WR: nvkm_memory_wr(memory, 0, data, size); break;
+		case RD: nvkm_memory_rd(memory, 0, data, size); break;
+		default:
+			nvkm_memory_fill(memory, 0, data[0], size);
+			break;
+		}
+	} else {
+		for (i = 0; i < size; i += 4) {
+			switch (op) {
+			case WR: nvkm_wo32(memory, i, data[i / 4]); break;
+			case RD: data[i / 4] = nvkm_ro32(memory, i); break;
+			default:
+				nvkm_wo32(memory, i, data[0]);
+				break;
+			}
+		}
+	}
+	nvkm_done(memory);
+
+	return ktime_to_ns(ktime_get()) - time;
+}
+
+static int
+check(int obj, const u32 *data, const u32 *temp, u32 size, bool fill)
+{
+	u32 i;
+
+	for (i = 0; i < size / 4; i++) {
+		if (temp[i] != data[fill ? 0 : i]) {
+			printf("object %d: %s %08x: %08x, expected %08x\n",
+			       obj, fill ? "fill" : "wr", i * 4, temp[i],
+			       data[fill ? 0 : i]);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static int
+nv50_vram(struct nvkm_device *device)
+{
+	mutex_init(&fb.subdev.mutex);
+	fb.ram = &ram;
+	ram.fb = &fb;
+	ram.size = SIM_VRAM;
+	device->fb = &fb;
+	return nvkm_mm_init(&ram.vram, NVKM_RAM_MM_NORMAL, 0,
+			    SIM_VRAM >> NVKM_RAM_MM_SHIFT, 1);
+}
+
+static s64
+MiB(u64 bytes, s64 time)
+{
+	return div64_s64(bytes * 1000000000 / (1 << 20), max_t(s64, time, 1));
+}
+
+static int
+nv04_new(struct nvkm_device *device)
+{
+	return nv04_instmem_new(device, NVKM_SUBDEV_INSTMEM, &device->imem);
+}
+
+static int
+nv50_new(struct nvkm_device *device)
+{
+	/* No BAR, so it's PRAMIN or nothing. */
+	int ret = nv50_vram(device);
+	if (ret)
+		return ret;
+	return nv50_instmem_new(device, NVKM_SUBDEV_INSTMEM, &device->imem);
+}
+
+static const struct {
+	const char *name;
+	int (*new)(struct nvkm_device *);
+} sim_backends[] = {
+	{ "nv04", nv04_new },
+	{ "nv50", nv50_new },
+};
+
+static u32 *data, *temp;
+
+static int
+bench(int b, int objs, u32 size, int loops, const char *dbg)
+{
+	struct nvkm_device device = {};
+	struct nvkm_memory *memory[objs];
+	struct nvkm_subdev *subdev;
+	s64 time[2][3] = {};
+	int errors = 0, ret, j, k;
+	u32 i;
+
+	/* Swap the host-memory instmem for the real thing. */
+	ret = sim_device_init(&device, "nv_praminbench", NULL, dbg);
+	if (ret == 0) {
+		subdev = &device.imem->subdev;
+		nvkm_subdev_del(&subdev);
+		ret = sim_backends[b].new(&device);
+	}
+
+	if (ret == 0)
+		ret = nvkm_subdev_init(&device.imem->subdev);
+	for (j = 0; j < objs; j++)
+		memory[j] = NULL;
+	for (j = 0; ret == 0 && j < objs; j++)
+		ret = nvkm_instobj_new(device.imem, size, 0x1000, true,
+				       NVKM_MEM_TARGET_INST, &memory[j]);
+	if (ret) {
+		fprintf(stderr, "%s: failed to create objects: %d\n",
+			sim_backends[b].name, ret);
+		return -1;
+	}
+
+	for (k = 0; k < loops && !errors; k++) {
+		for (j = 0; j < objs && !errors; j++) {
+			const bool block = (j + k) & 1;
+
+			for (i = 0; i < size / 4; i++)
+				data[i] = (k << 24 | j << 16) ^ i;
+
+			/* Read back with the other method to the one written
+			 * with, so each is checked against the other.
+			 */
+			time[block][WR] += pass(memory[j], data, size, block,
+						WR);
+			memset(temp, 0x00, size);
+			time[!block][RD] += pass(memory[j], temp, size, !block,
+						 RD);
+			errors += check(j, data, temp, size, false);
+
+			data[0] = ~data[0];
+			time[block][FILL] += pass(memory[j], data, size, block,
+						  FILL);
+			memset(temp, 0x00, size);
+			time[!block][RD] += pass(memory[j], temp, size, !block,
+						 RD);
+			errors += check(j, data, temp, size, true);
+		}
+	}
+
+	for (j = 0; j < 2 && !errors; j++) {
+		const u64 bytes = (u64)size * objs * loops / 2;
+		printf("%-7s %-6s %10lld %10lld %10lld\n",
+		       sim_backends[b].name, j ? "block" : "word",
+		       MiB(bytes, time[j][WR]), MiB(bytes, time[j][FILL]),
+		       MiB(bytes * 2, time[j][RD]));
+	}
+
+	for (j = 0; j < objs; j++)
+		nvkm_memory_unref(&memory[j]);
+	sim_device_fini(&device);
+	if (device.fb)
+		nvkm_mm_fini(&ram.vram);
+	return errors;
+}
+
+int
+main(int argc, char **argv)
+{
+	const char *dbg = "error";
+	const char *backend = NULL;
+	int objs = 16, loops = 64, errors = 0;
+	u32 size = 16 << 10;
+	int ret, b, c;
+
+	while ((c = getopt(argc, argv, "b:d:n:o:s:")) != -1) {
+		switch (c) {
+		case 'b': backend = optarg; break;
+		case 'd': dbg = optarg; break;
+		case 'n': loops = strtol(optarg, NULL, 0); break;
+		case 'o': objs = strtol(optarg, NULL, 0); break;
+		case 's': size = strtol(optarg, NULL, 0); break;
+		default:
+			fprintf(stderr, "usage: %s [-b nv04|nv50] [-o objects] "
+					"[-s size] [-n loops] [-d debug]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+
+	size = ALIGN(size, 4);
+	if (objs < 1 || loops < 1 || !size || size > (1 << 20) ||
+	    (u64)objs * ALIGN(size, 4096) > SIM_VRAM) {
+		fprintf(stderr, "invalid object count/size\n");
+		return 1;
+	}
+
+	for (b = 0; backend && b < ARRAY_SIZE(sim_backends); b++) {
+		if (!strcmp(backend, sim_backends[b].name))
+			break;
+	}
+
+	if (b == ARRAY_SIZE(sim_backends)) {
+		fprintf(stderr, "unknown backend %s\n", backend);
+		return 1;
+	}
+
+	data = malloc(size);
+	temp = malloc(size);
+	if (!data || !temp)
+		return 1;
+
+	printf("%d object(s) of %d bytes, %d loop(s), MiB/s:\n", objs, size,
+	       loops);
+	printf("%-7s %-6s %10s %10s %10s\n", "", "", "wr", "fill", "rd");
+	for (; b < ARRAY_SIZE(sim_backends); b++) {
+		if ((ret = bench(b, objs, size, loops, dbg)) < 0)
+			return 1;
+		errors += ret;
+		if (backend)
+			break;
+	}
+
+	free(data);
+	free(temp);
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,134 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <nvif/client.h>
+#include <nvif/device.h>
+#include <nvif/class.h>
+#include <nvif/if0001.h>
+
+#include "util.h"
+
+/* Streams the device's telemetry ring, one line per record.  Use "-b null"
+ * to run against the simulated device, where nothing can be measured and
+ * every field reads as unavailable, but records are still produced.
+ */
+
+#define RECORDS 64
+
+static void
+field(int val, int div)
+{
+	if (val < 0)
+		printf(" %8s", "-");
+	else
+		printf(" %8d", val / div);
+}
+
+int
+main(int argc, char **argv)
+{
+	struct nvif_client client;
+	struct nvif_device device;
+	struct nvif_object ctrl;
+	struct nvif_control_telemetry_info_v0 info = {};
+	struct nvif_control_telemetry_period_v0 period = {};
+	struct nvif_control_telemetry_read_v0 *args;
+	u32 size = sizeof(*args) + RECORDS * sizeof(args->data[0]);
+	int loops = -1, ms = 100;
+	bool sim;
+	u32 seq;
+	int ret, c, i;
+
+	while ((c = getopt(argc, argv, "n:p:"U_GETOPT)) != -1) {
+		switch (c) {
+		case 'n': loops = strtol(optarg, NULL, 0); break;
+		case 'p': ms = strtol(optarg, NULL, 0); break;
+		default:
+			if (!u_option(c))
+				return 1;
+			break;
+		}
+	}
+
+	if (ms <= 0) {
+		fprintf(stderr, "invalid period\n");
+		return 1;
+	}
+
+	/* The simulated device has no hardware to detect or map. */
+	sim = u_drv && !strcmp(u_drv, "null");
+	ret = u_device("lib", argv[0], "error", !sim, !sim, sim ? 0 : ~0ULL,
+		       0x00000000, &client, &device);
+	if (ret)
+		return ret;
+
+	ret = nvif_object_init(&device.object, 0, NVIF_CLASS_CONTROL, NULL, 0,
+			       &ctrl);
+	if (ret)
+		goto fail_ctrl;
+
+	period.period = ms;
+	ret = nvif_mthd(&ctrl, NVIF_CONTROL_TELEMETRY_PERIOD,
+			&period, sizeof(period));
+	if (ret == 0) {
+		ret = nvif_mthd(&ctrl, NVIF_CONTROL_TELEMETRY_INFO,
+				&info, sizeof(info));
+	}
+
+	if (ret)
+		goto fail_info;
+
+	if (!(args = malloc(size))) {
+		ret = -ENOMEM;
+		goto fail_info;
+	}
+
+	printf("period %dms, %d record(s) held, clocks in MHz\n",
+	       info.period, info.count);
+	printf("%10s %12s %8s %8s %8s %8s %8s %8s %8s %8s %8s\n", "seq",
+	       "time(ms)", "temp(C)", "fan(%)", "fan(rpm)", "pwr(mW)",
+	       "volt(mV)", "clk0", "clk1", "clk2", "clk3");
+
+	seq = info.seq;
+	while (loops) {
+		memset(args, 0x00, sizeof(*args));
+		args->count = RECORDS;
+		args->seq = seq;
+
+		ret = nvif_mthd(&ctrl, NVIF_CONTROL_TELEMETRY_READ, args, size);
+		if (ret)
+			break;
+
+		if (args->count && args->seq != seq)
+			printf("%u record(s) lost\n", args->seq - seq);
+
+		for (i = 0; i < args->count && loops; i++, loops--) {
+			struct nvif_control_telemetry_v0 *rec = &args->data[i];
+			int j;
+
+			printf("%10u %12llu", rec->seq, rec->time / 1000000);
+			field(rec->temp, 1);
+			field(rec->fan_duty, 1);
+			field(rec->fan_rpm, 1);
+			field(rec->power, 1000);
+			field(rec->voltage, 1000);
+			for (j = 0; j < ARRAY_SIZE(rec->clock); j++)
+				field(rec->clock[j], 1000);
+			printf("\n");
+			seq = rec->seq + 1;
+		}
+
+		fflush(stdout);
+		usleep(ms * 1000);
+	}
+
+	free(args);
+fail_info:
+	nvif_object_fini(&ctrl);
+fail_ctrl:
+	nvif_device_fini(&device);
+	nvif_client_fini(&client);
+	return ret;
+}
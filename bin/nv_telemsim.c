@@ -0,0 +1,248 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "sim.h"
+
+#include <core/client.h>
+#include <engine/device/ctrl.h>
+#include <engine/device/telem.h>
+#include <subdev/therm/priv.h>
+
+#include <nvif/if0001.h>
+
+/* Runs the telemetry service on a simulated device with only a thermal
+ * subdev, whose fan tachometer takes a while to read, as the GPIO polling
+ * in nvkm_therm_fan_sense() does.  The timer's alarms are run by hand.
+ *
+ * Checks that the sample period is kept within 100-4000ms (0 still
+ * stops it), that the tachometer isn't read more than once a second
+ * however often records are taken, that every record still carries the
+ * last speed read, and that nothing is sampled once the service has been
+ * stopped.
+ *
+ * Then goes through the control object's methods, as a client would, and
+ * checks that only a supervisor may change the period, and that a read
+ * from a sequence number that's not been reached yet is refused rather
+ * than wrapping around to return the whole ring.
+ */
+
+static unsigned long sense_ms = 25;
+static u64 senses;
+static int errors;
+
+static int
+sim_temp_get(struct nvkm_therm *therm)
+{
+	return 45;
+}
+
+static int
+sim_fan_sense(struct nvkm_therm *therm)
+{
+	msleep(sense_ms);
+	return 1000 + ++senses;
+}
+
+static const struct nvkm_therm_func
+sim_therm = {
+	.temp_get = sim_temp_get,
+	.fan_sense = sim_fan_sense,
+};
+
+static void
+sim_period(struct nvkm_device *device, u32 period, u32 expect)
+{
+	u32 ret = nvkm_telem_period(device, period);
+
+	if (ret != expect) {
+		printf("period %ums: got %ums, expected %ums\n",
+		       period, ret, expect);
+		errors++;
+	}
+}
+
+static int
+sim_control(struct nvkm_device *device, bool super, u32 mthd,
+	    void *data, u32 size)
+{
+	struct nvkm_client client = { .super = super };
+	struct nvkm_oclass oclass = { .client = &client };
+	struct nvkm_object *object;
+	int ret;
+
+	ret = nvkm_control_oclass.ctor(device, &oclass, NULL, 0, &object);
+	if (ret == 0) {
+		ret = nvkm_object_mthd(object, mthd, data, size);
+		nvkm_object_del(&object);
+	}
+	return ret;
+}
+
+/* Control methods, as a client would call them, in order.  'arg' is the
+ * period to set, or where to read from relative to the next record, and
+ * 'want' the records a read should return.  A refused period change has
+ * to leave the period as it was.
+ */
+static const struct {
+	const char *name;
+	bool super;
+	bool read;
+	s32 arg;
+	int ret;
+	u32 want;
+} sim_methods[] = {
+	{ "period (user)",   false, false,   0, -EACCES },
+	{ "period (super)",  true,  false, 250,       0 },
+	{ "read (ahead)",    false, true,    5, -EINVAL },
+	{ "read (next)",     false, true,    0,       0, 0 },
+	{ "read (last two)", false, true,   -2,       0, 2 },
+};
+
+static void
+sim_method(struct nvkm_device *device, int m)
+{
+	struct {
+		struct nvif_control_telemetry_read_v0 args;
+		struct nvif_control_telemetry_v0 data[4];
+	} rd = {};
+	struct nvif_control_telemetry_period_v0 pd = {};
+	u32 period, count, seq, want;
+	bool ok;
+	int ret;
+
+	nvkm_telem_info(device, &period, &count, &seq);
+	if (sim_methods[m].read) {
+		rd.args.count = ARRAY_SIZE(rd.data);
+		rd.args.seq = seq + sim_methods[m].arg;
+		ret = sim_control(device, sim_methods[m].super,
+				  NVIF_CONTROL_TELEMETRY_READ, &rd, sizeof(rd));
+		want = sim_methods[m].want;
+		ok = ret || (rd.args.count == want &&
+			     rd.args.seq == seq + sim_methods[m].arg &&
+			     (!want || rd.data[want - 1].seq ==
+				       rd.args.seq + want - 1));
+		printf("%-16s %4d, %u record(s)", sim_methods[m].name, ret,
+		       ret ? 0 : rd.args.count);
+	} else {
+		pd.period = sim_methods[m].arg;
+		ret = sim_control(device, sim_methods[m].super,
+				  NVIF_CONTROL_TELEMETRY_PERIOD, &pd, sizeof(pd));
+		want = ret ? period : sim_methods[m].arg;
+		nvkm_telem_info(device, &period, &count, &seq);
+		ok = period == want;
+		printf("%-16s %4d, period %ums", sim_methods[m].name, ret,
+		       period);
+	}
+
+	if (ret != sim_methods[m].ret || !ok) {
+		printf(", expected %d", sim_methods[m].ret);
+		if (sim_methods[m].read && !sim_methods[m].ret)
+			printf(", %u from %u", want, seq + sim_methods[m].arg);
+		else if (!sim_methods[m].read)
+			printf(", period %ums", want);
+		errors++;
+	}
+	printf("\n");
+}
+
+int
+main(int argc, char **argv)
+{
+	struct nvif_control_telemetry_v0 recs[256];
+	struct nvkm_device device = {};
+	struct nvkm_therm therm = {};
+	const char *dbg = "error";
+	int loops = 25, ms = 100;
+	u32 period, count, seq, nr, i;
+	s64 time;
+	int ret, c;
+
+	while ((c = getopt(argc, argv, "d:f:n:p:")) != -1) {
+		switch (c) {
+		case 'd': dbg = optarg; break;
+		case 'f': sense_ms = strtol(optarg, NULL, 0); break;
+		case 'n': loops = strtol(optarg, NULL, 0); break;
+		case 'p': ms = strtol(optarg, NULL, 0); break;
+		default:
+			fprintf(stderr, "usage: %s [-n periods] [-p period_ms] "
+					"[-f ms_per_sense] [-d debug]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+
+	if (loops < 1 || loops > 200 || ms < 100 || ms > 4000) {
+		fprintf(stderr, "invalid period count/length\n");
+		return 1;
+	}
+
+	ret = sim_device_init(&device, "nv_telemsim", "NvTelemetry=1", dbg);
+	if (ret == 0)
+		ret = nvkm_telem_ctor(&device);
+	if (ret) {
+		fprintf(stderr, "failed to create device: %d\n", ret);
+		return 1;
+	}
+	therm.func = &sim_therm;
+	therm.subdev.device = &device;
+	device.therm = &therm;
+
+	nvkm_telem_info(&device, &period, &count, &seq);
+	if (period != 100) {
+		printf("NvTelemetry=1: got %ums, expected 100ms\n", period);
+		errors++;
+	}
+
+	sim_period(&device, 0, 0);
+	sim_period(&device, 1, 100);
+	sim_period(&device, 99, 100);
+	sim_period(&device, 250, 250);
+	sim_period(&device, 5000, 4000);
+	sim_period(&device, ~0, 4000);
+	sim_period(&device, ms, ms);
+
+	nvkm_telem_init(&device);
+	time = ktime_to_ns(ktime_get());
+	while (ktime_to_ns(ktime_get()) - time < loops * ms * 1000000LL) {
+		nvkm_timer_alarm_trigger(device.timer);
+		usleep(1000);
+	}
+	nvkm_telem_fini(&device);
+	time = ktime_to_ns(ktime_get()) - time;
+
+	seq = 0;
+	nr = ARRAY_SIZE(recs);
+	nvkm_telem_read(&device, &seq, recs, &nr);
+	printf("%u record(s) in %lldms, %llu fan sense(s)\n", nr,
+	       time / 1000000, senses);
+	if (!nr || senses > time / 1000000000 + 1) {
+		printf("fan sensed too often\n");
+		errors++;
+	}
+
+	for (i = 0; i < nr; i++) {
+		if (recs[i].temp != 45 || recs[i].fan_rpm <= 1000 ||
+		    recs[i].fan_rpm > 1000 + senses) {
+			printf("record %u: temp %d, fan %drpm\n", recs[i].seq,
+			       recs[i].temp, recs[i].fan_rpm);
+			errors++;
+		}
+	}
+
+	nvkm_timer_alarm_trigger(device.timer);
+	msleep(ms * 2);
+	nvkm_timer_alarm_trigger(device.timer);
+	nvkm_telem_info(&device, &period, &count, &seq);
+	if (count != nr) {
+		printf("%u record(s) taken after fini\n", count - nr);
+		errors++;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(sim_methods); i++)
+		sim_method(&device, i);
+
+	nvkm_telem_dtor(&device);
+	sim_device_fini(&device);
+	return errors ? 1 : 0;
+}
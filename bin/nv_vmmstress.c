@@ -0,0 +1,570 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/prctl.h>
+
+#include "sim.h"
+#include "../lib/priv.h"
+
+#include <core/client.h>
+#include <subdev/mmu/umem.h>
+#include <subdev/mmu/ummu.h>
+#include <subdev/mmu/uvmm.h>
+#include <subdev/mmu/vmm.h>
+
+#include <nvif/if000a.h>
+#include <nvif/if000c.h>
+
+/* Drives the uvmm methods from several threads at once, the way separate
+ * clients sharing an address space would, with every page table access
+ * sleeping for a while, as if it were an uncached access across the bus.
+ *
+ * Each thread either works on 64KiB regions of its own, which it maps,
+ * unmaps, puts and gets again, checking its PTEs after every method, or
+ * on a handful of regions shared by all threads.  Threads working on the
+ * shared regions unmap at addresses they've looked up beforehand, which
+ * may no longer be the start of a VMA by the time the method runs, and
+ * their PTEs are checked against the VMAs once all threads are done.
+ * Either way, all regions must be unmapped, and all DMA mappings made by
+ * PFN maps released, once the regions have been put.
+ *
+ * "overlap" is the average number of threads that were stalled on a page
+ * table access whenever one started, ie. how many of them the locks let
+ * update page tables at the same time.
+ *
+ * Usage: nv_vmmstress [methods per thread]
+ */
+
+#define SIM_THREADS 8
+#define SIM_PAGES 16
+#define SIM_SHARED 4
+#define SIM_STALL 20000
+
+#define SIM_PHYS 0x0000000100000000ULL /* PFNs, by GPU virtual address */
+#define SIM_DMA  0x0000000200000000ULL /* memory objects, by thread */
+#define SIM_IOVA 0x0000010000000000ULL /* DMA mappings made for PFNs */
+
+struct sim_thread {
+	pthread_t thread;
+	int id;
+	unsigned int seed;
+	u64 addr;
+	struct nvkm_object *umem;
+	dma_addr_t dma[SIM_PAGES];
+	u32 done, refused;
+};
+
+static const struct sim_chip {
+	const char *name;
+	int (*new)(struct nvkm_device *, int, struct nvkm_mmu **);
+	u64 (*pte)(u64 addr);
+	bool pfn;
+} *chip;
+
+static struct sim_thread sim_thread[SIM_THREADS];
+static struct nvkm_object *uvmm;
+static struct nvkm_vmm *vmm;
+static u64 sim_region[SIM_SHARED];
+static bool sim_pfn, sim_shared;
+static long sim_dma_bytes;
+static int sim_methods;
+static int errors;
+
+/* There's no IOMMU, PFNs are simply moved up to the SIM_IOVA window. */
+static dma_addr_t
+sim_dma_map(u64 phys, u64 size)
+{
+	__sync_fetch_and_add(&sim_dma_bytes, size);
+	return SIM_IOVA + phys;
+}
+
+static void
+sim_dma_unmap(dma_addr_t addr, u64 size)
+{
+	__sync_fetch_and_sub(&sim_dma_bytes, size);
+}
+
+/* Page tables are read behind the back of the stalling accessors. */
+static u32
+sim_rd32(struct nvkm_mmu_pt *pt, u32 offset)
+{
+	return *(u32 *)(sim_instobj(pt->memory)->data + pt->base + offset);
+}
+
+static u64
+nv44_pte(u64 addr)
+{
+	struct nvkm_mmu_pt *pt = vmm->pd->pt[0];
+	const u32 ptei = addr >> 12;
+	const u32 pteo = (ptei << 2) & ~0x0000000f;
+	u32 tmp[4], i, data;
+
+	for (i = 0; i < 4; i++)
+		tmp[i] = sim_rd32(pt, pteo + i * 4);
+
+	switch (ptei & 3) {
+	case 0: data = tmp[0] & 0x07ffffff; break;
+	case 1: data = tmp[0] >> 27 | (tmp[1] & 0x003fffff) << 5; break;
+	case 2: data = tmp[1] >> 22 | (tmp[2] & 0x0001ffff) << 10; break;
+	default:
+		data = tmp[2] >> 17 | (tmp[3] & 0x00000fff) << 15;
+		break;
+	}
+
+	return data ? (u64)data << 12 | NVKM_VMM_PFN_V : 0;
+}
+
+static u64
+gp100_pte(u64 addr)
+{
+	struct nvkm_vmm_pt *pgt = vmm->pd;
+	u64 data = 0, phys;
+
+	pgt = pgt->pde[(addr >> 47) & 0x003];
+	if (!NVKM_VMM_PDE_INVALID(pgt))
+		pgt = pgt->pde[(addr >> 38) & 0x1ff];
+	if (!NVKM_VMM_PDE_INVALID(pgt))
+		pgt = pgt->pde[(addr >> 29) & 0x1ff];
+	if (!NVKM_VMM_PDE_INVALID(pgt))
+		pgt = pgt->pde[(addr >> 21) & 0x0ff];
+	if (NVKM_VMM_PDE_INVALID(pgt))
+		return 0;
+
+	if (pgt->pt[0]) {
+		const u32 ptei = (addr >> 16) & 0x1f;
+		data = (u64)sim_rd32(pgt->pt[0], ptei * 8 + 4) << 32 |
+			    sim_rd32(pgt->pt[0], ptei * 8 + 0);
+		if (data & BIT_ULL(0))
+			addr &= 0xf000;
+		else
+			data = 0;
+	}
+	if (!data && pgt->pt[1]) {
+		const u32 ptei = (addr >> 12) & 0x1ff;
+		data = (u64)sim_rd32(pgt->pt[1], ptei * 8 + 4) << 32 |
+			    sim_rd32(pgt->pt[1], ptei * 8 + 0);
+		addr = 0;
+	}
+	if (!(data & BIT_ULL(0)))
+		return 0;
+
+	phys = ((data & 0x003fffffffffff00ULL) << 4) + addr;
+	if (((data >> 1) & 3) == 0)
+		return phys | NVKM_VMM_PFN_VRAM | NVKM_VMM_PFN_V;
+	if (phys >= SIM_IOVA)
+		phys -= SIM_IOVA;
+	return phys | NVKM_VMM_PFN_V;
+}
+
+static const struct sim_chip
+sim_chips[] = {
+	{ "nv44",  nv44_mmu_new,  nv44_pte },
+	{ "gp100", gp100_mmu_new, gp100_pte, true },
+};
+
+/* PFNs follow the GPU virtual address, and alternate between host memory
+ * and VRAM every 64KiB, so all threads map the same thing at any address.
+ */
+static u64
+sim_pfn_at(u64 addr)
+{
+	u64 pfn = (SIM_PHYS + addr) | NVKM_VMM_PFN_W | NVKM_VMM_PFN_V;
+	if (addr & BIT_ULL(16))
+		pfn |= NVKM_VMM_PFN_VRAM;
+	return pfn;
+}
+
+/* What the PTE at addr should translate to, going by its VMA. */
+static u64
+sim_want(u64 addr)
+{
+	struct nvkm_vma *vma = nvkm_vmm_node_search(vmm, addr);
+	int i;
+
+	if (!vma || !vma->mapped)
+		return 0;
+
+	if (!vma->memory)
+		return sim_pfn_at(addr) & ~NVKM_VMM_PFN_W;
+
+	for (i = 0; i < SIM_THREADS; i++) {
+		if (nvkm_umem(sim_thread[i].umem)->memory == vma->memory) {
+			const u32 page = (addr >> 12) % SIM_PAGES;
+			return sim_thread[i].dma[page] | NVKM_VMM_PFN_V;
+		}
+	}
+
+	return ~0ULL;
+}
+
+static bool
+sim_check(const char *what, u64 base)
+{
+	u64 addr, want, data;
+
+	mutex_lock(&vmm->mutex);
+	for (addr = base; addr < base + (SIM_PAGES << 12); addr += 0x1000) {
+		want = sim_want(addr);
+		data = chip->pte(addr);
+		if (data != want) {
+			printf("%s: %s: %010llx is %016llx, expected %016llx\n",
+			       chip->name, what, addr, data, want);
+			__sync_fetch_and_add(&errors, 1);
+			break;
+		}
+	}
+	mutex_unlock(&vmm->mutex);
+	return addr == base + (SIM_PAGES << 12);
+}
+
+static int
+sim_get(u64 *addr)
+{
+	struct nvif_vmm_get_v0 args = {
+		.type = sim_pfn ? NVIF_VMM_GET_V0_ADDR : NVIF_VMM_GET_V0_PTES,
+		.page = sim_pfn ? 0 : 12,
+		.align = 16,
+		.size = SIM_PAGES << 12,
+	};
+	int ret;
+
+	ret = nvkm_object_mthd(uvmm, NVIF_VMM_V0_GET, &args, sizeof(args));
+	*addr = args.addr;
+	return ret;
+}
+
+static int
+sim_put(u64 addr)
+{
+	struct nvif_vmm_put_v0 args = { .addr = addr };
+	return nvkm_object_mthd(uvmm, NVIF_VMM_V0_PUT, &args, sizeof(args));
+}
+
+static int
+sim_map(struct sim_thread *t, u64 addr, u32 pages)
+{
+	struct nvif_vmm_map_v0 args = {
+		.addr = addr,
+		.size = pages << 12,
+		.memory = t->umem->object,
+		.offset = ((addr >> 12) % SIM_PAGES) << 12,
+	};
+	return nvkm_object_mthd(uvmm, NVIF_VMM_V0_MAP, &args, sizeof(args));
+}
+
+/* Unmap whatever VMA covered addr when we looked. */
+static int
+sim_unmap(u64 addr)
+{
+	struct nvif_vmm_unmap_v0 args = { .addr = addr };
+	struct nvkm_vma *vma;
+
+	mutex_lock(&vmm->mutex);
+	if ((vma = nvkm_vmm_node_search(vmm, addr)))
+		args.addr = vma->addr;
+	mutex_unlock(&vmm->mutex);
+
+	return nvkm_object_mthd(uvmm, NVIF_VMM_V0_UNMAP, &args, sizeof(args));
+}
+
+static int
+sim_pfnmap(u64 addr, u32 pages)
+{
+	struct {
+		struct nvif_vmm_pfnmap_v0 v0;
+		u64 phys[SIM_PAGES];
+	} args = {
+		.v0.page = 12,
+		.v0.addr = addr,
+		.v0.size = pages << 12,
+	};
+	int i;
+
+	for (i = 0; i < pages; i++)
+		args.phys[i] = sim_pfn_at(addr + (i << 12));
+
+	return nvkm_object_mthd(uvmm, NVIF_VMM_V0_PFNMAP, &args,
+				sizeof(args.v0) + pages * sizeof(args.phys[0]));
+}
+
+static int
+sim_pfnclr(u64 addr, u32 pages)
+{
+	struct nvif_vmm_pfnclr_v0 args = {
+		.addr = addr,
+		.size = pages << 12,
+	};
+	return nvkm_object_mthd(uvmm, NVIF_VMM_V0_PFNCLR, &args, sizeof(args));
+}
+
+static void *
+sim_worker(void *data)
+{
+	struct sim_thread *t = data;
+	int i, ret;
+
+	for (i = 0; i < sim_methods && !errors; i++) {
+		const u32 r = rand_r(&t->seed);
+		const u32 o = r % SIM_PAGES;
+		const u32 n = 1 + (r >> 4) % (SIM_PAGES - o);
+		const u64 base = sim_shared ? sim_region[(r >> 8) % SIM_SHARED]
+					    : t->addr;
+		const u64 addr = base + (o << 12);
+
+		switch ((r >> 12) % 4) {
+		case 0:
+		case 1:
+			if (sim_pfn)
+				ret = sim_pfnmap(addr, n);
+			else
+				ret = sim_map(t, addr, n);
+			break;
+		case 2:
+			if (sim_pfn)
+				ret = sim_pfnclr(addr, n);
+			else
+				ret = sim_unmap(addr);
+			break;
+		default:
+			if (sim_shared) {
+				if (sim_pfn)
+					ret = sim_pfnclr(base, SIM_PAGES);
+				else
+					ret = sim_unmap(base);
+				break;
+			}
+
+			if ((ret = sim_put(t->addr)) ||
+			    (ret = sim_get(&t->addr))) {
+				printf("%s: thread %d: put/get failed: %d\n",
+				       chip->name, t->id, ret);
+				__sync_fetch_and_add(&errors, 1);
+				return NULL;
+			}
+			break;
+		}
+
+		if (ret)
+			t->refused++;
+		else
+			t->done++;
+
+		if (!sim_shared)
+			sim_check("own region", t->addr);
+	}
+
+	return NULL;
+}
+
+static void
+sim_run(bool pfn, bool shared, int threads)
+{
+	u32 done = 0, refused = 0;
+	u64 *addr;
+	s64 time;
+	int i, nr;
+
+	sim_pfn = pfn;
+	sim_shared = shared;
+
+	for (i = 0; i < SIM_SHARED && shared; i++) {
+		if (sim_get(&sim_region[i])) {
+			printf("%s: get failed\n", chip->name);
+			errors++;
+			return;
+		}
+	}
+
+	for (i = 0; i < threads; i++) {
+		sim_thread[i].done = sim_thread[i].refused = 0;
+		sim_thread[i].seed = i;
+		if (!shared && sim_get(&sim_thread[i].addr)) {
+			printf("%s: get failed\n", chip->name);
+			errors++;
+			return;
+		}
+	}
+
+	sim_imem_stalls = sim_imem_overlap = 0;
+	sim_imem_stall = SIM_STALL;
+	time = ktime_to_ns(ktime_get());
+	for (i = 0; i < threads; i++) {
+		pthread_create(&sim_thread[i].thread, NULL, sim_worker,
+			       &sim_thread[i]);
+	}
+	for (i = 0; i < threads; i++) {
+		pthread_join(sim_thread[i].thread, NULL);
+		done += sim_thread[i].done;
+		refused += sim_thread[i].refused;
+	}
+	time = ktime_to_ns(ktime_get()) - time;
+	sim_imem_stall = 0;
+
+	printf("%-6s %-9s %-7s %7d %6u %7u %8lld %7.2f\n", chip->name,
+	       pfn ? "pfn" : "map", shared ? "shared" : "own", threads,
+	       done, refused, time / 1000000,
+	       (double)sim_imem_overlap / max_t(u64, sim_imem_stalls, 1));
+
+	addr = shared ? sim_region : NULL;
+	nr = shared ? SIM_SHARED : threads;
+	for (i = 0; i < nr; i++) {
+		const u64 base = addr ? addr[i] : sim_thread[i].addr;
+		if (sim_check("after", base) && sim_put(base)) {
+			printf("%s: put failed\n", chip->name);
+			errors++;
+		}
+		sim_check("put", base);
+	}
+
+	if (sim_dma_bytes) {
+		printf("%s: %ld bytes of DMA mappings left behind\n",
+		       chip->name, sim_dma_bytes);
+		errors++;
+		sim_dma_bytes = 0;
+	}
+}
+
+static const struct nvkm_device_func
+sim_device = {
+};
+
+static int
+sim_chip(struct nvkm_device *device, int methods)
+{
+	struct nvif_vmm_v0 vargs = {};
+	struct {
+		struct nvif_mem_v0 mem;
+		struct nvif_mem_ram_v0 ram;
+	} margs = {};
+	struct nvkm_client *client;
+	struct nvkm_ummu ummu = {};
+	struct nvkm_oclass oclass = {};
+	struct nvkm_vmm_func *func;
+	struct nvkm_subdev *subdev;
+	struct nvkm_object *object;
+	int type, ret, i, j;
+
+	ret = chip->new(device, NVKM_SUBDEV_MMU, &device->mmu);
+	if (ret == 0)
+		ret = nvkm_subdev_init(&device->mmu->subdev);
+	if (ret == 0) {
+		ret = nvkm_client_new("nv_vmmstress", 0, NULL, "fatal", NULL,
+				      &client);
+	}
+	if (ret)
+		return ret;
+
+	/* PFN maps are only for privileged clients. */
+	client->super = true;
+	ummu.mmu = device->mmu;
+	oclass.client = client;
+	oclass.parent = &ummu.object;
+	oclass.base = device->mmu->func->vmm.user;
+
+	ret = nvkm_uvmm_new(&oclass, &vargs, sizeof(vargs), &uvmm);
+	if (ret)
+		return ret;
+	vmm = nvkm_uvmm(uvmm)->vmm;
+
+	/* There's no TLB to flush. */
+	for (i = 0; vmm->func->page[i].shift; i++);
+	func = kmemdup(vmm->func, sizeof(*func) + (i + 1) *
+		       sizeof(func->page[0]), GFP_KERNEL);
+	if (!func)
+		return -ENOMEM;
+	func->flush = NULL;
+	vmm->func = func;
+
+	for (type = 0; type < device->mmu->type_nr; type++) {
+		if (device->mmu->type[type].type & NVKM_MEM_HOST)
+			break;
+	}
+
+	/* A memory object for each thread, with pages it can recognise. */
+	for (i = 0; i < SIM_THREADS; i++) {
+		struct sim_thread *t = &sim_thread[i];
+
+		for (j = 0; j < SIM_PAGES; j++)
+			t->dma[j] = SIM_DMA + ((u64)i << 24) + (j << 12);
+
+		margs.mem.type = type;
+		margs.mem.page = 12;
+		margs.mem.size = SIM_PAGES << 12;
+		margs.ram.dma = t->dma;
+		oclass.base = device->mmu->func->mem.user;
+		oclass.object = 0x1000 + i;
+
+		ret = nvkm_umem_new(&oclass, &margs, sizeof(margs), &t->umem);
+		if (ret || !nvkm_object_insert(t->umem))
+			return ret ? ret : -EEXIST;
+		t->id = i;
+	}
+
+	sim_methods = methods;
+	sim_run(false, false, 1);
+	sim_run(false, false, SIM_THREADS);
+	sim_run(false, true, SIM_THREADS);
+	if (chip->pfn) {
+		sim_run(true, false, 1);
+		sim_run(true, false, SIM_THREADS);
+		sim_run(true, true, SIM_THREADS);
+	}
+
+	for (i = 0; i < SIM_THREADS; i++)
+		nvkm_object_del(&sim_thread[i].umem);
+	nvkm_object_del(&uvmm);
+	kfree(func);
+	nvkm_mmu_ptc_dump(device->mmu);
+	object = &client->object;
+	nvkm_object_del(&object);
+	subdev = &device->mmu->subdev;
+	nvkm_subdev_del(&subdev);
+	return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	struct nvkm_device device = {
+		.type = NVKM_DEVICE_PCIE,
+		.func = &sim_device,
+	};
+	int methods = argc > 1 ? strtol(argv[1], NULL, 0) : 200;
+	int ret, i;
+
+	if (methods < 1) {
+		fprintf(stderr, "invalid method count\n");
+		return 1;
+	}
+
+	/* Sleep for about as long as asked to. */
+	prctl(PR_SET_TIMERSLACK, 1);
+
+	os_dma_map_sim = sim_dma_map;
+	os_dma_unmap_sim = sim_dma_unmap;
+
+	ret = sim_device_init(&device, "nv_vmmstress", NULL, "fatal");
+	if (ret) {
+		fprintf(stderr, "failed to create device: %d\n", ret);
+		return 1;
+	}
+
+	printf("%-6s %-9s %-7s %7s %6s %7s %8s %7s\n", "", "methods",
+	       "regions", "threads", "done", "refused", "ms", "overlap");
+	for (i = 0; i < ARRAY_SIZE(sim_chips); i++) {
+		chip = &sim_chips[i];
+		/* GP100 page tables live in VRAM. */
+		sim_imem_target = chip->pfn ? NVKM_MEM_TARGET_VRAM :
+					      NVKM_MEM_TARGET_INST;
+		if ((ret = sim_chip(&device, methods))) {
+			fprintf(stderr, "%s: failed to create vmm: %d\n",
+				chip->name, ret);
+			return 1;
+		}
+	}
+
+	printf("%d error(s)\n", errors);
+	sim_device_fini(&device);
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,279 @@
+#ifndef __SIM_H__
+#define __SIM_H__
+#include <sched.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <nvif/os.h>
+
+#include <core/device.h>
+#include <core/memory.h>
+#include <subdev/instmem/priv.h>
+#include <subdev/timer/priv.h>
+
+/* Pieces shared by the tools that drive nvkm code against simulated
+ * hardware, standing in for what a real device would provide:
+ *
+ * - BAR0 is a plain register file, reads return whatever was last written.
+ * - PTIMER counts host nanoseconds, and its alarms never fire.
+ * - Instance memory is host memory, always mapped, and reports itself as
+ *   being in sim_imem_target (INST, unless a tool says otherwise).  Word
+ *   accesses through the accessor functions can be slowed down to
+ *   something closer to the cost of an uncached access across the bus,
+ *   with sim_imem_delay, or made to give up the CPU with sim_imem_yield,
+ *   so that threads racing on the same memory interleave even on a
+ *   single CPU.  sim_imem_stall instead sleeps through each access, the
+ *   way a CPU waiting on the bus would leave others to get on with their
+ *   own work, and keeps count of how many threads were stalled at once.
+ */
+
+#define SIM_MMIO_SIZE 0x01000000
+
+static unsigned long sim_imem_delay; /* ns per rd32/wr32 */
+static bool sim_imem_yield;
+static unsigned long sim_imem_stall; /* ns per rd32/wr32, sleeping */
+static int sim_imem_stalled;
+static u64 sim_imem_stalls, sim_imem_overlap;
+static enum nvkm_memory_target sim_imem_target = NVKM_MEM_TARGET_INST;
+
+static inline void
+sim_imem_access(void)
+{
+	if (sim_imem_delay)
+		ndelay(sim_imem_delay);
+	if (sim_imem_yield)
+		sched_yield();
+	if (sim_imem_stall) {
+		struct timespec ts = { .tv_nsec = sim_imem_stall };
+		const int nr = __sync_add_and_fetch(&sim_imem_stalled, 1);
+		__sync_fetch_and_add(&sim_imem_overlap, nr);
+		__sync_fetch_and_add(&sim_imem_stalls, 1);
+		nanosleep(&ts, NULL);
+		__sync_fetch_and_sub(&sim_imem_stalled, 1);
+	}
+}
+
+static inline u64
+sim_timer_read(struct nvkm_timer *tmr)
+{
+	return ktime_to_ns(ktime_get());
+}
+
+static inline void
+sim_timer_alarm_init(struct nvkm_timer *tmr, u32 time)
+{
+}
+
+static inline void
+sim_timer_alarm_fini(struct nvkm_timer *tmr)
+{
+}
+
+static const struct nvkm_timer_func
+sim_timer = {
+	.read = sim_timer_read,
+	.alarm_init = sim_timer_alarm_init,
+	.alarm_fini = sim_timer_alarm_fini,
+};
+
+struct sim_instobj {
+	struct nvkm_instobj base;
+	struct nvkm_instmem *imem;
+	void *data;
+	u64 addr;
+	u32 size;
+};
+
+#define sim_instobj(p) container_of((p), struct sim_instobj, base.memory)
+
+static inline enum nvkm_memory_target
+sim_instobj_target(struct nvkm_memory *memory)
+{
+	return sim_imem_target;
+}
+
+static inline u8
+sim_instobj_page(struct nvkm_memory *memory)
+{
+	return 12;
+}
+
+static inline u64
+sim_instobj_addr(struct nvkm_memory *memory)
+{
+	return sim_instobj(memory)->addr;
+}
+
+/* Objects are always mapped, at their made-up address. */
+static inline u64
+sim_instobj_bar2(struct nvkm_memory *memory)
+{
+	return sim_instobj(memory)->addr;
+}
+
+static inline u64
+sim_instobj_size(struct nvkm_memory *memory)
+{
+	return sim_instobj(memory)->size;
+}
+
+static inline void __iomem *
+sim_instobj_acquire(struct nvkm_memory *memory)
+{
+	return sim_instobj(memory)->data;
+}
+
+static inline void
+sim_instobj_release(struct nvkm_memory *memory)
+{
+}
+
+static inline void *
+sim_instobj_dtor(struct nvkm_memory *memory)
+{
+	struct sim_instobj *iobj = sim_instobj(memory);
+	nvkm_instobj_dtor(iobj->imem, &iobj->base);
+	free(iobj->data);
+	return iobj;
+}
+
+static const struct nvkm_memory_func
+sim_instobj_func = {
+	.dtor = sim_instobj_dtor,
+	.target = sim_instobj_target,
+	.page = sim_instobj_page,
+	.bar2 = sim_instobj_bar2,
+	.addr = sim_instobj_addr,
+	.size = sim_instobj_size,
+	.acquire = sim_instobj_acquire,
+	.release = sim_instobj_release,
+};
+
+static inline u32
+sim_instobj_rd32(struct nvkm_memory *memory, u64 offset)
+{
+	sim_imem_access();
+	return *(volatile u32 *)(sim_instobj(memory)->data + offset);
+}
+
+static inline void
+sim_instobj_wr32(struct nvkm_memory *memory, u64 offset, u32 data)
+{
+	sim_imem_access();
+	*(volatile u32 *)(sim_instobj(memory)->data + offset) = data;
+}
+
+static inline void
+sim_instobj_rd(struct nvkm_memory *memory, u64 offset, void *data, u32 size)
+{
+	memcpy(data, sim_instobj(memory)->data + offset, size);
+}
+
+static inline void
+sim_instobj_wr(struct nvkm_memory *memory, u64 offset, const void *data,
+	       u32 size)
+{
+	memcpy(sim_instobj(memory)->data + offset, data, size);
+}
+
+static inline void
+sim_instobj_fill(struct nvkm_memory *memory, u64 offset, u32 data, u32 size)
+{
+	memset32(sim_instobj(memory)->data + offset, data, size / 4);
+}
+
+static const struct nvkm_memory_ptrs
+sim_instobj_ptrs = {
+	.rd32 = sim_instobj_rd32,
+	.wr32 = sim_instobj_wr32,
+	.rd = sim_instobj_rd,
+	.wr = sim_instobj_wr,
+	.fill = sim_instobj_fill,
+};
+
+static inline int
+sim_instobj_new(struct nvkm_instmem *imem, u32 size, u32 align, bool zero,
+		enum nvkm_memory_target target, struct nvkm_memory **pmemory)
+{
+	static u64 addr = 0x100000;
+	struct sim_instobj *iobj;
+
+	if (!(iobj = kzalloc(sizeof(*iobj), GFP_KERNEL)))
+		return -ENOMEM;
+	*pmemory = &iobj->base.memory;
+
+	nvkm_instobj_ctor(&sim_instobj_func, imem, target, &iobj->base);
+	iobj->base.memory.ptrs = &sim_instobj_ptrs;
+	iobj->imem = imem;
+
+	size = ALIGN(size, 4);
+	align = max_t(u32, align, 16);
+	if (!(iobj->data = aligned_alloc(align, ALIGN(size, align))))
+		return -ENOMEM;
+	memset(iobj->data, 0x00, size);
+
+	/* Hand out made-up, but unique and aligned, addresses. */
+	spin_lock(&imem->lock);
+	iobj->addr = addr = ALIGN(addr, align);
+	addr += size;
+	spin_unlock(&imem->lock);
+	iobj->size = size;
+	return 0;
+}
+
+static const struct nvkm_instmem_func
+sim_instmem = {
+	.memory_new = sim_instobj_new,
+	.zero = true,
+};
+
+/* Set up a device with as much as most of the tools need, further subdevs
+ * can be created by the caller once this has succeeded.
+ */
+static inline int
+sim_device_init(struct nvkm_device *device, const char *name,
+		const char *cfg, const char *dbg)
+{
+	struct device *dev;
+	int ret;
+
+	if (!(dev = kzalloc(sizeof(*dev), GFP_KERNEL)))
+		return -ENOMEM;
+	snprintf(dev->name, sizeof(dev->name), "%s", name);
+
+	device->dev = dev;
+	device->name = name;
+	device->cfgopt = cfg ? cfg : "";
+	device->dbgopt = dbg ? dbg : "error";
+	mutex_init(&device->mutex);
+	INIT_LIST_HEAD(&device->head);
+
+	if (!(device->pri = calloc(1, SIM_MMIO_SIZE)))
+		return -ENOMEM;
+
+	ret = nvkm_timer_new_(&sim_timer, device, NVKM_SUBDEV_TIMER,
+			      &device->timer);
+	if (ret)
+		return ret;
+
+	if (!(device->imem = kzalloc(sizeof(*device->imem), GFP_KERNEL)))
+		return -ENOMEM;
+	nvkm_instmem_ctor(&sim_instmem, device, NVKM_SUBDEV_INSTMEM,
+			  device->imem);
+	return 0;
+}
+
+static inline void
+sim_device_fini(struct nvkm_device *device)
+{
+	struct nvkm_subdev *subdev;
+
+	subdev = &device->imem->subdev;
+	nvkm_subdev_del(&subdev);
+	subdev = &device->timer->subdev;
+	nvkm_subdev_del(&subdev);
+	free(device->pri);
+	kfree(device->dev);
+}
+#endif
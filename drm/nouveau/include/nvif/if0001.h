@@ -5,6 +5,9 @@
 #define NVIF_CONTROL_PSTATE_INFO                                           0x00
 #define NVIF_CONTROL_PSTATE_ATTR                                           0x01
 #define NVIF_CONTROL_PSTATE_USER                                           0x02
+#define NVIF_CONTROL_TELEMETRY_INFO                                        0x03
+#define NVIF_CONTROL_TELEMETRY_PERIOD                                      0x04
+#define NVIF_CONTROL_TELEMETRY_READ                                        0x05
 
 struct nvif_control_pstate_info_v0 {
 	__u8  version;
@@ -44,4 +47,49 @@ struct nvif_control_pstate_user_v0 {
 	__s8  pwrsrc; /*  in: target power source */
 	__u8  pad03[5];
 };
+
+struct nvif_control_telemetry_info_v0 {
+	__u8  version;
+	__u8  pad01[3];
+	__u32 period; /* out: sample period in ms, 0 if stopped */
+	__u32 count; /* out: number of records held by the ring */
+	__u32 seq; /* out: sequence number of the next record */
+};
+
+struct nvif_control_telemetry_period_v0 {
+	__u8  version;
+	__u8  pad01[3];
+	__u32 period; /*  in: sample period in ms, 0 to stop, supervisor only
+		       * out: sample period in effect, 100-4000ms
+		       */
+};
+
+/* Fields that can't be read on this device hold a negative error code. */
+struct nvif_control_telemetry_v0 {
+	__u64 time; /* ns, CLOCK_MONOTONIC */
+	__u32 seq;
+	__s32 temp; /* degrees C */
+	__s32 fan_duty; /* percent */
+	__s32 fan_rpm;
+	__s32 power; /* uW */
+	__s32 voltage; /* uV */
+#define NVIF_CONTROL_TELEMETRY_V0_CLOCK_NR                                    4
+	__s32 clock[NVIF_CONTROL_TELEMETRY_V0_CLOCK_NR]; /* kHz, in the order
+							 * of PSTATE_ATTR
+							 */
+};
+
+struct nvif_control_telemetry_read_v0 {
+	__u8  version;
+	__u8  pad01[3];
+	__u32 count; /*  in: number of records there's space for
+		      * out: number of records returned
+		      */
+	__u32 seq; /*  in: sequence number of first record wanted, no later
+		    *      than the next one, or -EINVAL
+		    * out: sequence number of first record returned
+		    */
+	__u8  pad0c[4];
+	struct nvif_control_telemetry_v0 data[];
+};
 #endif
@@ -40,4 +40,5 @@ void nvkm_gpuobj_memcpy_to(struct nvkm_gpuobj *dst, u32 dstoffset, void *src,
 			   u32 length);
 void nvkm_gpuobj_memcpy_from(void *dst, struct nvkm_gpuobj *src, u32 srcoffset,
 			     u32 length);
+void nvkm_gpuobj_fill(struct nvkm_gpuobj *, u32 offset, u32 data, u32 length);
 #endif
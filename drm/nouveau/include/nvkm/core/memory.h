@@ -16,6 +16,7 @@ enum nvkm_memory_target {
 	NVKM_MEM_TARGET_VRAM, /* video memory */
 	NVKM_MEM_TARGET_HOST, /* coherent system memory */
 	NVKM_MEM_TARGET_NCOH, /* non-coherent system memory */
+	NVKM_MEM_TARGET_INST_SR_LOST, /* instance memory - not preserved across suspend */
 };
 
 struct nvkm_memory {
@@ -42,6 +43,10 @@ struct nvkm_memory_func {
 struct nvkm_memory_ptrs {
 	u32 (*rd32)(struct nvkm_memory *, u64 offset);
 	void (*wr32)(struct nvkm_memory *, u64 offset, u32 data);
+	/* Optional block transfers, offset/size are 32-bit aligned. */
+	void (*rd)(struct nvkm_memory *, u64 offset, void *data, u32 size);
+	void (*wr)(struct nvkm_memory *, u64 offset, const void *data, u32 size);
+	void (*fill)(struct nvkm_memory *, u64 offset, u32 data, u32 size);
 };
 
 void nvkm_memory_ctor(const struct nvkm_memory_func *, struct nvkm_memory *);
@@ -54,6 +59,10 @@ int nvkm_memory_tags_get(struct nvkm_memory *, struct nvkm_device *, u32 tags,
 			 struct nvkm_tags **);
 void nvkm_memory_tags_put(struct nvkm_memory *, struct nvkm_device *,
 			  struct nvkm_tags **);
+void nvkm_memory_rd(struct nvkm_memory *, u64 offset, void *data, u32 size);
+void nvkm_memory_wr(struct nvkm_memory *, u64 offset, const void *data,
+		    u32 size);
+void nvkm_memory_fill(struct nvkm_memory *, u64 offset, u32 data, u32 size);
 
 #define nvkm_memory_target(p) (p)->func->target(p)
 #define nvkm_memory_page(p) (p)->func->page(p)
@@ -47,6 +47,20 @@ struct nvkm_falcon {
 		u8 ports;
 	} data;
 
+	/* Staging buffer for IMEM/DMEM uploads via the falcon's DMA engine. */
+	struct {
+		bool enable;
+		struct mutex mutex;
+		struct nvkm_memory *mem;
+	} dma;
+
+	struct {
+		u64 bytes;
+		u64 time;
+		u32 dma;
+		u32 pio;
+	} load;
+
 	struct nvkm_engine engine;
 };
 
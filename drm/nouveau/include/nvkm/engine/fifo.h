@@ -41,6 +41,15 @@ struct nvkm_fifo {
 	struct list_head chan;
 	spinlock_t lock;
 
+	/* Idle channel instance blocks, kept joined to their VMM. */
+	struct {
+		struct mutex mutex;
+		struct list_head list;
+		int max; /* per-VMM */
+		u64 hit;
+		u64 miss;
+	} pool;
+
 	struct nvkm_event uevent; /* async user trigger */
 	struct nvkm_event cevent; /* channel creation event */
 	struct nvkm_event kevent; /* channel killed */
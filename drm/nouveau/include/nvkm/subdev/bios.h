@@ -21,6 +21,9 @@ struct nvkm_bios {
 		u8 micro;
 		u8 patch;
 	} version;
+
+	struct nvbios_initx *initx;
+	struct nvbios_index *index;
 };
 
 u8  nvbios_checksum(const u8 *data, int size);
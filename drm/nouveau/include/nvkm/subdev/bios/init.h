@@ -17,6 +17,7 @@ struct nvbios_init {
 	u32 repeat;
 	u32 repend;
 	u32 ramcfg;
+	struct nvbios_init_trace *trace;
 };
 
 #define nvbios_init(s,o,ARGS...) ({                                            \
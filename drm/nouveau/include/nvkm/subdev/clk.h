@@ -103,6 +103,17 @@ struct nvkm_clk {
 	int dstate; /* display adjustment (min+) */
 	u8  temp;
 
+	/* Memoised calc() results, by (previous, next) cstate. */
+	struct {
+		struct list_head list;
+		int nr;
+		struct nvkm_cstate *from; /* last programmed, if known */
+		bool precalc;
+		u64 hit;
+		u64 miss;
+	} memo;
+	s64 queued; /* time of last pstate update request, in us */
+
 	bool allow_reclock;
 #define NVKM_CLK_BOOST_NONE 0x0
 #define NVKM_CLK_BOOST_BIOS 0x1
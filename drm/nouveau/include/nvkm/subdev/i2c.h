@@ -39,6 +39,8 @@ struct nvkm_i2c_bus {
 	struct list_head head;
 	struct i2c_adapter i2c;
 	u8 enabled;
+
+	struct nvkm_i2c_bit *bit[4]; /* compiled by bit.c, MRU first */
 };
 
 int nvkm_i2c_bus_acquire(struct nvkm_i2c_bus *);
@@ -61,6 +63,27 @@ struct nvkm_i2c_aux {
 	u8 enabled;
 
 	u32 intr;
+
+	/* Copy of the sink's read-only DPCD capability fields, for reads
+	 * through nvkm_rdaux() while the pad is being monitored for hotplug,
+	 * and dropped when the hpd count no longer matches the one the data
+	 * was read at.
+	 */
+	atomic_t hpd;
+	struct {
+		bool enable;
+		int hpd;
+		u32 valid[2][8];
+		u8  data[2][256];
+	} dpcd;
+
+	struct {
+		u64 xfer;
+		u64 chunk;
+		u64 retry;
+		u64 hit;
+		u64 miss;
+	} stats;
 };
 
 void nvkm_i2c_aux_monitor(struct nvkm_i2c_aux *, bool monitor);
@@ -68,6 +91,8 @@ int nvkm_i2c_aux_acquire(struct nvkm_i2c_aux *);
 void nvkm_i2c_aux_release(struct nvkm_i2c_aux *);
 int nvkm_i2c_aux_xfer(struct nvkm_i2c_aux *, bool retry, u8 type,
 		      u32 addr, u8 *data, u8 *size);
+int nvkm_i2c_aux_rd(struct nvkm_i2c_aux *, u32 addr, u8 *data, u32 size);
+int nvkm_i2c_aux_wr(struct nvkm_i2c_aux *, u32 addr, u8 *data, u32 size);
 int nvkm_i2c_aux_lnk_ctl(struct nvkm_i2c_aux *, int link_nr, int link_bw,
 			 bool enhanced_framing);
 
@@ -163,24 +188,22 @@ nvkm_probe_i2c(struct i2c_adapter *adap, u8 addr)
 }
 
 static inline int
-nvkm_rdaux(struct nvkm_i2c_aux *aux, u32 addr, u8 *data, u8 size)
+nvkm_rdaux(struct nvkm_i2c_aux *aux, u32 addr, u8 *data, u32 size)
 {
-	const u8 xfer = size;
 	int ret = nvkm_i2c_aux_acquire(aux);
 	if (ret == 0) {
-		ret = nvkm_i2c_aux_xfer(aux, true, 9, addr, data, &size);
-		WARN_ON(!ret && size != xfer);
+		ret = nvkm_i2c_aux_rd(aux, addr, data, size);
 		nvkm_i2c_aux_release(aux);
 	}
 	return ret;
 }
 
 static inline int
-nvkm_wraux(struct nvkm_i2c_aux *aux, u32 addr, u8 *data, u8 size)
+nvkm_wraux(struct nvkm_i2c_aux *aux, u32 addr, u8 *data, u32 size)
 {
 	int ret = nvkm_i2c_aux_acquire(aux);
 	if (ret == 0) {
-		ret = nvkm_i2c_aux_xfer(aux, true, 8, addr, data, &size);
+		ret = nvkm_i2c_aux_wr(aux, addr, data, size);
 		nvkm_i2c_aux_release(aux);
 	}
 	return ret;
@@ -3,6 +3,14 @@
 #define __NVKM_ICCSENSE_H__
 
 #include <core/subdev.h>
+#include <subdev/timer.h>
+
+struct nvkm_iccsense_sample {
+	u64 time; /* ns */
+	int power; /* uW */
+};
+
+#define NVKM_ICCSENSE_HISTORY 16
 
 struct nvkm_iccsense {
 	struct nvkm_subdev subdev;
@@ -12,8 +20,31 @@ struct nvkm_iccsense {
 
 	u32 power_w_max;
 	u32 power_w_crit;
+
+	/* All rails are read together, one i2c transfer per bus, either
+	 * from the background alarm (every 'period' ms, if non-zero) or
+	 * when a query finds the newest sample older than 'stale' ms (every
+	 * query, if zero).  Failed reads aren't kept as samples.
+	 */
+	struct {
+		struct mutex mutex;
+		struct nvkm_alarm alarm;
+		struct work_struct work;
+		bool enabled;
+		u32 period;
+		u32 stale;
+
+		struct i2c_msg *msgs;
+		struct nvkm_iccsense_sample hist[NVKM_ICCSENSE_HISTORY];
+		u32 count;
+
+		u64 hits;
+		u64 misses;
+	} sample;
 };
 
 int gf100_iccsense_new(struct nvkm_device *, int index, struct nvkm_iccsense **);
 int nvkm_iccsense_read_all(struct nvkm_iccsense *iccsense);
+int nvkm_iccsense_history(struct nvkm_iccsense *, struct nvkm_iccsense_sample *,
+			  int nr);
 #endif
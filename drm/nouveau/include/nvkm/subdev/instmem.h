@@ -2,7 +2,7 @@
 #ifndef __NVKM_INSTMEM_H__
 #define __NVKM_INSTMEM_H__
 #include <core/subdev.h>
-struct nvkm_memory;
+#include <core/memory.h>
 
 struct nvkm_instmem {
 	const struct nvkm_instmem_func *func;
@@ -22,7 +22,7 @@ struct nvkm_instmem {
 u32 nvkm_instmem_rd32(struct nvkm_instmem *, u32 addr);
 void nvkm_instmem_wr32(struct nvkm_instmem *, u32 addr, u32 data);
 int nvkm_instobj_new(struct nvkm_instmem *, u32 size, u32 align, bool zero,
-		     struct nvkm_memory **);
+		     enum nvkm_memory_target, struct nvkm_memory **);
 
 
 int nv04_instmem_new(struct nvkm_device *, int, struct nvkm_instmem **);
@@ -20,6 +20,8 @@ struct nvkm_vma {
 	bool mapped:1; /* Region contains valid pages. */
 	struct nvkm_memory *memory; /* Memory currently mapped into VMA. */
 	struct nvkm_tags *tags; /* Compression tag reference. */
+	u64 pfn; /* First PFN of a run mapped as a whole by pfn_map(). */
+	dma_addr_t dma; /* DMA mapping covering the run, for host memory. */
 };
 
 struct nvkm_vmm {
@@ -28,7 +30,15 @@ struct nvkm_vmm {
 	const char *name;
 	u32 debug;
 	struct kref kref;
-	struct mutex mutex;
+	struct mutex mutex; /* VMA lists/trees. */
+	struct mutex ptes; /* Page tree refcounts, PDE updates. */
+
+	/* Address ranges currently locked for map/unmap/get/put. */
+	struct {
+		spinlock_t lock;
+		struct list_head list;
+		wait_queue_head_t wait;
+	} range;
 
 	u64 start;
 	u64 limit;
@@ -25,6 +25,12 @@ struct nvkm_pmu {
 		u32 message;
 		u32 data[2];
 	} recv;
+
+	struct {
+		struct mutex mutex;
+		struct list_head cache;
+		int cache_nr;
+	} memx;
 };
 
 int nvkm_pmu_send(struct nvkm_pmu *, u32 reply[2], u32 process,
@@ -46,8 +52,17 @@ int gp102_pmu_new(struct nvkm_device *, int, struct nvkm_pmu **);
 
 /* interface to MEMX process running on PMU */
 struct nvkm_memx;
+struct nvkm_memx_key {
+	u32 from; /* kHz */
+	u32 to; /* kHz */
+	int temp; /* temperature bucket */
+	u32 data; /* implementation-specific */
+};
+
 int  nvkm_memx_init(struct nvkm_pmu *, struct nvkm_memx **);
 int  nvkm_memx_fini(struct nvkm_memx **, bool exec);
+bool nvkm_memx_cache(struct nvkm_memx *, const struct nvkm_memx_key *);
+u32  nvkm_memx_rd32(struct nvkm_memx *, u32 addr);
 void nvkm_memx_wr32(struct nvkm_memx *, u32 addr, u32 data);
 void nvkm_memx_wait(struct nvkm_memx *, u32 addr, u32 mask, u32 data, u32 nsec);
 void nvkm_memx_nsec(struct nvkm_memx *, u32 nsec);
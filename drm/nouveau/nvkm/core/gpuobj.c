@@ -172,7 +172,6 @@ static int
 nvkm_gpuobj_ctor(struct nvkm_device *device, u32 size, int align, bool zero,
 		 struct nvkm_gpuobj *parent, struct nvkm_gpuobj *gpuobj)
 {
-	u32 offset;
 	int ret;
 
 	if (parent) {
@@ -193,8 +192,7 @@ nvkm_gpuobj_ctor(struct nvkm_device *device, u32 size, int align, bool zero,
 
 		if (zero) {
 			nvkm_kmap(gpuobj);
-			for (offset = 0; offset < gpuobj->size; offset += 4)
-				nvkm_wo32(gpuobj, offset, 0x00000000);
+			nvkm_gpuobj_fill(gpuobj, 0, 0x00000000, gpuobj->size);
 			nvkm_done(gpuobj);
 		}
 	} else {
@@ -257,22 +255,44 @@ nvkm_gpuobj_wrap(struct nvkm_memory *memory, struct nvkm_gpuobj **pgpuobj)
 	return 0;
 }
 
+/* Find the memory object backing a gpuobj, and the offset within it, so
+ * that block transfers can be used for copies.
+ */
+static struct nvkm_memory *
+nvkm_gpuobj_memory(struct nvkm_gpuobj *gpuobj, u64 *offset)
+{
+	while (gpuobj->parent) {
+		*offset += gpuobj->node->offset;
+		gpuobj = gpuobj->parent;
+	}
+	return gpuobj->memory;
+}
+
 void
 nvkm_gpuobj_memcpy_to(struct nvkm_gpuobj *dst, u32 dstoffset, void *src,
 		      u32 length)
 {
-	int i;
+	u64 offset = dstoffset;
+	struct nvkm_memory *memory = nvkm_gpuobj_memory(dst, &offset);
 
-	for (i = 0; i < length; i += 4)
-		nvkm_wo32(dst, dstoffset + i, *(u32 *)(src + i));
+	nvkm_memory_wr(memory, offset, src, length);
 }
 
 void
 nvkm_gpuobj_memcpy_from(void *dst, struct nvkm_gpuobj *src, u32 srcoffset,
 			u32 length)
 {
-	int i;
+	u64 offset = srcoffset;
+	struct nvkm_memory *memory = nvkm_gpuobj_memory(src, &offset);
+
+	nvkm_memory_rd(memory, offset, dst, length);
+}
+
+void
+nvkm_gpuobj_fill(struct nvkm_gpuobj *gpuobj, u32 offset, u32 data, u32 length)
+{
+	u64 addr = offset;
+	struct nvkm_memory *memory = nvkm_gpuobj_memory(gpuobj, &addr);
 
-	for (i = 0; i < length; i += 4)
-		((u32 *)src)[i / 4] = nvkm_ro32(src, srcoffset + i);
+	nvkm_memory_fill(memory, addr, data, length);
 }
@@ -26,6 +26,82 @@
 #include <subdev/fb.h>
 #include <subdev/instmem.h>
 
+/* Block accessors, must be bracketed by kmap()/done() like the others.
+ *
+ * Backends that can't provide block transfers fall back to 32-bit access,
+ * as does any partial word at the end of the transfer.
+ */
+void
+nvkm_memory_rd(struct nvkm_memory *memory, u64 offset, void *data, u32 size)
+{
+	u32 tail = size & 3, temp;
+	u8 *ptr = data;
+
+	if (WARN_ON(offset & 3))
+		return;
+	size -= tail;
+
+	if (memory->ptrs->rd) {
+		memory->ptrs->rd(memory, offset, ptr, size);
+		offset += size;
+		ptr += size;
+	} else {
+		for (; size; size -= 4, offset += 4, ptr += 4) {
+			temp = nvkm_ro32(memory, offset);
+			memcpy(ptr, &temp, 4);
+		}
+	}
+
+	if (tail) {
+		temp = nvkm_ro32(memory, offset);
+		memcpy(ptr, &temp, tail);
+	}
+}
+
+void
+nvkm_memory_wr(struct nvkm_memory *memory, u64 offset, const void *data,
+	       u32 size)
+{
+	u32 tail = size & 3, temp, mask;
+	const u8 *ptr = data;
+
+	if (WARN_ON(offset & 3))
+		return;
+	size -= tail;
+
+	if (memory->ptrs->wr) {
+		memory->ptrs->wr(memory, offset, ptr, size);
+		offset += size;
+		ptr += size;
+	} else {
+		for (; size; size -= 4, offset += 4, ptr += 4) {
+			memcpy(&temp, ptr, 4);
+			nvkm_wo32(memory, offset, temp);
+		}
+	}
+
+	if (tail) {
+		temp = mask = 0;
+		memcpy(&temp, ptr, tail);
+		memset(&mask, 0xff, tail);
+		nvkm_mo32(memory, offset, mask, temp);
+	}
+}
+
+void
+nvkm_memory_fill(struct nvkm_memory *memory, u64 offset, u32 data, u32 size)
+{
+	if (WARN_ON((offset | size) & 3))
+		return;
+
+	if (memory->ptrs->fill) {
+		memory->ptrs->fill(memory, offset, data, size);
+	} else {
+		for (; size; size -= 4, offset += 4)
+			nvkm_wo32(memory, offset, data);
+	}
+}
+
 void
 nvkm_memory_tags_put(struct nvkm_memory *memory, struct nvkm_device *device,
 		     struct nvkm_tags **ptags)
@@ -142,10 +218,18 @@ nvkm_memory_new(struct nvkm_device *device, enum nvkm_memory_target target,
 	struct nvkm_memory *memory;
 	int ret = -ENOSYS;
 
-	if (unlikely(target != NVKM_MEM_TARGET_INST || !imem))
+	switch (target) {
+	case NVKM_MEM_TARGET_INST_SR_LOST:
+	case NVKM_MEM_TARGET_INST:
+		break;
+	default:
+		return -ENOSYS;
+	}
+
+	if (unlikely(!imem))
 		return -ENOSYS;
 
-	ret = nvkm_instobj_new(imem, size, align, zero, &memory);
+	ret = nvkm_instobj_new(imem, size, align, zero, target, &memory);
 	if (ret)
 		return ret;
 
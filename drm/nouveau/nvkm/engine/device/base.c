@@ -23,6 +23,7 @@
  */
 #include "priv.h"
 #include "acpi.h"
+#include "telem.h"
 
 #include <core/notify.h>
 #include <core/option.h>
@@ -2735,6 +2736,7 @@ nvkm_device_fini(struct nvkm_device *device, bool suspend)
 	time = ktime_to_us(ktime_get());
 
 	nvkm_acpi_fini(device);
+	nvkm_telem_fini(device);
 
 	for (i = NVKM_SUBDEV_NR - 1; i >= 0; i--) {
 		if ((subdev = nvkm_device_subdev(device, i))) {
@@ -2835,6 +2837,7 @@ nvkm_device_init(struct nvkm_device *device)
 
 	nvkm_acpi_init(device);
 	nvkm_therm_clkgate_enable(device->therm);
+	nvkm_telem_init(device);
 
 	time = ktime_to_us(ktime_get()) - time;
 	nvdev_trace(device, "init completed in %lldus\n", time);
@@ -2868,6 +2871,7 @@ nvkm_device_del(struct nvkm_device **pdevice)
 		}
 
 		nvkm_event_fini(&device->event);
+		nvkm_telem_dtor(device);
 
 		if (device->pri)
 			iounmap(device->pri);
@@ -3127,6 +3131,10 @@ nvkm_device_ctor(const struct nvkm_device_func *func,
 
 	mutex_init(&device->mutex);
 
+	ret = nvkm_telem_ctor(device);
+	if (ret)
+		goto done;
+
 	for (i = 0; i < NVKM_SUBDEV_NR; i++) {
 #define _(s,m) case s:                                                         \
 	if (device->chip->m && (subdev_mask & (1ULL << (s)))) {                \
@@ -22,6 +22,7 @@
  * Authors: Ben Skeggs <bskeggs@redhat.com>
  */
 #include "ctrl.h"
+#include "telem.h"
 
 #include <core/client.h>
 #include <subdev/clk.h>
@@ -166,6 +167,75 @@ nvkm_control_mthd_pstate_user(struct nvkm_control *ctrl, void *data, u32 size)
 	return ret;
 }
 
+static int
+nvkm_control_mthd_telemetry_info(struct nvkm_control *ctrl,
+				 void *data, u32 size)
+{
+	union {
+		struct nvif_control_telemetry_info_v0 v0;
+	} *args = data;
+	int ret = -ENOSYS;
+
+	nvif_ioctl(&ctrl->object, "control telemetry info size %d\n", size);
+	if (!(ret = nvif_unpack(ret, &data, &size, args->v0, 0, 0, false))) {
+		nvif_ioctl(&ctrl->object, "control telemetry info vers %d\n",
+			   args->v0.version);
+	} else
+		return ret;
+
+	nvkm_telem_info(ctrl->device, &args->v0.period, &args->v0.count,
+			&args->v0.seq);
+	return 0;
+}
+
+static int
+nvkm_control_mthd_telemetry_period(struct nvkm_control *ctrl,
+				   void *data, u32 size)
+{
+	union {
+		struct nvif_control_telemetry_period_v0 v0;
+	} *args = data;
+	int ret = -ENOSYS;
+
+	nvif_ioctl(&ctrl->object, "control telemetry period size %d\n", size);
+	if (!(ret = nvif_unpack(ret, &data, &size, args->v0, 0, 0, false))) {
+		nvif_ioctl(&ctrl->object,
+			   "control telemetry period vers %d period %d\n",
+			   args->v0.version, args->v0.period);
+	} else
+		return ret;
+
+	/* Sampling is device-wide, and shared by every client's reads. */
+	if (!ctrl->object.client->super)
+		return -EACCES;
+
+	args->v0.period = nvkm_telem_period(ctrl->device, args->v0.period);
+	return 0;
+}
+
+static int
+nvkm_control_mthd_telemetry_read(struct nvkm_control *ctrl,
+				 void *data, u32 size)
+{
+	union {
+		struct nvif_control_telemetry_read_v0 v0;
+	} *args = data;
+	int ret = -ENOSYS;
+
+	nvif_ioctl(&ctrl->object, "control telemetry read size %d\n", size);
+	if (!(ret = nvif_unpack(ret, &data, &size, args->v0, 0, 0, true))) {
+		nvif_ioctl(&ctrl->object,
+			   "control telemetry read vers %d count %d seq %d\n",
+			   args->v0.version, args->v0.count, args->v0.seq);
+		if (args->v0.count > size / sizeof(args->v0.data[0]))
+			return -EINVAL;
+	} else
+		return ret;
+
+	return nvkm_telem_read(ctrl->device, &args->v0.seq, args->v0.data,
+			       &args->v0.count);
+}
+
 static int
 nvkm_control_mthd(struct nvkm_object *object, u32 mthd, void *data, u32 size)
 {
@@ -177,6 +247,12 @@ nvkm_control_mthd(struct nvkm_object *object, u32 mthd, void *data, u32 size)
 		return nvkm_control_mthd_pstate_attr(ctrl, data, size);
 	case NVIF_CONTROL_PSTATE_USER:
 		return nvkm_control_mthd_pstate_user(ctrl, data, size);
+	case NVIF_CONTROL_TELEMETRY_INFO:
+		return nvkm_control_mthd_telemetry_info(ctrl, data, size);
+	case NVIF_CONTROL_TELEMETRY_PERIOD:
+		return nvkm_control_mthd_telemetry_period(ctrl, data, size);
+	case NVIF_CONTROL_TELEMETRY_READ:
+		return nvkm_control_mthd_telemetry_read(ctrl, data, size);
 	default:
 		break;
 	}
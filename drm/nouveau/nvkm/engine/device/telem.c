@@ -0,0 +1,242 @@
+// SPDX-License-Identifier: MIT
+#include "telem.h"
+
+#include <core/device.h>
+#include <core/option.h>
+#include <subdev/clk.h>
+#include <subdev/iccsense.h>
+#include <subdev/therm.h>
+#include <subdev/timer.h>
+#include <subdev/volt.h>
+
+#include <nvif/if0001.h>
+
+#define NVKM_TELEM_RING 256
+
+/* The timer can't schedule alarms more than ~4s out, and sampling more
+ * often than this would keep the sensors' buses busy for little gain.
+ */
+#define NVKM_TELEM_PERIOD_MIN 100
+#define NVKM_TELEM_PERIOD_MAX 4000
+
+/* nvkm_therm_fan_sense() can poll the tachometer for up to 250ms, so the
+ * fan's speed is only sensed this often (ms), and reused in between.
+ */
+#define NVKM_TELEM_FAN_WINDOW 1000
+
+struct nvkm_telem {
+	struct nvkm_device *device;
+	struct mutex mutex;
+	struct nvkm_alarm alarm;
+	struct work_struct work;
+	bool init;
+	bool enabled;
+	u32 period;
+
+	struct nvif_control_telemetry_v0 ring[NVKM_TELEM_RING];
+	u32 count;
+	u32 seq;
+
+	int fan_rpm;
+	u64 fan_time;
+};
+
+static u32
+nvkm_telem_clamp(s64 period)
+{
+	if (period <= 0)
+		return 0;
+	return clamp_t(s64, period, NVKM_TELEM_PERIOD_MIN,
+		       NVKM_TELEM_PERIOD_MAX);
+}
+
+/* must be called with telem->mutex held */
+static void
+nvkm_telem_sample(struct nvkm_telem *telem)
+{
+	struct nvkm_device *device = telem->device;
+	struct nvkm_therm *therm = device->therm;
+	struct nvkm_clk *clk = device->clk;
+	struct nvif_control_telemetry_v0 *rec;
+	int i;
+
+	rec = &telem->ring[telem->seq % NVKM_TELEM_RING];
+	rec->time = ktime_to_ns(ktime_get());
+	rec->seq = telem->seq++;
+	if (telem->count < NVKM_TELEM_RING)
+		telem->count++;
+
+	rec->temp = therm ? nvkm_therm_temp_get(therm) : -ENODEV;
+	rec->fan_duty = therm && therm->fan_get ? therm->fan_get(therm) :
+						  -ENODEV;
+	if (!telem->fan_time || rec->time - telem->fan_time >=
+			       NVKM_TELEM_FAN_WINDOW * 1000000ULL) {
+		telem->fan_rpm = therm ? nvkm_therm_fan_sense(therm) : -ENODEV;
+		telem->fan_time = rec->time;
+	}
+	rec->fan_rpm = telem->fan_rpm;
+	rec->power = device->iccsense ?
+		     nvkm_iccsense_read_all(device->iccsense) : -ENODEV;
+	rec->voltage = device->volt ? nvkm_volt_get(device->volt) : -ENODEV;
+
+	for (i = 0; i < ARRAY_SIZE(rec->clock); i++)
+		rec->clock[i] = -ENODEV;
+
+	if (clk) {
+		const struct nvkm_domain *domain = clk->domains;
+
+		for (i = 0; domain->name != nv_clk_src_max &&
+			    i < ARRAY_SIZE(rec->clock); domain++) {
+			if (domain->mname)
+				rec->clock[i++] = nvkm_clk_read(clk,
+								domain->name);
+		}
+	}
+}
+
+/* must be called with telem->mutex held */
+static void
+nvkm_telem_arm(struct nvkm_telem *telem)
+{
+	struct nvkm_timer *tmr = telem->device->timer;
+
+	/* Without a timer, records are taken when the ring is read. */
+	telem->enabled = telem->init && telem->period && tmr;
+	if (telem->enabled)
+		nvkm_timer_alarm(tmr, telem->period * 1000000, &telem->alarm);
+	else
+	if (tmr)
+		nvkm_timer_alarm(tmr, 0, &telem->alarm);
+}
+
+static void
+nvkm_telem_work(struct work_struct *work)
+{
+	struct nvkm_telem *telem = container_of(work, typeof(*telem), work);
+	struct nvkm_timer *tmr = telem->device->timer;
+
+	mutex_lock(&telem->mutex);
+	if (telem->enabled) {
+		nvkm_telem_sample(telem);
+		nvkm_timer_alarm(tmr, telem->period * 1000000, &telem->alarm);
+	}
+	mutex_unlock(&telem->mutex);
+}
+
+static void
+nvkm_telem_alarm(struct nvkm_alarm *alarm)
+{
+	struct nvkm_telem *telem = container_of(alarm, typeof(*telem), alarm);
+	schedule_work(&telem->work);
+}
+
+/* Copy out up to *nr records starting at *seq, or at the oldest record
+ * still in the ring if *seq has already been overwritten.  A *seq that
+ * hasn't been handed out yet is refused.
+ */
+int
+nvkm_telem_read(struct nvkm_device *device, u32 *seq,
+		struct nvif_control_telemetry_v0 *data, u32 *nr)
+{
+	struct nvkm_telem *telem = device->telem;
+	u32 avail, i;
+
+	mutex_lock(&telem->mutex);
+	if (telem->init && telem->period && !device->timer) {
+		const struct nvif_control_telemetry_v0 *last =
+			&telem->ring[(telem->seq - 1) % NVKM_TELEM_RING];
+		if (!telem->count || ktime_to_ns(ktime_get()) - last->time >=
+				     telem->period * 1000000ULL)
+			nvkm_telem_sample(telem);
+	}
+
+	if ((s32)(telem->seq - *seq) < 0) {
+		mutex_unlock(&telem->mutex);
+		return -EINVAL;
+	}
+
+	avail = min(telem->seq - *seq, telem->count);
+	*seq = telem->seq - avail;
+	*nr = min(*nr, avail);
+	for (i = 0; i < *nr; i++)
+		data[i] = telem->ring[(*seq + i) % NVKM_TELEM_RING];
+	mutex_unlock(&telem->mutex);
+	return 0;
+}
+
+u32
+nvkm_telem_period(struct nvkm_device *device, u32 period)
+{
+	struct nvkm_telem *telem = device->telem;
+
+	mutex_lock(&telem->mutex);
+	telem->period = nvkm_telem_clamp(period);
+	nvkm_telem_arm(telem);
+	period = telem->period;
+	mutex_unlock(&telem->mutex);
+	return period;
+}
+
+void
+nvkm_telem_info(struct nvkm_device *device, u32 *period, u32 *count, u32 *seq)
+{
+	struct nvkm_telem *telem = device->telem;
+
+	mutex_lock(&telem->mutex);
+	*period = telem->period;
+	*count = telem->count;
+	*seq = telem->seq;
+	mutex_unlock(&telem->mutex);
+}
+
+void
+nvkm_telem_fini(struct nvkm_device *device)
+{
+	struct nvkm_telem *telem = device->telem;
+
+	/* Disarm before the work's cancelled, it can't be re-armed after. */
+	mutex_lock(&telem->mutex);
+	telem->init = false;
+	nvkm_telem_arm(telem);
+	mutex_unlock(&telem->mutex);
+	cancel_work_sync(&telem->work);
+}
+
+void
+nvkm_telem_init(struct nvkm_device *device)
+{
+	struct nvkm_telem *telem = device->telem;
+
+	/* The fan may have been changed while suspended. */
+	mutex_lock(&telem->mutex);
+	telem->init = true;
+	telem->fan_time = 0;
+	nvkm_telem_arm(telem);
+	mutex_unlock(&telem->mutex);
+}
+
+void
+nvkm_telem_dtor(struct nvkm_device *device)
+{
+	if (device->telem)
+		cancel_work_sync(&device->telem->work);
+	kfree(device->telem);
+	device->telem = NULL;
+}
+
+int
+nvkm_telem_ctor(struct nvkm_device *device)
+{
+	struct nvkm_telem *telem;
+
+	if (!(telem = device->telem = kzalloc(sizeof(*telem), GFP_KERNEL)))
+		return -ENOMEM;
+
+	telem->device = device;
+	telem->period = nvkm_telem_clamp(nvkm_longopt(device->cfgopt,
+						      "NvTelemetry", 0));
+	mutex_init(&telem->mutex);
+	nvkm_alarm_init(&telem->alarm, nvkm_telem_alarm);
+	INIT_WORK(&telem->work, nvkm_telem_work);
+	return 0;
+}
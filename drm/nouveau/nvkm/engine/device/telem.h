@@ -0,0 +1,16 @@
+/* SPDX-License-Identifier: MIT */
+#ifndef __NVKM_DEVICE_TELEM_H__
+#define __NVKM_DEVICE_TELEM_H__
+#include <core/os.h>
+struct nvkm_device;
+struct nvif_control_telemetry_v0;
+
+int  nvkm_telem_ctor(struct nvkm_device *);
+void nvkm_telem_dtor(struct nvkm_device *);
+void nvkm_telem_init(struct nvkm_device *);
+void nvkm_telem_fini(struct nvkm_device *);
+void nvkm_telem_info(struct nvkm_device *, u32 *period, u32 *count, u32 *seq);
+u32  nvkm_telem_period(struct nvkm_device *, u32 period);
+int  nvkm_telem_read(struct nvkm_device *, u32 *seq,
+		     struct nvif_control_telemetry_v0 *, u32 *nr);
+#endif
@@ -26,6 +26,7 @@
 #include "head.h"
 #include "ior.h"
 
+#include <core/option.h>
 #include <subdev/bios.h>
 #include <subdev/bios/init.h>
 #include <subdev/gpio.h>
@@ -40,6 +41,7 @@ struct lt_state {
 	bool pc2;
 	u8  pc2stat;
 	u8  pc2conf[2];
+	bool fast;
 };
 
 static int
@@ -177,7 +179,7 @@ nvkm_dp_train_eq(struct lt_state *lt)
 			    !(lane & DPCD_LS02_LANE0_SYMBOL_LOCKED))
 				eq_done = false;
 		}
-	} while (!eq_done && cr_done && ++tries <= 5);
+	} while (!eq_done && cr_done && !lt->fast && ++tries <= 5);
 
 	return eq_done ? 0 : -1;
 }
@@ -192,7 +194,7 @@ nvkm_dp_train_cr(struct lt_state *lt)
 	nvkm_dp_train_pattern(lt, 1);
 
 	do {
-		if (nvkm_dp_train_drive(lt, false) ||
+		if (nvkm_dp_train_drive(lt, lt->fast && lt->pc2) ||
 		    nvkm_dp_train_sense(lt, false, 100))
 			break;
 
@@ -211,11 +213,30 @@ nvkm_dp_train_cr(struct lt_state *lt)
 			voltage = lt->conf[0] & DPCD_LC03_VOLTAGE_SWING_SET;
 			tries = 0;
 		}
-	} while (!cr_done && !abort && ++tries < 5);
+	} while (!cr_done && !abort && !lt->fast && ++tries < 5);
 
 	return cr_done ? 0 : -1;
 }
 
+/* Fill in the sink's adjust requests from the drive settings we last
+ * trained with, so that the first nvkm_dp_train_drive() applies them.
+ */
+static void
+nvkm_dp_train_last(struct lt_state *lt)
+{
+	struct nvkm_dp *dp = lt->dp;
+	int i;
+
+	for (i = 0; i < dp->outp.ior->dp.nr; i++) {
+		u8 lpre = (dp->lt.last.conf[i] & DPCD_LC03_PRE_EMPHASIS_SET) >> 3;
+		u8 lvsw = (dp->lt.last.conf[i] & DPCD_LC03_VOLTAGE_SWING_SET);
+		u8 lpc2 = (dp->lt.last.pc2conf[i >> 1] >> ((i & 1) * 4)) & 0x3;
+
+		lt->stat[4 + (i >> 1)] |= ((lpre << 2) | lvsw) << ((i & 1) * 4);
+		lt->pc2stat |= lpc2 << (i * 2);
+	}
+}
+
 static int
 nvkm_dp_train_links(struct nvkm_dp *dp)
 {
@@ -225,13 +246,15 @@ nvkm_dp_train_links(struct nvkm_dp *dp)
 	struct nvkm_bios *bios = subdev->device->bios;
 	struct lt_state lt = {
 		.dp = dp,
+		.fast = dp->lt.fast,
 	};
 	u32 lnkcmp;
 	u8 sink[2];
 	int ret;
 
-	OUTP_DBG(&dp->outp, "training %d x %d MB/s",
-		 ior->dp.nr, ior->dp.bw * 27);
+	OUTP_DBG(&dp->outp, "training %d x %d MB/s%s",
+		 ior->dp.nr, ior->dp.bw * 27, lt.fast ? " (fast)" : "");
+	dp->lt.stats.links++;
 
 	/* Intersect misc. capabilities of the OR and sink. */
 	if (disp->engine.subdev.device->chipset < 0xd0)
@@ -280,10 +303,22 @@ nvkm_dp_train_links(struct nvkm_dp *dp)
 
 	/* Attempt to train the link in this configuration. */
 	memset(lt.stat, 0x00, sizeof(lt.stat));
+	if (lt.fast)
+		nvkm_dp_train_last(&lt);
 	ret = nvkm_dp_train_cr(&lt);
 	if (ret == 0)
 		ret = nvkm_dp_train_eq(&lt);
 	nvkm_dp_train_pattern(&lt, 0);
+
+	if (ret == 0) {
+		memcpy(dp->lt.last.dpcd, dp->dpcd, sizeof(dp->lt.last.dpcd));
+		memcpy(dp->lt.last.conf, lt.conf, sizeof(lt.conf));
+		memcpy(dp->lt.last.pc2conf, lt.pc2conf, sizeof(lt.pc2conf));
+		dp->lt.last.bw = ior->dp.bw;
+		dp->lt.last.nr = ior->dp.nr;
+		dp->lt.last.valid = true;
+	}
+
 	return ret;
 }
 
@@ -341,6 +376,35 @@ static const struct dp_rates {
 	{}
 };
 
+/* Find the last successful link configuration, if it's still usable
+ * with the current sink and mode.
+ */
+static const struct dp_rates *
+nvkm_dp_train_fast(struct nvkm_dp *dp, const struct dp_rates *failsafe,
+		   u32 dataKBps)
+{
+	struct nvkm_device *device = dp->outp.disp->engine.subdev.device;
+	const struct dp_rates *cfg;
+
+	if (!dp->lt.last.valid ||
+	    !nvkm_boolopt(device->cfgopt, "NvDpFastTrain", true))
+		return NULL;
+
+	/* Different sink, or one that has changed its capabilities. */
+	if (memcmp(dp->lt.last.dpcd, dp->dpcd, sizeof(dp->dpcd)))
+		return NULL;
+
+	if (dp->lt.last.bw * 27000 * dp->lt.last.nr < dataKBps)
+		return NULL;
+
+	for (cfg = nvkm_dp_rates; cfg <= failsafe; cfg++) {
+		if (cfg->bw == dp->lt.last.bw && cfg->nr == dp->lt.last.nr)
+			return cfg;
+	}
+
+	return NULL;
+}
+
 static int
 nvkm_dp_train(struct nvkm_dp *dp, u32 dataKBps)
 {
@@ -350,7 +414,9 @@ nvkm_dp_train(struct nvkm_dp *dp, u32 dataKBps)
 	const u8 outp_nr = dp->outp.info.dpconf.link_nr;
 	const u8 outp_bw = dp->outp.info.dpconf.link_bw;
 	const struct dp_rates *failsafe = NULL, *cfg;
+	u32 links = dp->lt.stats.links;
 	int ret = -EINVAL;
+	s64 time;
 	u8  pwr;
 
 	/* Find the lowest configuration of the OR that can support
@@ -393,7 +459,34 @@ nvkm_dp_train(struct nvkm_dp *dp, u32 dataKBps)
 	/* Link training. */
 	OUTP_DBG(&dp->outp, "training (min: %d x %d MB/s)",
 		 failsafe->nr, failsafe->bw * 27);
+	time = ktime_to_us(ktime_get());
 	nvkm_dp_train_init(dp);
+
+	/* Retry the configuration and drive settings that last worked on
+	 * this sink, skipping the search through rates and drive levels.
+	 * Any problem results in the full sequence below.
+	 */
+	if ((cfg = nvkm_dp_train_fast(dp, failsafe, dataKBps))) {
+		ior->dp.mst = dp->lt.mst;
+		ior->dp.ef = dp->dpcd[DPCD_RC02] & DPCD_RC02_ENHANCED_FRAME_CAP;
+		ior->dp.bw = cfg->bw;
+		ior->dp.nr = cfg->nr;
+
+		dp->lt.fast = true;
+		ret = nvkm_dp_train_links(dp);
+		dp->lt.fast = false;
+		if (ret == 0) {
+			dp->lt.stats.fast++;
+		} else {
+			OUTP_DBG(&dp->outp, "fast training failed");
+			dp->lt.stats.fast_fail++;
+			dp->lt.last.valid = false;
+			ret = -EINVAL;
+		}
+	}
+
+	if (ret < 0)
+		dp->lt.stats.full++;
 	for (cfg = nvkm_dp_rates; ret < 0 && cfg <= failsafe; cfg++) {
 		/* Skip configurations not supported by both OR and sink. */
 		if ((cfg->nr > outp_nr || cfg->bw > outp_bw ||
@@ -411,10 +504,14 @@ nvkm_dp_train(struct nvkm_dp *dp, u32 dataKBps)
 		ret = nvkm_dp_train_links(dp);
 	}
 	nvkm_dp_train_fini(dp);
+	time = ktime_to_us(ktime_get()) - time;
 	if (ret < 0)
 		OUTP_ERR(&dp->outp, "training failed");
 	else
 		OUTP_DBG(&dp->outp, "training done");
+	OUTP_DBG(&dp->outp, "%d attempt(s) in %lldus, fast %d/%d full %d",
+		 dp->lt.stats.links - links, time, dp->lt.stats.fast,
+		 dp->lt.stats.fast + dp->lt.stats.fast_fail, dp->lt.stats.full);
 	atomic_set(&dp->lt.done, 1);
 	return ret;
 }
@@ -542,6 +639,15 @@ nvkm_dp_hpd(struct nvkm_notify *notify)
 	struct nvif_notify_conn_rep_v0 rep = {};
 
 	OUTP_DBG(&dp->outp, "HPD: %d", line->mask);
+
+	/* The sink may have been swapped for one that reports the same
+	 * capabilities, or lost the link, so don't assume the last drive
+	 * settings still apply.
+	 */
+	mutex_lock(&dp->mutex);
+	dp->lt.last.valid = false;
+	mutex_unlock(&dp->mutex);
+
 	if (line->mask & NVKM_I2C_IRQ) {
 		if (atomic_read(&dp->lt.done))
 			dp->outp.func->acquire(&dp->outp);
@@ -27,6 +27,26 @@ struct nvkm_dp {
 	struct {
 		atomic_t done;
 		bool mst;
+
+		/* Last configuration that trained successfully, and the
+		 * sink capabilities it was trained against.
+		 */
+		bool fast;
+		struct {
+			bool valid;
+			u8 dpcd[16];
+			u8 bw;
+			u8 nr;
+			u8 conf[4];
+			u8 pc2conf[2];
+		} last;
+
+		struct {
+			u32 fast;
+			u32 fast_fail;
+			u32 full;
+			u32 links;
+		} stats;
 	} lt;
 };
 
@@ -254,8 +254,8 @@ nvkm_falcon_init(struct nvkm_engine *engine)
 		}
 
 		nvkm_kmap(falcon->core);
-		for (i = 0; i < falcon->code.size; i += 4)
-			nvkm_wo32(falcon->core, i, falcon->code.data[i / 4]);
+		nvkm_memory_wr(falcon->core, 0, falcon->code.data,
+			       falcon->code.size);
 		nvkm_done(falcon->core);
 	}
 
@@ -27,6 +27,7 @@
 #include <core/client.h>
 #include <core/gpuobj.h>
 #include <core/notify.h>
+#include <core/option.h>
 #include <subdev/mc.h>
 
 #include <nvif/event.h>
@@ -282,6 +283,7 @@ static int
 nvkm_fifo_fini(struct nvkm_engine *engine, bool suspend)
 {
 	struct nvkm_fifo *fifo = nvkm_fifo(engine);
+	nvkm_fifo_chan_pool_trim(fifo);
 	if (fifo->func->fini)
 		fifo->func->fini(fifo);
 	return 0;
@@ -329,6 +331,7 @@ nvkm_fifo_dtor(struct nvkm_engine *engine)
 {
 	struct nvkm_fifo *fifo = nvkm_fifo(engine);
 	void *data = fifo;
+	nvkm_fifo_chan_pool_fini(fifo);
 	if (fifo->func->dtor)
 		data = fifo->func->dtor(fifo);
 	nvkm_event_fini(&fifo->kevent);
@@ -358,6 +361,9 @@ nvkm_fifo_ctor(const struct nvkm_fifo_func *func, struct nvkm_device *device,
 	fifo->func = func;
 	INIT_LIST_HEAD(&fifo->chan);
 	spin_lock_init(&fifo->lock);
+	mutex_init(&fifo->pool.mutex);
+	INIT_LIST_HEAD(&fifo->pool.list);
+	fifo->pool.max = nvkm_longopt(device->cfgopt, "NvFifoChanPool", 4);
 
 	if (WARN_ON(fifo->nr > NVKM_FIFO_CHID_NR))
 		fifo->nr = NVKM_FIFO_CHID_NR;
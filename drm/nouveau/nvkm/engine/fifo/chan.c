@@ -309,6 +309,166 @@ nvkm_fifo_chan_init(struct nvkm_object *object)
 	return 0;
 }
 
+struct nvkm_fifo_chan_pool {
+	struct list_head head;
+	struct nvkm_vmm *vmm;
+	struct nvkm_gpuobj *inst;
+};
+
+static void
+nvkm_fifo_chan_pool_del(struct nvkm_fifo_chan_pool *pool)
+{
+	list_del(&pool->head);
+	nvkm_vmm_part(pool->vmm, pool->inst->memory);
+	nvkm_vmm_unref(&pool->vmm);
+	nvkm_gpuobj_del(&pool->inst);
+	kfree(pool);
+}
+
+static int
+nvkm_fifo_chan_pool_refs(struct nvkm_fifo *fifo, struct nvkm_vmm *vmm)
+{
+	struct nvkm_fifo_chan_pool *pool;
+	int refs = 0;
+	list_for_each_entry(pool, &fifo->pool.list, head) {
+		if (pool->vmm == vmm)
+			refs++;
+	}
+	return refs;
+}
+
+/* Release instance blocks belonging to VMMs that are only being kept alive
+ * by the pool itself.  The pool takes a reference on each VMM, so this is
+ * done whenever the pool is used, and on fini.
+ */
+static void
+nvkm_fifo_chan_pool_prune(struct nvkm_fifo *fifo)
+{
+	struct nvkm_fifo_chan_pool *pool, *temp;
+	list_for_each_entry_safe(pool, temp, &fifo->pool.list, head) {
+		if (kref_read(&pool->vmm->kref) <=
+		    nvkm_fifo_chan_pool_refs(fifo, pool->vmm))
+			nvkm_fifo_chan_pool_del(pool);
+	}
+}
+
+static bool
+nvkm_fifo_chan_pool_put(struct nvkm_fifo_chan *chan)
+{
+	struct nvkm_fifo *fifo = chan->fifo;
+	struct nvkm_gpuobj *inst = chan->inst;
+	struct nvkm_fifo_chan_pool *pool;
+	struct nvkm_mm_node *node;
+
+	if (!fifo->pool.max || !chan->vmm)
+		return false;
+
+	/* Everything sub-allocated from the instance block must be gone. */
+	if (!list_is_singular(&inst->heap.nodes))
+		return false;
+	node = list_first_entry(&inst->heap.nodes, typeof(*node), nl_entry);
+	if (node->type != NVKM_MM_TYPE_NONE)
+		return false;
+
+	if (!(pool = kmalloc(sizeof(*pool), GFP_KERNEL)))
+		return false;
+
+	mutex_lock(&fifo->pool.mutex);
+	if (nvkm_fifo_chan_pool_refs(fifo, chan->vmm) >= fifo->pool.max) {
+		mutex_unlock(&fifo->pool.mutex);
+		kfree(pool);
+		return false;
+	}
+
+	pool->vmm = chan->vmm;
+	pool->inst = chan->inst;
+	list_add(&pool->head, &fifo->pool.list);
+	chan->vmm = NULL;
+	chan->inst = NULL;
+
+	/* The VMM's owner may already be gone, in which case this block
+	 * (and any others pooled for the VMM) are released right away.
+	 */
+	nvkm_fifo_chan_pool_prune(fifo);
+	mutex_unlock(&fifo->pool.mutex);
+	return true;
+}
+
+static struct nvkm_gpuobj *
+nvkm_fifo_chan_pool_get(struct nvkm_fifo *fifo, struct nvkm_vmm *vmm,
+			u32 size, u32 align, bool zero)
+{
+	struct nvkm_fifo_chan_pool *pool = NULL, *temp;
+	struct nvkm_gpuobj *inst;
+
+	if (!fifo->pool.max || !vmm)
+		return NULL;
+
+	mutex_lock(&fifo->pool.mutex);
+	nvkm_fifo_chan_pool_prune(fifo);
+	list_for_each_entry(temp, &fifo->pool.list, head) {
+		if (temp->vmm == vmm && temp->inst->size == size &&
+		    IS_ALIGNED(temp->inst->addr, align)) {
+			list_del(&temp->head);
+			pool = temp;
+			break;
+		}
+	}
+
+	if (pool)
+		fifo->pool.hit++;
+	else
+		fifo->pool.miss++;
+	mutex_unlock(&fifo->pool.mutex);
+	if (!pool)
+		return NULL;
+
+	/* The VMM join writes to the instance block, so it needs to be
+	 * redone after clearing it.
+	 */
+	if (zero) {
+		nvkm_vmm_part(pool->vmm, pool->inst->memory);
+		nvkm_kmap(pool->inst);
+		nvkm_gpuobj_fill(pool->inst, 0, 0x00000000, size);
+		nvkm_done(pool->inst);
+		if (nvkm_vmm_join(pool->vmm, pool->inst->memory)) {
+			nvkm_vmm_unref(&pool->vmm);
+			nvkm_gpuobj_del(&pool->inst);
+			kfree(pool);
+			return NULL;
+		}
+	}
+
+	inst = pool->inst;
+	nvkm_vmm_unref(&pool->vmm);
+	kfree(pool);
+	return inst;
+}
+
+void
+nvkm_fifo_chan_pool_trim(struct nvkm_fifo *fifo)
+{
+	mutex_lock(&fifo->pool.mutex);
+	nvkm_fifo_chan_pool_prune(fifo);
+	mutex_unlock(&fifo->pool.mutex);
+}
+
+void
+nvkm_fifo_chan_pool_fini(struct nvkm_fifo *fifo)
+{
+	struct nvkm_fifo_chan_pool *pool, *temp;
+
+	if (fifo->pool.hit || fifo->pool.miss) {
+		nvkm_debug(&fifo->engine.subdev, "channel pool: %lld hits, "
+			   "%lld misses\n", fifo->pool.hit, fifo->pool.miss);
+	}
+
+	mutex_lock(&fifo->pool.mutex);
+	list_for_each_entry_safe(pool, temp, &fifo->pool.list, head)
+		nvkm_fifo_chan_pool_del(pool);
+	mutex_unlock(&fifo->pool.mutex);
+}
+
 static void *
 nvkm_fifo_chan_dtor(struct nvkm_object *object)
 {
@@ -327,12 +487,15 @@ nvkm_fifo_chan_dtor(struct nvkm_object *object)
 	if (chan->user)
 		iounmap(chan->user);
 
+	nvkm_gpuobj_del(&chan->push);
+	if (nvkm_fifo_chan_pool_put(chan))
+		return data;
+
 	if (chan->vmm) {
 		nvkm_vmm_part(chan->vmm, chan->inst->memory);
 		nvkm_vmm_unref(&chan->vmm);
 	}
 
-	nvkm_gpuobj_del(&chan->push);
 	nvkm_gpuobj_del(&chan->inst);
 	return data;
 }
@@ -359,6 +522,7 @@ nvkm_fifo_chan_ctor(const struct nvkm_fifo_chan_func *func,
 	struct nvkm_client *client = oclass->client;
 	struct nvkm_device *device = fifo->engine.subdev.device;
 	struct nvkm_dmaobj *dmaobj;
+	struct nvkm_vmm *vmm = NULL;
 	unsigned long flags;
 	int ret;
 
@@ -368,10 +532,28 @@ nvkm_fifo_chan_ctor(const struct nvkm_fifo_chan_func *func,
 	chan->engines = engines;
 	INIT_LIST_HEAD(&chan->head);
 
-	/* instance memory */
-	ret = nvkm_gpuobj_new(device, size, align, zero, NULL, &chan->inst);
-	if (ret)
-		return ret;
+	/* channel address space */
+	if (hvmm) {
+		vmm = nvkm_uvmm_search(client, hvmm);
+		if (IS_ERR(vmm))
+			return PTR_ERR(vmm);
+
+		if (vmm->mmu != device->mmu)
+			return -EINVAL;
+	}
+
+	/* instance memory, reusing an idle block already joined to the
+	 * channel's address space if one is available
+	 */
+	chan->inst = nvkm_fifo_chan_pool_get(fifo, vmm, size, align, zero);
+	if (chan->inst) {
+		chan->vmm = nvkm_vmm_ref(vmm);
+	} else {
+		ret = nvkm_gpuobj_new(device, size, align, zero, NULL,
+				      &chan->inst);
+		if (ret)
+			return ret;
+	}
 
 	/* allocate push buffer ctxdma instance */
 	if (push) {
@@ -385,15 +567,7 @@ nvkm_fifo_chan_ctor(const struct nvkm_fifo_chan_func *func,
 			return ret;
 	}
 
-	/* channel address space */
-	if (hvmm) {
-		struct nvkm_vmm *vmm = nvkm_uvmm_search(client, hvmm);
-		if (IS_ERR(vmm))
-			return PTR_ERR(vmm);
-
-		if (vmm->mmu != device->mmu)
-			return -EINVAL;
-
+	if (vmm && !chan->vmm) {
 		ret = nvkm_vmm_join(vmm, chan->inst->memory);
 		if (ret)
 			return ret;
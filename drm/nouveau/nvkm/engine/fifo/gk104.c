@@ -27,6 +27,7 @@
 
 #include <core/client.h>
 #include <core/gpuobj.h>
+#include <core/option.h>
 #include <subdev/bar.h>
 #include <subdev/fault.h>
 #include <subdev/timer.h>
@@ -152,8 +153,7 @@ void
 gk104_fifo_runlist_commit(struct gk104_fifo *fifo, int runl,
 			  struct nvkm_memory *mem, int nr)
 {
-	struct nvkm_subdev *subdev = &fifo->base.engine.subdev;
-	struct nvkm_device *device = subdev->device;
+	struct nvkm_device *device = fifo->base.engine.subdev.device;
 	int target;
 
 	switch (nvkm_memory_target(mem)) {
@@ -167,42 +167,118 @@ gk104_fifo_runlist_commit(struct gk104_fifo *fifo, int runl,
 	nvkm_wr32(device, 0x002270, (nvkm_memory_addr(mem) >> 12) |
 				    (target << 28));
 	nvkm_wr32(device, 0x002274, (runl << 20) | nr);
+}
 
-	if (nvkm_msec(device, 2000,
-		if (!(nvkm_rd32(device, 0x002284 + (runl * 0x08)) & 0x00100000))
-			break;
-	) < 0)
-		nvkm_error(subdev, "runlist %d update timeout\n", runl);
+bool
+gk104_fifo_runlist_pending(struct gk104_fifo *fifo, int runl)
+{
+	struct nvkm_device *device = fifo->base.engine.subdev.device;
+	return nvkm_rd32(device, 0x002284 + (runl * 0x08)) & 0x00100000;
 }
 
-void
-gk104_fifo_runlist_update(struct gk104_fifo *fifo, int runl)
+/* Write an entry to the runlist, touching only the words that have changed
+ * since this buffer was last built.
+ */
+static void
+gk104_fifo_runlist_patch(struct gk104_fifo *fifo, int runl,
+			 struct nvkm_memory *mem, u32 *shadow, int nr,
+			 const u32 *data)
+{
+	const int size = fifo->func->runlist->size / 4;
+	int i;
+
+	for (i = 0, shadow += nr * size; i < size; i++) {
+		if (shadow[i] != data[i]) {
+			nvkm_wo32(mem, (nr * size + i) * 4, data[i]);
+			shadow[i] = data[i];
+			fifo->runlist[runl].stats.patch++;
+		}
+	}
+}
+
+static int
+gk104_fifo_runlist_build(struct gk104_fifo *fifo, int runl,
+			 struct nvkm_memory *mem, u32 *shadow)
 {
 	const struct gk104_fifo_runlist_func *func = fifo->func->runlist;
 	struct gk104_fifo_chan *chan;
-	struct nvkm_subdev *subdev = &fifo->base.engine.subdev;
-	struct nvkm_memory *mem;
 	struct nvkm_fifo_cgrp *cgrp;
+	u32 data[4];
 	int nr = 0;
 
-	mutex_lock(&subdev->mutex);
-	mem = fifo->runlist[runl].mem[fifo->runlist[runl].next];
-	fifo->runlist[runl].next = !fifo->runlist[runl].next;
-
 	nvkm_kmap(mem);
 	list_for_each_entry(chan, &fifo->runlist[runl].chan, head) {
-		func->chan(chan, mem, nr++ * func->size);
+		func->chan(chan, data);
+		gk104_fifo_runlist_patch(fifo, runl, mem, shadow, nr++, data);
 	}
 
 	list_for_each_entry(cgrp, &fifo->runlist[runl].cgrp, head) {
-		func->cgrp(cgrp, mem, nr++ * func->size);
+		func->cgrp(cgrp, data);
+		gk104_fifo_runlist_patch(fifo, runl, mem, shadow, nr++, data);
 		list_for_each_entry(chan, &cgrp->chan, head) {
-			func->chan(chan, mem, nr++ * func->size);
+			func->chan(chan, data);
+			gk104_fifo_runlist_patch(fifo, runl, mem, shadow,
+						 nr++, data);
 		}
 	}
 	nvkm_done(mem);
+	return nr;
+}
+
+void
+gk104_fifo_runlist_update(struct gk104_fifo *fifo, int runl)
+{
+	const struct gk104_fifo_runlist_func *func = fifo->func->runlist;
+	struct gk104_fifo_runl *rl = &fifo->runlist[runl];
+	struct nvkm_subdev *subdev = &fifo->base.engine.subdev;
+	struct nvkm_memory *mem;
+	u32 seq, *shadow;
+	s64 time;
+	int nr;
 
-	func->commit(fifo, runl, mem, nr);
+	mutex_lock(&subdev->mutex);
+	seq = ++rl->seq;
+	rl->stats.update++;
+
+	/* A commit is already in flight.  Whoever submitted it will build
+	 * and commit again once it completes, picking up our changes along
+	 * with any others that arrive in the meantime.
+	 */
+	if (rl->busy) {
+		mutex_unlock(&subdev->mutex);
+		wait_event(rl->wait, (s32)(rl->done - seq) >= 0);
+		return;
+	}
+
+	rl->busy = true;
+	do {
+		seq = rl->seq;
+		mem = rl->mem[rl->next];
+		shadow = rl->shadow[rl->next];
+		rl->next = !rl->next;
+
+		nr = gk104_fifo_runlist_build(fifo, runl, mem, shadow);
+		time = ktime_to_us(ktime_get());
+		func->commit(fifo, runl, mem, nr);
+		mutex_unlock(&subdev->mutex);
+
+		/* Completion is signalled by the runlist interrupt. */
+		if (func->pending &&
+		    !wait_event_timeout(rl->wait, !func->pending(fifo, runl),
+					msecs_to_jiffies(2000)))
+			nvkm_error(subdev, "runlist %d update timeout\n", runl);
+		time = ktime_to_us(ktime_get()) - time;
+
+		mutex_lock(&subdev->mutex);
+		nvkm_trace(subdev, "runlist %d: %d entries, %d update(s), "
+				   "%lldus\n", runl, nr, seq - rl->done, time);
+		rl->stats.commit++;
+		rl->stats.time += time;
+		rl->stats.time_max = max_t(u64, rl->stats.time_max, time);
+		rl->done = seq;
+		wake_up_all(&rl->wait);
+	} while (rl->done != rl->seq);
+	rl->busy = false;
 	mutex_unlock(&subdev->mutex);
 }
 
@@ -235,11 +311,10 @@ gk104_fifo_runlist_insert(struct gk104_fifo *fifo, struct gk104_fifo_chan *chan)
 }
 
 void
-gk104_fifo_runlist_chan(struct gk104_fifo_chan *chan,
-			struct nvkm_memory *memory, u32 offset)
+gk104_fifo_runlist_chan(struct gk104_fifo_chan *chan, u32 *data)
 {
-	nvkm_wo32(memory, offset + 0, chan->base.chid);
-	nvkm_wo32(memory, offset + 4, 0x00000000);
+	data[0] = chan->base.chid;
+	data[1] = 0x00000000;
 }
 
 const struct gk104_fifo_runlist_func
@@ -247,6 +322,7 @@ gk104_fifo_runlist = {
 	.size = 8,
 	.chan = gk104_fifo_runlist_chan,
 	.commit = gk104_fifo_runlist_commit,
+	.pending = gk104_fifo_runlist_pending,
 };
 
 void
@@ -271,15 +347,58 @@ gk104_fifo_pbdma = {
 	.init = gk104_fifo_pbdma_init,
 };
 
+static void gk104_fifo_recover_runl(struct gk104_fifo *, int runl);
+
+static void
+gk104_fifo_recover_preempt(struct gk104_fifo *fifo, int runl, u32 id)
+{
+	struct nvkm_subdev *subdev = &fifo->base.engine.subdev;
+	struct nvkm_device *device = subdev->device;
+	unsigned long flags;
+
+	mutex_lock(&subdev->mutex);
+	nvkm_wr32(device, 0x002634, id);
+	if (nvkm_msec(device, 2000,
+		if (!(nvkm_rd32(device, 0x002634) & 0x00100000))
+			break;
+	) < 0) {
+		/* Fall back to blocking the whole runlist. */
+		nvkm_error(subdev, "%s %d preempt timeout\n",
+			   (id & 0x01000000) ? "tsg" : "channel", id & 0xfff);
+		spin_lock_irqsave(&fifo->base.lock, flags);
+		gk104_fifo_recover_runl(fifo, runl);
+		spin_unlock_irqrestore(&fifo->base.lock, flags);
+	}
+	mutex_unlock(&subdev->mutex);
+}
+
 static void
 gk104_fifo_recover_work(struct work_struct *w)
 {
 	struct gk104_fifo *fifo = container_of(w, typeof(*fifo), recover.work);
-	struct nvkm_device *device = fifo->base.engine.subdev.device;
+	struct nvkm_subdev *subdev = &fifo->base.engine.subdev;
+	struct nvkm_device *device = subdev->device;
 	struct nvkm_engine *engine;
+	typeof(fifo->recover.preempt) preempt;
 	unsigned long flags;
-	u32 engm, runm, todo;
-	int engn, runl;
+	u32 engm, runm, chanm, todo;
+	int engn, runl, preempt_nr, i;
+	s64 stall;
+
+	spin_lock_irqsave(&fifo->base.lock, flags);
+	chanm = fifo->recover.chanm;
+	preempt_nr = fifo->recover.preempt_nr;
+	memcpy(preempt, fifo->recover.preempt, sizeof(preempt));
+	fifo->recover.chanm = 0;
+	fifo->recover.preempt_nr = 0;
+	spin_unlock_irqrestore(&fifo->base.lock, flags);
+
+	/* Evict killed channels that aren't on an engine, then drop them
+	 * from the runlist while it continues to schedule everything else.
+	 * Anything that can't be preempted escalates to runlist recovery.
+	 */
+	for (i = 0; i < preempt_nr; i++)
+		gk104_fifo_recover_preempt(fifo, preempt[i].runl, preempt[i].id);
 
 	spin_lock_irqsave(&fifo->base.lock, flags);
 	runm = fifo->recover.runm;
@@ -288,6 +407,12 @@ gk104_fifo_recover_work(struct work_struct *w)
 	fifo->recover.runm = 0;
 	spin_unlock_irqrestore(&fifo->base.lock, flags);
 
+	for (todo = chanm & ~runm; runl = __ffs(todo), todo; todo &= ~BIT(runl))
+		gk104_fifo_runlist_update(fifo, runl);
+
+	if (!runm)
+		return;
+
 	nvkm_mask(device, 0x002630, runm, runm);
 
 	for (todo = engm; engn = __ffs(todo), todo; todo &= ~BIT(engn)) {
@@ -302,6 +427,16 @@ gk104_fifo_recover_work(struct work_struct *w)
 
 	nvkm_wr32(device, 0x00262c, runm);
 	nvkm_mask(device, 0x002630, runm, 0x00000000);
+
+	/* Record how long other channels on the runlist(s) were stalled. */
+	for (todo = runm; runl = __ffs(todo), todo; todo &= ~BIT(runl)) {
+		struct gk104_fifo_runl *rl = &fifo->runlist[runl];
+		stall = ktime_to_us(ktime_get()) - rl->blocked;
+		rl->stats.stall += stall;
+		rl->stats.stall_max = max_t(u64, rl->stats.stall_max, stall);
+		nvkm_warn(subdev, "runlist %d: recovered, blocked for %lldus\n",
+			  runl, stall);
+	}
 }
 
 static void gk104_fifo_recover_engn(struct gk104_fifo *fifo, int engn);
@@ -320,6 +455,8 @@ gk104_fifo_recover_runl(struct gk104_fifo *fifo, int runl)
 
 	/* Block runlist to prevent channel assignment(s) from changing. */
 	nvkm_mask(device, 0x002630, runm, runm);
+	fifo->runlist[runl].blocked = ktime_to_us(ktime_get());
+	fifo->runlist[runl].stats.recover_runl++;
 
 	/* Schedule recovery. */
 	nvkm_warn(subdev, "runlist %d: scheduled for recovery\n", runl);
@@ -363,6 +500,8 @@ gk104_fifo_recover_chan(struct nvkm_fifo *base, int chid)
 	const bool used = (stat & 0x00000001);
 	unsigned long engn, engm = fifo->runlist[runl].engm;
 	struct gk104_fifo_chan *chan;
+	unsigned long resm = 0;
+	u32 id = chid;
 
 	assert_spin_locked(&fifo->base.lock);
 	if (!used)
@@ -371,6 +510,8 @@ gk104_fifo_recover_chan(struct nvkm_fifo *base, int chid)
 	/* Lookup SW state for channel, and mark it as dead. */
 	chan = gk104_fifo_recover_chid(fifo, runl, chid);
 	if (chan) {
+		if (chan->cgrp)
+			id = chan->cgrp->id | 0x01000000;
 		chan->killed = true;
 		nvkm_fifo_kevent(&fifo->base, chid);
 	}
@@ -379,17 +520,35 @@ gk104_fifo_recover_chan(struct nvkm_fifo *base, int chid)
 	nvkm_wr32(device, 0x800004 + (chid * 0x08), stat | 0x00000800);
 	nvkm_warn(subdev, "channel %d: killed\n", chid);
 
-	/* Block channel assignments from changing during recovery. */
-	gk104_fifo_recover_runl(fifo, runl);
-
-	/* Schedule recovery for any engines the channel is on. */
+	/* Determine which engines (if any) the channel is on. */
 	for_each_set_bit(engn, &engm, fifo->engine_nr) {
 		struct gk104_fifo_engine_status status;
 		gk104_fifo_engine_status(fifo, engn, &status);
 		if (!status.chan || status.chan->id != chid)
 			continue;
-		gk104_fifo_recover_engn(fifo, engn);
+		resm |= BIT(engn);
+	}
+
+	/* If it isn't, it's enough to evict the channel and remove it from
+	 * the runlist, the other channels can keep running in the meantime.
+	 */
+	if (!resm && fifo->recover.chan &&
+	    fifo->recover.preempt_nr < ARRAY_SIZE(fifo->recover.preempt)) {
+		fifo->recover.preempt[fifo->recover.preempt_nr].runl = runl;
+		fifo->recover.preempt[fifo->recover.preempt_nr].id = id;
+		fifo->recover.preempt_nr++;
+		fifo->recover.chanm |= BIT(runl);
+		fifo->runlist[runl].stats.recover_chan++;
+		schedule_work(&fifo->recover.work);
+		return;
 	}
+
+	/* Block channel assignments from changing during recovery. */
+	gk104_fifo_recover_runl(fifo, runl);
+
+	/* Schedule recovery for any engines the channel is on. */
+	for_each_set_bit(engn, &resm, fifo->engine_nr)
+		gk104_fifo_recover_engn(fifo, engn);
 }
 
 static void
@@ -865,8 +1024,31 @@ static void
 gk104_fifo_fini(struct nvkm_fifo *base)
 {
 	struct gk104_fifo *fifo = gk104_fifo(base);
-	struct nvkm_device *device = fifo->base.engine.subdev.device;
+	struct nvkm_subdev *subdev = &fifo->base.engine.subdev;
+	struct nvkm_device *device = subdev->device;
+	int runl;
+
 	flush_work(&fifo->recover.work);
+
+	for (runl = 0; runl < fifo->runlist_nr; runl++) {
+		struct gk104_fifo_runl *rl = &fifo->runlist[runl];
+		if (!rl->stats.commit)
+			continue;
+		nvkm_debug(subdev, "runlist %d: %lld commits for %lld updates, "
+				   "%lld words patched, avg %lldus max %lldus\n",
+			   runl, rl->stats.commit, rl->stats.update,
+			   rl->stats.patch,
+			   div_u64(rl->stats.time, rl->stats.commit),
+			   rl->stats.time_max);
+		if (!rl->stats.recover_chan && !rl->stats.recover_runl)
+			continue;
+		nvkm_debug(subdev, "runlist %d: %lld channel recoveries, "
+				   "%lld runlist recoveries, stalled %lldus "
+				   "total %lldus max\n",
+			   runl, rl->stats.recover_chan, rl->stats.recover_runl,
+			   rl->stats.stall, rl->stats.stall_max);
+	}
+
 	/* allow mmu fault interrupts, even when we're not using fifo */
 	nvkm_mask(device, 0x002140, 0x10000000, 0x10000000);
 }
@@ -913,6 +1095,9 @@ gk104_fifo_oneinit(struct nvkm_fifo *base)
 	fifo->pbdma_nr = fifo->func->pbdma->nr(fifo);
 	nvkm_debug(subdev, "%d PBDMA(s)\n", fifo->pbdma_nr);
 
+	fifo->recover.chan = nvkm_boolopt(device->cfgopt, "NvFifoChanRecover",
+					  true);
+
 	/* Read PBDMA->runlist(s) mapping from HW. */
 	if (!(map = kcalloc(fifo->pbdma_nr, sizeof(*map), GFP_KERNEL)))
 		return -ENOMEM;
@@ -949,10 +1134,16 @@ gk104_fifo_oneinit(struct nvkm_fifo *base)
 			ret = nvkm_memory_new(device, NVKM_MEM_TARGET_INST,
 					      fifo->base.nr * 2/* TSG+chan */ *
 					      fifo->func->runlist->size,
-					      0x1000, false,
+					      0x1000, true,
 					      &fifo->runlist[i].mem[j]);
 			if (ret)
 				return ret;
+
+			fifo->runlist[i].shadow[j] =
+				kvzalloc(nvkm_memory_size(fifo->runlist[i].mem[j]),
+					 GFP_KERNEL);
+			if (!fifo->runlist[i].shadow[j])
+				return -ENOMEM;
 		}
 
 		init_waitqueue_head(&fifo->runlist[i].wait);
@@ -1017,6 +1208,8 @@ gk104_fifo_dtor(struct nvkm_fifo *base)
 	nvkm_memory_unref(&fifo->user.mem);
 
 	for (i = 0; i < fifo->runlist_nr; i++) {
+		kvfree(fifo->runlist[i].shadow[1]);
+		kvfree(fifo->runlist[i].shadow[0]);
 		nvkm_memory_unref(&fifo->runlist[i].mem[1]);
 		nvkm_memory_unref(&fifo->runlist[i].mem[0]);
 	}
@@ -17,6 +17,18 @@ struct gk104_fifo {
 		struct work_struct work;
 		u32 engm;
 		u32 runm;
+
+		/* Channel-granular recovery, for channels not resident on
+		 * an engine: preempt and drop them from the runlist without
+		 * blocking it.
+		 */
+		bool chan;
+		u32 chanm;
+		struct {
+			int runl;
+			u32 id;
+		} preempt[8];
+		int preempt_nr;
 	} recover;
 
 	int pbdma_nr;
@@ -28,13 +40,34 @@ struct gk104_fifo {
 	} engine[16];
 	int engine_nr;
 
-	struct {
+	struct gk104_fifo_runl {
 		struct nvkm_memory *mem[2];
+		u32 *shadow[2]; /* CPU copy of mem[], for incremental updates. */
 		int next;
 		wait_queue_head_t wait;
 		struct list_head cgrp;
 		struct list_head chan;
 		u32 engm;
+
+		/* Time the runlist was blocked for recovery, in us. */
+		s64 blocked;
+
+		/* Update requests vs. those covered by a completed commit. */
+		u32 seq;
+		u32 done;
+		bool busy;
+
+		struct {
+			u64 commit;
+			u64 update;
+			u64 patch;
+			u64 time;
+			u64 time_max;
+			u64 recover_chan;
+			u64 recover_runl;
+			u64 stall;
+			u64 stall_max;
+		} stats;
 	} runlist[16];
 	int runlist_nr;
 
@@ -65,12 +98,11 @@ struct gk104_fifo_func {
 
 	const struct gk104_fifo_runlist_func {
 		u8 size;
-		void (*cgrp)(struct nvkm_fifo_cgrp *,
-			     struct nvkm_memory *, u32 offset);
-		void (*chan)(struct gk104_fifo_chan *,
-			     struct nvkm_memory *, u32 offset);
+		void (*cgrp)(struct nvkm_fifo_cgrp *, u32 *data);
+		void (*chan)(struct gk104_fifo_chan *, u32 *data);
 		void (*commit)(struct gk104_fifo *, int runl,
 			       struct nvkm_memory *, int entries);
+		bool (*pending)(struct gk104_fifo *, int runl);
 	} *runlist;
 
 	struct gk104_fifo_user_user {
@@ -102,14 +134,13 @@ extern const struct nvkm_enum gk104_fifo_fault_reason[];
 extern const struct nvkm_enum gk104_fifo_fault_hubclient[];
 extern const struct nvkm_enum gk104_fifo_fault_gpcclient[];
 extern const struct gk104_fifo_runlist_func gk104_fifo_runlist;
-void gk104_fifo_runlist_chan(struct gk104_fifo_chan *,
-			     struct nvkm_memory *, u32);
+void gk104_fifo_runlist_chan(struct gk104_fifo_chan *, u32 *);
 void gk104_fifo_runlist_commit(struct gk104_fifo *, int runl,
 			       struct nvkm_memory *, int);
+bool gk104_fifo_runlist_pending(struct gk104_fifo *, int runl);
 
 extern const struct gk104_fifo_runlist_func gk110_fifo_runlist;
-void gk110_fifo_runlist_cgrp(struct nvkm_fifo_cgrp *,
-			     struct nvkm_memory *, u32);
+void gk110_fifo_runlist_cgrp(struct nvkm_fifo_cgrp *, u32 *);
 
 extern const struct gk104_fifo_pbdma_func gk208_fifo_pbdma;
 void gk208_fifo_pbdma_init_timeout(struct gk104_fifo *);
@@ -128,8 +159,6 @@ extern const struct nvkm_enum gv100_fifo_fault_access[];
 extern const struct nvkm_enum gv100_fifo_fault_reason[];
 extern const struct nvkm_enum gv100_fifo_fault_hubclient[];
 extern const struct nvkm_enum gv100_fifo_fault_gpcclient[];
-void gv100_fifo_runlist_cgrp(struct nvkm_fifo_cgrp *,
-			     struct nvkm_memory *, u32);
-void gv100_fifo_runlist_chan(struct gk104_fifo_chan *,
-			     struct nvkm_memory *, u32);
+void gv100_fifo_runlist_cgrp(struct nvkm_fifo_cgrp *, u32 *);
+void gv100_fifo_runlist_chan(struct gk104_fifo_chan *, u32 *);
 #endif
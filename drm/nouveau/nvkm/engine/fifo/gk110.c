@@ -30,12 +30,11 @@
 #include <nvif/class.h>
 
 void
-gk110_fifo_runlist_cgrp(struct nvkm_fifo_cgrp *cgrp,
-			struct nvkm_memory *memory, u32 offset)
+gk110_fifo_runlist_cgrp(struct nvkm_fifo_cgrp *cgrp, u32 *data)
 {
-	nvkm_wo32(memory, offset + 0, (cgrp->chan_nr << 26) | (128 << 18) |
-				      (3 << 14) | 0x00002000 | cgrp->id);
-	nvkm_wo32(memory, offset + 4, 0x00000000);
+	data[0] = (cgrp->chan_nr << 26) | (128 << 18) |
+		  (3 << 14) | 0x00002000 | cgrp->id;
+	data[1] = 0x00000000;
 }
 
 const struct gk104_fifo_runlist_func
@@ -44,6 +43,7 @@ gk110_fifo_runlist = {
 	.cgrp = gk110_fifo_runlist_cgrp,
 	.chan = gk104_fifo_runlist_chan,
 	.commit = gk104_fifo_runlist_commit,
+	.pending = gk104_fifo_runlist_pending,
 };
 
 static const struct gk104_fifo_func
@@ -30,11 +30,10 @@
 #include <nvif/class.h>
 
 static void
-gm107_fifo_runlist_chan(struct gk104_fifo_chan *chan,
-			struct nvkm_memory *memory, u32 offset)
+gm107_fifo_runlist_chan(struct gk104_fifo_chan *chan, u32 *data)
 {
-	nvkm_wo32(memory, offset + 0, chan->base.chid);
-	nvkm_wo32(memory, offset + 4, chan->base.inst->addr >> 12);
+	data[0] = chan->base.chid;
+	data[1] = chan->base.inst->addr >> 12;
 }
 
 const struct gk104_fifo_runlist_func
@@ -43,6 +42,7 @@ gm107_fifo_runlist = {
 	.cgrp = gk110_fifo_runlist_cgrp,
 	.chan = gm107_fifo_runlist_chan,
 	.commit = gk104_fifo_runlist_commit,
+	.pending = gk104_fifo_runlist_pending,
 };
 
 const struct nvkm_enum
@@ -29,27 +29,25 @@
 #include <nvif/class.h>
 
 void
-gv100_fifo_runlist_chan(struct gk104_fifo_chan *chan,
-			struct nvkm_memory *memory, u32 offset)
+gv100_fifo_runlist_chan(struct gk104_fifo_chan *chan, u32 *data)
 {
 	struct nvkm_memory *usermem = chan->fifo->user.mem;
 	const u64 user = nvkm_memory_addr(usermem) + (chan->base.chid * 0x200);
 	const u64 inst = chan->base.inst->addr;
 
-	nvkm_wo32(memory, offset + 0x0, lower_32_bits(user));
-	nvkm_wo32(memory, offset + 0x4, upper_32_bits(user));
-	nvkm_wo32(memory, offset + 0x8, lower_32_bits(inst) | chan->base.chid);
-	nvkm_wo32(memory, offset + 0xc, upper_32_bits(inst));
+	data[0] = lower_32_bits(user);
+	data[1] = upper_32_bits(user);
+	data[2] = lower_32_bits(inst) | chan->base.chid;
+	data[3] = upper_32_bits(inst);
 }
 
 void
-gv100_fifo_runlist_cgrp(struct nvkm_fifo_cgrp *cgrp,
-			struct nvkm_memory *memory, u32 offset)
+gv100_fifo_runlist_cgrp(struct nvkm_fifo_cgrp *cgrp, u32 *data)
 {
-	nvkm_wo32(memory, offset + 0x0, (128 << 24) | (3 << 16) | 0x00000001);
-	nvkm_wo32(memory, offset + 0x4, cgrp->chan_nr);
-	nvkm_wo32(memory, offset + 0x8, cgrp->id);
-	nvkm_wo32(memory, offset + 0xc, 0x00000000);
+	data[0] = (128 << 24) | (3 << 16) | 0x00000001;
+	data[1] = cgrp->chan_nr;
+	data[2] = cgrp->id;
+	data[3] = 0x00000000;
 }
 
 const struct gk104_fifo_runlist_func
@@ -58,6 +56,7 @@ gv100_fifo_runlist = {
 	.cgrp = gv100_fifo_runlist_cgrp,
 	.chan = gv100_fifo_runlist_chan,
 	.commit = gk104_fifo_runlist_commit,
+	.pending = gk104_fifo_runlist_pending,
 };
 
 const struct nvkm_enum
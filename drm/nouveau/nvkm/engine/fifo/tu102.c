@@ -39,8 +39,6 @@ tu102_fifo_runlist_commit(struct gk104_fifo *fifo, int runl,
 	nvkm_wr32(device, 0x002b00 + (runl * 0x10), lower_32_bits(addr));
 	nvkm_wr32(device, 0x002b04 + (runl * 0x10), upper_32_bits(addr));
 	nvkm_wr32(device, 0x002b08 + (runl * 0x10), nr);
-
-	/*XXX: how to wait? can you even wait? */
 }
 
 const struct gk104_fifo_runlist_func
@@ -49,6 +47,7 @@ tu102_fifo_runlist = {
 	.cgrp = gv100_fifo_runlist_cgrp,
 	.chan = gv100_fifo_runlist_chan,
 	.commit = tu102_fifo_runlist_commit,
+	/*XXX: how to wait? can you even wait? */
 };
 
 static const struct nvkm_enum
@@ -23,6 +23,7 @@
  */
 #include "ctxgf100.h"
 
+#include <core/option.h>
 #include <subdev/fb.h>
 #include <subdev/mc.h>
 #include <subdev/timer.h>
@@ -1446,7 +1447,7 @@ gf100_grctx_generate(struct gf100_gr *gr)
 	struct nvkm_vmm *vmm = NULL;
 	struct nvkm_vma *ctx = NULL;
 	struct gf100_grctx info;
-	int ret, i;
+	int ret;
 	u64 addr;
 
 	/* NV_PGRAPH_FE_PWR_MODE_FORCE_ON. */
@@ -1561,8 +1562,7 @@ gf100_grctx_generate(struct gf100_gr *gr)
 	gr->data = kmalloc(gr->size, GFP_KERNEL);
 	if (gr->data) {
 		nvkm_kmap(data);
-		for (i = 0; i < gr->size; i += 4)
-			gr->data[i / 4] = nvkm_ro32(data, CB_RESERVED + i);
+		nvkm_memory_rd(data, CB_RESERVED, gr->data, gr->size);
 		nvkm_done(data);
 		ret = 0;
 	} else {
@@ -1578,6 +1578,245 @@ done:
 	return ret;
 }
 
+static u32
+gf100_grctx_hash(u32 hash, const void *data, u32 size)
+{
+	const u8 *ptr = data;
+	while (size--) {
+		hash ^= *ptr++;
+		hash *= 0x01000193;
+	}
+	return hash;
+}
+
+static u32
+gf100_grctx_hash_fuc(u32 hash, const struct gf100_gr_fuc *fuc)
+{
+	if (fuc->data)
+		hash = gf100_grctx_hash(hash, fuc->data, fuc->size);
+	return gf100_grctx_hash(hash, &fuc->size, sizeof(fuc->size));
+}
+
+/* Hashes what the packs write, rather than how they're laid out. */
+static u32
+gf100_grctx_hash_pack(u32 hash, const struct gf100_gr_pack *p)
+{
+	const struct gf100_gr_pack *pack;
+	const struct gf100_gr_init *init;
+
+	pack_for_each_init(init, pack, p) {
+		const u32 data[] = {
+			pack->type, init->addr, init->count, init->pitch,
+			init->data
+		};
+		hash = gf100_grctx_hash(hash, data, sizeof(data));
+	}
+	return hash;
+}
+
+void
+gf100_grctx_key(struct gf100_gr *gr, struct gf100_grctx_key *key)
+{
+	const struct gf100_grctx_func *grctx = gr->func->grctx;
+	u32 hash = 0x811c9dc5;
+
+	key->version = GF100_GRCTX_VERSION;
+	key->chipset = gr->base.engine.subdev.device->chipset;
+	key->size = gr->size;
+
+	if (gr->firmware) {
+		hash = gf100_grctx_hash_fuc(hash, &gr->fuc409c);
+		hash = gf100_grctx_hash_fuc(hash, &gr->fuc409d);
+		hash = gf100_grctx_hash_fuc(hash, &gr->fuc41ac);
+		hash = gf100_grctx_hash_fuc(hash, &gr->fuc41ad);
+	} else {
+		hash = gf100_grctx_hash_fuc(hash, &gr->func->fecs.ucode->code);
+		hash = gf100_grctx_hash_fuc(hash, &gr->func->fecs.ucode->data);
+		hash = gf100_grctx_hash_fuc(hash, &gr->func->gpccs.ucode->code);
+		hash = gf100_grctx_hash_fuc(hash, &gr->func->gpccs.ucode->data);
+	}
+	key->fw = gf100_grctx_hash(hash, &gr->firmware, sizeof(gr->firmware));
+
+	hash = 0x811c9dc5;
+	hash = gf100_grctx_hash_pack(hash, gr->func->mmio);
+	hash = gf100_grctx_hash_pack(hash, gr->fuc_sw_nonctx);
+	hash = gf100_grctx_hash_pack(hash, gr->fuc_sw_ctx);
+	hash = gf100_grctx_hash_pack(hash, gr->fuc_bundle);
+	hash = gf100_grctx_hash_pack(hash, gr->fuc_method);
+	hash = gf100_grctx_hash_pack(hash, grctx->hub);
+	hash = gf100_grctx_hash_pack(hash, grctx->gpc_0);
+	hash = gf100_grctx_hash_pack(hash, grctx->gpc_1);
+	hash = gf100_grctx_hash_pack(hash, grctx->zcull);
+	hash = gf100_grctx_hash_pack(hash, grctx->tpc);
+	hash = gf100_grctx_hash_pack(hash, grctx->ppc);
+	hash = gf100_grctx_hash_pack(hash, grctx->icmd);
+	hash = gf100_grctx_hash_pack(hash, grctx->mthd);
+	key->init = gf100_grctx_hash_pack(hash, grctx->sw_veid_bundle_init);
+
+	hash = 0x811c9dc5;
+	hash = gf100_grctx_hash(hash, &gr->rop_nr, sizeof(gr->rop_nr));
+	hash = gf100_grctx_hash(hash, &gr->gpc_nr, sizeof(gr->gpc_nr));
+	hash = gf100_grctx_hash(hash, gr->tpc_nr, sizeof(gr->tpc_nr));
+	hash = gf100_grctx_hash(hash, gr->ppc_nr, sizeof(gr->ppc_nr));
+	hash = gf100_grctx_hash(hash, gr->ppc_mask, sizeof(gr->ppc_mask));
+	hash = gf100_grctx_hash(hash, gr->ppc_tpc_mask,
+				sizeof(gr->ppc_tpc_mask));
+	hash = gf100_grctx_hash(hash, gr->sm, sizeof(gr->sm));
+	key->config = gf100_grctx_hash(hash, &gr->sm_nr, sizeof(gr->sm_nr));
+}
+
+/* On-disk cache file layout:
+ *
+ * struct gf100_grctx_file header;
+ * struct gf100_gr_data mmio_data[4];
+ * struct gf100_gr_mmio mmio_list[header.mmio_nr];
+ * u32 image[header.key.size / 4];
+ */
+struct gf100_grctx_file {
+#define GF100_GRCTX_FILE_MAGIC 0x58435247 /* "GRCX" */
+	u32 magic;
+	u32 version;
+	struct gf100_grctx_key key;
+	u32 mmio_nr;
+};
+
+static int
+gf100_grctx_load(struct gf100_gr *gr, const char *name,
+		 const struct gf100_grctx_key *key)
+{
+	struct nvkm_subdev *subdev = &gr->base.engine.subdev;
+	const size_t data_size = sizeof(gr->mmio_data);
+	const struct gf100_grctx_file *file;
+	const struct firmware *fw;
+	const u8 *ptr;
+	size_t mmio_size;
+	int ret = -EINVAL;
+
+	if (firmware_request_nowarn(&fw, name, subdev->device->dev))
+		return -ENOENT;
+
+	file = (const void *)fw->data;
+	if (fw->size < sizeof(*file) ||
+	    file->magic != GF100_GRCTX_FILE_MAGIC || file->version != 2 ||
+	    memcmp(&file->key, key, sizeof(*key)) ||
+	    file->mmio_nr > ARRAY_SIZE(gr->mmio_list))
+		goto done;
+
+	mmio_size = file->mmio_nr * sizeof(gr->mmio_list[0]);
+	if (fw->size != sizeof(*file) + data_size + mmio_size + key->size)
+		goto done;
+
+	if (!(gr->data = kmalloc(key->size, GFP_KERNEL))) {
+		ret = -ENOMEM;
+		goto done;
+	}
+
+	ptr = fw->data + sizeof(*file);
+	memcpy(gr->mmio_data, ptr, data_size);
+	ptr += data_size;
+	memset(gr->mmio_list, 0x00, sizeof(gr->mmio_list));
+	memcpy(gr->mmio_list, ptr, mmio_size);
+	ptr += mmio_size;
+	memcpy(gr->data, ptr, key->size);
+	ret = 0;
+done:
+	release_firmware(fw);
+	return ret;
+}
+
+static void
+gf100_grctx_save(struct gf100_gr *gr, const char *name,
+		 const struct gf100_grctx_key *key)
+{
+#ifdef CONFIG_NOUVEAU_FIRMWARE_CACHE
+	struct nvkm_subdev *subdev = &gr->base.engine.subdev;
+	const size_t data_size = sizeof(gr->mmio_data);
+	struct gf100_grctx_file *file;
+	size_t mmio_size, size;
+	u32 mmio_nr = 0;
+	u8 *ptr;
+
+	while (mmio_nr < ARRAY_SIZE(gr->mmio_list) &&
+	       gr->mmio_list[mmio_nr].addr)
+		mmio_nr++;
+	mmio_size = mmio_nr * sizeof(gr->mmio_list[0]);
+	size = sizeof(*file) + data_size + mmio_size + key->size;
+
+	if (!(file = kvmalloc(size, GFP_KERNEL)))
+		return;
+
+	file->magic = GF100_GRCTX_FILE_MAGIC;
+	file->version = 2;
+	file->key = *key;
+	file->mmio_nr = mmio_nr;
+	ptr = (u8 *)(file + 1);
+	memcpy(ptr, gr->mmio_data, data_size);
+	ptr += data_size;
+	memcpy(ptr, gr->mmio_list, mmio_size);
+	ptr += mmio_size;
+	memcpy(ptr, gr->data, key->size);
+
+	if (firmware_cache_write(name, file, size))
+		nvkm_warn(subdev, "failed to write context cache %s\n", name);
+	kvfree(file);
+#endif
+}
+
+/* Provide the golden context image for the current configuration.
+ *
+ * The image survives GR resets and suspend, but is regenerated whenever
+ * any of its inputs change.  If NvGrCtxCache names a file, it's also
+ * looked for there before generating, and (where supported) written
+ * back after.
+ */
+int
+gf100_grctx_golden(struct gf100_gr *gr)
+{
+	struct nvkm_subdev *subdev = &gr->base.engine.subdev;
+	struct nvkm_device *device = subdev->device;
+	struct gf100_grctx_key key;
+	const char *optarg;
+	char *name = NULL;
+	int optlen, ret;
+	s64 time;
+
+	gf100_grctx_key(gr, &key);
+	if (gr->data) {
+		if (!memcmp(&gr->data_key, &key, sizeof(key)))
+			return 0;
+		nvkm_debug(subdev, "golden context stale, regenerating\n");
+		kfree(gr->data);
+		gr->data = NULL;
+	}
+
+	optarg = nvkm_stropt(device->cfgopt, "NvGrCtxCache", &optlen);
+	if (optarg && !(name = kstrndup(optarg, optlen, GFP_KERNEL)))
+		return -ENOMEM;
+
+	if (name && !gf100_grctx_load(gr, name, &key)) {
+		nvkm_debug(subdev, "golden context loaded from %s\n", name);
+		gr->data_key = key;
+		kfree(name);
+		return 0;
+	}
+
+	memset(gr->mmio_data, 0x00, sizeof(gr->mmio_data));
+	memset(gr->mmio_list, 0x00, sizeof(gr->mmio_list));
+
+	time = ktime_to_us(ktime_get());
+	ret = gf100_grctx_generate(gr);
+	if (ret == 0) {
+		time = ktime_to_us(ktime_get()) - time;
+		nvkm_debug(subdev, "golden context generated in %lldus\n", time);
+		gr->data_key = key;
+		if (name)
+			gf100_grctx_save(gr, name, &key);
+	}
+
+	kfree(name);
+	return ret;
+}
+
 const struct gf100_grctx_func
 gf100_grctx = {
 	.main  = gf100_grctx_generate_main,
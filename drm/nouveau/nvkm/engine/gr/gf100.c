@@ -322,7 +322,7 @@ gf100_gr_chan_bind(struct nvkm_object *object, struct nvkm_gpuobj *parent,
 {
 	struct gf100_gr_chan *chan = gf100_gr_chan(object);
 	struct gf100_gr *gr = chan->gr;
-	int ret, i;
+	int ret;
 
 	ret = nvkm_gpuobj_new(gr->base.engine.subdev.device, gr->size,
 			      align, false, parent, pgpuobj);
@@ -330,8 +330,7 @@ gf100_gr_chan_bind(struct nvkm_object *object, struct nvkm_gpuobj *parent,
 		return ret;
 
 	nvkm_kmap(*pgpuobj);
-	for (i = 0; i < gr->size; i += 4)
-		nvkm_wo32(*pgpuobj, i, gr->data[i / 4]);
+	nvkm_gpuobj_memcpy_to(*pgpuobj, 0, gr->data, gr->size);
 
 	if (!gr->firmware) {
 		nvkm_wo32(*pgpuobj, 0x00, chan->mmio_nr / 2);
@@ -1760,12 +1759,10 @@ gf100_gr_init_ctxctl_ext(struct gf100_gr *gr)
 	}
 
 	/* Generate golden context image. */
-	if (gr->data == NULL) {
-		int ret = gf100_grctx_generate(gr);
-		if (ret) {
-			nvkm_error(subdev, "failed to construct context\n");
-			return ret;
-		}
+	ret = gf100_grctx_golden(gr);
+	if (ret) {
+		nvkm_error(subdev, "failed to construct context\n");
+		return ret;
 	}
 
 	return 0;
@@ -1777,6 +1774,7 @@ gf100_gr_init_ctxctl_int(struct gf100_gr *gr)
 	const struct gf100_grctx_func *grctx = gr->func->grctx;
 	struct nvkm_subdev *subdev = &gr->base.engine.subdev;
 	struct nvkm_device *device = subdev->device;
+	int ret;
 
 	if (!gr->func->fecs.ucode) {
 		return -ENOSYS;
@@ -1819,12 +1817,10 @@ gf100_gr_init_ctxctl_int(struct gf100_gr *gr)
 	}
 
 	gr->size = nvkm_rd32(device, 0x409804);
-	if (gr->data == NULL) {
-		int ret = gf100_grctx_generate(gr);
-		if (ret) {
-			nvkm_error(subdev, "failed to construct context\n");
-			return ret;
-		}
+	ret = gf100_grctx_golden(gr);
+	if (ret) {
+		nvkm_error(subdev, "failed to construct context\n");
+		return ret;
 	}
 
 	return 0;
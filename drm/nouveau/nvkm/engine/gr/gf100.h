@@ -55,6 +55,19 @@ struct gf100_gr_mmio {
 	int buffer;
 };
 
+/* Inputs the golden context image depends on.  Bump GF100_GRCTX_VERSION
+ * whenever the generation code changes what ends up in the image.
+ */
+struct gf100_grctx_key {
+#define GF100_GRCTX_VERSION 1
+	u32 version;
+	u32 chipset;
+	u32 size;
+	u32 fw;
+	u32 init;
+	u32 config;
+};
+
 struct gf100_gr_fuc {
 	u32 *data;
 	u32  size;
@@ -136,6 +149,7 @@ struct gf100_gr {
 	struct gf100_gr_mmio mmio_list[4096/8];
 	u32  size;
 	u32 *data;
+	struct gf100_grctx_key data_key;
 	u32 size_zcull;
 	u32 size_pm;
 };
@@ -279,8 +293,8 @@ extern const struct nvkm_object_func gf100_fermi;
 
 struct gf100_gr_init {
 	u32 addr;
-	u8  count;
-	u32 pitch;
+	u32 count:8;
+	u32 pitch:24;
 	u32 data;
 };
 
@@ -32,6 +32,32 @@ struct gk20a_fw_av
 	u32 data;
 };
 
+/* Append an address/value pair to an init list, extending the previous
+ * entry instead if the pair continues a run of the same value at a
+ * constant stride.
+ */
+static int
+gk20a_gr_init_add(struct gf100_gr_init *init, int nr, u32 addr, u32 data)
+{
+	struct gf100_gr_init *prev = nr ? &init[nr - 1] : NULL;
+
+	if (prev && prev->data == data && prev->count < 255) {
+		const u32 last = prev->addr + (prev->count - 1) * prev->pitch;
+		if (addr > last && (prev->count == 1 ?
+		    addr - last < BIT(24) : addr - last == prev->pitch)) {
+			prev->pitch = addr - last;
+			prev->count++;
+			return nr;
+		}
+	}
+
+	init[nr].addr = addr;
+	init[nr].data = data;
+	init[nr].count = 1;
+	init[nr].pitch = 1;
+	return nr + 1;
+}
+
 int
 gk20a_gr_av_to_init(struct gf100_gr *gr, const char *fw_name,
 		    struct gf100_gr_pack **ppack)
@@ -39,7 +65,7 @@ gk20a_gr_av_to_init(struct gf100_gr *gr, const char *fw_name,
 	struct gf100_gr_fuc fuc;
 	struct gf100_gr_init *init;
 	struct gf100_gr_pack *pack;
-	int nent;
+	int nent, nr;
 	int ret;
 	int i;
 
@@ -57,14 +83,9 @@ gk20a_gr_av_to_init(struct gf100_gr *gr, const char *fw_name,
 	init = (void *)(pack + 2);
 	pack[0].init = init;
 
-	for (i = 0; i < nent; i++) {
-		struct gf100_gr_init *ent = &init[i];
+	for (i = 0, nr = 0; i < nent; i++) {
 		struct gk20a_fw_av *av = &((struct gk20a_fw_av *)fuc.data)[i];
-
-		ent->addr = av->addr;
-		ent->data = av->data;
-		ent->count = 1;
-		ent->pitch = 1;
+		nr = gk20a_gr_init_add(init, nr, av->addr, av->data);
 	}
 
 	*ppack = pack;
@@ -88,7 +109,7 @@ gk20a_gr_aiv_to_init(struct gf100_gr *gr, const char *fw_name,
 	struct gf100_gr_fuc fuc;
 	struct gf100_gr_init *init;
 	struct gf100_gr_pack *pack;
-	int nent;
+	int nent, nr;
 	int ret;
 	int i;
 
@@ -106,14 +127,9 @@ gk20a_gr_aiv_to_init(struct gf100_gr *gr, const char *fw_name,
 	init = (void *)(pack + 2);
 	pack[0].init = init;
 
-	for (i = 0; i < nent; i++) {
-		struct gf100_gr_init *ent = &init[i];
+	for (i = 0, nr = 0; i < nent; i++) {
 		struct gk20a_fw_aiv *av = &((struct gk20a_fw_aiv *)fuc.data)[i];
-
-		ent->addr = av->addr;
-		ent->data = av->data;
-		ent->count = 1;
-		ent->pitch = 1;
+		nr = gk20a_gr_init_add(init, nr, av->addr, av->data);
 	}
 
 	*ppack = pack;
@@ -133,7 +149,7 @@ gk20a_gr_av_to_method(struct gf100_gr *gr, const char *fw_name,
 	/* We don't suppose we will initialize more than 16 classes here... */
 	static const unsigned int max_classes = 16;
 	u32 classidx = 0, prevclass = 0;
-	int nent;
+	int nent, nr;
 	int ret;
 	int i;
 
@@ -144,7 +160,7 @@ gk20a_gr_av_to_method(struct gf100_gr *gr, const char *fw_name,
 	nent = (fuc.size / sizeof(struct gk20a_fw_av));
 
 	pack = vzalloc((sizeof(*pack) * max_classes) +
-		       (sizeof(*init) * (nent + 1)));
+		       (sizeof(*init) * (nent + max_classes)));
 	if (!pack) {
 		ret = -ENOMEM;
 		goto end;
@@ -152,14 +168,17 @@ gk20a_gr_av_to_method(struct gf100_gr *gr, const char *fw_name,
 
 	init = (void *)(pack + max_classes);
 
-	for (i = 0; i < nent; i++) {
-		struct gf100_gr_init *ent = &init[i];
+	for (i = 0, nr = 0; i < nent; i++) {
 		struct gk20a_fw_av *av = &((struct gk20a_fw_av *)fuc.data)[i];
 		u32 class = av->addr & 0xffff;
 		u32 addr = (av->addr & 0xffff0000) >> 14;
 
 		if (prevclass != class) {
-			pack[classidx].init = ent;
+			/* Leave a terminator between each class' list. */
+			if (nr)
+				init = &init[nr + 1];
+			nr = 0;
+			pack[classidx].init = init;
 			pack[classidx].type = class;
 			prevclass = class;
 			if (++classidx >= max_classes) {
@@ -169,10 +188,7 @@ gk20a_gr_av_to_method(struct gf100_gr *gr, const char *fw_name,
 			}
 		}
 
-		ent->addr = addr;
-		ent->data = av->data;
-		ent->count = 1;
-		ent->pitch = 1;
+		nr = gk20a_gr_init_add(init, nr, addr, av->data);
 	}
 
 	*ppack = pack;
@@ -21,29 +21,52 @@
  */
 #include "priv.h"
 
+#include <core/memory.h>
+#include <core/option.h>
 #include <subdev/mc.h>
 
+static void
+nvkm_falcon_load_time(struct nvkm_falcon *falcon, const char *type, u32 size,
+		      s64 time)
+{
+	time = ktime_to_us(ktime_get()) - time;
+	mutex_lock(&falcon->mutex);
+	falcon->load.bytes += size;
+	falcon->load.time += time;
+	mutex_unlock(&falcon->mutex);
+	nvkm_trace(falcon->owner, "%s falcon: %s upload of %d bytes in %lldus\n",
+		   falcon->name, type, size, time);
+}
+
 void
 nvkm_falcon_load_imem(struct nvkm_falcon *falcon, void *data, u32 start,
 		      u32 size, u16 tag, u8 port, bool secure)
 {
+	s64 time;
+
 	if (secure && !falcon->secret) {
 		nvkm_warn(falcon->user,
 			  "writing with secure tag on a non-secure falcon!\n");
 		return;
 	}
 
+	time = ktime_to_us(ktime_get());
 	falcon->func->load_imem(falcon, data, start, size, tag, port,
 				secure);
+	nvkm_falcon_load_time(falcon, "IMEM", size, time);
 }
 
 void
 nvkm_falcon_load_dmem(struct nvkm_falcon *falcon, void *data, u32 start,
 		      u32 size, u8 port)
 {
+	s64 time;
+
 	mutex_lock(&falcon->dmem_mutex);
 
+	time = ktime_to_us(ktime_get());
 	falcon->func->load_dmem(falcon, data, start, size, port);
+	nvkm_falcon_load_time(falcon, "DMEM", size, time);
 
 	mutex_unlock(&falcon->dmem_mutex);
 }
@@ -179,6 +202,9 @@ nvkm_falcon_ctor(const struct nvkm_falcon_func *func,
 	falcon->addr = addr;
 	mutex_init(&falcon->mutex);
 	mutex_init(&falcon->dmem_mutex);
+	mutex_init(&falcon->dma.mutex);
+	falcon->dma.enable = nvkm_boolopt(subdev->device->cfgopt,
+					  "NvFalconDMA", true);
 
 	reg = nvkm_falcon_rd32(falcon, 0x12c);
 	falcon->version = reg & 0xf;
@@ -223,7 +249,14 @@ nvkm_falcon_ctor(const struct nvkm_falcon_func *func,
 void
 nvkm_falcon_del(struct nvkm_falcon **pfalcon)
 {
-	if (*pfalcon) {
+	struct nvkm_falcon *falcon = *pfalcon;
+
+	if (falcon) {
+		nvkm_debug(falcon->owner, "%s falcon: %llu bytes uploaded in "
+					  "%lluus, %u DMA, %u PIO\n",
+			   falcon->name, falcon->load.bytes, falcon->load.time,
+			   falcon->load.dma, falcon->load.pio);
+		nvkm_memory_unref(&falcon->dma.mem);
 		kfree(*pfalcon);
 		*pfalcon = NULL;
 	}
@@ -153,14 +153,13 @@ close:
 
 static bool
 cmd_queue_has_room(struct nvkm_msgqueue *priv, struct nvkm_msgqueue_queue *queue,
-		   u32 size, bool *rewind)
+		   u32 head, u32 size, bool *rewind)
 {
 	struct nvkm_falcon *falcon = priv->falcon;
-	u32 head, tail, free;
+	u32 tail, free;
 
 	size = ALIGN(size, QUEUE_ALIGNMENT);
 
-	head = nvkm_falcon_rd32(falcon, queue->head_reg);
 	tail = nvkm_falcon_rd32(falcon, queue->tail_reg);
 
 	if (head >= tail) {
@@ -217,16 +216,18 @@ cmd_queue_open(struct nvkm_msgqueue *priv, struct nvkm_msgqueue_queue *queue,
 	struct nvkm_falcon *falcon = priv->falcon;
 	const struct nvkm_subdev *subdev = priv->falcon->owner;
 	bool rewind = false;
+	u32 head;
 
 	mutex_lock(&queue->mutex);
 
-	if (!cmd_queue_has_room(priv, queue, size, &rewind)) {
+	head = nvkm_falcon_rd32(falcon, queue->head_reg);
+	if (!cmd_queue_has_room(priv, queue, head, size, &rewind)) {
 		nvkm_error(subdev, "queue full\n");
 		mutex_unlock(&queue->mutex);
 		return -EAGAIN;
 	}
 
-	queue->position = nvkm_falcon_rd32(falcon, queue->head_reg);
+	queue->position = head;
 
 	if (rewind)
 		cmd_queue_rewind(priv, queue);
@@ -234,6 +235,24 @@ cmd_queue_open(struct nvkm_msgqueue *priv, struct nvkm_msgqueue_queue *queue,
 	return 0;
 }
 
+/* Make room for another command behind those already pushed, but not yet
+ * published, on an open queue.
+ */
+static bool
+cmd_queue_reserve(struct nvkm_msgqueue *priv, struct nvkm_msgqueue_queue *queue,
+		  u32 size)
+{
+	bool rewind = false;
+
+	if (!cmd_queue_has_room(priv, queue, queue->position, size, &rewind))
+		return false;
+
+	if (rewind)
+		cmd_queue_rewind(priv, queue);
+
+	return true;
+}
+
 static void
 cmd_queue_close(struct nvkm_msgqueue *priv, struct nvkm_msgqueue_queue *queue,
 		bool commit)
@@ -246,69 +265,91 @@ cmd_queue_close(struct nvkm_msgqueue *priv, struct nvkm_msgqueue_queue *queue,
 	mutex_unlock(&queue->mutex);
 }
 
+/* Returns the number of commands published, or an error if none were. */
 static int
-cmd_write(struct nvkm_msgqueue *priv, struct nvkm_msgqueue_hdr *cmd,
-	  struct nvkm_msgqueue_queue *queue)
+cmd_write(struct nvkm_msgqueue *priv, struct nvkm_msgqueue_queue *queue,
+	  struct nvkm_msgqueue_cmd *cmds, int nr, u32 *heads)
 {
 	const struct nvkm_subdev *subdev = priv->falcon->owner;
 	static unsigned timeout = 2000;
 	unsigned long end_jiffies = jiffies + msecs_to_jiffies(timeout);
-	int ret = -EAGAIN;
-	bool commit = true;
-
-	while (ret == -EAGAIN && time_before(jiffies, end_jiffies))
-		ret = cmd_queue_open(priv, queue, cmd->size);
-	if (ret) {
-		nvkm_error(subdev, "pmu_queue_open_write failed\n");
-		return ret;
-	}
+	int ret = 0, i = 0, done;
+
+	while (i < nr) {
+		ret = -EAGAIN;
+		while (ret == -EAGAIN && time_before(jiffies, end_jiffies))
+			ret = cmd_queue_open(priv, queue, cmds[i].hdr->size);
+		if (ret) {
+			nvkm_error(subdev, "pmu_queue_open_write failed\n");
+			break;
+		}
 
-	ret = cmd_queue_push(priv, queue, cmd, cmd->size);
-	if (ret) {
-		nvkm_error(subdev, "pmu_queue_push failed\n");
-		commit = false;
+		/* Push as many commands as will fit, and publish them all
+		 * with a single HEAD update.
+		 */
+		done = i;
+		do {
+			ret = cmd_queue_push(priv, queue, cmds[i].hdr,
+					     cmds[i].hdr->size);
+			if (ret) {
+				nvkm_error(subdev, "pmu_queue_push failed\n");
+				break;
+			}
+		} while (++i < nr &&
+			 cmd_queue_reserve(priv, queue, cmds[i].hdr->size));
+
+		cmd_queue_close(priv, queue, i > done);
+		if (i > done)
+			(*heads)++;
+		if (ret)
+			break;
 	}
 
-	cmd_queue_close(priv, queue, commit);
-
-	return ret;
+	return i ? i : ret;
 }
 
-static struct nvkm_msgqueue_seq *
-msgqueue_seq_acquire(struct nvkm_msgqueue *priv)
+static int
+msgqueue_seq_acquire(struct nvkm_msgqueue *priv,
+		     struct nvkm_msgqueue_seq **seq, int nr)
 {
 	const struct nvkm_subdev *subdev = priv->falcon->owner;
-	struct nvkm_msgqueue_seq *seq;
 	u32 index;
+	int i;
 
 	mutex_lock(&priv->seq_lock);
 
-	index = find_first_zero_bit(priv->seq_tbl, NVKM_MSGQUEUE_NUM_SEQUENCES);
-
-	if (index >= NVKM_MSGQUEUE_NUM_SEQUENCES) {
+	if (priv->stats.inflight + nr > NVKM_MSGQUEUE_NUM_SEQUENCES) {
 		nvkm_error(subdev, "no free sequence available\n");
 		mutex_unlock(&priv->seq_lock);
-		return ERR_PTR(-EAGAIN);
+		return -EAGAIN;
 	}
 
-	set_bit(index, priv->seq_tbl);
-
-	mutex_unlock(&priv->seq_lock);
+	for (i = 0; i < nr; i++) {
+		index = find_first_zero_bit(priv->seq_tbl,
+					    NVKM_MSGQUEUE_NUM_SEQUENCES);
+		set_bit(index, priv->seq_tbl);
 
-	seq = &priv->seq[index];
-	seq->state = SEQ_STATE_PENDING;
+		seq[i] = &priv->seq[index];
+		seq[i]->state = SEQ_STATE_PENDING;
+	}
 
-	return seq;
+	priv->stats.inflight += nr;
+	priv->stats.inflight_max = max(priv->stats.inflight_max,
+				       priv->stats.inflight);
+	mutex_unlock(&priv->seq_lock);
+	return 0;
 }
 
+/* Must be called with seq_lock held. */
 static void
 msgqueue_seq_release(struct nvkm_msgqueue *priv, struct nvkm_msgqueue_seq *seq)
 {
-	/* no need to acquire seq_lock since clear_bit is atomic */
 	seq->state = SEQ_STATE_FREE;
 	seq->callback = NULL;
 	seq->completion = NULL;
+	seq->data = NULL;
 	clear_bit(seq->id, priv->seq_tbl);
+	priv->stats.inflight--;
 }
 
 /* specifies that we want to know the command status in the answer message */
@@ -316,14 +357,30 @@ msgqueue_seq_release(struct nvkm_msgqueue *priv, struct nvkm_msgqueue_seq *seq)
 /* specifies that we want an interrupt when the answer message is queued */
 #define CMD_FLAGS_INTR BIT(1)
 
+/**
+ * nvkm_msgqueue_submit - post several commands without waiting for them
+ *
+ * Each command gets its own sequence, and is completed independently through
+ * its callback and/or completion.  Commands are written to the queue back to
+ * back and published with as few HEAD updates as the queue space allows.
+ *
+ * Returns the number of commands posted, which is less than @nr only if an
+ * error occurred after some of them were published, or a negative error code
+ * if none were.
+ */
 int
-nvkm_msgqueue_post(struct nvkm_msgqueue *priv, enum msgqueue_msg_priority prio,
-		   struct nvkm_msgqueue_hdr *cmd, nvkm_msgqueue_callback cb,
-		   struct completion *completion, bool wait_init)
+nvkm_msgqueue_submit(struct nvkm_msgqueue *priv,
+		     enum msgqueue_msg_priority prio,
+		     struct nvkm_msgqueue_cmd *cmds, int nr, bool wait_init)
 {
-	struct nvkm_msgqueue_seq *seq;
+	struct nvkm_msgqueue_seq *seq[NVKM_MSGQUEUE_NUM_SEQUENCES];
 	struct nvkm_msgqueue_queue *queue;
-	int ret;
+	u32 heads = 0;
+	s64 time;
+	int ret, i;
+
+	if (nr <= 0 || nr > NVKM_MSGQUEUE_NUM_SEQUENCES)
+		return -EINVAL;
 
 	if (wait_init && !wait_for_completion_timeout(&priv->init_done,
 					 msecs_to_jiffies(1000)))
@@ -333,23 +390,77 @@ nvkm_msgqueue_post(struct nvkm_msgqueue *priv, enum msgqueue_msg_priority prio,
 	if (IS_ERR(queue))
 		return PTR_ERR(queue);
 
-	seq = msgqueue_seq_acquire(priv);
-	if (IS_ERR(seq))
-		return PTR_ERR(seq);
-
-	cmd->seq_id = seq->id;
-	cmd->ctrl_flags = CMD_FLAGS_STATUS | CMD_FLAGS_INTR;
+	ret = msgqueue_seq_acquire(priv, seq, nr);
+	if (ret)
+		return ret;
 
-	seq->callback = cb;
-	seq->state = SEQ_STATE_USED;
-	seq->completion = completion;
+	time = ktime_to_us(ktime_get());
+	for (i = 0; i < nr; i++) {
+		cmds[i].hdr->seq_id = seq[i]->id;
+		cmds[i].hdr->ctrl_flags = CMD_FLAGS_STATUS | CMD_FLAGS_INTR;
 
-	ret = cmd_write(priv, cmd, queue);
-	if (ret) {
-		seq->state = SEQ_STATE_PENDING;
-		msgqueue_seq_release(priv, seq);
+		seq[i]->callback = cmds[i].callback;
+		seq[i]->completion = cmds[i].completion;
+		seq[i]->data = cmds[i].data;
+		seq[i]->time = time;
+		seq[i]->state = SEQ_STATE_USED;
 	}
 
+	ret = cmd_write(priv, queue, cmds, nr, &heads);
+
+	mutex_lock(&priv->seq_lock);
+	for (i = max(ret, 0); i < nr; i++)
+		msgqueue_seq_release(priv, seq[i]);
+	priv->stats.cmds += max(ret, 0);
+	priv->stats.heads += heads;
+	mutex_unlock(&priv->seq_lock);
+	return ret;
+}
+
+int
+nvkm_msgqueue_post(struct nvkm_msgqueue *priv, enum msgqueue_msg_priority prio,
+		   struct nvkm_msgqueue_hdr *cmd, nvkm_msgqueue_callback cb,
+		   struct completion *completion, bool wait_init)
+{
+	struct nvkm_msgqueue_cmd args = {
+		.hdr = cmd,
+		.callback = cb,
+		.completion = completion,
+	};
+	int ret;
+
+	ret = nvkm_msgqueue_submit(priv, prio, &args, 1, wait_init);
+	if (ret < 0)
+		return ret;
+
+	return 0;
+}
+
+/**
+ * nvkm_msgqueue_wait - wait for a posted command to complete
+ *
+ * On timeout, the command's sequence is cancelled so that a late reply will
+ * neither run its callback nor signal @completion.
+ */
+int
+nvkm_msgqueue_wait(struct nvkm_msgqueue *priv, struct nvkm_msgqueue_hdr *cmd,
+		   struct completion *completion, u32 ms)
+{
+	struct nvkm_msgqueue_seq *seq = &priv->seq[cmd->seq_id];
+	int ret = 0;
+
+	if (wait_for_completion_timeout(completion, msecs_to_jiffies(ms)))
+		return 0;
+
+	mutex_lock(&priv->seq_lock);
+	if (seq->state == SEQ_STATE_USED && seq->completion == completion) {
+		seq->state = SEQ_STATE_CANCELLED;
+		seq->callback = NULL;
+		seq->completion = NULL;
+		seq->data = NULL;
+		ret = -ETIMEDOUT;
+	}
+	mutex_unlock(&priv->seq_lock);
 	return ret;
 }
 
@@ -358,23 +469,37 @@ msgqueue_msg_handle(struct nvkm_msgqueue *priv, struct nvkm_msgqueue_hdr *hdr)
 {
 	const struct nvkm_subdev *subdev = priv->falcon->owner;
 	struct nvkm_msgqueue_seq *seq;
+	nvkm_msgqueue_callback callback = NULL;
+	s64 time;
 
 	seq = &priv->seq[hdr->seq_id];
+
+	mutex_lock(&priv->seq_lock);
 	if (seq->state != SEQ_STATE_USED && seq->state != SEQ_STATE_CANCELLED) {
+		mutex_unlock(&priv->seq_lock);
 		nvkm_error(subdev, "msg for unknown sequence %d", seq->id);
 		return -EINVAL;
 	}
 
-	if (seq->state == SEQ_STATE_USED) {
-		if (seq->callback)
-			seq->callback(priv, hdr);
-	}
+	if (seq->state == SEQ_STATE_USED)
+		callback = seq->callback;
+	mutex_unlock(&priv->seq_lock);
 
+	/* The callback may submit further commands, so call it unlocked. */
+	if (callback)
+		callback(priv, hdr);
+
+	mutex_lock(&priv->seq_lock);
 	if (seq->completion)
 		complete(seq->completion);
 
-	msgqueue_seq_release(priv, seq);
+	time = ktime_to_us(ktime_get()) - seq->time;
+	priv->stats.msgs++;
+	priv->stats.latency += time;
+	priv->stats.latency_max = max_t(u64, priv->stats.latency_max, time);
 
+	msgqueue_seq_release(priv, seq);
+	mutex_unlock(&priv->seq_lock);
 	return 0;
 }
 
@@ -526,8 +651,18 @@ nvkm_msgqueue_new(u32 version, struct nvkm_falcon *falcon,
 void
 nvkm_msgqueue_del(struct nvkm_msgqueue **queue)
 {
-	if (*queue) {
-		(*queue)->func->dtor(*queue);
+	struct nvkm_msgqueue *priv = *queue;
+
+	if (priv) {
+		nvkm_debug(priv->falcon->owner, "msgqueue: %llu cmds, %llu HEAD "
+			   "updates, max %u in flight, %llu msgs, avg %lluus "
+			   "max %lluus\n",
+			   priv->stats.cmds, priv->stats.heads,
+			   priv->stats.inflight_max, priv->stats.msgs,
+			   priv->stats.msgs ?
+			   div64_u64(priv->stats.latency, priv->stats.msgs) : 0,
+			   priv->stats.latency_max);
+		priv->func->dtor(priv);
 		*queue = NULL;
 	}
 }
@@ -153,6 +153,8 @@ struct nvkm_msgqueue_queue {
  * @state:	current state
  * @callback:	callback to call upon receiving matching message
  * @completion:	completion to signal after callback is called
+ * @data:	private data of the submitter
+ * @time:	submission time, in us
  */
 struct nvkm_msgqueue_seq {
 	u16 id;
@@ -164,6 +166,23 @@ struct nvkm_msgqueue_seq {
 	} state;
 	nvkm_msgqueue_callback callback;
 	struct completion *completion;
+	void *data;
+	s64 time;
+};
+
+/**
+ * struct nvkm_msgqueue_cmd - command for asynchronous submission
+ *
+ * @hdr:	command to send, seq_id and ctrl_flags are filled on submission
+ * @callback:	called with the matching message (optional)
+ * @completion:	signaled after @callback is called (optional)
+ * @data:	returned by nvkm_msgqueue_cmd_data() from within @callback
+ */
+struct nvkm_msgqueue_cmd {
+	struct nvkm_msgqueue_hdr *hdr;
+	nvkm_msgqueue_callback callback;
+	struct completion *completion;
+	void *data;
 };
 
 /*
@@ -179,9 +198,10 @@ struct nvkm_msgqueue_seq {
  * @func:	implementation of the firmware to use
  * @init_msg_received:	whether the init message has already been received
  * @init_done:	whether all init is complete and commands can be processed
- * @seq_lock:	protects seq and seq_tbl
+ * @seq_lock:	protects seq, seq_tbl and stats
  * @seq:	sequences to match commands and messages
  * @seq_tbl:	bitmap of sequences currently in use
+ * @stats:	queue depth, HEAD updates and command round-trip latency (us)
  */
 struct nvkm_msgqueue {
 	struct nvkm_falcon *falcon;
@@ -193,6 +213,16 @@ struct nvkm_msgqueue {
 	struct mutex seq_lock;
 	struct nvkm_msgqueue_seq seq[NVKM_MSGQUEUE_NUM_SEQUENCES];
 	unsigned long seq_tbl[BITS_TO_LONGS(NVKM_MSGQUEUE_NUM_SEQUENCES)];
+
+	struct {
+		u32 inflight;
+		u32 inflight_max;
+		u64 cmds;
+		u64 heads;
+		u64 msgs;
+		u64 latency;
+		u64 latency_max;
+	} stats;
 };
 
 void nvkm_msgqueue_ctor(const struct nvkm_msgqueue_func *, struct nvkm_falcon *,
@@ -200,6 +230,17 @@ void nvkm_msgqueue_ctor(const struct nvkm_msgqueue_func *, struct nvkm_falcon *,
 int nvkm_msgqueue_post(struct nvkm_msgqueue *, enum msgqueue_msg_priority,
 		       struct nvkm_msgqueue_hdr *, nvkm_msgqueue_callback,
 		       struct completion *, bool);
+int nvkm_msgqueue_submit(struct nvkm_msgqueue *, enum msgqueue_msg_priority,
+			 struct nvkm_msgqueue_cmd *, int nr, bool);
+int nvkm_msgqueue_wait(struct nvkm_msgqueue *, struct nvkm_msgqueue_hdr *,
+		       struct completion *, u32 ms);
+
+static inline void *
+nvkm_msgqueue_cmd_data(struct nvkm_msgqueue *priv,
+		       struct nvkm_msgqueue_hdr *hdr)
+{
+	return priv->seq[hdr->seq_id].data;
+}
 void nvkm_msgqueue_process_msgs(struct nvkm_msgqueue *,
 				struct nvkm_msgqueue_queue *);
 
@@ -209,6 +209,7 @@ acr_boot_falcon(struct nvkm_msgqueue *priv, enum nvkm_secboot_falcon falcon)
 		u32 flags;
 		u32 falcon_id;
 	} cmd;
+	int ret;
 
 	memset(&cmd, 0, sizeof(cmd));
 
@@ -217,13 +218,12 @@ acr_boot_falcon(struct nvkm_msgqueue *priv, enum nvkm_secboot_falcon falcon)
 	cmd.cmd_type = ACR_CMD_BOOTSTRAP_FALCON;
 	cmd.flags = ACR_CMD_BOOTSTRAP_FALCON_FLAGS_RESET_YES;
 	cmd.falcon_id = falcon;
-	nvkm_msgqueue_post(priv, MSGQUEUE_MSG_PRIORITY_HIGH, &cmd.hdr,
+	ret = nvkm_msgqueue_post(priv, MSGQUEUE_MSG_PRIORITY_HIGH, &cmd.hdr,
 			   acr_boot_falcon_callback, &completed, true);
+	if (ret)
+		return ret;
 
-	if (!wait_for_completion_timeout(&completed, msecs_to_jiffies(1000)))
-		return -ETIMEDOUT;
-
-	return 0;
+	return nvkm_msgqueue_wait(priv, &cmd.hdr, &completed, 1000);
 }
 
 const struct nvkm_msgqueue_acr_func
@@ -25,6 +25,151 @@
 #include <core/memory.h>
 #include <subdev/timer.h>
 
+/* Uploads smaller than this aren't worth the DMA setup cost. */
+#define NVKM_FALCON_DMA_MIN 0x400
+
+static u32
+nvkm_falcon_v1_fbif(struct nvkm_falcon *falcon)
+{
+	switch (falcon->owner->index) {
+	case NVKM_ENGINE_NVENC0:
+	case NVKM_ENGINE_NVENC1:
+	case NVKM_ENGINE_NVENC2:
+		return 0x800;
+	case NVKM_SUBDEV_PMU:
+		return 0xe00;
+	default:
+		return 0x600;
+	}
+}
+
+/* Upload a block of IMEM/DMEM with the falcon's own DMA engine, from a
+ * staging buffer in instance memory.  Transfers are done in 256-byte
+ * blocks, IMEM tags are derived from the FB offset of each block.
+ */
+static int
+nvkm_falcon_v1_dma(struct nvkm_falcon *falcon, const void *data, u32 start,
+		   u32 size, u16 tag, bool imem)
+{
+	struct nvkm_device *device = falcon->owner->device;
+	const u32 fbif = nvkm_falcon_v1_fbif(falcon);
+	const u32 len = ALIGN(size, 0x100);
+	enum nvkm_falcon_dmaidx idx;
+	struct nvkm_memory *mem;
+	u32 dmactl, fbifctl, dmabase, transcfg, cmd, i;
+	u64 base;
+	int ret;
+
+	mutex_lock(&falcon->dma.mutex);
+	if (!falcon->dma.enable) {
+		ret = -ENODEV;
+		goto done;
+	}
+
+	mem = falcon->dma.mem;
+	if (!mem || nvkm_memory_size(mem) < len) {
+		u32 max = max(len, max(falcon->code.limit, falcon->data.limit));
+
+		nvkm_memory_unref(&falcon->dma.mem);
+		ret = nvkm_memory_new(device, NVKM_MEM_TARGET_INST,
+				      ALIGN(max, 0x100), 0x100, false,
+				      &falcon->dma.mem);
+		if (ret)
+			goto done;
+		mem = falcon->dma.mem;
+	}
+
+	switch (nvkm_memory_target(mem)) {
+	case NVKM_MEM_TARGET_VRAM:
+		idx = FALCON_DMAIDX_PHYS_VID;
+		transcfg = 0x4;
+		break;
+	case NVKM_MEM_TARGET_HOST:
+		idx = FALCON_DMAIDX_PHYS_SYS_COH;
+		transcfg = 0x5;
+		break;
+	case NVKM_MEM_TARGET_NCOH:
+		idx = FALCON_DMAIDX_PHYS_SYS_NCOH;
+		transcfg = 0x6;
+		break;
+	default:
+		ret = -EINVAL;
+		goto done;
+	}
+
+	/* The DMA base is offset so that FB offset >> 8 is the IMEM tag. */
+	base = nvkm_memory_addr(mem) >> 8;
+	if (imem) {
+		if (base < tag) {
+			ret = -EINVAL;
+			goto done;
+		}
+		base -= tag;
+	}
+
+	nvkm_kmap(mem);
+	if (len != size)
+		nvkm_memory_fill(mem, size & ~3, 0, len - (size & ~3));
+	nvkm_memory_wr(mem, 0, data, size);
+	nvkm_done(mem);
+
+	/* Allow physical DMA without a bound context.  The DMA base is
+	 * shared with the bootloader path, so it's put back afterwards.
+	 */
+	dmactl = nvkm_falcon_rd32(falcon, 0x10c);
+	fbifctl = nvkm_falcon_rd32(falcon, fbif + 0x24);
+	dmabase = nvkm_falcon_rd32(falcon, 0x110);
+	nvkm_falcon_wr32(falcon, 0x10c, 0x0);
+	nvkm_falcon_wr32(falcon, fbif + 0x24, fbifctl | 0x00000080);
+	nvkm_falcon_wr32(falcon, fbif + 4 * idx, transcfg);
+	nvkm_falcon_wr32(falcon, 0x110, lower_32_bits(base));
+
+	cmd = (idx << 12) | (6 << 8) | (imem ? 0x10 : 0x00);
+	for (i = 0; i < len; i += 0x100) {
+		ret = nvkm_wait_msec(device, 10, falcon->addr + 0x118,
+				     0x00000001, 0x00000000);
+		if (ret < 0)
+			break;
+
+		nvkm_falcon_wr32(falcon, 0x114, start + i);
+		nvkm_falcon_wr32(falcon, 0x11c, (imem ? tag << 8 : 0) + i);
+		nvkm_falcon_wr32(falcon, 0x118, cmd);
+	}
+
+	if (ret >= 0) {
+		ret = nvkm_wait_msec(device, 10, falcon->addr + 0x118,
+				     0x00000002, 0x00000002);
+	}
+
+	nvkm_falcon_wr32(falcon, 0x110, dmabase);
+	nvkm_falcon_wr32(falcon, fbif + 0x24, fbifctl);
+	nvkm_falcon_wr32(falcon, 0x10c, dmactl & 0x00000001);
+
+	if (ret < 0) {
+		nvkm_warn(falcon->owner, "%s falcon DMA upload timed out, "
+					 "using PIO\n", falcon->name);
+		falcon->dma.enable = false;
+		ret = -ETIMEDOUT;
+	} else {
+		ret = 0;
+	}
+
+done:
+	mutex_unlock(&falcon->dma.mutex);
+	return ret;
+}
+
+static void
+nvkm_falcon_v1_load_stat(struct nvkm_falcon *falcon, bool dma)
+{
+	mutex_lock(&falcon->mutex);
+	if (dma)
+		falcon->load.dma++;
+	else
+		falcon->load.pio++;
+	mutex_unlock(&falcon->mutex);
+}
+
 static void
 nvkm_falcon_v1_load_imem(struct nvkm_falcon *falcon, void *data, u32 start,
 			 u32 size, u16 tag, u8 port, bool secure)
@@ -33,6 +178,14 @@ nvkm_falcon_v1_load_imem(struct nvkm_falcon *falcon, void *data, u32 start,
 	u32 reg;
 	int i;
 
+	/* Secure (HS) uploads are left on PIO. */
+	if (!secure && size >= NVKM_FALCON_DMA_MIN && !(start & 0xff) &&
+	    !nvkm_falcon_v1_dma(falcon, data, start, size, tag, true)) {
+		nvkm_falcon_v1_load_stat(falcon, true);
+		return;
+	}
+
+	nvkm_falcon_v1_load_stat(falcon, false);
 	size -= rem;
 
 	reg = start | BIT(24) | (secure ? BIT(28) : 0);
@@ -103,6 +256,18 @@ nvkm_falcon_v1_load_dmem(struct nvkm_falcon *falcon, void *data, u32 start,
 						start - EMEM_START_ADDR, size,
 						port);
 
+	/* DMA whole blocks only, so we don't clobber DMEM past the end. */
+	if (size >= NVKM_FALCON_DMA_MIN && !(start & 0xff) &&
+	    !nvkm_falcon_v1_dma(falcon, data, start, size & ~0xff, 0, false)) {
+		nvkm_falcon_v1_load_stat(falcon, true);
+		data = (u8 *)data + (size & ~0xff);
+		start += size & ~0xff;
+		size &= 0xff;
+		rem = size % 4;
+	} else {
+		nvkm_falcon_v1_load_stat(falcon, false);
+	}
+
 	size -= rem;
 
 	nvkm_falcon_wr32(falcon, 0x1c0 + (port * 8), start | (0x1 << 24));
@@ -192,19 +357,7 @@ nvkm_falcon_v1_bind_context(struct nvkm_falcon *falcon, struct nvkm_memory *ctx)
 		return;
 	}
 
-	switch (falcon->owner->index) {
-	case NVKM_ENGINE_NVENC0:
-	case NVKM_ENGINE_NVENC1:
-	case NVKM_ENGINE_NVENC2:
-		fbif = 0x800;
-		break;
-	case NVKM_SUBDEV_PMU:
-		fbif = 0xe00;
-		break;
-	default:
-		fbif = 0x600;
-		break;
-	}
+	fbif = nvkm_falcon_v1_fbif(falcon);
 
 	nvkm_falcon_wr32(falcon, 0x10c, 0x1);
 
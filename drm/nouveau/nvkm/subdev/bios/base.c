@@ -130,6 +130,8 @@ static void *
 nvkm_bios_dtor(struct nvkm_subdev *subdev)
 {
 	struct nvkm_bios *bios = nvkm_bios(subdev);
+	nvbios_initx_fini(bios);
+	nvbios_index_fini(bios);
 	kfree(bios->data);
 	return bios;
 }
@@ -200,5 +202,10 @@ nvkm_bios_new(struct nvkm_device *device, int index, struct nvkm_bios **pbios)
 	nvkm_info(&bios->subdev, "version %02x.%02x.%02x.%02x.%02x\n",
 		  bios->version.major, bios->version.chip,
 		  bios->version.minor, bios->version.micro, bios->version.patch);
-	return 0;
+
+	ret = nvbios_index_new(bios);
+	if (ret)
+		return ret;
+
+	return nvbios_initx_new(bios);
 }
@@ -21,12 +21,22 @@
  *
  * Authors: Ben Skeggs
  */
-#include <subdev/bios.h>
-#include <subdev/bios/bit.h>
+#include "priv.h"
 
 int
 bit_entry(struct nvkm_bios *bios, u8 id, struct bit_entry *bit)
 {
+	const struct nvbios_index *index = bios->index;
+
+	if (likely(bios->bit_offset) && index) {
+		if (index->bit_map[id >> 5] & BIT(id & 31)) {
+			*bit = index->bit[id];
+			return 0;
+		}
+
+		return -ENOENT;
+	}
+
 	if (likely(bios->bit_offset)) {
 		u8  entries = nvbios_rd08(bios, bios->bit_offset + 10);
 		u32 entry   = bios->bit_offset + 12;
@@ -21,14 +21,23 @@
  *
  * Authors: Ben Skeggs
  */
-#include <subdev/bios.h>
-#include <subdev/bios/dcb.h>
-#include <subdev/bios/conn.h>
+#include "priv.h"
 
 u32
 nvbios_connTe(struct nvkm_bios *bios, u8 *ver, u8 *hdr, u8 *cnt, u8 *len)
 {
-	u32 dcb = dcb_table(bios, ver, hdr, cnt, len);
+	const struct nvbios_index *index = bios->index;
+	u32 dcb;
+
+	if (index && index->conn.data) {
+		*ver = index->conn.ver;
+		*hdr = index->conn.hdr;
+		*cnt = index->conn.cnt;
+		*len = index->conn.len;
+		return index->conn.data;
+	}
+
+	dcb = dcb_table(bios, ver, hdr, cnt, len);
 	if (dcb && *ver >= 0x30 && *hdr >= 0x16) {
 		u32 data = nvbios_rd16(bios, dcb + 0x14);
 		if (data) {
@@ -72,7 +81,20 @@ u32
 nvbios_connEp(struct nvkm_bios *bios, u8 idx, u8 *ver, u8 *len,
 	      struct nvbios_connE *info)
 {
-	u32 data = nvbios_connEe(bios, idx, ver, len);
+	const struct nvbios_index *index = bios->index;
+	u32 data;
+
+	if (index && index->connE && idx < index->conn.cnt) {
+		const struct nvbios_index_connE *e = &index->connE[idx];
+		if (e->data) {
+			*ver = e->ver;
+			*len = e->len;
+			*info = e->info;
+			return e->data;
+		}
+	}
+
+	data = nvbios_connEe(bios, idx, ver, len);
 	memset(info, 0x00, sizeof(*info));
 	switch (!!data * *ver) {
 	case 0x30:
@@ -21,16 +21,24 @@
  *
  * Authors: Ben Skeggs
  */
-#include <subdev/bios.h>
-#include <subdev/bios/dcb.h>
+#include "priv.h"
 
 u16
 dcb_table(struct nvkm_bios *bios, u8 *ver, u8 *hdr, u8 *cnt, u8 *len)
 {
 	struct nvkm_subdev *subdev = &bios->subdev;
 	struct nvkm_device *device = subdev->device;
+	const struct nvbios_index *index = bios->index;
 	u16 dcb = 0x0000;
 
+	if (index && index->dcb.data) {
+		*ver = index->dcb.ver;
+		*hdr = index->dcb.hdr;
+		*cnt = index->dcb.cnt;
+		*len = index->dcb.len;
+		return index->dcb.data;
+	}
+
 	if (device->card_type > NV_04)
 		dcb = nvbios_rd16(bios, 0x36);
 	if (!dcb) {
@@ -121,7 +129,20 @@ u16
 dcb_outp_parse(struct nvkm_bios *bios, u8 idx, u8 *ver, u8 *len,
 	       struct dcb_output *outp)
 {
-	u16 dcb = dcb_outp(bios, idx, ver, len);
+	const struct nvbios_index *index = bios->index;
+	u16 dcb;
+
+	if (index && index->dcbE && idx < index->dcb.cnt) {
+		const struct nvbios_index_dcbE *e = &index->dcbE[idx];
+		if (e->data) {
+			*ver = e->ver;
+			*len = e->len;
+			*outp = e->outp;
+			return e->data;
+		}
+	}
+
+	dcb = dcb_outp(bios, idx, ver, len);
 	memset(outp, 0x00, sizeof(*outp));
 	if (dcb) {
 		if (*ver >= 0x20) {
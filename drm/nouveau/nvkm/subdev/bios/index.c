@@ -0,0 +1,180 @@
+// SPDX-License-Identifier: MIT
+#include "priv.h"
+
+#include <core/option.h>
+#include <subdev/bios/bmp.h>
+
+static void
+nvbios_index_bit(struct nvkm_bios *bios, struct nvbios_index *index)
+{
+	u8  entries = nvbios_rd08(bios, bios->bit_offset + 10);
+	u8  stride  = nvbios_rd08(bios, bios->bit_offset + 9);
+	u32 entry   = bios->bit_offset + 12;
+
+	while (entries--) {
+		u8 id = nvbios_rd08(bios, entry + 0);
+		/* bit_entry() returns the first match, so must we. */
+		if (!(index->bit_map[id >> 5] & BIT(id & 31))) {
+			index->bit[id].id      = id;
+			index->bit[id].version = nvbios_rd08(bios, entry + 1);
+			index->bit[id].length  = nvbios_rd16(bios, entry + 2);
+			index->bit[id].offset  = nvbios_rd16(bios, entry + 4);
+			index->bit_map[id >> 5] |= BIT(id & 31);
+		}
+		entry += stride;
+	}
+}
+
+static int
+nvbios_index_tables(struct nvkm_bios *bios, struct nvbios_index *index)
+{
+	struct nvbios_index_table *t;
+	int i;
+
+	t = &index->perf;
+	t->data = nvbios_perf_table(bios, &t->ver, &t->hdr, &t->cnt, &t->len,
+					  &t->snr, &t->ssz);
+	if (t->data && t->cnt) {
+		index->perfE = kcalloc(t->cnt, sizeof(*index->perfE), GFP_KERNEL);
+		if (!index->perfE)
+			return -ENOMEM;
+
+		for (i = 0; i < t->cnt; i++) {
+			struct nvbios_index_perfE *e = &index->perfE[i];
+			e->data = nvbios_perfEp(bios, i, &e->ver, &e->hdr,
+						&e->cnt, &e->len, &e->info);
+		}
+	}
+
+	t = &index->rammap;
+	t->data = nvbios_rammapTe(bios, &t->ver, &t->hdr, &t->cnt, &t->len,
+					&t->snr, &t->ssz);
+	if (t->data && t->cnt) {
+		index->rammapE = kcalloc(t->cnt, sizeof(*index->rammapE),
+					 GFP_KERNEL);
+		if (!index->rammapE)
+			return -ENOMEM;
+
+		for (i = 0; i < t->cnt; i++) {
+			struct nvbios_index_rammapE *e = &index->rammapE[i];
+			e->data = nvbios_rammapEp(bios, i, &e->ver, &e->hdr,
+						  &e->cnt, &e->len, &e->info);
+		}
+	}
+
+	t = &index->volt;
+	t->data = nvbios_volt_table(bios, &t->ver, &t->hdr, &t->cnt, &t->len);
+	if (t->data && t->cnt) {
+		index->voltE = kcalloc(t->cnt, sizeof(*index->voltE), GFP_KERNEL);
+		if (!index->voltE)
+			return -ENOMEM;
+
+		for (i = 0; i < t->cnt; i++) {
+			struct nvbios_index_voltE *e = &index->voltE[i];
+			e->data = nvbios_volt_entry_parse(bios, i, &e->ver,
+							  &e->len, &e->info);
+		}
+	}
+
+	/* The legacy BMP parser clears the DCB pointer on pre-5.x images,
+	 * which it shares with us, so don't remember what it used to be.
+	 *
+	 * Also don't poke dcb_table() on boards without a DCB, it'd warn
+	 * about it here as well as when display actually looks for one.
+	 */
+	if ((bios->bmp_offset && bmp_version(bios) < 0x0500) ||
+	    bios->subdev.device->card_type <= NV_04 ||
+	    !nvbios_rd16(bios, 0x36))
+		return 0;
+
+	t = &index->dcb;
+	t->data = dcb_table(bios, &t->ver, &t->hdr, &t->cnt, &t->len);
+	if (t->data && t->cnt) {
+		index->dcbE = kcalloc(t->cnt, sizeof(*index->dcbE), GFP_KERNEL);
+		if (!index->dcbE)
+			return -ENOMEM;
+
+		for (i = 0; i < t->cnt; i++) {
+			struct nvbios_index_dcbE *e = &index->dcbE[i];
+			e->data = dcb_outp_parse(bios, i, &e->ver, &e->len,
+						 &e->outp);
+		}
+	}
+
+	t = &index->conn;
+	t->data = nvbios_connTe(bios, &t->ver, &t->hdr, &t->cnt, &t->len);
+	if (t->data && t->cnt) {
+		index->connE = kcalloc(t->cnt, sizeof(*index->connE), GFP_KERNEL);
+		if (!index->connE)
+			return -ENOMEM;
+
+		for (i = 0; i < t->cnt; i++) {
+			struct nvbios_index_connE *e = &index->connE[i];
+			e->data = nvbios_connEp(bios, i, &e->ver, &e->len,
+						&e->info);
+		}
+	}
+
+	return 0;
+}
+
+static void
+nvbios_index_del(struct nvbios_index **pindex)
+{
+	struct nvbios_index *index = *pindex;
+	if (index) {
+		kfree(index->perfE);
+		kfree(index->rammapE);
+		kfree(index->voltE);
+		kfree(index->dcbE);
+		kfree(index->connE);
+		kfree(*pindex);
+		*pindex = NULL;
+	}
+}
+
+void
+nvbios_index_fini(struct nvkm_bios *bios)
+{
+	nvbios_index_del(&bios->index);
+}
+
+int
+nvbios_index_new(struct nvkm_bios *bios)
+{
+	struct nvkm_subdev *subdev = &bios->subdev;
+	struct nvbios_index *index;
+	s64 time;
+	int ret;
+
+	if (!nvkm_boolopt(subdev->device->cfgopt, "NvBiosIndex", true))
+		return 0;
+
+	if (!(index = kzalloc(sizeof(*index), GFP_KERNEL)))
+		return -ENOMEM;
+
+	/* bios->index isn't set until we're done, so the parsers called
+	 * from here take their normal paths and we record exactly what
+	 * they would have returned.
+	 */
+	time = ktime_to_us(ktime_get());
+	if (bios->bit_offset)
+		nvbios_index_bit(bios, index);
+
+	ret = nvbios_index_tables(bios, index);
+	if (ret) {
+		nvbios_index_del(&index);
+		return ret;
+	}
+
+	time = ktime_to_us(ktime_get()) - time;
+	nvkm_debug(subdev, "index: perf %d rammap %d volt %d dcb %d conn %d "
+			   "entries, %lldus\n",
+		   index->perfE ? index->perf.cnt : 0,
+		   index->rammapE ? index->rammap.cnt : 0,
+		   index->voltE ? index->volt.cnt : 0,
+		   index->dcbE ? index->dcb.cnt : 0,
+		   index->connE ? index->conn.cnt : 0, time);
+	bios->index = index;
+	return 0;
+}
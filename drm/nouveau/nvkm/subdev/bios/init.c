@@ -21,6 +21,9 @@
  *
  * Authors: Ben Skeggs
  */
+#include "priv.h"
+
+#include <core/option.h>
 #include <subdev/bios.h>
 #include <subdev/bios/bit.h>
 #include <subdev/bios/bmp.h>
@@ -81,6 +84,112 @@ init_exec_force(struct nvbios_init *init, bool exec)
 	else      init->execute &= 0xfb;
 }
 
+/******************************************************************************
+ * access traces, used to check decoded scripts against the interpreter
+ *
+ * A script is first run by the interpreter, recording each register and
+ * VGA/port access.  The decoded form then runs against the recording,
+ * rather than the hardware, with reads answered from it and writes
+ * compared against it.
+ *****************************************************************************/
+struct nvbios_init_trace {
+	struct nvbios_init_access {
+#define INIT_ACCESS_RD32   0
+#define INIT_ACCESS_WR32   1
+#define INIT_ACCESS_RDPORT 2
+#define INIT_ACCESS_WRPORT 3
+#define INIT_ACCESS_RDVGAI 4
+#define INIT_ACCESS_WRVGAI 5
+		u8  type;
+		u32 addr;
+		u32 data;
+	} *ent;
+	u32 nr;
+	u32 max;
+	u32 pos;
+	bool replay;
+	bool opaque;
+	bool mismatch;
+};
+
+static void
+init_trace_record(struct nvbios_init *init, u8 type, u32 addr, u32 data)
+{
+	struct nvbios_init_trace *trace = init->trace;
+	struct nvbios_init_access *ent;
+
+	if (!trace || trace->opaque)
+		return;
+
+	if (trace->nr == trace->max) {
+		u32 max = trace->max ? trace->max * 2 : 256;
+		if (!(ent = kvmalloc_array(max, sizeof(*ent), GFP_KERNEL))) {
+			trace->opaque = true;
+			return;
+		}
+
+		if (trace->ent)
+			memcpy(ent, trace->ent, trace->nr * sizeof(*ent));
+		kvfree(trace->ent);
+		trace->ent = ent;
+		trace->max = max;
+	}
+
+	ent = &trace->ent[trace->nr++];
+	ent->type = type;
+	ent->addr = addr;
+	ent->data = data;
+}
+
+/* Returns true if the access was handled by a trace being replayed. */
+static bool
+init_trace_replay(struct nvbios_init *init, u8 type, u32 addr, u32 *data)
+{
+	struct nvbios_init_trace *trace = init->trace;
+	struct nvbios_init_access *ent;
+
+	if (!trace || !trace->replay)
+		return false;
+
+	if (trace->pos == trace->nr) {
+		trace->mismatch = true;
+		*data = 0x00000000;
+		return true;
+	}
+
+	ent = &trace->ent[trace->pos++];
+	if (ent->type != type || ent->addr != addr)
+		trace->mismatch = true;
+
+	if (type & 1) {
+		if (ent->data != *data)
+			trace->mismatch = true;
+	} else {
+		*data = ent->data;
+	}
+
+	return true;
+}
+
+/* Accesses that aren't recorded (i2c, aux, plls, ...) make a trace
+ * unusable.  Returns false if the access must not reach the hardware.
+ */
+static bool
+init_trace_opaque(struct nvbios_init *init)
+{
+	struct nvbios_init_trace *trace = init->trace;
+
+	if (trace) {
+		if (trace->replay) {
+			trace->mismatch = true;
+			return false;
+		}
+		trace->opaque = true;
+	}
+
+	return true;
+}
+
 /******************************************************************************
  * init parser wrappers for normal register/i2c/whatever accessors
  *****************************************************************************/
@@ -178,33 +287,50 @@ init_nvreg(struct nvbios_init *init, u32 reg)
 	return nvkm_devinit_mmio(devinit, reg);
 }
 
+static u32
+init_rd32_(struct nvbios_init *init, u32 reg)
+{
+	u32 data;
+	if (!init_trace_replay(init, INIT_ACCESS_RD32, reg, &data)) {
+		data = nvkm_rd32(init->subdev->device, reg);
+		init_trace_record(init, INIT_ACCESS_RD32, reg, data);
+	}
+	return data;
+}
+
+static void
+init_wr32_(struct nvbios_init *init, u32 reg, u32 data)
+{
+	if (!init_trace_replay(init, INIT_ACCESS_WR32, reg, &data)) {
+		nvkm_wr32(init->subdev->device, reg, data);
+		init_trace_record(init, INIT_ACCESS_WR32, reg, data);
+	}
+}
+
 static u32
 init_rd32(struct nvbios_init *init, u32 reg)
 {
-	struct nvkm_device *device = init->subdev->device;
 	reg = init_nvreg(init, reg);
 	if (reg != ~0 && init_exec(init))
-		return nvkm_rd32(device, reg);
+		return init_rd32_(init, reg);
 	return 0x00000000;
 }
 
 static void
 init_wr32(struct nvbios_init *init, u32 reg, u32 val)
 {
-	struct nvkm_device *device = init->subdev->device;
 	reg = init_nvreg(init, reg);
 	if (reg != ~0 && init_exec(init))
-		nvkm_wr32(device, reg, val);
+		init_wr32_(init, reg, val);
 }
 
 static u32
 init_mask(struct nvbios_init *init, u32 reg, u32 mask, u32 val)
 {
-	struct nvkm_device *device = init->subdev->device;
 	reg = init_nvreg(init, reg);
 	if (reg != ~0 && init_exec(init)) {
-		u32 tmp = nvkm_rd32(device, reg);
-		nvkm_wr32(device, reg, (tmp & ~mask) | val);
+		u32 tmp = init_rd32_(init, reg);
+		init_wr32_(init, reg, (tmp & ~mask) | val);
 		return tmp;
 	}
 	return 0x00000000;
@@ -213,16 +339,29 @@ init_mask(struct nvbios_init *init, u32 reg, u32 mask, u32 val)
 static u8
 init_rdport(struct nvbios_init *init, u16 port)
 {
-	if (init_exec(init))
-		return nvkm_rdport(init->subdev->device, init->head, port);
+	u32 addr = ((init->head & 0xff) << 16) | port, data;
+	if (init_exec(init)) {
+		if (!init_trace_replay(init, INIT_ACCESS_RDPORT, addr, &data)) {
+			data = nvkm_rdport(init->subdev->device,
+					   init->head, port);
+			init_trace_record(init, INIT_ACCESS_RDPORT, addr, data);
+		}
+		return data;
+	}
 	return 0x00;
 }
 
 static void
 init_wrport(struct nvbios_init *init, u16 port, u8 value)
 {
-	if (init_exec(init))
-		nvkm_wrport(init->subdev->device, init->head, port, value);
+	u32 addr = ((init->head & 0xff) << 16) | port, data = value;
+	if (init_exec(init)) {
+		if (!init_trace_replay(init, INIT_ACCESS_WRPORT, addr, &data)) {
+			nvkm_wrport(init->subdev->device,
+				    init->head, port, value);
+			init_trace_record(init, INIT_ACCESS_WRPORT, addr, data);
+		}
+	}
 }
 
 static u8
@@ -231,7 +370,12 @@ init_rdvgai(struct nvbios_init *init, u16 port, u8 index)
 	struct nvkm_subdev *subdev = init->subdev;
 	if (init_exec(init)) {
 		int head = init->head < 0 ? 0 : init->head;
-		return nvkm_rdvgai(subdev->device, head, port, index);
+		u32 addr = (head << 24) | (port << 8) | index, data;
+		if (!init_trace_replay(init, INIT_ACCESS_RDVGAI, addr, &data)) {
+			data = nvkm_rdvgai(subdev->device, head, port, index);
+			init_trace_record(init, INIT_ACCESS_RDVGAI, addr, data);
+		}
+		return data;
 	}
 	return 0x00;
 }
@@ -249,7 +393,11 @@ init_wrvgai(struct nvbios_init *init, u16 port, u8 index, u8 value)
 
 	if (init_exec(init)) {
 		int head = init->head < 0 ? 0 : init->head;
-		nvkm_wrvgai(device, head, port, index, value);
+		u32 addr = (head << 24) | (port << 8) | index, data = value;
+		if (!init_trace_replay(init, INIT_ACCESS_WRVGAI, addr, &data)) {
+			nvkm_wrvgai(device, head, port, index, value);
+			init_trace_record(init, INIT_ACCESS_WRVGAI, addr, data);
+		}
 	}
 
 	/* select head 1 if cr44 write selected it */
@@ -285,7 +433,7 @@ static int
 init_rdi2cr(struct nvbios_init *init, u8 index, u8 addr, u8 reg)
 {
 	struct i2c_adapter *adap = init_i2c(init, index);
-	if (adap && init_exec(init))
+	if (adap && init_exec(init) && init_trace_opaque(init))
 		return nvkm_rdi2cr(adap, addr, reg);
 	return -ENODEV;
 }
@@ -294,7 +442,7 @@ static int
 init_wri2cr(struct nvbios_init *init, u8 index, u8 addr, u8 reg, u8 val)
 {
 	struct i2c_adapter *adap = init_i2c(init, index);
-	if (adap && init_exec(init))
+	if (adap && init_exec(init) && init_trace_opaque(init))
 		return nvkm_wri2cr(adap, addr, reg, val);
 	return -ENODEV;
 }
@@ -317,7 +465,7 @@ init_rdauxr(struct nvbios_init *init, u32 addr)
 	struct nvkm_i2c_aux *aux = init_aux(init);
 	u8 data;
 
-	if (aux && init_exec(init)) {
+	if (aux && init_exec(init) && init_trace_opaque(init)) {
 		int ret = nvkm_rdaux(aux, addr, &data, 1);
 		if (ret == 0)
 			return data;
@@ -331,7 +479,7 @@ static int
 init_wrauxr(struct nvbios_init *init, u32 addr, u8 data)
 {
 	struct nvkm_i2c_aux *aux = init_aux(init);
-	if (aux && init_exec(init)) {
+	if (aux && init_exec(init) && init_trace_opaque(init)) {
 		int ret = nvkm_wraux(aux, addr, &data, 1);
 		if (ret)
 			trace("auxch write failed with %d\n", ret);
@@ -344,7 +492,7 @@ static void
 init_prog_pll(struct nvbios_init *init, u32 id, u32 freq)
 {
 	struct nvkm_devinit *devinit = init->subdev->device->devinit;
-	if (init_exec(init)) {
+	if (init_exec(init) && init_trace_opaque(init)) {
 		int ret = nvkm_devinit_pll_set(devinit, id, freq);
 		if (ret)
 			warn("failed to prog pll 0x%08x to %dkHz\n", id, freq);
@@ -1080,7 +1228,8 @@ init_zm_i2c(struct nvbios_init *init)
 		};
 		int ret;
 
-		if (adap && (ret = i2c_transfer(adap, &msg, 1)) != 1)
+		if (adap && init_trace_opaque(init) &&
+		    (ret = i2c_transfer(adap, &msg, 1)) != 1)
 			warn("i2c wr failed, %d\n", ret);
 	}
 }
@@ -1464,7 +1613,7 @@ init_compute_mem(struct nvbios_init *init)
 	init->offset += 1;
 
 	init_exec_force(init, true);
-	if (init_exec(init))
+	if (init_exec(init) && init_trace_opaque(init))
 		nvkm_devinit_meminit(devinit);
 	init_exec_force(init, false);
 }
@@ -1968,7 +2117,7 @@ init_gpio(struct nvbios_init *init)
 	trace("GPIO\n");
 	init->offset += 1;
 
-	if (init_exec(init))
+	if (init_exec(init) && init_trace_opaque(init))
 		nvkm_gpio_reset(gpio, DCB_GPIO_UNUSED);
 }
 
@@ -2166,7 +2315,7 @@ init_i2c_long_if(struct nvbios_init *init)
 	init->offset += 7;
 
 	adap = init_i2c(init, index);
-	if (adap) {
+	if (adap && init_trace_opaque(init)) {
 		u8 i[2] = { reghi, reglo };
 		u8 o[1] = {};
 		struct i2c_msg msg[] = {
@@ -2214,7 +2363,7 @@ init_gpio_ne(struct nvbios_init *init)
 			trace("\tFUNC[0x%02x]", func.func);
 			if (i == (init->offset + count)) {
 				cont(" *");
-				if (init_exec(init))
+				if (init_exec(init) && init_trace_opaque(init))
 					nvkm_gpio_reset(gpio, func.func);
 			}
 			cont("\n");
@@ -2298,14 +2447,434 @@ static struct nvbios_init_opcode {
 	[0xaa] = { init_reserved },
 };
 
-int
-nvbios_exec(struct nvbios_init *init)
+/******************************************************************************
+ * decoded scripts
+ *
+ * Runs of simple opcodes are decoded once into blocks of grouped register
+ * writes, masks, VGA writes, conditions and delays, which are then executed
+ * without re-parsing the script.  Anything else (control flow, PLLs, i2c,
+ * aux, opcodes that depend on state we can't know ahead of time, ...)
+ * ends a block and is left to the interpreter.
+ *
+ * Register addresses are stored unmangled, so blocks don't depend on the
+ * head/OR/link a script is run for, and exec state is still tracked as the
+ * interpreter does, with constant condition/NOT/RESUME sequences folded.
+ *****************************************************************************/
+static u32 *
+nvbios_initx_emit(struct nvbios_initx *initx, u8 type, u32 offset,
+		  int nr, int size)
+{
+	struct nvbios_initx_op *op = NULL;
+	u32 *data;
+
+	if (initx->dec.data_nr + nr * size > NVBIOS_INITX_DATA)
+		return NULL;
+
+	if (initx->dec.op_nr)
+		op = &initx->dec.op[initx->dec.op_nr - 1];
+
+	if (!op || op->type != type || type > INITX_WRVGAI ||
+	    op->nr + nr > 0xffff) {
+		if (initx->dec.op_nr == NVBIOS_INITX_OPS)
+			return NULL;
+
+		op = &initx->dec.op[initx->dec.op_nr++];
+		op->type = type;
+		op->offset = offset;
+		op->nr = 0;
+		op->data = initx->dec.data_nr;
+	}
+
+	data = &initx->dec.data[initx->dec.data_nr];
+	initx->dec.data_nr += nr * size;
+	op->nr += nr;
+	return data;
+}
+
+static bool
+nvbios_initx_exec_op(struct nvbios_initx *initx, u32 offset, u8 and, u8 xor)
+{
+	struct nvbios_initx_op *op = NULL;
+
+	if (initx->dec.op_nr)
+		op = &initx->dec.op[initx->dec.op_nr - 1];
+
+	if (!op || op->type != INITX_EXEC) {
+		if (initx->dec.op_nr == NVBIOS_INITX_OPS)
+			return false;
+
+		op = &initx->dec.op[initx->dec.op_nr++];
+		op->type = INITX_EXEC;
+		op->offset = offset;
+		op->and = 0xff;
+		op->xor = 0x00;
+		op->nr = 0;
+		op->data = initx->dec.data_nr;
+	}
+
+	op->xor = (op->xor & and) ^ xor;
+	op->and = op->and & and;
+	op->nr++;
+
+	/* NOT NOT, and the like. */
+	if (op->and == 0xff && op->xor == 0x00)
+		initx->dec.op_nr--;
+	return true;
+}
+
+#define initx_exec_set(x,o,e) nvbios_initx_exec_op((x), (o), 0xfd, (e) ? 0 : 2)
+#define initx_exec_inv(x,o)   nvbios_initx_exec_op((x), (o), 0xff, 0x02)
+
+static struct nvbios_initx_block *
+nvbios_initx_decode(struct nvbios_init *init, u32 start)
 {
 	struct nvkm_bios *bios = init->subdev->device->bios;
+	struct nvbios_initx *initx = bios->initx;
+	struct nvbios_initx_block *block;
+	u32 offset = start, *data;
+	size_t size;
+	u16 table;
+	u8 count, i;
+
+	initx->dec.op_nr = 0;
+	initx->dec.data_nr = 0;
+
+	for (;;) {
+		u8 opcode = nvbios_rd08(bios, offset);
+		switch (opcode) {
+		case 0x38: /* INIT_NOT */
+			if (!initx_exec_inv(initx, offset))
+				goto done;
+			offset += 1;
+			break;
+		case 0x72: /* INIT_RESUME */
+			if (!initx_exec_set(initx, offset, true))
+				goto done;
+			offset += 1;
+			break;
+		case 0x3a: /* INIT_GENERIC_CONDITION */
+			/* CONDITION_ID_NO_PANEL_SEQ_DELAYS, always false. */
+			if (nvbios_rd08(bios, offset + 1) != 7 ||
+			    !initx_exec_set(initx, offset, false))
+				goto done;
+			offset += 3;
+			break;
+		case 0x75: /* INIT_CONDITION */
+			table = init_condition_table(init);
+			if (!table) {
+				if (!initx_exec_set(initx, offset, false))
+					goto done;
+			} else {
+				u8 cond = nvbios_rd08(bios, offset + 1);
+				table += cond * 12;
+				data = nvbios_initx_emit(initx, INITX_COND,
+							 offset, 1, 3);
+				if (!data)
+					goto done;
+				data[0] = nvbios_rd32(bios, table + 0);
+				data[1] = nvbios_rd32(bios, table + 4);
+				data[2] = nvbios_rd32(bios, table + 8);
+			}
+			offset += 2;
+			break;
+		case 0x76: /* INIT_IO_CONDITION */
+			table = init_io_condition_table(init);
+			if (!table) {
+				if (!initx_exec_set(initx, offset, false))
+					goto done;
+			} else {
+				u8 cond = nvbios_rd08(bios, offset + 1);
+				table += cond * 5;
+				data = nvbios_initx_emit(initx, INITX_IOCOND,
+							 offset, 1, 4);
+				if (!data)
+					goto done;
+				data[0] = nvbios_rd16(bios, table + 0);
+				data[1] = nvbios_rd08(bios, table + 2);
+				data[2] = nvbios_rd08(bios, table + 3);
+				data[3] = nvbios_rd08(bios, table + 4);
+			}
+			offset += 2;
+			break;
+		case 0x73: /* INIT_STRAP_CONDITION */
+			data = nvbios_initx_emit(initx, INITX_COND, offset, 1, 3);
+			if (!data)
+				goto done;
+			data[0] = 0x101000;
+			data[1] = nvbios_rd32(bios, offset + 1);
+			data[2] = nvbios_rd32(bios, offset + 5);
+			offset += 9;
+			break;
+		case 0x6d: /* INIT_RAM_CONDITION */
+			data = nvbios_initx_emit(initx, INITX_COND, offset, 1, 3);
+			if (!data)
+				goto done;
+			data[0] = 0x100000;
+			data[1] = nvbios_rd08(bios, offset + 1);
+			data[2] = nvbios_rd08(bios, offset + 2);
+			offset += 3;
+			break;
+		case 0x47: /* INIT_ANDN_REG */
+		case 0x48: /* INIT_OR_REG */
+			data = nvbios_initx_emit(initx, INITX_MASK, offset, 1, 3);
+			if (!data)
+				goto done;
+			data[0] = nvbios_rd32(bios, offset + 1);
+			data[1] = nvbios_rd32(bios, offset + 5);
+			data[2] = 0x00000000;
+			if (opcode == 0x48) {
+				data[2] = data[1];
+				data[1] = 0x00000000;
+			}
+			offset += 9;
+			break;
+		case 0x6e: /* INIT_NV_REG */
+			data = nvbios_initx_emit(initx, INITX_MASK, offset, 1, 3);
+			if (!data)
+				goto done;
+			data[0] =  nvbios_rd32(bios, offset + 1);
+			data[1] = ~nvbios_rd32(bios, offset + 5);
+			data[2] =  nvbios_rd32(bios, offset + 9);
+			offset += 13;
+			break;
+		case 0x7a: /* INIT_ZM_REG */
+			data = nvbios_initx_emit(initx, INITX_WR32, offset, 1, 2);
+			if (!data)
+				goto done;
+			data[0] = nvbios_rd32(bios, offset + 1);
+			data[1] = nvbios_rd32(bios, offset + 5);
+			if (data[0] == 0x000200)
+				data[1] |= 0x00000001;
+			offset += 9;
+			break;
+		case 0x77: /* INIT_ZM_REG16 */
+			data = nvbios_initx_emit(initx, INITX_WR32, offset, 1, 2);
+			if (!data)
+				goto done;
+			data[0] = nvbios_rd32(bios, offset + 1);
+			data[1] = nvbios_rd16(bios, offset + 5);
+			offset += 7;
+			break;
+		case 0x5a: /* INIT_ZM_REG_INDIRECT */
+			/* Yes, the interpreter writes to the VBIOS address. */
+			data = nvbios_initx_emit(initx, INITX_WR32, offset, 1, 2);
+			if (!data)
+				goto done;
+			data[0] = nvbios_rd16(bios, offset + 5);
+			data[1] = nvbios_rd32(bios, data[0]);
+			offset += 7;
+			break;
+		case 0x58: /* INIT_ZM_REG_SEQUENCE */
+		case 0x91: /* INIT_ZM_REG_GROUP */
+			count = nvbios_rd08(bios, offset + 5);
+			data = nvbios_initx_emit(initx, INITX_WR32, offset,
+						 count, 2);
+			if (!data)
+				goto done;
+			for (i = 0; i < count; i++) {
+				data[i * 2 + 0] = nvbios_rd32(bios, offset + 1);
+				data[i * 2 + 1] = nvbios_rd32(bios, offset + 6 +
+								    i * 4);
+				if (opcode == 0x58)
+					data[i * 2 + 0] += i * 4;
+			}
+			offset += 6 + count * 4;
+			break;
+		case 0x6f: /* INIT_MACRO */
+			table = init_macro_table(init);
+			if (table) {
+				u8 macro = nvbios_rd08(bios, offset + 1);
+				table += macro * 8;
+				data = nvbios_initx_emit(initx, INITX_WR32,
+							 offset, 1, 2);
+				if (!data)
+					goto done;
+				data[0] = nvbios_rd32(bios, table + 0);
+				data[1] = nvbios_rd32(bios, table + 4);
+			}
+			offset += 2;
+			break;
+		case 0x53: /* INIT_ZM_CR */
+			data = nvbios_initx_emit(initx, INITX_WRVGAI, offset, 1, 3);
+			if (!data)
+				goto done;
+			data[0] = 0x03d4;
+			data[1] = nvbios_rd08(bios, offset + 1);
+			data[2] = nvbios_rd08(bios, offset + 2);
+			offset += 3;
+			break;
+		case 0x54: /* INIT_ZM_CR_GROUP */
+			count = nvbios_rd08(bios, offset + 1);
+			data = nvbios_initx_emit(initx, INITX_WRVGAI, offset,
+						 count, 3);
+			if (!data)
+				goto done;
+			for (i = 0; i < count; i++) {
+				data[i * 3 + 0] = 0x03d4;
+				data[i * 3 + 1] = nvbios_rd08(bios, offset + 2 +
+								    i * 2);
+				data[i * 3 + 2] = nvbios_rd08(bios, offset + 3 +
+								    i * 2);
+			}
+			offset += 2 + count * 2;
+			break;
+		case 0x62: /* INIT_ZM_INDEX_IO */
+			data = nvbios_initx_emit(initx, INITX_WRVGAI, offset, 1, 3);
+			if (!data)
+				goto done;
+			data[0] = nvbios_rd16(bios, offset + 1);
+			data[1] = nvbios_rd08(bios, offset + 3);
+			data[2] = nvbios_rd08(bios, offset + 4);
+			offset += 5;
+			break;
+		case 0x74: /* INIT_TIME */
+		case 0x57: /* INIT_LTIME */
+			data = nvbios_initx_emit(initx, INITX_DELAY, offset, 1, 1);
+			if (!data)
+				goto done;
+			data[0] = nvbios_rd16(bios, offset + 1);
+			if (opcode == 0x57)
+				data[0] *= 1000;
+			offset += 3;
+			break;
+		case 0x8c: /* INIT_RESET_BEGUN */
+		case 0x8d: /* INIT_RESET_END */
+			offset += 1;
+			break;
+		case 0x71: /* INIT_DONE */
+			offset = 0;
+			goto done;
+		default:
+			goto done;
+		}
+		initx->stats.opcodes++;
+	}
+
+done:
+	size  = sizeof(*block);
+	size += initx->dec.data_nr * sizeof(initx->dec.data[0]);
+	size += initx->dec.op_nr * sizeof(initx->dec.op[0]);
+	if (!(block = kmalloc(size, GFP_KERNEL)))
+		return NULL;
+
+	block->start = start;
+	block->end = offset;
+	block->op_nr = initx->dec.op_nr;
+	block->op = (void *)&block->data[initx->dec.data_nr];
+	memcpy(block->data, initx->dec.data,
+	       initx->dec.data_nr * sizeof(initx->dec.data[0]));
+	memcpy(block->op, initx->dec.op,
+	       initx->dec.op_nr * sizeof(initx->dec.op[0]));
+	initx->stats.blocks++;
+	initx->stats.ops += block->op_nr;
+	return block;
+}
+
+/* Find (or create) the decoded block starting at offset.  A block without
+ * any ops means the opcode there must be interpreted.
+ */
+static struct nvbios_initx_block *
+nvbios_initx_get(struct nvbios_init *init, u32 offset)
+{
+	struct nvbios_initx *initx = init->subdev->device->bios->initx;
+	struct nvbios_initx_block **pblock, *block;
+
+	mutex_lock(&initx->mutex);
+	pblock = &initx->hash[offset % NVBIOS_INITX_HASH];
+	for (block = *pblock; block; block = block->next) {
+		if (block->start == offset)
+			break;
+	}
+
+	if (!block && (block = nvbios_initx_decode(init, offset))) {
+		block->next = *pblock;
+		*pblock = block;
+	}
+	mutex_unlock(&initx->mutex);
+	return block;
+}
+
+static void
+nvbios_initx_exec(struct nvbios_init *init, struct nvbios_initx_block *block)
+{
+	const struct nvbios_initx_op *op;
+	const u32 *data;
+	int i;
+
+	for (op = block->op; op < block->op + block->op_nr; op++) {
+		init->offset = op->offset;
+		data = &block->data[op->data];
+		switch (op->type) {
+		case INITX_WR32:
+			if (!init_exec(init))
+				break;
+			for (i = 0; i < op->nr; i++, data += 2)
+				init_wr32(init, data[0], data[1]);
+			break;
+		case INITX_MASK:
+			if (!init_exec(init))
+				break;
+			for (i = 0; i < op->nr; i++, data += 3)
+				init_mask(init, data[0], data[1], data[2]);
+			break;
+		case INITX_WRVGAI:
+			/* Not skipped when !exec, CR44 writes select head. */
+			for (i = 0; i < op->nr; i++, data += 3)
+				init_wrvgai(init, data[0], data[1], data[2]);
+			break;
+		case INITX_EXEC:
+			init->execute = (init->execute & op->and) ^ op->xor;
+			break;
+		case INITX_COND:
+			if ((init_rd32(init, data[0]) & data[1]) != data[2])
+				init_exec_set(init, false);
+			break;
+		case INITX_IOCOND:
+			if ((init_rdvgai(init, data[0], data[1]) & data[2]) !=
+			    data[3])
+				init_exec_set(init, false);
+			break;
+		case INITX_DELAY:
+			if (!init_exec(init))
+				break;
+			if (data[0] < 1000)
+				udelay(data[0]);
+			else
+				mdelay((data[0] + 900) / 1000);
+			break;
+		default:
+			WARN_ON(1);
+			break;
+		}
+	}
+
+	init->offset = block->end;
+}
+
+static int
+nvbios_exec_(struct nvbios_init *init)
+{
+	struct nvkm_bios *bios = init->subdev->device->bios;
+	struct nvbios_initx_block *block;
+	bool xlat = false;
+
+	/* Decoded blocks don't produce the interpreter's trace output. */
+	if (bios->initx && bios->initx->enable &&
+	    init->subdev->debug < NV_DBG_TRACE)
+		xlat = !init->trace || init->trace->replay;
 
 	init->nested++;
 	while (init->offset) {
-		u8 opcode = nvbios_rd08(bios, init->offset);
+		u8 opcode;
+
+		if (xlat && (block = nvbios_initx_get(init, init->offset)) &&
+		    block->op_nr) {
+			nvbios_initx_exec(init, block);
+			bios->initx->stats.runs++;
+			continue;
+		}
+
+		opcode = nvbios_rd08(bios, init->offset);
 		if (opcode >= ARRAY_SIZE(init_opcode) ||
 		    !init_opcode[opcode].exec) {
 			error("unknown opcode 0x%02x\n", opcode);
@@ -2318,6 +2887,105 @@ nvbios_exec(struct nvbios_init *init)
 	return 0;
 }
 
+/* Run a script with the interpreter, then replay the decoded form against
+ * what it did, and stop using decoded scripts if they disagree.
+ */
+static int
+nvbios_initx_check(struct nvbios_init *init)
+{
+	struct nvkm_bios *bios = init->subdev->device->bios;
+	struct nvbios_initx *initx = bios->initx;
+	struct nvbios_init_trace trace = {};
+	struct nvbios_init xlat = *init;
+	u32 start = init->offset;
+	int ret, ret_xlat;
+
+	init->trace = &trace;
+	ret = nvbios_exec_(init);
+	init->trace = NULL;
+
+	if (trace.opaque) {
+		initx->stats.skip++;
+		goto done;
+	}
+
+	trace.replay = true;
+	xlat.trace = &trace;
+	ret_xlat = nvbios_exec_(&xlat);
+	if (ret_xlat != ret || trace.mismatch || trace.pos != trace.nr ||
+	    xlat.execute != init->execute || xlat.head != init->head) {
+		nvkm_error(&bios->subdev, "init script %04x: decoded form "
+					  "differs from interpreter at access "
+					  "%d/%d, disabling\n",
+			   start, trace.pos, trace.nr);
+		initx->enable = false;
+		initx->stats.fail++;
+	} else {
+		initx->stats.pass++;
+	}
+
+done:
+	kvfree(trace.ent);
+	return ret;
+}
+
+int
+nvbios_exec(struct nvbios_init *init)
+{
+	struct nvkm_bios *bios = init->subdev->device->bios;
+
+	if (!init->nested && !init->trace && bios->initx &&
+	    bios->initx->enable && bios->initx->check)
+		return nvbios_initx_check(init);
+
+	return nvbios_exec_(init);
+}
+
+void
+nvbios_initx_fini(struct nvkm_bios *bios)
+{
+	struct nvbios_initx *initx = bios->initx;
+	struct nvbios_initx_block *block;
+	int i;
+
+	if (!initx)
+		return;
+
+	nvkm_debug(&bios->subdev, "init: %u blocks, %u opcodes in %u ops, "
+				  "%llu runs, check %u/%u/%u pass/fail/skip\n",
+		   initx->stats.blocks, initx->stats.opcodes, initx->stats.ops,
+		   initx->stats.runs, initx->stats.pass, initx->stats.fail,
+		   initx->stats.skip);
+
+	for (i = 0; i < ARRAY_SIZE(initx->hash); i++) {
+		while ((block = initx->hash[i])) {
+			initx->hash[i] = block->next;
+			kfree(block);
+		}
+	}
+
+	kfree(bios->initx);
+	bios->initx = NULL;
+}
+
+int
+nvbios_initx_new(struct nvkm_bios *bios)
+{
+	struct nvkm_device *device = bios->subdev.device;
+	struct nvbios_initx *initx;
+
+	if (!nvkm_boolopt(device->cfgopt, "NvBiosInitDecode", true))
+		return 0;
+
+	if (!(initx = bios->initx = kzalloc(sizeof(*initx), GFP_KERNEL)))
+		return -ENOMEM;
+
+	mutex_init(&initx->mutex);
+	initx->enable = true;
+	initx->check = nvkm_boolopt(device->cfgopt, "NvBiosInitCheck", false);
+	return 0;
+}
+
 int
 nvbios_post(struct nvkm_subdev *subdev, bool execute)
 {
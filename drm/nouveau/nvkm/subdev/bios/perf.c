@@ -21,18 +21,28 @@
  *
  * Authors: Martin Peres
  */
-#include <subdev/bios.h>
-#include <subdev/bios/bit.h>
-#include <subdev/bios/perf.h>
+#include "priv.h"
+
 #include <subdev/pci.h>
 
 u32
 nvbios_perf_table(struct nvkm_bios *bios, u8 *ver, u8 *hdr,
 		  u8 *cnt, u8 *len, u8 *snr, u8 *ssz)
 {
+	const struct nvbios_index *index = bios->index;
 	struct bit_entry bit_P;
 	u32 perf = 0;
 
+	if (index && index->perf.data) {
+		*ver = index->perf.ver;
+		*hdr = index->perf.hdr;
+		*cnt = index->perf.cnt;
+		*len = index->perf.len;
+		*snr = index->perf.snr;
+		*ssz = index->perf.ssz;
+		return index->perf.data;
+	}
+
 	if (!bit_entry(bios, 'P', &bit_P)) {
 		if (bit_P.version <= 2) {
 			perf = nvbios_rd32(bios, bit_P.offset + 0);
@@ -95,7 +105,22 @@ u32
 nvbios_perfEp(struct nvkm_bios *bios, int idx,
 	      u8 *ver, u8 *hdr, u8 *cnt, u8 *len, struct nvbios_perfE *info)
 {
-	u32 perf = nvbios_perf_entry(bios, idx, ver, hdr, cnt, len);
+	const struct nvbios_index *index = bios->index;
+	u32 perf;
+
+	if (index && index->perfE && idx >= 0 && idx < index->perf.cnt) {
+		const struct nvbios_index_perfE *e = &index->perfE[idx];
+		if (e->data) {
+			*ver = e->ver;
+			*hdr = e->hdr;
+			*cnt = e->cnt;
+			*len = e->len;
+			*info = e->info;
+			return e->data;
+		}
+	}
+
+	perf = nvbios_perf_entry(bios, idx, ver, hdr, cnt, len);
 	memset(info, 0x00, sizeof(*info));
 	info->pstate = nvbios_rd08(bios, perf + 0x00);
 	switch (!!perf * *ver) {
@@ -3,6 +3,12 @@
 #define __NVKM_BIOS_PRIV_H__
 #define nvkm_bios(p) container_of((p), struct nvkm_bios, subdev)
 #include <subdev/bios.h>
+#include <subdev/bios/bit.h>
+#include <subdev/bios/conn.h>
+#include <subdev/bios/dcb.h>
+#include <subdev/bios/perf.h>
+#include <subdev/bios/rammap.h>
+#include <subdev/bios/volt.h>
 
 struct nvbios_source {
 	const char *name;
@@ -18,6 +24,109 @@ struct nvbios_source {
 
 int nvbios_extend(struct nvkm_bios *, u32 length);
 int nvbios_shadow(struct nvkm_bios *);
+int nvbios_initx_new(struct nvkm_bios *);
+void nvbios_initx_fini(struct nvkm_bios *);
+
+/* Decoded init scripts, see init.c. */
+#define NVBIOS_INITX_HASH 64
+#define NVBIOS_INITX_OPS  64
+#define NVBIOS_INITX_DATA 1024
+
+struct nvbios_initx_op {
+#define INITX_WR32   0 /* { reg, data }[nr] */
+#define INITX_MASK   1 /* { reg, mask, data }[nr] */
+#define INITX_WRVGAI 2 /* { port, index, data }[nr] */
+#define INITX_EXEC   3 /* execute = (execute & and) ^ xor */
+#define INITX_COND   4 /* { reg, mask, data } */
+#define INITX_IOCOND 5 /* { port, index, mask, data } */
+#define INITX_DELAY  6 /* { usec } */
+	u8  type;
+	u8  and;
+	u8  xor;
+	u16 nr;
+	u32 offset;
+	u32 data;
+};
+
+struct nvbios_initx_block {
+	struct nvbios_initx_block *next;
+	u32 start;
+	u32 end;
+	u16 op_nr;
+	struct nvbios_initx_op *op;
+	u32 data[];
+};
+
+struct nvbios_initx {
+	struct mutex mutex;
+	struct nvbios_initx_block *hash[NVBIOS_INITX_HASH];
+	bool enable;
+	bool check;
+
+	struct {
+		struct nvbios_initx_op op[NVBIOS_INITX_OPS];
+		u32 data[NVBIOS_INITX_DATA];
+		int op_nr;
+		int data_nr;
+	} dec;
+
+	struct {
+		u32 blocks;
+		u32 opcodes;
+		u32 ops;
+		u64 runs;
+		u32 pass;
+		u32 fail;
+		u32 skip;
+	} stats;
+};
+
+/* Commonly used tables, parsed once after shadowing.  Only lookups that
+ * succeeded are recorded (data != 0), anything else is left to the parsers
+ * to compute as they always have.
+ */
+struct nvbios_index {
+	u32 bit_map[8];
+	struct bit_entry bit[256];
+
+	struct nvbios_index_table {
+		u32 data;
+		u8  ver, hdr, cnt, len, snr, ssz;
+	} perf, rammap, volt, dcb, conn;
+
+	struct nvbios_index_perfE {
+		u32 data;
+		u8  ver, hdr, cnt, len;
+		struct nvbios_perfE info;
+	} *perfE;
+
+	struct nvbios_index_rammapE {
+		u32 data;
+		u8  ver, hdr, cnt, len;
+		struct nvbios_ramcfg info;
+	} *rammapE;
+
+	struct nvbios_index_voltE {
+		u32 data;
+		u8  ver, len;
+		struct nvbios_volt_entry info;
+	} *voltE;
+
+	struct nvbios_index_dcbE {
+		u16 data;
+		u8  ver, len;
+		struct dcb_output outp;
+	} *dcbE;
+
+	struct nvbios_index_connE {
+		u32 data;
+		u8  ver, len;
+		struct nvbios_connE info;
+	} *connE;
+};
+
+int nvbios_index_new(struct nvkm_bios *);
+void nvbios_index_fini(struct nvkm_bios *);
 
 extern const struct nvbios_source nvbios_rom;
 extern const struct nvbios_source nvbios_ramin;
@@ -21,17 +21,26 @@
  *
  * Authors: Ben Skeggs
  */
-#include <subdev/bios.h>
-#include <subdev/bios/bit.h>
-#include <subdev/bios/rammap.h>
+#include "priv.h"
 
 u32
 nvbios_rammapTe(struct nvkm_bios *bios, u8 *ver, u8 *hdr,
 		u8 *cnt, u8 *len, u8 *snr, u8 *ssz)
 {
+	const struct nvbios_index *index = bios->index;
 	struct bit_entry bit_P;
 	u32 rammap = 0x0000;
 
+	if (index && index->rammap.data) {
+		*ver = index->rammap.ver;
+		*hdr = index->rammap.hdr;
+		*cnt = index->rammap.cnt;
+		*len = index->rammap.len;
+		*snr = index->rammap.snr;
+		*ssz = index->rammap.ssz;
+		return index->rammap.data;
+	}
+
 	if (!bit_entry(bios, 'P', &bit_P)) {
 		if (bit_P.version == 2)
 			rammap = nvbios_rd32(bios, bit_P.offset + 4);
@@ -91,7 +100,22 @@ u32
 nvbios_rammapEp(struct nvkm_bios *bios, int idx,
 		u8 *ver, u8 *hdr, u8 *cnt, u8 *len, struct nvbios_ramcfg *p)
 {
-	u32 data = nvbios_rammapEe(bios, idx, ver, hdr, cnt, len), temp;
+	const struct nvbios_index *index = bios->index;
+	u32 data, temp;
+
+	if (index && index->rammapE && idx >= 0 && idx < index->rammap.cnt) {
+		const struct nvbios_index_rammapE *e = &index->rammapE[idx];
+		if (e->data) {
+			*ver = e->ver;
+			*hdr = e->hdr;
+			*cnt = e->cnt;
+			*len = e->len;
+			*p = e->info;
+			return e->data;
+		}
+	}
+
+	data = nvbios_rammapEe(bios, idx, ver, hdr, cnt, len);
 	memset(p, 0x00, sizeof(*p));
 	p->rammap_ver = *ver;
 	p->rammap_hdr = *hdr;
@@ -24,6 +24,7 @@
 #include "priv.h"
 
 #include <core/option.h>
+#include <core/pci.h>
 #include <subdev/bios.h>
 #include <subdev/bios/image.h>
 
@@ -33,6 +34,15 @@ struct shadow {
 	void *data;
 	u32 size;
 	int score;
+	bool done;
+	bool bad;
+	s64 time;
+
+	/* Concurrent probing: each method shadows into its own copy of
+	 * the bios struct.
+	 */
+	struct work_struct work;
+	struct nvkm_bios *bios;
 };
 
 static bool
@@ -86,6 +96,7 @@ shadow_image(struct nvkm_bios *bios, int idx, u32 offset, struct shadow *mthd)
 		    nvbios_checksum(&bios->data[image.base], image.size)) {
 			nvkm_debug(subdev, "%08x: checksum failed\n",
 				   image.base);
+			mthd->bad = true;
 			if (!mthd->func->require_checksum) {
 				if (mthd->func->rw)
 					score += 1;
@@ -113,6 +124,8 @@ shadow_method(struct nvkm_bios *bios, struct shadow *mthd, const char *name)
 	struct nvkm_subdev *subdev = &bios->subdev;
 	if (func->name) {
 		nvkm_debug(subdev, "trying %s...\n", name ? name : func->name);
+		mthd->done = true;
+		mthd->time = ktime_to_us(ktime_get());
 		if (func->init) {
 			mthd->data = func->init(bios, name);
 			if (IS_ERR(mthd->data)) {
@@ -123,7 +136,9 @@ shadow_method(struct nvkm_bios *bios, struct shadow *mthd, const char *name)
 		mthd->score = shadow_image(bios, 0, 0, mthd);
 		if (func->fini)
 			func->fini(mthd->data);
-		nvkm_debug(subdev, "scored %d\n", mthd->score);
+		mthd->time = ktime_to_us(ktime_get()) - mthd->time;
+		nvkm_debug(subdev, "%s scored %d in %lldus\n",
+			   name ? name : func->name, mthd->score, mthd->time);
 		mthd->data = bios->data;
 		mthd->size = bios->size;
 		bios->data  = NULL;
@@ -132,6 +147,287 @@ shadow_method(struct nvkm_bios *bios, struct shadow *mthd, const char *name)
 	return mthd->score;
 }
 
+static void
+shadow_work(struct work_struct *work)
+{
+	struct shadow *mthd = container_of(work, typeof(*mthd), work);
+	shadow_method(mthd->bios, mthd, NULL);
+}
+
+/* Run the unconditional methods concurrently, rather than one after the
+ * other, and pick from them exactly as the serial scan would have: the
+ * highest score wins, and ties go to whichever comes first in mthds[].
+ */
+static struct shadow *
+shadow_probe(struct nvkm_bios *bios, struct shadow *mthds)
+{
+	struct nvkm_subdev *subdev = &bios->subdev;
+	struct shadow *mthd, *best;
+	s64 time;
+
+	time = ktime_to_us(ktime_get());
+
+	for (mthd = mthds; mthd->func; mthd++) {
+		if (mthd->skip || !mthd->func->name)
+			continue;
+
+		mthd->bios = kmemdup(bios, sizeof(*bios), GFP_KERNEL);
+		if (!mthd->bios)
+			continue;
+
+		mthd->bios->data = NULL;
+		mthd->bios->size = 0;
+		INIT_WORK(&mthd->work, shadow_work);
+		schedule_work(&mthd->work);
+	}
+
+	for (mthd = mthds; mthd->func; mthd++) {
+		if (!mthd->bios)
+			continue;
+
+		flush_work(&mthd->work);
+		kfree(mthd->bios);
+		mthd->bios = NULL;
+	}
+
+	for (mthd = mthds, best = mthd; mthd->func; mthd++) {
+		if (mthd->score > best->score)
+			best = mthd;
+	}
+
+	nvkm_debug(subdev, "concurrent probe took %lldus\n",
+		   ktime_to_us(ktime_get()) - time);
+	return best;
+}
+
+/******************************************************************************
+ * Image cache
+ *
+ * Validated images may be kept in a file, named by NvBiosCache, and reused
+ * when the board, and the start of each image in the ROM (as read back
+ * through the same method), still match.  This avoids reading the whole
+ * ROM, which for PROM is one MMIO read per dword.
+ *****************************************************************************/
+#define NVBIOS_CACHE_HDR 0x1000
+
+struct shadow_cache_key {
+	u32 chipset;
+	u16 vendor;
+	u16 device;
+	u16 subsystem_vendor;
+	u16 subsystem_device;
+};
+
+struct shadow_cache {
+#define NVBIOS_CACHE_MAGIC 0x43494256 /* "VBIC" */
+	u32 magic;
+#define NVBIOS_CACHE_VERSION 2
+	u32 version;
+	struct shadow_cache_key key;
+	u32 size;
+	u32 sum;
+	char source[16];
+};
+
+static void
+shadow_cache_key(struct nvkm_bios *bios, struct shadow_cache_key *key)
+{
+	struct nvkm_device *device = bios->subdev.device;
+
+	memset(key, 0x00, sizeof(*key));
+	key->chipset = device->chipset;
+	if (device->func->pci) {
+		struct pci_dev *pdev = device->func->pci(device)->pdev;
+		key->vendor = pdev->vendor;
+		key->device = pdev->device;
+		key->subsystem_vendor = pdev->subsystem_vendor;
+		key->subsystem_device = pdev->subsystem_device;
+	}
+}
+
+static u32
+shadow_cache_sum(const u8 *data, u32 size)
+{
+	u32 hash = 0x811c9dc5;
+	u32 i;
+
+	for (i = 0; i < size; i++) {
+		hash ^= data[i];
+		hash *= 0x01000193;
+	}
+
+	return hash;
+}
+
+/* Read the start of the image at base through the method, into temp, and
+ * compare it with what's cached.
+ */
+static bool
+shadow_cache_fetch(struct nvkm_bios *temp, struct shadow *mthd,
+		   struct nvkm_bios *bios, u32 base)
+{
+	const u32 limit = ALIGN(min_t(u32, base + NVBIOS_CACHE_HDR,
+				      bios->size), 4);
+
+	if (nvbios_extend(temp, limit) < 0 ||
+	    mthd->func->read(mthd->data, base, limit - base, temp) !=
+	    limit - base)
+		return false;
+
+	return !memcmp(temp->data + base, bios->data + base,
+		       min_t(u32, limit, bios->size) - base);
+}
+
+/* The cached image has to parse, and every image in it has to be whole,
+ * and pass its checksum, if the method would have checked it.  The ROM
+ * then has to agree with it about where each image starts, how large it
+ * is, and what its header holds.
+ */
+static bool
+shadow_cache_check(struct nvkm_bios *bios, struct shadow *mthd)
+{
+	const struct nvbios_source *func = mthd->func;
+	struct nvkm_subdev *subdev = &bios->subdev;
+	struct nvbios_image image, rimage;
+	struct nvkm_bios *temp;
+	bool valid = false;
+	int idx;
+
+	if (!(temp = kmemdup(bios, sizeof(*bios), GFP_KERNEL)))
+		return false;
+	temp->data = NULL;
+	temp->size = 0;
+
+	if (func->init) {
+		mthd->data = func->init(temp, NULL);
+		if (IS_ERR(mthd->data)) {
+			mthd->data = NULL;
+			kfree(temp);
+			return false;
+		}
+	}
+
+	if (func->no_pcir) {
+		valid = func->size(mthd->data) == bios->size &&
+			shadow_cache_fetch(temp, mthd, bios, 0);
+		goto done;
+	}
+
+	for (idx = 0; nvbios_image(bios, idx, &image); idx++) {
+		if (image.type == 0x00 && !func->ignore_checksum &&
+		    (image.base + image.size > bios->size ||
+		     nvbios_checksum(&bios->data[image.base], image.size))) {
+			nvkm_debug(subdev, "%08x: cached checksum failed\n",
+				   image.base);
+			goto done;
+		}
+
+		if (!shadow_cache_fetch(temp, mthd, bios, image.base) ||
+		    !nvbios_image(temp, idx, &rimage) ||
+		    memcmp(&image, &rimage, sizeof(image))) {
+			nvkm_debug(subdev, "%08x: image changed\n", image.base);
+			goto done;
+		}
+
+		valid = image.last;
+	}
+
+done:
+	if (func->fini)
+		func->fini(mthd->data);
+	mthd->data = NULL;
+	kfree(temp->data);
+	kfree(temp);
+	return valid;
+}
+
+static int
+shadow_cache_load(struct nvkm_bios *bios, struct shadow *mthds,
+		  const char *name)
+{
+	struct nvkm_subdev *subdev = &bios->subdev;
+	const struct shadow_cache *file;
+	struct shadow_cache_key key;
+	const struct firmware *fw;
+	struct shadow *mthd;
+	int ret = -EINVAL;
+	s64 time;
+
+	if (firmware_request_nowarn(&fw, name, subdev->device->dev))
+		return -ENOENT;
+
+	time = ktime_to_us(ktime_get());
+	shadow_cache_key(bios, &key);
+	file = (const void *)fw->data;
+	if (fw->size < sizeof(*file) ||
+	    file->magic != NVBIOS_CACHE_MAGIC ||
+	    file->version != NVBIOS_CACHE_VERSION ||
+	    memcmp(&file->key, &key, sizeof(key)) ||
+	    fw->size != sizeof(*file) + file->size ||
+	    file->sum != shadow_cache_sum((const u8 *)(file + 1), file->size)) {
+		nvkm_debug(subdev, "cached image invalid\n");
+		goto done;
+	}
+
+	for (mthd = mthds; mthd->func; mthd++) {
+		if (mthd->func->name &&
+		    !strncmp(file->source, mthd->func->name,
+			     sizeof(file->source)))
+			break;
+	}
+
+	if (!mthd->func)
+		goto done;
+
+	if (!(bios->data = kmemdup(file + 1, file->size, GFP_KERNEL))) {
+		ret = -ENOMEM;
+		goto done;
+	}
+	bios->size = file->size;
+
+	if (!shadow_cache_check(bios, mthd)) {
+		nvkm_debug(subdev, "cached image stale\n");
+		kfree(bios->data);
+		bios->data = NULL;
+		bios->size = 0;
+		goto done;
+	}
+
+	nvkm_debug(subdev, "using cached image from %s, validated in %lldus\n",
+		   mthd->func->name, ktime_to_us(ktime_get()) - time);
+	ret = 0;
+done:
+	release_firmware(fw);
+	return ret;
+}
+
+static void
+shadow_cache_save(struct nvkm_bios *bios, struct shadow *mthd,
+		  const char *name)
+{
+#ifdef CONFIG_NOUVEAU_FIRMWARE_CACHE
+	struct nvkm_subdev *subdev = &bios->subdev;
+	struct shadow_cache *file;
+	size_t size = sizeof(*file) + bios->size;
+
+	if (!(file = kvmalloc(size, GFP_KERNEL)))
+		return;
+
+	memset(file, 0x00, sizeof(*file));
+	file->magic = NVBIOS_CACHE_MAGIC;
+	file->version = NVBIOS_CACHE_VERSION;
+	shadow_cache_key(bios, &file->key);
+	file->size = bios->size;
+	file->sum = shadow_cache_sum(bios->data, bios->size);
+	strncpy(file->source, mthd->func->name, sizeof(file->source) - 1);
+	memcpy(file + 1, bios->data, bios->size);
+
+	if (firmware_cache_write(name, file, size))
+		nvkm_warn(subdev, "failed to write image cache %s\n", name);
+	kvfree(file);
+#endif
+}
+
 static u32
 shadow_fw_read(void *data, u32 offset, u32 length, struct nvkm_bios *bios)
 {
@@ -179,7 +475,7 @@ nvbios_shadow(struct nvkm_bios *bios)
 		{}
 	}, *mthd, *best = NULL;
 	const char *optarg;
-	char *source;
+	char *source, *cache = NULL;
 	int optlen;
 
 	/* handle user-specified bios source */
@@ -210,9 +506,31 @@ nvbios_shadow(struct nvkm_bios *bios)
 		}
 	}
 
+	if (!source) {
+		optarg = nvkm_stropt(device->cfgopt, "NvBiosCache", &optlen);
+		if (optarg && !(cache = kstrndup(optarg, optlen, GFP_KERNEL)))
+			return -ENOMEM;
+
+		if (cache && !shadow_cache_load(bios, mthds, cache)) {
+			/* NvBios may have been tried, and found wanting. */
+			for (mthd = mthds; mthd->func; mthd++)
+				kfree(mthd->data);
+			kfree(mthd->data);
+			kfree(cache);
+			return 0;
+		}
+	}
+
 	/* scan all potential bios sources, looking for best image */
 	if (!best || !best->score) {
-		for (mthd = mthds, best = mthd; mthd->func; mthd++) {
+		if (nvkm_boolopt(device->cfgopt, "NvBiosProbeParallel", false))
+			best = shadow_probe(bios, mthds);
+		else
+			best = mthds;
+
+		for (mthd = mthds; mthd->func; mthd++) {
+			if (mthd->done)
+				continue;
 			if (!mthd->skip || best->score < mthd->skip) {
 				if (shadow_method(bios, mthd, NULL)) {
 					if (mthd->score > best->score)
@@ -230,6 +548,7 @@ nvbios_shadow(struct nvkm_bios *bios)
 
 	if (!best->score) {
 		nvkm_error(subdev, "unable to locate usable image\n");
+		kfree(cache);
 		return -EINVAL;
 	}
 
@@ -237,6 +556,9 @@ nvbios_shadow(struct nvkm_bios *bios)
 		   best->func->name : source);
 	bios->data = best->data;
 	bios->size = best->size;
+	if (cache && best->func && !best->bad)
+		shadow_cache_save(bios, best, cache);
+	kfree(cache);
 	kfree(source);
 	return 0;
 }
@@ -21,16 +21,23 @@
  *
  * Authors: Martin Peres
  */
-#include <subdev/bios.h>
-#include <subdev/bios/bit.h>
-#include <subdev/bios/volt.h>
+#include "priv.h"
 
 u32
 nvbios_volt_table(struct nvkm_bios *bios, u8 *ver, u8 *hdr, u8 *cnt, u8 *len)
 {
+	const struct nvbios_index *index = bios->index;
 	struct bit_entry bit_P;
 	u32 volt = 0;
 
+	if (index && index->volt.data) {
+		*ver = index->volt.ver;
+		*hdr = index->volt.hdr;
+		*cnt = index->volt.cnt;
+		*len = index->volt.len;
+		return index->volt.data;
+	}
+
 	if (!bit_entry(bios, 'P', &bit_P)) {
 		if (bit_P.version == 2)
 			volt = nvbios_rd32(bios, bit_P.offset + 0x0c);
@@ -137,7 +144,20 @@ u32
 nvbios_volt_entry_parse(struct nvkm_bios *bios, int idx, u8 *ver, u8 *len,
 			struct nvbios_volt_entry *info)
 {
-	u32 volt = nvbios_volt_entry(bios, idx, ver, len);
+	const struct nvbios_index *index = bios->index;
+	u32 volt;
+
+	if (index && index->voltE && idx >= 0 && idx < index->volt.cnt) {
+		const struct nvbios_index_voltE *e = &index->voltE[idx];
+		if (e->data) {
+			*ver = e->ver;
+			*len = e->len;
+			*info = e->info;
+			return e->data;
+		}
+	}
+
+	volt = nvbios_volt_entry(bios, idx, ver, len);
 	memset(info, 0x00, sizeof(*info));
 	switch (!!volt * *ver) {
 	case 0x12:
@@ -156,6 +156,130 @@ nvkm_cstate_get(struct nvkm_clk *clk, struct nvkm_pstate *pstate, int cstatei)
 	return NULL;
 }
 
+static struct nvkm_cstate *
+nvkm_cstate_pick(struct nvkm_clk *clk, struct nvkm_pstate *pstate, int cstatei)
+{
+	struct nvkm_cstate *cstate;
+
+	if (list_empty(&pstate->list))
+		return &pstate->base;
+
+	cstate = nvkm_cstate_get(clk, pstate, cstatei);
+	return nvkm_cstate_find_best(clk, pstate, cstate);
+}
+
+/******************************************************************************
+ * calc() memoisation
+ *
+ * A backend's calc() depends on the clock tree's current configuration as
+ * well as the target cstate, so results are only reused for transitions from
+ * a known state, ie. the cstate we last successfully programmed.
+ *****************************************************************************/
+#define NVKM_CLK_MEMO_NR 16
+
+struct nvkm_clk_memo {
+	struct list_head head;
+	struct nvkm_cstate *from;
+	struct nvkm_cstate *to;
+	u8 data[];
+};
+
+static void
+nvkm_clk_memo_fini(struct nvkm_clk *clk)
+{
+	struct nvkm_clk_memo *memo, *temp;
+
+	list_for_each_entry_safe(memo, temp, &clk->memo.list, head) {
+		list_del(&memo->head);
+		kfree(memo);
+	}
+
+	clk->memo.nr = 0;
+	clk->memo.from = NULL;
+}
+
+static struct nvkm_clk_memo *
+nvkm_clk_memo_find(struct nvkm_clk *clk, struct nvkm_cstate *cstate)
+{
+	struct nvkm_clk_memo *memo;
+
+	list_for_each_entry(memo, &clk->memo.list, head) {
+		if (memo->from == clk->memo.from && memo->to == cstate)
+			return memo;
+	}
+
+	return NULL;
+}
+
+static void
+nvkm_clk_memo_save(struct nvkm_clk *clk, struct nvkm_cstate *cstate)
+{
+	struct nvkm_clk_memo *memo;
+
+	if (clk->memo.nr == NVKM_CLK_MEMO_NR) {
+		memo = list_last_entry(&clk->memo.list, typeof(*memo), head);
+		list_del(&memo->head);
+		clk->memo.nr--;
+	} else {
+		memo = kmalloc(sizeof(*memo) + clk->func->calc_size,
+			       GFP_KERNEL);
+		if (!memo)
+			return;
+	}
+
+	memo->from = clk->memo.from;
+	memo->to = cstate;
+	clk->func->calc_save(clk, memo->data);
+	list_add(&memo->head, &clk->memo.list);
+	clk->memo.nr++;
+}
+
+static int
+nvkm_clk_calc(struct nvkm_clk *clk, struct nvkm_cstate *cstate, bool *hit)
+{
+	struct nvkm_clk_memo *memo;
+	int ret;
+
+	*hit = false;
+	if (!clk->func->calc_save || !clk->memo.from)
+		return clk->func->calc(clk, cstate);
+
+	if ((memo = nvkm_clk_memo_find(clk, cstate))) {
+		clk->func->calc_load(clk, memo->data);
+		list_move(&memo->head, &clk->memo.list);
+		clk->memo.hit++;
+		*hit = true;
+		return 0;
+	}
+
+	ret = clk->func->calc(clk, cstate);
+	if (ret == 0)
+		nvkm_clk_memo_save(clk, cstate);
+	clk->memo.miss++;
+	return ret;
+}
+
+/* Compute the result for a likely transition ahead of time, while the hw
+ * is in the state the transition will start from.
+ */
+static void
+nvkm_clk_precalc(struct nvkm_clk *clk, struct nvkm_pstate *pstate)
+{
+	struct nvkm_cstate *cstate;
+
+	if (!pstate || !clk->func->calc_save || !clk->memo.from)
+		return;
+
+	cstate = nvkm_cstate_pick(clk, pstate, NVKM_CLK_CSTATE_HIGHEST);
+	if (!cstate || cstate == clk->memo.from ||
+	    nvkm_clk_memo_find(clk, cstate))
+		return;
+
+	if (clk->func->calc(clk, cstate) == 0)
+		nvkm_clk_memo_save(clk, cstate);
+	clk->func->tidy(clk);
+}
+
 static int
 nvkm_cstate_prog(struct nvkm_clk *clk, struct nvkm_pstate *pstate, int cstatei)
 {
@@ -164,14 +288,12 @@ nvkm_cstate_prog(struct nvkm_clk *clk, struct nvkm_pstate *pstate, int cstatei)
 	struct nvkm_therm *therm = device->therm;
 	struct nvkm_volt *volt = device->volt;
 	struct nvkm_cstate *cstate;
+	s64 t0, t1, t2, t3, t4;
+	bool hit;
 	int ret;
 
-	if (!list_empty(&pstate->list)) {
-		cstate = nvkm_cstate_get(clk, pstate, cstatei);
-		cstate = nvkm_cstate_find_best(clk, pstate, cstate);
-	} else {
-		cstate = &pstate->base;
-	}
+	t0 = ktime_to_us(ktime_get());
+	cstate = nvkm_cstate_pick(clk, pstate, cstatei);
 
 	if (therm) {
 		ret = nvkm_therm_cstate(therm, pstate->fanspeed, +1);
@@ -190,11 +312,17 @@ nvkm_cstate_prog(struct nvkm_clk *clk, struct nvkm_pstate *pstate, int cstatei)
 		}
 	}
 
-	ret = clk->func->calc(clk, cstate);
+	t1 = ktime_to_us(ktime_get());
+	ret = nvkm_clk_calc(clk, cstate, &hit);
+	t2 = ktime_to_us(ktime_get());
 	if (ret == 0) {
 		ret = clk->func->prog(clk);
 		clk->func->tidy(clk);
 	}
+	t3 = ktime_to_us(ktime_get());
+
+	/* We can only trust the memoised results from a known state. */
+	clk->memo.from = ret ? NULL : cstate;
 
 	if (volt) {
 		ret = nvkm_volt_set_id(volt, cstate->voltage,
@@ -209,6 +337,10 @@ nvkm_cstate_prog(struct nvkm_clk *clk, struct nvkm_pstate *pstate, int cstatei)
 			nvkm_error(subdev, "failed to lower fan speed: %d\n", ret);
 	}
 
+	t4 = ktime_to_us(ktime_get());
+	nvkm_debug(subdev, "cstate %d: raise %lldus, calc %lldus%s, "
+			   "prog %lldus, lower %lldus\n", cstate->id,
+		   t1 - t0, t2 - t1, hit ? " (memo)" : "", t3 - t2, t4 - t3);
 	return ret;
 }
 
@@ -261,6 +393,20 @@ nvkm_cstate_new(struct nvkm_clk *clk, int idx, struct nvkm_pstate *pstate)
 /******************************************************************************
  * P-States
  *****************************************************************************/
+static struct nvkm_pstate *
+nvkm_pstate_get(struct nvkm_clk *clk, int pstatei)
+{
+	struct nvkm_pstate *pstate;
+	int idx = 0;
+
+	list_for_each_entry(pstate, &clk->states, head) {
+		if (idx++ == pstatei)
+			return pstate;
+	}
+
+	return NULL;
+}
+
 static int
 nvkm_pstate_prog(struct nvkm_clk *clk, int pstatei)
 {
@@ -268,27 +414,33 @@ nvkm_pstate_prog(struct nvkm_clk *clk, int pstatei)
 	struct nvkm_fb *fb = subdev->device->fb;
 	struct nvkm_pci *pci = subdev->device->pci;
 	struct nvkm_pstate *pstate;
-	int ret, idx = 0;
+	s64 time;
+	int ret;
 
-	list_for_each_entry(pstate, &clk->states, head) {
-		if (idx++ == pstatei)
-			break;
-	}
+	pstate = nvkm_pstate_get(clk, pstatei);
+	if (WARN_ON(!pstate))
+		return -EINVAL;
 
-	nvkm_debug(subdev, "setting performance state %d\n", pstatei);
+	nvkm_debug(subdev, "setting performance state %d, queued %lldus\n",
+		   pstatei, ktime_to_us(ktime_get()) - clk->queued);
 	clk->pstate = pstatei;
 
+	time = ktime_to_us(ktime_get());
 	nvkm_pcie_set_link(pci, pstate->pcie_speed, pstate->pcie_width);
+	nvkm_debug(subdev, "pcie %lldus\n", ktime_to_us(ktime_get()) - time);
 
 	if (fb && fb->ram && fb->ram->func->calc) {
 		struct nvkm_ram *ram = fb->ram;
 		int khz = pstate->base.domain[nv_clk_src_mem];
+		time = ktime_to_us(ktime_get());
 		do {
 			ret = ram->func->calc(ram, khz);
 			if (ret == 0)
 				ret = ram->func->prog(ram);
 		} while (ret > 0);
 		ram->func->tidy(ram);
+		nvkm_debug(subdev, "ram %lldus\n",
+			   ktime_to_us(ktime_get()) - time);
 	}
 
 	return nvkm_cstate_prog(clk, pstate, NVKM_CLK_CSTATE_HIGHEST);
@@ -320,11 +472,23 @@ nvkm_pstate_work(struct work_struct *work)
 
 	nvkm_trace(subdev, "-> %d\n", pstate);
 	if (pstate != clk->pstate) {
+		int prev = clk->pstate;
 		int ret = nvkm_pstate_prog(clk, pstate);
 		if (ret) {
 			nvkm_error(subdev, "error setting pstate %d: %d\n",
 				   pstate, ret);
 		}
+
+		wake_up_all(&clk->wait);
+
+		/* Likely next targets are the state we just left, and the
+		 * neighbours of the new one.
+		 */
+		if (clk->memo.precalc && pstate >= 0) {
+			nvkm_clk_precalc(clk, nvkm_pstate_get(clk, prev));
+			nvkm_clk_precalc(clk, nvkm_pstate_get(clk, pstate - 1));
+			nvkm_clk_precalc(clk, nvkm_pstate_get(clk, pstate + 1));
+		}
 	}
 
 	wake_up_all(&clk->wait);
@@ -334,6 +498,7 @@ nvkm_pstate_work(struct work_struct *work)
 static int
 nvkm_pstate_calc(struct nvkm_clk *clk, bool wait)
 {
+	clk->queued = ktime_to_us(ktime_get());
 	atomic_set(&clk->waiting, 1);
 	schedule_work(&clk->work);
 	if (wait)
@@ -584,6 +749,10 @@ nvkm_clk_fini(struct nvkm_subdev *subdev, bool suspend)
 	flush_work(&clk->work);
 	if (clk->func->fini)
 		clk->func->fini(clk);
+
+	nvkm_debug(subdev, "calc memo: %llu hits, %llu misses\n",
+		   clk->memo.hit, clk->memo.miss);
+	nvkm_clk_memo_fini(clk);
 	return 0;
 }
 
@@ -628,6 +797,7 @@ nvkm_clk_dtor(struct nvkm_subdev *subdev)
 	struct nvkm_pstate *pstate, *temp;
 
 	nvkm_notify_fini(&clk->pwrsrc_ntfy);
+	nvkm_clk_memo_fini(clk);
 
 	/* Early return if the pstates have been provided statically */
 	if (clk->func->pstates)
@@ -669,6 +839,7 @@ nvkm_clk_ctor(const struct nvkm_clk_func *func, struct nvkm_device *device,
 
 	clk->func = func;
 	INIT_LIST_HEAD(&clk->states);
+	INIT_LIST_HEAD(&clk->memo.list);
 	clk->domains = func->domains;
 	clk->ustate_ac = -1;
 	clk->ustate_dc = -1;
@@ -711,6 +882,7 @@ nvkm_clk_ctor(const struct nvkm_clk_func *func, struct nvkm_device *device,
 
 	clk->boost_mode = nvkm_longopt(device->cfgopt, "NvBoost",
 				       NVKM_CLK_BOOST_NONE);
+	clk->memo.precalc = nvkm_boolopt(device->cfgopt, "NvClkPrecalc", false);
 	return 0;
 }
 
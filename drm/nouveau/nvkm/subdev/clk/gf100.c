@@ -445,12 +445,29 @@ gf100_clk_tidy(struct nvkm_clk *base)
 	memset(clk->eng, 0x00, sizeof(clk->eng));
 }
 
+static void
+gf100_clk_calc_save(struct nvkm_clk *base, void *data)
+{
+	struct gf100_clk *clk = gf100_clk(base);
+	memcpy(data, clk->eng, sizeof(clk->eng));
+}
+
+static void
+gf100_clk_calc_load(struct nvkm_clk *base, const void *data)
+{
+	struct gf100_clk *clk = gf100_clk(base);
+	memcpy(clk->eng, data, sizeof(clk->eng));
+}
+
 static const struct nvkm_clk_func
 gf100_clk = {
 	.read = gf100_clk_read,
 	.calc = gf100_clk_calc,
 	.prog = gf100_clk_prog,
 	.tidy = gf100_clk_tidy,
+	.calc_size = sizeof(((struct gf100_clk *)0)->eng),
+	.calc_save = gf100_clk_calc_save,
+	.calc_load = gf100_clk_calc_load,
 	.domains = {
 		{ nv_clk_src_crystal, 0xff },
 		{ nv_clk_src_href   , 0xff },
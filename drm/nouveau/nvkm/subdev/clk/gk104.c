@@ -482,12 +482,29 @@ gk104_clk_tidy(struct nvkm_clk *base)
 	memset(clk->eng, 0x00, sizeof(clk->eng));
 }
 
+static void
+gk104_clk_calc_save(struct nvkm_clk *base, void *data)
+{
+	struct gk104_clk *clk = gk104_clk(base);
+	memcpy(data, clk->eng, sizeof(clk->eng));
+}
+
+static void
+gk104_clk_calc_load(struct nvkm_clk *base, const void *data)
+{
+	struct gk104_clk *clk = gk104_clk(base);
+	memcpy(clk->eng, data, sizeof(clk->eng));
+}
+
 static const struct nvkm_clk_func
 gk104_clk = {
 	.read = gk104_clk_read,
 	.calc = gk104_clk_calc,
 	.prog = gk104_clk_prog,
 	.tidy = gk104_clk_tidy,
+	.calc_size = sizeof(((struct gk104_clk *)0)->eng),
+	.calc_save = gk104_clk_calc_save,
+	.calc_load = gk104_clk_calc_load,
 	.domains = {
 		{ nv_clk_src_crystal, 0xff },
 		{ nv_clk_src_href   , 0xff },
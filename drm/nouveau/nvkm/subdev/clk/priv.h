@@ -11,6 +11,10 @@ struct nvkm_clk_func {
 	int (*calc)(struct nvkm_clk *, struct nvkm_cstate *);
 	int (*prog)(struct nvkm_clk *);
 	void (*tidy)(struct nvkm_clk *);
+	/* Optional, allows calc() results to be memoised. */
+	u32 calc_size;
+	void (*calc_save)(struct nvkm_clk *, void *);
+	void (*calc_load)(struct nvkm_clk *, const void *);
 	struct nvkm_pstate *pstates;
 	int nr_pstates;
 	struct nvkm_domain domains[];
@@ -101,9 +101,9 @@ nvkm_fault_oneinit_buffer(struct nvkm_fault *fault, int id)
 
 	nvkm_debug(subdev, "buffer %d: %d entries\n", id, buffer->entries);
 
-	ret = nvkm_memory_new(device, NVKM_MEM_TARGET_INST, buffer->entries *
-			      fault->func->buffer.entry_size, 0x1000, true,
-			      &buffer->mem);
+	ret = nvkm_memory_new(device, NVKM_MEM_TARGET_INST_SR_LOST,
+			      buffer->entries * fault->func->buffer.entry_size,
+			      0x1000, true, &buffer->mem);
 	if (ret)
 		return ret;
 
@@ -150,6 +150,7 @@ nvkm_fault_dtor(struct nvkm_subdev *subdev)
 
 	for (i = 0; i < fault->buffer_nr; i++) {
 		if (fault->buffer[i]) {
+			kvfree(fault->buffer[i]->batch);
 			nvkm_memory_unref(&fault->buffer[i]->mem);
 			kfree(fault->buffer[i]);
 		}
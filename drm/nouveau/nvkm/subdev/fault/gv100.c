@@ -27,47 +27,105 @@
 
 #include <nvif/class.h>
 
+static void
+gv100_fault_buffer_decode(const u32 *data, struct nvkm_fault_data *info)
+{
+	const u32 instlo = data[0];
+	const u32 insthi = data[1];
+	const u32 addrlo = data[2];
+	const u32 addrhi = data[3];
+	const u32 timelo = data[4];
+	const u32 timehi = data[5];
+	const u32  info0 = data[6];
+	const u32  info1 = data[7];
+
+	info->addr   = ((u64)addrhi << 32) | addrlo;
+	info->inst   = ((u64)insthi << 32) | instlo;
+	info->time   = ((u64)timehi << 32) | timelo;
+	info->engine = (info0 & 0x000000ff);
+	info->valid  = (info1 & 0x80000000) >> 31;
+	info->gpc    = (info1 & 0x1f000000) >> 24;
+	info->hub    = (info1 & 0x00100000) >> 20;
+	info->access = (info1 & 0x000f0000) >> 16;
+	info->client = (info1 & 0x00007f00) >> 8;
+	info->reason = (info1 & 0x0000001f);
+}
+
+/* Entries describing the same fault, ignoring the timestamp. */
+static bool
+gv100_fault_buffer_same(const u32 *a, const u32 *b)
+{
+	return a[0] == b[0] && a[1] == b[1] && a[2] == b[2] && a[3] == b[3] &&
+	       a[6] == b[6] && a[7] == b[7];
+}
+
+static u32
+gv100_fault_buffer_hash(const u32 *a)
+{
+	return ((a[0] ^ a[2] ^ a[3] ^ a[7]) * 0x9e3779b9) >> 16;
+}
+
 static void
 gv100_fault_buffer_process(struct nvkm_fault_buffer *buffer)
 {
-	struct nvkm_device *device = buffer->fault->subdev.device;
+	struct nvkm_subdev *subdev = &buffer->fault->subdev;
+	struct nvkm_device *device = subdev->device;
 	struct nvkm_memory *mem = buffer->mem;
+	const u32 size = buffer->fault->func->buffer.entry_size;
+	const u32 words = size / 4;
+	struct nvkm_fault_data info;
+	u32 *data = buffer->batch;
 	u32 get = nvkm_rd32(device, buffer->get);
 	u32 put = nvkm_rd32(device, buffer->put);
-	if (put == get)
-		return;
+	u8 seen[NVKM_FAULT_BATCH * 2]; /* unique entry + 1, by hash */
+	int nr, uniq, i, h;
 
-	nvkm_kmap(mem);
 	while (get != put) {
-		const u32   base = get * buffer->fault->func->buffer.entry_size;
-		const u32 instlo = nvkm_ro32(mem, base + 0x00);
-		const u32 insthi = nvkm_ro32(mem, base + 0x04);
-		const u32 addrlo = nvkm_ro32(mem, base + 0x08);
-		const u32 addrhi = nvkm_ro32(mem, base + 0x0c);
-		const u32 timelo = nvkm_ro32(mem, base + 0x10);
-		const u32 timehi = nvkm_ro32(mem, base + 0x14);
-		const u32  info0 = nvkm_ro32(mem, base + 0x18);
-		const u32  info1 = nvkm_ro32(mem, base + 0x1c);
-		struct nvkm_fault_data info;
-
-		if (++get == buffer->entries)
+		/* Copy out as many pending entries as possible in one go,
+		 * stopping at the end of the ring.
+		 */
+		nr = min_t(u32, (put > get ? put : buffer->entries) - get,
+			   NVKM_FAULT_BATCH);
+		nvkm_kmap(mem);
+		nvkm_memory_rd(mem, get * size, data, nr * size);
+		nvkm_done(mem);
+
+		get += nr;
+		if (get == buffer->entries)
 			get = 0;
 		nvkm_wr32(device, buffer->get, get);
 
-		info.addr   = ((u64)addrhi << 32) | addrlo;
-		info.inst   = ((u64)insthi << 32) | instlo;
-		info.time   = ((u64)timehi << 32) | timelo;
-		info.engine = (info0 & 0x000000ff);
-		info.valid  = (info1 & 0x80000000) >> 31;
-		info.gpc    = (info1 & 0x1f000000) >> 24;
-		info.hub    = (info1 & 0x00100000) >> 20;
-		info.access = (info1 & 0x000f0000) >> 16;
-		info.client = (info1 & 0x00007f00) >> 8;
-		info.reason = (info1 & 0x0000001f);
-
-		nvkm_fifo_fault(device->fifo, &info);
+		/* Drop repeats of the same fault within the batch.  A storm
+		 * may be all repeats, or hardly any, so look them up by hash
+		 * rather than against every unique entry so far.
+		 */
+		memset(seen, 0x00, sizeof(seen));
+		for (i = 0, uniq = 0; i < nr; i++) {
+			const u32 *entry = &data[i * words];
+
+			h = gv100_fault_buffer_hash(entry) % ARRAY_SIZE(seen);
+			while (seen[h] && !gv100_fault_buffer_same(entry,
+					&data[(seen[h] - 1) * words]))
+				h = (h + 1) % ARRAY_SIZE(seen);
+			if (seen[h])
+				continue;
+			if (uniq != i)
+				memcpy(&data[uniq * words], entry, size);
+			seen[h] = ++uniq;
+		}
+
+		for (i = 0; i < uniq; i++) {
+			gv100_fault_buffer_decode(&data[i * words], &info);
+			nvkm_fifo_fault(device->fifo, &info);
+		}
+
+		buffer->stats.batch++;
+		buffer->stats.fault += nr;
+		buffer->stats.dup += nr - uniq;
+		buffer->stats.max = max_t(u32, buffer->stats.max, nr);
+		nvkm_trace(subdev, "buffer %d: %d fault(s), %d unique\n",
+			   buffer->id, nr, uniq);
 	}
-	nvkm_done(mem);
 }
 
 static void
@@ -183,7 +241,16 @@ gv100_fault_intr(struct nvkm_fault *fault)
 static void
 gv100_fault_fini(struct nvkm_fault *fault)
 {
+	struct nvkm_fault_buffer *buffer = fault->buffer[0];
+
 	nvkm_notify_put(&fault->nrpfb);
+	if (buffer && buffer->stats.batch) {
+		nvkm_debug(&fault->subdev, "buffer %d: %lld faults in %lld "
+			   "batches (max %d), %lld duplicates dropped\n",
+			   buffer->id, buffer->stats.fault, buffer->stats.batch,
+			   buffer->stats.max, buffer->stats.dup);
+	}
+
 	if (fault->buffer[0])
 		fault->func->buffer.fini(fault->buffer[0]);
 	nvkm_mask(fault->subdev.device, 0x100a34, 0x80000000, 0x80000000);
@@ -200,6 +267,13 @@ gv100_fault_init(struct nvkm_fault *fault)
 int
 gv100_fault_oneinit(struct nvkm_fault *fault)
 {
+	struct nvkm_fault_buffer *buffer = fault->buffer[0];
+
+	buffer->batch = kvmalloc(NVKM_FAULT_BATCH *
+				 fault->func->buffer.entry_size, GFP_KERNEL);
+	if (!buffer->batch)
+		return -ENOMEM;
+
 	return nvkm_notify_init(&fault->buffer[0]->object, &fault->event,
 				gv100_fault_ntfy_nrpfb, true, NULL, 0, 0,
 				&fault->nrpfb);
@@ -16,6 +16,17 @@ struct nvkm_fault_buffer {
 	u32 put;
 	struct nvkm_memory *mem;
 	u64 addr;
+
+	/* Host copy of pending entries, for draining in batches. */
+#define NVKM_FAULT_BATCH 64
+	u32 *batch;
+
+	struct {
+		u64 batch;
+		u64 fault;
+		u64 dup;
+		u32 max;
+	} stats;
 };
 
 int nvkm_fault_new_(const struct nvkm_fault_func *, struct nvkm_device *,
@@ -67,6 +67,12 @@ ramfuc_init(struct ramfuc *ram, struct nvkm_fb *fb)
 	return 0;
 }
 
+static inline bool
+ramfuc_cache(struct ramfuc *ram, const struct nvkm_memx_key *key)
+{
+	return nvkm_memx_cache(ram->memx, key);
+}
+
 static inline int
 ramfuc_exec(struct ramfuc *ram, bool exec)
 {
@@ -81,9 +87,8 @@ ramfuc_exec(struct ramfuc *ram, bool exec)
 static inline u32
 ramfuc_rd32(struct ramfuc *ram, struct ramfuc_reg *reg)
 {
-	struct nvkm_device *device = ram->fb->subdev.device;
 	if (reg->sequence != ram->sequence)
-		reg->data = nvkm_rd32(device, reg->addr);
+		reg->data = nvkm_memx_rd32(ram->memx, reg->addr);
 	return reg->data;
 }
 
@@ -163,6 +168,7 @@ ramfuc_unblock(struct ramfuc *ram)
 
 #define ram_init(s,p)        ramfuc_init(&(s)->base, (p))
 #define ram_exec(s,e)        ramfuc_exec(&(s)->base, (e))
+#define ram_cache(s,k)       ramfuc_cache(&(s)->base, (k))
 #define ram_have(s,r)        ((s)->r_##r.addr != 0x000000)
 #define ram_rd32(s,r)        ramfuc_rd32(&(s)->base, &(s)->r_##r)
 #define ram_wr32(s,r,d)      ramfuc_wr32(&(s)->base, &(s)->r_##r, (d))
@@ -36,6 +36,7 @@
 #include <subdev/clk.h>
 #include <subdev/clk/pll.h>
 #include <subdev/gpio.h>
+#include <subdev/therm.h>
 
 struct gk104_ramfuc {
 	struct ramfuc base;
@@ -229,9 +230,7 @@ static void
 gk104_ram_nuts(struct gk104_ram *ram, struct ramfuc_reg *reg,
 	       u32 _mask, u32 _data, u32 _copy)
 {
-	struct nvkm_fb *fb = ram->base.fb;
 	struct ramfuc *fuc = &ram->fuc.base;
-	struct nvkm_device *device = fb->subdev.device;
 	u32 addr = 0x110000 + (reg->addr & 0xfff);
 	u32 mask = _mask | _copy;
 	u32 data = (_data & _mask) | (reg->data & _copy);
@@ -239,7 +238,8 @@ gk104_ram_nuts(struct gk104_ram *ram, struct ramfuc_reg *reg,
 
 	for (i = 0; i < 16; i++, addr += 0x1000) {
 		if (ram->pnuts & (1 << i)) {
-			u32 prev = nvkm_rd32(device, addr);
+			/* Through memx, so cached scripts notice if it changes. */
+			u32 prev = nvkm_memx_rd32(fuc->memx, addr);
 			u32 next = (prev & ~mask) | data;
 			nvkm_memx_wr32(fuc->memx, addr, next);
 		}
@@ -1042,6 +1042,13 @@ gk104_ram_calc_xits(struct gk104_ram *ram, struct nvkm_ram_data *next)
 {
 	struct gk104_ramfuc *fuc = &ram->fuc;
 	struct nvkm_subdev *subdev = &ram->base.fb->subdev;
+	struct nvkm_therm *therm = subdev->device->therm;
+	struct nvkm_memx_key key = {
+		.from = ram->base.former.freq,
+		.to = next->freq,
+		.temp = -1,
+		.data = (next == &ram->base.xition),
+	};
 	int refclk, i;
 	int ret;
 
@@ -1052,6 +1059,16 @@ gk104_ram_calc_xits(struct gk104_ram *ram, struct nvkm_ram_data *next)
 	ram->mode = (next->freq > fuc->refpll.vco1.max_freq) ? 2 : 1;
 	ram->from = ram_rd32(fuc, 0x1373f4) & 0x0000000f;
 
+	/* Reuse the script from the last identical transition, if the
+	 * registers it was generated from haven't changed since.
+	 */
+	if (therm && (ret = nvkm_therm_temp_get(therm)) >= 0)
+		key.temp = ret / 10;
+	if (ram_cache(fuc, &key)) {
+		ram->base.freq = next->freq;
+		return 0;
+	}
+
 	/* XXX: this is *not* what nvidia do.  on fermi nvidia generally
 	 * select, based on some unknown condition, one of the two possible
 	 * reference frequencies listed in the vbios table for mempll and
@@ -24,6 +24,8 @@
 #include "aux.h"
 #include "pad.h"
 
+#include <core/option.h>
+
 static int
 nvkm_i2c_aux_i2c_xfer(struct i2c_adapter *adap, struct i2c_msg *msgs, int num)
 {
@@ -35,6 +37,7 @@ nvkm_i2c_aux_i2c_xfer(struct i2c_adapter *adap, struct i2c_msg *msgs, int num)
 	if (ret)
 		return ret;
 
+	aux->stats.xfer++;
 	while (mcnt--) {
 		u8 remaining = msg->len;
 		u8 *ptr = msg->buf;
@@ -56,8 +59,11 @@ nvkm_i2c_aux_i2c_xfer(struct i2c_adapter *adap, struct i2c_msg *msgs, int num)
 				cnt = min_t(u8, remaining, 16);
 				ret = aux->func->xfer(aux, true, cmd,
 						      msg->addr, ptr, &cnt);
+				aux->stats.chunk++;
 				if (ret < 0)
 					goto out;
+				if (!cnt)
+					aux->stats.retry++;
 			}
 			if (!cnt) {
 				AUX_TRACE(aux, "no data after 32 retries");
@@ -95,6 +101,7 @@ nvkm_i2c_aux_monitor(struct nvkm_i2c_aux *aux, bool monitor)
 {
 	struct nvkm_i2c_pad *pad = aux->pad;
 	AUX_TRACE(aux, "monitor: %s", monitor ? "yes" : "no");
+	atomic_inc(&aux->hpd);
 	if (monitor)
 		nvkm_i2c_pad_mode(pad, NVKM_I2C_PAD_AUX);
 	else
@@ -129,6 +136,73 @@ nvkm_i2c_aux_acquire(struct nvkm_i2c_aux *aux)
 	return ret;
 }
 
+/*******************************************************************************
+ * DPCD receiver capability cache
+ ******************************************************************************/
+static const u32
+nvkm_i2c_aux_dpcd_base[] = {
+	0x00000, /* receiver capability */
+	0x02200, /* extended receiver capability */
+};
+
+static int
+nvkm_i2c_aux_dpcd_range(struct nvkm_i2c_aux *aux, u32 addr, u32 size)
+{
+	int i;
+
+	if (!aux->dpcd.enable || aux->pad->mode != NVKM_I2C_PAD_AUX)
+		return -1;
+
+	for (i = 0; i < ARRAY_SIZE(nvkm_i2c_aux_dpcd_base); i++) {
+		const u32 base = nvkm_i2c_aux_dpcd_base[i];
+		if (addr >= base && addr + size <= base + 0x100)
+			break;
+	}
+
+	if (i == ARRAY_SIZE(nvkm_i2c_aux_dpcd_base))
+		return -1;
+
+	/* Sink may have changed since we last looked, start over. */
+	if (aux->dpcd.hpd != atomic_read(&aux->hpd)) {
+		memset(aux->dpcd.valid, 0x00, sizeof(aux->dpcd.valid));
+		aux->dpcd.hpd = atomic_read(&aux->hpd);
+	}
+
+	return i;
+}
+
+static bool
+nvkm_i2c_aux_dpcd_get(struct nvkm_i2c_aux *aux, int r, u32 addr,
+		      u8 *data, u32 size)
+{
+	const u32 *valid = aux->dpcd.valid[r];
+	u32 i, o = addr - nvkm_i2c_aux_dpcd_base[r];
+
+	for (i = o; i < o + size; i++) {
+		if (!(valid[i >> 5] & BIT(i & 31)))
+			return false;
+	}
+
+	memcpy(data, &aux->dpcd.data[r][o], size);
+	return true;
+}
+
+static void
+nvkm_i2c_aux_dpcd_put(struct nvkm_i2c_aux *aux, int r, int hpd, u32 addr,
+		      u8 *data, u32 size)
+{
+	u32 *valid = aux->dpcd.valid[r];
+	u32 i, o = addr - nvkm_i2c_aux_dpcd_base[r];
+
+	/* HPD may have fired while the transaction was in flight. */
+	if (hpd != atomic_read(&aux->hpd))
+		return;
+
+	memcpy(&aux->dpcd.data[r][o], data, size);
+	for (i = o; i < o + size; i++)
+		valid[i >> 5] |= BIT(i & 31);
+}
+
 int
 nvkm_i2c_aux_xfer(struct nvkm_i2c_aux *aux, bool retry, u8 type,
 		  u32 addr, u8 *data, u8 *size)
@@ -137,9 +211,81 @@ nvkm_i2c_aux_xfer(struct nvkm_i2c_aux *aux, bool retry, u8 type,
 		AUX_ERR(aux, "address-only transaction dropped");
 		return -ENOSYS;
 	}
+	aux->stats.chunk++;
 	return aux->func->xfer(aux, retry, type, addr, data, size);
 }
 
+/*******************************************************************************
+ * Native AUX transfers of any length, split into the 16-byte transactions
+ * the hardware supports.  Short replies continue from where the sink left
+ * off, and replies with no data at all are retried a limited number of times.
+ ******************************************************************************/
+static int
+nvkm_i2c_aux_chunk(struct nvkm_i2c_aux *aux, u8 type, u32 addr,
+		   u8 *data, u32 size)
+{
+	int ret, retries = 0;
+
+	aux->stats.xfer++;
+	while (size) {
+		u8 cnt = min_t(u32, size, 16);
+
+		ret = nvkm_i2c_aux_xfer(aux, true, type, addr, data, &cnt);
+		if (ret)
+			return ret;
+
+		if (!cnt || cnt > min_t(u32, size, 16)) {
+			if (cnt || ++retries == 32) {
+				AUX_TRACE(aux, "%d: %05x no data", type, addr);
+				return -EIO;
+			}
+			aux->stats.retry++;
+			continue;
+		}
+
+		retries = 0;
+		addr += cnt;
+		data += cnt;
+		size -= cnt;
+	}
+
+	return 0;
+}
+
+/* Only these go through the DPCD cache, nvkm_i2c_aux_xfer() is left raw
+ * for drm_dp_aux, which has to see what the sink says now.
+ */
+int
+nvkm_i2c_aux_rd(struct nvkm_i2c_aux *aux, u32 addr, u8 *data, u32 size)
+{
+	int ret, r = -1, hpd = 0;
+
+	if (size)
+		r = nvkm_i2c_aux_dpcd_range(aux, addr, size);
+	if (r >= 0) {
+		if (nvkm_i2c_aux_dpcd_get(aux, r, addr, data, size)) {
+			aux->stats.hit++;
+			return 0;
+		}
+		aux->stats.miss++;
+		hpd = aux->dpcd.hpd;
+	}
+
+	ret = nvkm_i2c_aux_chunk(aux, 9, addr, data, size);
+	if (ret == 0 && r >= 0)
+		nvkm_i2c_aux_dpcd_put(aux, r, hpd, addr, data, size);
+	return ret;
+}
+
+int
+nvkm_i2c_aux_wr(struct nvkm_i2c_aux *aux, u32 addr, u8 *data, u32 size)
+{
+	/* Shouldn't happen, but play it safe. */
+	if (nvkm_i2c_aux_dpcd_range(aux, addr, size) >= 0)
+		atomic_inc(&aux->hpd);
+	return nvkm_i2c_aux_chunk(aux, 8, addr, data, size);
+}
+
 int
 nvkm_i2c_aux_lnk_ctl(struct nvkm_i2c_aux *aux, int nr, int bw, bool ef)
 {
@@ -176,7 +322,14 @@ nvkm_i2c_aux_fini(struct nvkm_i2c_aux *aux)
 	AUX_TRACE(aux, "fini");
 	mutex_lock(&aux->mutex);
 	aux->enabled = false;
+	/* Sink could be swapped while we're suspended. */
+	atomic_inc(&aux->hpd);
 	mutex_unlock(&aux->mutex);
+
+	AUX_DBG(aux, "%llu xfers in %llu transactions, %llu retries, "
+		     "dpcd cache %llu/%llu hit/miss",
+		aux->stats.xfer, aux->stats.chunk, aux->stats.retry,
+		aux->stats.hit, aux->stats.miss);
 }
 
 int
@@ -189,6 +342,7 @@ nvkm_i2c_aux_ctor(const struct nvkm_i2c_aux_func *func,
 	aux->func = func;
 	aux->pad = pad;
 	aux->id = id;
+	aux->dpcd.enable = nvkm_boolopt(device->cfgopt, "NvAuxCache", true);
 	mutex_init(&aux->mutex);
 	list_add_tail(&aux->head, &pad->i2c->aux);
 	AUX_TRACE(aux, "ctor");
@@ -145,6 +145,9 @@ nvkm_i2c_intr(struct nvkm_subdev *subdev)
 		if (lo & aux->intr) mask |= NVKM_I2C_UNPLUG;
 		if (rq & aux->intr) mask |= NVKM_I2C_IRQ;
 		if (tx & aux->intr) mask |= NVKM_I2C_DONE;
+		/* IRQ_HPD may mean the sink's capabilities changed. */
+		if (mask & (NVKM_I2C_PLUG | NVKM_I2C_UNPLUG | NVKM_I2C_IRQ))
+			atomic_inc(&aux->hpd);
 		if (mask) {
 			struct nvkm_i2c_ntfy_rep rep = {
 				.mask = mask,
@@ -55,7 +55,7 @@ nvkm_i2c_sense_sda(struct nvkm_i2c_bus *bus)
 static void
 nvkm_i2c_delay(struct nvkm_i2c_bus *bus, u32 nsec)
 {
-	udelay((nsec + 500) / 1000);
+	ndelay(nsec);
 }
 
 static bool
@@ -104,110 +104,316 @@ i2c_stop(struct nvkm_i2c_bus *bus)
 	nvkm_i2c_delay(bus, T_HOLD);
 }
 
-static int
-i2c_bitw(struct nvkm_i2c_bus *bus, int sda)
+/*******************************************************************************
+ * Transactions are compiled into a list of line operations up-front, which
+ * lets us drop writes that wouldn't change the state of a line (ie. releasing
+ * SDA before every bit of a read), and fold their delays into a single wait.
+ *
+ * Sensor polling repeats the same few transactions over and over, so the last
+ * few compiled are kept around on the bus, most recently used first, and
+ * reused if the next one matches.  A miss recompiles into the least recently
+ * used one's allocation, if that's large enough.
+ ******************************************************************************/
+enum {
+	I2C_BIT_START,
+	I2C_BIT_SCL,
+	I2C_BIT_SDA,
+	I2C_BIT_RAISE,
+	I2C_BIT_READ,
+	I2C_BIT_ACK,
+};
+
+struct nvkm_i2c_bit_op {
+	u8  type;
+	u8  arg;
+	u16 msg;
+	u16 byte;
+	u32 nsec;
+};
+
+struct nvkm_i2c_bit {
+	size_t size;
+	int num;
+	struct nvkm_i2c_bit_msg {
+		u16 addr;
+		u16 flags;
+		u16 len;
+	} *msg;
+	u8 *data;
+	int data_nr;
+
+	struct nvkm_i2c_bit_op *op;
+	int nr;
+
+	/* Line state driven by the ops emitted so far. */
+	u8 scl;
+	u8 sda;
+};
+
+static struct nvkm_i2c_bit_op *
+i2c_bit_emit(struct nvkm_i2c_bit *bit, u8 type, u8 arg, u32 nsec)
 {
-	nvkm_i2c_drive_sda(bus, sda);
-	nvkm_i2c_delay(bus, T_RISEFALL);
-
-	if (!nvkm_i2c_raise_scl(bus))
-		return -ETIMEDOUT;
-	nvkm_i2c_delay(bus, T_HOLD);
+	struct nvkm_i2c_bit_op *op;
+
+	switch (type) {
+	case I2C_BIT_START:
+		bit->scl = 0;
+		bit->sda = 0;
+		break;
+	case I2C_BIT_SCL:
+		if (bit->scl == arg)
+			goto merge;
+		bit->scl = arg;
+		break;
+	case I2C_BIT_SDA:
+		if (bit->sda == arg)
+			goto merge;
+		bit->sda = arg;
+		break;
+	case I2C_BIT_RAISE:
+		bit->scl = 1;
+		break;
+	default:
+		break;
+	}
 
-	nvkm_i2c_drive_scl(bus, 0);
-	nvkm_i2c_delay(bus, T_HOLD);
-	return 0;
+	op = &bit->op[bit->nr++];
+	op->type = type;
+	op->arg = arg;
+	op->nsec = nsec;
+	return op;
+
+merge:
+	/* Every transaction starts with I2C_BIT_START, there's always an
+	 * earlier op to extend.
+	 */
+	bit->op[bit->nr - 1].nsec += nsec;
+	return NULL;
 }
 
-static int
-i2c_bitr(struct nvkm_i2c_bus *bus)
+static void
+i2c_bit_bitw(struct nvkm_i2c_bit *bit, int sda)
 {
-	int sda;
+	i2c_bit_emit(bit, I2C_BIT_SDA, sda, T_RISEFALL);
+	i2c_bit_emit(bit, I2C_BIT_RAISE, 0, T_HOLD);
+	i2c_bit_emit(bit, I2C_BIT_SCL, 0, T_HOLD);
+}
 
-	nvkm_i2c_drive_sda(bus, 1);
-	nvkm_i2c_delay(bus, T_RISEFALL);
+static struct nvkm_i2c_bit_op *
+i2c_bit_bitr(struct nvkm_i2c_bit *bit, u8 type)
+{
+	struct nvkm_i2c_bit_op *op;
 
-	if (!nvkm_i2c_raise_scl(bus))
-		return -ETIMEDOUT;
-	nvkm_i2c_delay(bus, T_HOLD);
+	i2c_bit_emit(bit, I2C_BIT_SDA, 1, T_RISEFALL);
+	i2c_bit_emit(bit, I2C_BIT_RAISE, 0, T_HOLD);
+	op = i2c_bit_emit(bit, type, 0, 0);
+	i2c_bit_emit(bit, I2C_BIT_SCL, 0, T_HOLD);
+	return op;
+}
 
-	sda = nvkm_i2c_sense_sda(bus);
+static void
+i2c_bit_put_byte(struct nvkm_i2c_bit *bit, u8 byte)
+{
+	int i;
 
-	nvkm_i2c_drive_scl(bus, 0);
-	nvkm_i2c_delay(bus, T_HOLD);
-	return sda;
+	for (i = 7; i >= 0; i--)
+		i2c_bit_bitw(bit, !!(byte & (1 << i)));
+	i2c_bit_bitr(bit, I2C_BIT_ACK);
 }
 
-static int
-nvkm_i2c_get_byte(struct nvkm_i2c_bus *bus, u8 *byte, bool last)
+static void
+i2c_bit_get_byte(struct nvkm_i2c_bit *bit, int msg, int byte, bool last)
 {
-	int i, bit;
+	struct nvkm_i2c_bit_op *op;
+	int i;
 
-	*byte = 0;
 	for (i = 7; i >= 0; i--) {
-		bit = i2c_bitr(bus);
-		if (bit < 0)
-			return bit;
-		*byte |= bit << i;
+		op = i2c_bit_bitr(bit, I2C_BIT_READ);
+		op->arg = i;
+		op->msg = msg;
+		op->byte = byte;
+	}
+
+	i2c_bit_bitw(bit, last ? 1 : 0);
+}
+
+static bool
+i2c_bit_match(struct nvkm_i2c_bit *bit, struct i2c_msg *msgs, int num)
+{
+	u8 *data = bit->data;
+	int i;
+
+	if (bit->num != num)
+		return false;
+
+	for (i = 0; i < num; i++) {
+		struct nvkm_i2c_bit_msg *shape = &bit->msg[i];
+		struct i2c_msg *msg = &msgs[i];
+
+		if (shape->addr != msg->addr ||
+		    shape->flags != msg->flags ||
+		    shape->len != msg->len)
+			return false;
+
+		if (!(msg->flags & I2C_M_RD)) {
+			if (memcmp(data, msg->buf, msg->len))
+				return false;
+			data += msg->len;
+		}
 	}
 
-	return i2c_bitw(bus, last ? 1 : 0);
+	return true;
+}
+
+static struct nvkm_i2c_bit *
+i2c_bit_compile(struct nvkm_i2c_bit *bit, struct i2c_msg *msgs, int num)
+{
+	size_t size, ops = 0, data_nr = 0;
+	u8 *data;
+	int i, j;
+
+	/* Worst case, nothing gets merged: a start, then 8 bits and an
+	 * ACK of four ops each for the address and every data byte.
+	 */
+	for (i = 0; i < num; i++) {
+		ops += 1 + (msgs[i].len + 1) * 9 * 4;
+		if (!(msgs[i].flags & I2C_M_RD))
+			data_nr += msgs[i].len;
+	}
+
+	size = sizeof(*bit) + ops * sizeof(*bit->op) +
+	       num * sizeof(*bit->msg) + data_nr;
+	if (!bit || bit->size < size) {
+		kvfree(bit);
+		if (!(bit = kvmalloc(size, GFP_KERNEL)))
+			return NULL;
+	} else {
+		size = bit->size;
+	}
+
+	memset(bit, 0x00, sizeof(*bit));
+	bit->size = size;
+	bit->op = (void *)(bit + 1);
+	bit->msg = (void *)(bit->op + ops);
+	bit->data = data = (void *)(bit->msg + num);
+	bit->data_nr = data_nr;
+	bit->num = num;
+
+	for (i = 0; i < num; i++) {
+		struct i2c_msg *msg = &msgs[i];
+
+		bit->msg[i].addr = msg->addr;
+		bit->msg[i].flags = msg->flags;
+		bit->msg[i].len = msg->len;
+
+		i2c_bit_emit(bit, I2C_BIT_START, 0, 0);
+		i2c_bit_put_byte(bit, (msg->addr << 1) |
+				      !!(msg->flags & I2C_M_RD));
+
+		for (j = 0; j < msg->len; j++) {
+			if (msg->flags & I2C_M_RD) {
+				i2c_bit_get_byte(bit, i, j, j == msg->len - 1);
+			} else {
+				i2c_bit_put_byte(bit, msg->buf[j]);
+				*data++ = msg->buf[j];
+			}
+		}
+	}
+
+	return bit;
 }
 
 static int
-nvkm_i2c_put_byte(struct nvkm_i2c_bus *bus, u8 byte)
+i2c_bit_exec(struct nvkm_i2c_bus *bus, struct nvkm_i2c_bit *bit,
+	     struct i2c_msg *msgs)
 {
-	int i, ret;
-	for (i = 7; i >= 0; i--) {
-		ret = i2c_bitw(bus, !!(byte & (1 << i)));
-		if (ret < 0)
-			return ret;
+	struct nvkm_i2c_bit_op *op = bit->op, *end = bit->op + bit->nr;
+	int ret = 0;
+
+	for (; !ret && op < end; op++) {
+		switch (op->type) {
+		case I2C_BIT_START:
+			ret = i2c_start(bus);
+			break;
+		case I2C_BIT_SCL:
+			nvkm_i2c_drive_scl(bus, op->arg);
+			break;
+		case I2C_BIT_SDA:
+			nvkm_i2c_drive_sda(bus, op->arg);
+			break;
+		case I2C_BIT_RAISE:
+			if (!nvkm_i2c_raise_scl(bus))
+				ret = -ETIMEDOUT;
+			break;
+		case I2C_BIT_READ:
+			if (op->arg == 7)
+				msgs[op->msg].buf[op->byte] = 0;
+			if (nvkm_i2c_sense_sda(bus))
+				msgs[op->msg].buf[op->byte] |= 1 << op->arg;
+			break;
+		case I2C_BIT_ACK:
+			if (nvkm_i2c_sense_sda(bus)) /* nack */
+				ret = -EIO;
+			break;
+		default:
+			WARN_ON(1);
+			ret = -EINVAL;
+			break;
+		}
+
+		if (op->nsec)
+			nvkm_i2c_delay(bus, op->nsec);
 	}
 
-	ret = i2c_bitr(bus);
-	if (ret == 1) /* nack */
-		ret = -EIO;
+	i2c_stop(bus);
 	return ret;
 }
 
-static int
-i2c_addr(struct nvkm_i2c_bus *bus, struct i2c_msg *msg)
+void
+nvkm_i2c_bit_fini(struct nvkm_i2c_bus *bus)
 {
-	u32 addr = msg->addr << 1;
-	if (msg->flags & I2C_M_RD)
-		addr |= 1;
-	return nvkm_i2c_put_byte(bus, addr);
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(bus->bit); i++) {
+		kvfree(bus->bit[i]);
+		bus->bit[i] = NULL;
+	}
 }
 
 int
 nvkm_i2c_bit_xfer(struct nvkm_i2c_bus *bus, struct i2c_msg *msgs, int num)
 {
-	struct i2c_msg *msg = msgs;
-	int ret = 0, mcnt = num;
-
-	while (!ret && mcnt--) {
-		u8 remaining = msg->len;
-		u8 *ptr = msg->buf;
+	struct nvkm_i2c_bit *bit;
+	int ret, i;
 
-		ret = i2c_start(bus);
-		if (ret == 0)
-			ret = i2c_addr(bus, msg);
+	for (i = 0; i < ARRAY_SIZE(bus->bit); i++) {
+		if (bus->bit[i] && i2c_bit_match(bus->bit[i], msgs, num))
+			break;
+	}
 
-		if (msg->flags & I2C_M_RD) {
-			while (!ret && remaining--)
-				ret = nvkm_i2c_get_byte(bus, ptr++, !remaining);
-		} else {
-			while (!ret && remaining--)
-				ret = nvkm_i2c_put_byte(bus, *ptr++);
+	if (i == ARRAY_SIZE(bus->bit)) {
+		i--;
+		if (!(bit = i2c_bit_compile(bus->bit[i], msgs, num))) {
+			bus->bit[i] = NULL;
+			return -ENOMEM;
 		}
-
-		msg++;
+		BUS_TRACE(bus, "%d msgs compiled to %d ops", num, bit->nr);
+	} else {
+		bit = bus->bit[i];
 	}
 
-	i2c_stop(bus);
+	memmove(&bus->bit[1], &bus->bit[0], i * sizeof(bus->bit[0]));
+	bus->bit[0] = bit;
+
+	ret = i2c_bit_exec(bus, bit, msgs);
 	return (ret < 0) ? ret : num;
 }
 #else
+void
+nvkm_i2c_bit_fini(struct nvkm_i2c_bus *bus)
+{
+}
+
 int
 nvkm_i2c_bit_xfer(struct nvkm_i2c_bus *bus, struct i2c_msg *msgs, int num)
 {
@@ -199,6 +199,7 @@ nvkm_i2c_bus_del(struct nvkm_i2c_bus **pbus)
 		list_del(&bus->head);
 		i2c_del_adapter(&bus->i2c);
 		kfree(bus->i2c.algo_data);
+		nvkm_i2c_bit_fini(bus);
 		kfree(*pbus);
 		*pbus = NULL;
 	}
@@ -21,6 +21,7 @@ void nvkm_i2c_bus_init(struct nvkm_i2c_bus *);
 void nvkm_i2c_bus_fini(struct nvkm_i2c_bus *);
 
 int nvkm_i2c_bit_xfer(struct nvkm_i2c_bus *, struct i2c_msg *, int);
+void nvkm_i2c_bit_fini(struct nvkm_i2c_bus *);
 
 int nv04_i2c_bus_new(struct nvkm_i2c_pad *, int, u8, u8,
 		     struct nvkm_i2c_bus **);
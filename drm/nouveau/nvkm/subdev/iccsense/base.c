@@ -23,6 +23,7 @@
  */
 #include "priv.h"
 
+#include <core/option.h>
 #include <subdev/bios.h>
 #include <subdev/bios/extdev.h>
 #include <subdev/bios/iccsense.h>
@@ -46,54 +47,61 @@ nvkm_iccsense_validate_device(struct i2c_adapter *i2c, u8 addr,
 }
 
 static int
-nvkm_iccsense_poll_lane(struct i2c_adapter *i2c, u8 addr, u8 shunt_reg,
-			u8 shunt_shift, u8 bus_reg, u8 bus_shift, u8 shunt,
-			u16 lsb)
+nvkm_iccsense_poll_lane(struct nvkm_iccsense_rail *rail, int vshunt, int vbus)
 {
-	int vshunt = nv_rd16i2cr(i2c, addr, shunt_reg);
-	int vbus = nv_rd16i2cr(i2c, addr, bus_reg);
-
 	if (vshunt < 0 || vbus < 0)
 		return -EINVAL;
 
-	vshunt >>= shunt_shift;
-	vbus >>= bus_shift;
+	vshunt >>= rail->shunt_shift;
+	vbus >>= rail->bus_shift;
 
-	return vbus * vshunt * lsb / shunt;
+	return vbus * vshunt * rail->lsb / rail->mohm;
 }
 
 static int
-nvkm_iccsense_ina2x9_read(struct nvkm_iccsense *iccsense,
-                          struct nvkm_iccsense_rail *rail,
-			  u8 shunt_reg, u8 bus_reg)
+nvkm_iccsense_rail_read(struct nvkm_iccsense *iccsense,
+			struct nvkm_iccsense_rail *rail)
 {
-	return nvkm_iccsense_poll_lane(rail->sensor->i2c, rail->sensor->addr,
-				       shunt_reg, 0, bus_reg, 3, rail->mohm,
-				       10 * 4);
-}
+	struct i2c_adapter *i2c = rail->sensor->i2c;
+	u8 addr = rail->sensor->addr;
 
-static int
-nvkm_iccsense_ina209_read(struct nvkm_iccsense *iccsense,
-			  struct nvkm_iccsense_rail *rail)
-{
-	return nvkm_iccsense_ina2x9_read(iccsense, rail, 3, 4);
+	return nvkm_iccsense_poll_lane(rail,
+				       nv_rd16i2cr(i2c, addr, rail->shunt_reg),
+				       nv_rd16i2cr(i2c, addr, rail->bus_reg));
 }
 
-static int
-nvkm_iccsense_ina219_read(struct nvkm_iccsense *iccsense,
-			  struct nvkm_iccsense_rail *rail)
+int
+nvkm_iccsense_rail_type(struct nvkm_iccsense_rail *rail,
+			enum nvbios_extdev_type type)
 {
-	return nvkm_iccsense_ina2x9_read(iccsense, rail, 1, 2);
-}
+	switch (type) {
+	case NVBIOS_EXTDEV_INA209:
+		rail->shunt_reg = 3;
+		rail->bus_reg = 4;
+		rail->shunt_shift = 0;
+		rail->bus_shift = 3;
+		rail->lsb = 10 * 4;
+		break;
+	case NVBIOS_EXTDEV_INA219:
+		rail->shunt_reg = 1;
+		rail->bus_reg = 2;
+		rail->shunt_shift = 0;
+		rail->bus_shift = 3;
+		rail->lsb = 10 * 4;
+		break;
+	case NVBIOS_EXTDEV_INA3221:
+		rail->shunt_reg = 1 + (rail->idx * 2);
+		rail->bus_reg = 2 + (rail->idx * 2);
+		rail->shunt_shift = 3;
+		rail->bus_shift = 3;
+		rail->lsb = 40 * 8;
+		break;
+	default:
+		return -EINVAL;
+	}
 
-static int
-nvkm_iccsense_ina3221_read(struct nvkm_iccsense *iccsense,
-			   struct nvkm_iccsense_rail *rail)
-{
-	return nvkm_iccsense_poll_lane(rail->sensor->i2c, rail->sensor->addr,
-				       1 + (rail->idx * 2), 3,
-				       2 + (rail->idx * 2), 3, rail->mohm,
-				       40 * 8);
+	rail->read = nvkm_iccsense_rail_read;
+	return 0;
 }
 
 static void
@@ -105,26 +113,184 @@ nvkm_iccsense_sensor_config(struct nvkm_iccsense *iccsense,
 	nv_wr16i2cr(sensor->i2c, sensor->addr, 0x00, sensor->config);
 }
 
+/* Read the shunt and bus voltage of every rail behind an adapter with a
+ * single transfer, rather than taking the bus twice per rail.
+ */
+static void
+nvkm_iccsense_sample_bus(struct nvkm_iccsense *iccsense,
+			 struct i2c_adapter *i2c)
+{
+	struct i2c_msg *msgs = iccsense->sample.msgs;
+	struct nvkm_iccsense_rail *rail;
+	int nr = 0, ret;
+
+	list_for_each_entry(rail, &iccsense->rails, head) {
+		if (rail->sensor->i2c != i2c)
+			continue;
+
+		msgs[nr++] = (struct i2c_msg) {
+			.addr = rail->sensor->addr, .flags = 0,
+			.len = 1, .buf = &rail->shunt_reg,
+		};
+		msgs[nr++] = (struct i2c_msg) {
+			.addr = rail->sensor->addr, .flags = I2C_M_RD,
+			.len = 2, .buf = rail->data[0],
+		};
+		msgs[nr++] = (struct i2c_msg) {
+			.addr = rail->sensor->addr, .flags = 0,
+			.len = 1, .buf = &rail->bus_reg,
+		};
+		msgs[nr++] = (struct i2c_msg) {
+			.addr = rail->sensor->addr, .flags = I2C_M_RD,
+			.len = 2, .buf = rail->data[1],
+		};
+	}
+
+	ret = i2c_transfer(i2c, msgs, nr);
+
+	list_for_each_entry(rail, &iccsense->rails, head) {
+		if (rail->sensor->i2c != i2c)
+			continue;
+
+		if (ret != nr) {
+			rail->power = -EIO;
+			continue;
+		}
+
+		rail->power = nvkm_iccsense_poll_lane(rail,
+			rail->data[0][0] << 8 | rail->data[0][1],
+			rail->data[1][0] << 8 | rail->data[1][1]);
+	}
+}
+
+/* must be called with sample.mutex held */
+static int
+nvkm_iccsense_sample(struct nvkm_iccsense *iccsense)
+{
+	struct nvkm_iccsense_sample *sample;
+	struct nvkm_iccsense_rail *rail, *prev;
+	int power = 0;
+
+	if (!iccsense->sample.msgs && !list_empty(&iccsense->rails)) {
+		int nr = 0;
+		list_for_each_entry(rail, &iccsense->rails, head)
+			nr += 4;
+		iccsense->sample.msgs = kcalloc(nr, sizeof(struct i2c_msg),
+						GFP_KERNEL);
+		if (!iccsense->sample.msgs)
+			return -ENOMEM;
+	}
+
+	list_for_each_entry(rail, &iccsense->rails, head) {
+		if (!rail->read) {
+			power = -ENODEV;
+			goto done;
+		}
+
+		/* Each adapter is handled when its first rail is found. */
+		list_for_each_entry(prev, &iccsense->rails, head) {
+			if (prev == rail ||
+			    prev->sensor->i2c == rail->sensor->i2c)
+				break;
+		}
+
+		if (prev == rail)
+			nvkm_iccsense_sample_bus(iccsense, rail->sensor->i2c);
+	}
+
+	list_for_each_entry(rail, &iccsense->rails, head) {
+		if (rail->power < 0) {
+			power = rail->power;
+			break;
+		}
+		power += rail->power;
+	}
+
+done:
+	/* A failed read isn't a sample, the next query has to try again. */
+	if (power < 0)
+		return power;
+
+	sample = &iccsense->sample.hist[iccsense->sample.count++ %
+					NVKM_ICCSENSE_HISTORY];
+	sample->time = ktime_to_ns(ktime_get());
+	sample->power = power;
+	return power;
+}
+
 int
 nvkm_iccsense_read_all(struct nvkm_iccsense *iccsense)
 {
-	int result = 0;
-	struct nvkm_iccsense_rail *rail;
+	struct nvkm_iccsense_sample *sample;
+	int power;
 
 	if (!iccsense)
 		return -EINVAL;
 
-	list_for_each_entry(rail, &iccsense->rails, head) {
-		int res;
-		if (!rail->read)
-			return -ENODEV;
-
-		res = rail->read(iccsense, rail);
-		if (res < 0)
-			return res;
-		result += res;
+	mutex_lock(&iccsense->sample.mutex);
+	if (iccsense->sample.stale && iccsense->sample.count) {
+		sample = &iccsense->sample.hist[(iccsense->sample.count - 1) %
+						NVKM_ICCSENSE_HISTORY];
+		if (ktime_to_ns(ktime_get()) - sample->time <=
+		    iccsense->sample.stale * 1000000ULL) {
+			iccsense->sample.hits++;
+			power = sample->power;
+			goto done;
+		}
+	}
+
+	iccsense->sample.misses++;
+	power = nvkm_iccsense_sample(iccsense);
+done:
+	mutex_unlock(&iccsense->sample.mutex);
+	return power;
+}
+
+/* Copy out up to 'nr' of the most recent samples, newest first. */
+int
+nvkm_iccsense_history(struct nvkm_iccsense *iccsense,
+		      struct nvkm_iccsense_sample *hist, int nr)
+{
+	int i;
+
+	if (!iccsense)
+		return -EINVAL;
+
+	mutex_lock(&iccsense->sample.mutex);
+	nr = min_t(u32, nr, min_t(u32, iccsense->sample.count,
+				       NVKM_ICCSENSE_HISTORY));
+	for (i = 0; i < nr; i++) {
+		hist[i] = iccsense->sample.hist[(iccsense->sample.count - 1 - i) %
+						NVKM_ICCSENSE_HISTORY];
+	}
+	mutex_unlock(&iccsense->sample.mutex);
+	return nr;
+}
+
+static void
+nvkm_iccsense_sample_work(struct work_struct *work)
+{
+	struct nvkm_iccsense *iccsense =
+		container_of(work, typeof(*iccsense), sample.work);
+	struct nvkm_timer *tmr = iccsense->subdev.device->timer;
+
+	mutex_lock(&iccsense->sample.mutex);
+	if (iccsense->sample.enabled) {
+		nvkm_iccsense_sample(iccsense);
+		nvkm_timer_alarm(tmr, iccsense->sample.period * 1000000,
+				 &iccsense->sample.alarm);
 	}
-	return result;
+	mutex_unlock(&iccsense->sample.mutex);
+}
+
+static void
+nvkm_iccsense_sample_alarm(struct nvkm_alarm *alarm)
+{
+	struct nvkm_iccsense *iccsense =
+		container_of(alarm, typeof(*iccsense), sample.alarm);
+
+	/* i2c is far too slow to be done from the timer interrupt. */
+	schedule_work(&iccsense->sample.work);
 }
 
 static void *
@@ -134,6 +300,9 @@ nvkm_iccsense_dtor(struct nvkm_subdev *subdev)
 	struct nvkm_iccsense_sensor *sensor, *tmps;
 	struct nvkm_iccsense_rail *rail, *tmpr;
 
+	cancel_work_sync(&iccsense->sample.work);
+	kfree(iccsense->sample.msgs);
+
 	list_for_each_entry_safe(sensor, tmps, &iccsense->sensors, head) {
 		list_del(&sensor->head);
 		kfree(sensor);
@@ -259,34 +428,22 @@ nvkm_iccsense_oneinit(struct nvkm_subdev *subdev)
 		for (r = 0; r < pwr_rail->resistor_count; ++r) {
 			struct nvkm_iccsense_rail *rail;
 			struct pwr_rail_resistor_t *res = &pwr_rail->resistors[r];
-			int (*read)(struct nvkm_iccsense *,
-				    struct nvkm_iccsense_rail *);
 
 			if (!res->mohm || !res->enabled)
 				continue;
 
-			switch (sensor->type) {
-			case NVBIOS_EXTDEV_INA209:
-				read = nvkm_iccsense_ina209_read;
-				break;
-			case NVBIOS_EXTDEV_INA219:
-				read = nvkm_iccsense_ina219_read;
-				break;
-			case NVBIOS_EXTDEV_INA3221:
-				read = nvkm_iccsense_ina3221_read;
-				break;
-			default:
-				continue;
-			}
-
-			rail = kmalloc(sizeof(*rail), GFP_KERNEL);
+			rail = kzalloc(sizeof(*rail), GFP_KERNEL);
 			if (!rail)
 				return -ENOMEM;
 
-			rail->read = read;
 			rail->sensor = sensor;
 			rail->idx = r;
 			rail->mohm = res->mohm;
+			if (nvkm_iccsense_rail_type(rail, sensor->type)) {
+				kfree(rail);
+				continue;
+			}
+
 			nvkm_debug(subdev, "create rail for extdev %i: { idx: %i, mohm: %i }\n", pwr_rail->extdev_id, r, rail->mohm);
 			list_add_tail(&rail->head, &iccsense->rails);
 		}
@@ -294,13 +451,44 @@ nvkm_iccsense_oneinit(struct nvkm_subdev *subdev)
 	return 0;
 }
 
+static int
+nvkm_iccsense_fini(struct nvkm_subdev *subdev, bool suspend)
+{
+	struct nvkm_iccsense *iccsense = nvkm_iccsense(subdev);
+	struct nvkm_timer *tmr = subdev->device->timer;
+
+	/* Disarm before the work's cancelled, it can't be re-armed after. */
+	mutex_lock(&iccsense->sample.mutex);
+	iccsense->sample.enabled = false;
+	if (iccsense->sample.period)
+		nvkm_timer_alarm(tmr, 0, &iccsense->sample.alarm);
+	mutex_unlock(&iccsense->sample.mutex);
+	cancel_work_sync(&iccsense->sample.work);
+
+	nvkm_debug(subdev, "%u samples, %llu/%llu queries cached/uncached\n",
+		   iccsense->sample.count, iccsense->sample.hits,
+		   iccsense->sample.misses);
+	return 0;
+}
+
 static int
 nvkm_iccsense_init(struct nvkm_subdev *subdev)
 {
 	struct nvkm_iccsense *iccsense = nvkm_iccsense(subdev);
+	struct nvkm_timer *tmr = subdev->device->timer;
 	struct nvkm_iccsense_sensor *sensor;
 	list_for_each_entry(sensor, &iccsense->sensors, head)
 		nvkm_iccsense_sensor_config(iccsense, sensor);
+
+	/* Sensors have just been reconfigured, forget what they said. */
+	mutex_lock(&iccsense->sample.mutex);
+	iccsense->sample.count = 0;
+	if (iccsense->sample.period && !list_empty(&iccsense->rails)) {
+		iccsense->sample.enabled = true;
+		nvkm_timer_alarm(tmr, iccsense->sample.period * 1000000,
+				 &iccsense->sample.alarm);
+	}
+	mutex_unlock(&iccsense->sample.mutex);
 	return 0;
 }
 
@@ -308,6 +496,7 @@ static const struct nvkm_subdev_func
 iccsense_func = {
 	.oneinit = nvkm_iccsense_oneinit,
 	.init = nvkm_iccsense_init,
+	.fini = nvkm_iccsense_fini,
 	.dtor = nvkm_iccsense_dtor,
 };
 
@@ -316,6 +505,17 @@ nvkm_iccsense_ctor(struct nvkm_device *device, int index,
 		   struct nvkm_iccsense *iccsense)
 {
 	nvkm_subdev_ctor(&iccsense_func, device, index, &iccsense->subdev);
+
+	/* The timer can't schedule alarms more than ~4s out. */
+	iccsense->sample.period =
+		clamp_t(long, nvkm_longopt(device->cfgopt, "NvIccSensePeriod",
+					   0), 0, 4000);
+	iccsense->sample.stale =
+		max_t(long, nvkm_longopt(device->cfgopt, "NvIccSenseStale",
+					 0), 0);
+	mutex_init(&iccsense->sample.mutex);
+	nvkm_alarm_init(&iccsense->sample.alarm, nvkm_iccsense_sample_alarm);
+	INIT_WORK(&iccsense->sample.work, nvkm_iccsense_sample_work);
 }
 
 int
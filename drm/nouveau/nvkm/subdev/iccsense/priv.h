@@ -20,8 +20,18 @@ struct nvkm_iccsense_rail {
 	struct nvkm_iccsense_sensor *sensor;
 	u8 idx;
 	u8 mohm;
+
+	u8  shunt_reg;
+	u8  shunt_shift;
+	u8  bus_reg;
+	u8  bus_shift;
+	u16 lsb;
+	u8  data[2][2];
+	int power;
 };
 
+int nvkm_iccsense_rail_type(struct nvkm_iccsense_rail *,
+			    enum nvbios_extdev_type);
 void nvkm_iccsense_ctor(struct nvkm_device *, int, struct nvkm_iccsense *);
 int nvkm_iccsense_new_(struct nvkm_device *, int, struct nvkm_iccsense **);
 #endif
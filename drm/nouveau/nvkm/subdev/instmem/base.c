@@ -34,11 +34,9 @@ nvkm_instobj_load(struct nvkm_instobj *iobj)
 	struct nvkm_memory *memory = &iobj->memory;
 	const u64 size = nvkm_memory_size(memory);
 	void __iomem *map;
-	int i;
 
 	if (!(map = nvkm_kmap(memory))) {
-		for (i = 0; i < size; i += 4)
-			nvkm_wo32(memory, i, iobj->suspend[i / 4]);
+		nvkm_memory_wr(memory, 0, iobj->suspend, size);
 	} else {
 		memcpy_toio(map, iobj->suspend, size);
 	}
@@ -54,15 +52,15 @@ nvkm_instobj_save(struct nvkm_instobj *iobj)
 	struct nvkm_memory *memory = &iobj->memory;
 	const u64 size = nvkm_memory_size(memory);
 	void __iomem *map;
-	int i;
 
-	iobj->suspend = kvmalloc(size, GFP_KERNEL);
-	if (!iobj->suspend)
-		return -ENOMEM;
+	if (!iobj->suspend) {
+		iobj->suspend = kvmalloc(size, GFP_KERNEL);
+		if (!iobj->suspend)
+			return -ENOMEM;
+	}
 
 	if (!(map = nvkm_kmap(memory))) {
-		for (i = 0; i < size; i += 4)
-			iobj->suspend[i / 4] = nvkm_ro32(memory, i);
+		nvkm_memory_rd(memory, 0, iobj->suspend, size);
 	} else {
 		memcpy_fromio(iobj->suspend, map, size);
 	}
@@ -76,13 +74,16 @@ nvkm_instobj_dtor(struct nvkm_instmem *imem, struct nvkm_instobj *iobj)
 	spin_lock(&imem->lock);
 	list_del(&iobj->head);
 	spin_unlock(&imem->lock);
+	kvfree(iobj->suspend);
 }
 
 void
 nvkm_instobj_ctor(const struct nvkm_memory_func *func,
-		  struct nvkm_instmem *imem, struct nvkm_instobj *iobj)
+		  struct nvkm_instmem *imem, enum nvkm_memory_target target,
+		  struct nvkm_instobj *iobj)
 {
 	nvkm_memory_ctor(func, &iobj->memory);
+	iobj->preserve = target != NVKM_MEM_TARGET_INST_SR_LOST;
 	iobj->suspend = NULL;
 	spin_lock(&imem->lock);
 	list_add_tail(&iobj->head, &imem->list);
@@ -91,14 +92,13 @@ nvkm_instobj_ctor(const struct nvkm_memory_func *func,
 
 int
 nvkm_instobj_new(struct nvkm_instmem *imem, u32 size, u32 align, bool zero,
-		 struct nvkm_memory **pmemory)
+		 enum nvkm_memory_target target, struct nvkm_memory **pmemory)
 {
 	struct nvkm_subdev *subdev = &imem->subdev;
 	struct nvkm_memory *memory = NULL;
-	u32 offset;
 	int ret;
 
-	ret = imem->func->memory_new(imem, size, align, zero, &memory);
+	ret = imem->func->memory_new(imem, size, align, zero, target, &memory);
 	if (ret) {
 		nvkm_error(subdev, "OOM: %08x %08x %d\n", size, align, ret);
 		goto done;
@@ -108,13 +108,8 @@ nvkm_instobj_new(struct nvkm_instmem *imem, u32 size, u32 align, bool zero,
 		   zero, nvkm_memory_addr(memory), nvkm_memory_size(memory));
 
 	if (!imem->func->zero && zero) {
-		void __iomem *map = nvkm_kmap(memory);
-		if (unlikely(!map)) {
-			for (offset = 0; offset < size; offset += 4)
-				nvkm_wo32(memory, offset, 0x00000000);
-		} else {
-			memset_io(map, 0x00, size);
-		}
+		nvkm_kmap(memory);
+		nvkm_memory_fill(memory, 0, 0x00000000, size);
 		nvkm_done(memory);
 	}
 
@@ -156,26 +151,71 @@ nvkm_instmem_boot(struct nvkm_instmem *imem)
 	spin_unlock(&imem->lock);
 }
 
+static int
+nvkm_instmem_save(struct nvkm_instmem *imem, struct list_head *list,
+		  const char *name)
+{
+	struct nvkm_instobj *iobj;
+	u64 copy = 0, lost = 0;
+	s64 time = ktime_to_us(ktime_get());
+
+	list_for_each_entry(iobj, list, head) {
+		const u64 size = nvkm_memory_size(&iobj->memory);
+		int ret;
+
+		/* Skip objects that the driver will regenerate. */
+		if (!iobj->preserve) {
+			lost += size;
+			continue;
+		}
+
+		if ((ret = nvkm_instobj_save(iobj)))
+			return ret;
+		copy += size;
+	}
+
+	time = ktime_to_us(ktime_get()) - time;
+	nvkm_debug(&imem->subdev, "%s: saved %llu bytes, %llu lost, "
+				  "in %lldus\n", name, copy, lost, time);
+	return 0;
+}
+
+static void
+nvkm_instmem_load(struct nvkm_instmem *imem, struct list_head *list,
+		  const char *name)
+{
+	struct nvkm_instobj *iobj;
+	s64 time = ktime_to_us(ktime_get());
+	u64 size = 0;
+
+	list_for_each_entry(iobj, list, head) {
+		if (iobj->suspend) {
+			size += nvkm_memory_size(&iobj->memory);
+			nvkm_instobj_load(iobj);
+		}
+	}
+
+	time = ktime_to_us(ktime_get()) - time;
+	nvkm_debug(&imem->subdev, "%s: restored %llu bytes in %lldus\n",
+		   name, size, time);
+}
+
 static int
 nvkm_instmem_fini(struct nvkm_subdev *subdev, bool suspend)
 {
 	struct nvkm_instmem *imem = nvkm_instmem(subdev);
-	struct nvkm_instobj *iobj;
+	int ret;
 
 	if (suspend) {
-		list_for_each_entry(iobj, &imem->list, head) {
-			int ret = nvkm_instobj_save(iobj);
-			if (ret)
-				return ret;
-		}
+		ret = nvkm_instmem_save(imem, &imem->list, "objects");
+		if (ret)
+			return ret;
 
 		nvkm_bar_bar2_fini(subdev->device);
 
-		list_for_each_entry(iobj, &imem->boot, head) {
-			int ret = nvkm_instobj_save(iobj);
-			if (ret)
-				return ret;
-		}
+		ret = nvkm_instmem_save(imem, &imem->boot, "boot objects");
+		if (ret)
+			return ret;
 	}
 
 	if (imem->func->fini)
@@ -188,20 +228,10 @@ static int
 nvkm_instmem_init(struct nvkm_subdev *subdev)
 {
 	struct nvkm_instmem *imem = nvkm_instmem(subdev);
-	struct nvkm_instobj *iobj;
-
-	list_for_each_entry(iobj, &imem->boot, head) {
-		if (iobj->suspend)
-			nvkm_instobj_load(iobj);
-	}
 
+	nvkm_instmem_load(imem, &imem->boot, "boot objects");
 	nvkm_bar_bar2_init(subdev->device);
-
-	list_for_each_entry(iobj, &imem->list, head) {
-		if (iobj->suspend)
-			nvkm_instobj_load(iobj);
-	}
-
+	nvkm_instmem_load(imem, &imem->list, "objects");
 	return 0;
 }
 
@@ -277,6 +277,31 @@ gk20a_instobj_wr32(struct nvkm_memory *memory, u64 offset, u32 data)
 	node->vaddr[offset / 4] = data;
 }
 
+static void
+gk20a_instobj_wr(struct nvkm_memory *memory, u64 offset,
+		 const void *data, u32 size)
+{
+	struct gk20a_instobj *node = gk20a_instobj(memory);
+
+	memcpy(&node->vaddr[offset / 4], data, size);
+}
+
+static void
+gk20a_instobj_rd(struct nvkm_memory *memory, u64 offset, void *data, u32 size)
+{
+	struct gk20a_instobj *node = gk20a_instobj(memory);
+
+	memcpy(data, &node->vaddr[offset / 4], size);
+}
+
+static void
+gk20a_instobj_fill(struct nvkm_memory *memory, u64 offset, u32 data, u32 size)
+{
+	struct gk20a_instobj *node = gk20a_instobj(memory);
+
+	memset32(&node->vaddr[offset / 4], data, size / 4);
+}
+
 static int
 gk20a_instobj_map(struct nvkm_memory *memory, u64 offset, struct nvkm_vmm *vmm,
 		  struct nvkm_vma *vma, void *argv, u32 argc)
@@ -377,6 +402,9 @@ static const struct nvkm_memory_ptrs
 gk20a_instobj_ptrs = {
 	.rd32 = gk20a_instobj_rd32,
 	.wr32 = gk20a_instobj_wr32,
+	.rd = gk20a_instobj_rd,
+	.wr = gk20a_instobj_wr,
+	.fill = gk20a_instobj_fill,
 };
 
 static int
@@ -512,7 +540,7 @@ free_pages:
 
 static int
 gk20a_instobj_new(struct nvkm_instmem *base, u32 size, u32 align, bool zero,
-		  struct nvkm_memory **pmemory)
+		  enum nvkm_memory_target target, struct nvkm_memory **pmemory)
 {
 	struct gk20a_instmem *imem = gk20a_instmem(base);
 	struct nvkm_subdev *subdev = &imem->base.subdev;
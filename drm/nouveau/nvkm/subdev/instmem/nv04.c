@@ -58,10 +58,40 @@ nv04_instobj_rd32(struct nvkm_memory *memory, u64 offset)
 	return nvkm_rd32(device, 0x700000 + iobj->node->offset + offset);
 }
 
+static void __iomem *
+nv04_instobj_io(struct nvkm_memory *memory, u64 offset)
+{
+	struct nv04_instobj *iobj = nv04_instobj(memory);
+	struct nvkm_device *device = iobj->imem->base.subdev.device;
+	return device->pri + 0x700000 + iobj->node->offset + offset;
+}
+
+static void
+nv04_instobj_wr(struct nvkm_memory *memory, u64 offset,
+		const void *data, u32 size)
+{
+	memcpy_toio(nv04_instobj_io(memory, offset), data, size);
+}
+
+static void
+nv04_instobj_rd(struct nvkm_memory *memory, u64 offset, void *data, u32 size)
+{
+	memcpy_fromio(data, nv04_instobj_io(memory, offset), size);
+}
+
+static void
+nv04_instobj_fill(struct nvkm_memory *memory, u64 offset, u32 data, u32 size)
+{
+	nvkm_instobj_fill_io(nv04_instobj_io(memory, offset), data, size);
+}
+
 static const struct nvkm_memory_ptrs
 nv04_instobj_ptrs = {
 	.rd32 = nv04_instobj_rd32,
 	.wr32 = nv04_instobj_wr32,
+	.rd = nv04_instobj_rd,
+	.wr = nv04_instobj_wr,
+	.fill = nv04_instobj_fill,
 };
 
 static void
@@ -118,7 +148,7 @@ nv04_instobj_func = {
 
 static int
 nv04_instobj_new(struct nvkm_instmem *base, u32 size, u32 align, bool zero,
-		 struct nvkm_memory **pmemory)
+		 enum nvkm_memory_target target, struct nvkm_memory **pmemory)
 {
 	struct nv04_instmem *imem = nv04_instmem(base);
 	struct nv04_instobj *iobj;
@@ -128,7 +158,7 @@ nv04_instobj_new(struct nvkm_instmem *base, u32 size, u32 align, bool zero,
 		return -ENOMEM;
 	*pmemory = &iobj->base.memory;
 
-	nvkm_instobj_ctor(&nv04_instobj_func, &imem->base, &iobj->base);
+	nvkm_instobj_ctor(&nv04_instobj_func, &imem->base, target, &iobj->base);
 	iobj->base.memory.ptrs = &nv04_instobj_ptrs;
 	iobj->imem = imem;
 
@@ -58,10 +58,39 @@ nv40_instobj_rd32(struct nvkm_memory *memory, u64 offset)
 	return ioread32_native(iobj->imem->iomem + iobj->node->offset + offset);
 }
 
+static void __iomem *
+nv40_instobj_io(struct nvkm_memory *memory, u64 offset)
+{
+	struct nv40_instobj *iobj = nv40_instobj(memory);
+	return iobj->imem->iomem + iobj->node->offset + offset;
+}
+
+static void
+nv40_instobj_wr(struct nvkm_memory *memory, u64 offset,
+		const void *data, u32 size)
+{
+	memcpy_toio(nv40_instobj_io(memory, offset), data, size);
+}
+
+static void
+nv40_instobj_rd(struct nvkm_memory *memory, u64 offset, void *data, u32 size)
+{
+	memcpy_fromio(data, nv40_instobj_io(memory, offset), size);
+}
+
+static void
+nv40_instobj_fill(struct nvkm_memory *memory, u64 offset, u32 data, u32 size)
+{
+	nvkm_instobj_fill_io(nv40_instobj_io(memory, offset), data, size);
+}
+
 static const struct nvkm_memory_ptrs
 nv40_instobj_ptrs = {
 	.rd32 = nv40_instobj_rd32,
 	.wr32 = nv40_instobj_wr32,
+	.rd = nv40_instobj_rd,
+	.wr = nv40_instobj_wr,
+	.fill = nv40_instobj_fill,
 };
 
 static void
@@ -118,7 +147,7 @@ nv40_instobj_func = {
 
 static int
 nv40_instobj_new(struct nvkm_instmem *base, u32 size, u32 align, bool zero,
-		 struct nvkm_memory **pmemory)
+		 enum nvkm_memory_target target, struct nvkm_memory **pmemory)
 {
 	struct nv40_instmem *imem = nv40_instmem(base);
 	struct nv40_instobj *iobj;
@@ -128,7 +157,7 @@ nv40_instobj_new(struct nvkm_instmem *base, u32 size, u32 align, bool zero,
 		return -ENOMEM;
 	*pmemory = &iobj->base.memory;
 
-	nvkm_instobj_ctor(&nv40_instobj_func, &imem->base, &iobj->base);
+	nvkm_instobj_ctor(&nv40_instobj_func, &imem->base, target, &iobj->base);
 	iobj->base.memory.ptrs = &nv40_instobj_ptrs;
 	iobj->imem = imem;
 
@@ -25,6 +25,7 @@
 #include "priv.h"
 
 #include <core/memory.h>
+#include <core/option.h>
 #include <subdev/bar.h>
 #include <subdev/fb.h>
 #include <subdev/mmu.h>
@@ -35,6 +36,14 @@ struct nv50_instmem {
 
 	/* Mappings that can be evicted when BAR2 space has been exhausted. */
 	struct list_head lru;
+	struct nv50_instobj *(*evict)(struct nv50_instmem *, u64 size);
+
+	struct {
+		u64 hit;
+		u64 miss;
+		u64 evict;
+		u64 evict_bytes;
+	} stats;
 };
 
 /******************************************************************************
@@ -50,24 +59,38 @@ struct nv50_instobj {
 	refcount_t maps;
 	void *map;
 	struct list_head lru;
+	u32 hits; /* Decaying count of accesses needing the mapping. */
 };
 
+/* Point the PRAMIN window at the 1MiB region containing addr, and return
+ * the offset of addr within the window.  Must be called with the instmem
+ * lock held.
+ */
+static inline u32
+nv50_instmem_window(struct nv50_instmem *imem, u64 addr)
+{
+	struct nvkm_device *device = imem->base.subdev.device;
+	u64 base = addr & 0xffffff00000ULL;
+
+	if (unlikely(imem->addr != base)) {
+		nvkm_wr32(device, 0x001700, base >> 16);
+		imem->addr = base;
+	}
+
+	return 0x700000 + (addr & 0x000000fffffULL);
+}
+
 static void
 nv50_instobj_wr32_slow(struct nvkm_memory *memory, u64 offset, u32 data)
 {
 	struct nv50_instobj *iobj = nv50_instobj(memory);
 	struct nv50_instmem *imem = iobj->imem;
 	struct nvkm_device *device = imem->base.subdev.device;
-	u64 base = (nvkm_memory_addr(iobj->ram) + offset) & 0xffffff00000ULL;
-	u64 addr = (nvkm_memory_addr(iobj->ram) + offset) & 0x000000fffffULL;
+	u64 addr = nvkm_memory_addr(iobj->ram) + offset;
 	unsigned long flags;
 
 	spin_lock_irqsave(&imem->base.lock, flags);
-	if (unlikely(imem->addr != base)) {
-		nvkm_wr32(device, 0x001700, base >> 16);
-		imem->addr = base;
-	}
-	nvkm_wr32(device, 0x700000 + addr, data);
+	nvkm_wr32(device, nv50_instmem_window(imem, addr), data);
 	spin_unlock_irqrestore(&imem->base.lock, flags);
 }
 
@@ -77,25 +100,100 @@ nv50_instobj_rd32_slow(struct nvkm_memory *memory, u64 offset)
 	struct nv50_instobj *iobj = nv50_instobj(memory);
 	struct nv50_instmem *imem = iobj->imem;
 	struct nvkm_device *device = imem->base.subdev.device;
-	u64 base = (nvkm_memory_addr(iobj->ram) + offset) & 0xffffff00000ULL;
-	u64 addr = (nvkm_memory_addr(iobj->ram) + offset) & 0x000000fffffULL;
+	u64 addr = nvkm_memory_addr(iobj->ram) + offset;
 	u32 data;
 	unsigned long flags;
 
 	spin_lock_irqsave(&imem->base.lock, flags);
-	if (unlikely(imem->addr != base)) {
-		nvkm_wr32(device, 0x001700, base >> 16);
-		imem->addr = base;
-	}
-	data = nvkm_rd32(device, 0x700000 + addr);
+	data = nvkm_rd32(device, nv50_instmem_window(imem, addr));
 	spin_unlock_irqrestore(&imem->base.lock, flags);
 	return data;
 }
 
+/* Block transfers are done in chunks that never cross a window boundary,
+ * so the window is only (re)programmed once per chunk.  The lock is
+ * dropped between chunks to avoid starving other PRAMIN users.
+ */
+#define NV50_INSTOBJ_BLOCK 0x10000
+
+static void
+nv50_instobj_wr_slow(struct nvkm_memory *memory, u64 offset,
+		     const void *data, u32 size)
+{
+	struct nv50_instobj *iobj = nv50_instobj(memory);
+	struct nv50_instmem *imem = iobj->imem;
+	struct nvkm_device *device = imem->base.subdev.device;
+	u64 addr = nvkm_memory_addr(iobj->ram) + offset;
+	const u32 *ptr = data;
+	unsigned long flags;
+	u32 mmio, next;
+
+	while (size) {
+		next = NV50_INSTOBJ_BLOCK - (addr & (NV50_INSTOBJ_BLOCK - 1));
+		next = min(next, size);
+
+		spin_lock_irqsave(&imem->base.lock, flags);
+		mmio = nv50_instmem_window(imem, addr);
+		for (addr += next, size -= next; next; next -= 4, mmio += 4)
+			nvkm_wr32(device, mmio, *ptr++);
+		spin_unlock_irqrestore(&imem->base.lock, flags);
+	}
+}
+
+static void
+nv50_instobj_fill_slow(struct nvkm_memory *memory, u64 offset,
+		       u32 data, u32 size)
+{
+	struct nv50_instobj *iobj = nv50_instobj(memory);
+	struct nv50_instmem *imem = iobj->imem;
+	struct nvkm_device *device = imem->base.subdev.device;
+	u64 addr = nvkm_memory_addr(iobj->ram) + offset;
+	unsigned long flags;
+	u32 mmio, next;
+
+	while (size) {
+		next = NV50_INSTOBJ_BLOCK - (addr & (NV50_INSTOBJ_BLOCK - 1));
+		next = min(next, size);
+
+		spin_lock_irqsave(&imem->base.lock, flags);
+		mmio = nv50_instmem_window(imem, addr);
+		for (addr += next, size -= next; next; next -= 4, mmio += 4)
+			nvkm_wr32(device, mmio, data);
+		spin_unlock_irqrestore(&imem->base.lock, flags);
+	}
+}
+
+static void
+nv50_instobj_rd_slow(struct nvkm_memory *memory, u64 offset,
+		     void *data, u32 size)
+{
+	struct nv50_instobj *iobj = nv50_instobj(memory);
+	struct nv50_instmem *imem = iobj->imem;
+	struct nvkm_device *device = imem->base.subdev.device;
+	u64 addr = nvkm_memory_addr(iobj->ram) + offset;
+	u32 *ptr = data;
+	unsigned long flags;
+	u32 mmio, next;
+
+	while (size) {
+		next = NV50_INSTOBJ_BLOCK - (addr & (NV50_INSTOBJ_BLOCK - 1));
+		next = min(next, size);
+
+		spin_lock_irqsave(&imem->base.lock, flags);
+		mmio = nv50_instmem_window(imem, addr);
+		for (addr += next, size -= next; next; next -= 4, mmio += 4)
+			*ptr++ = nvkm_rd32(device, mmio);
+		spin_unlock_irqrestore(&imem->base.lock, flags);
+	}
+}
+
 static const struct nvkm_memory_ptrs
 nv50_instobj_slow = {
 	.rd32 = nv50_instobj_rd32_slow,
 	.wr32 = nv50_instobj_wr32_slow,
+	.rd = nv50_instobj_rd_slow,
+	.wr = nv50_instobj_wr_slow,
+	.fill = nv50_instobj_fill_slow,
 };
 
 static void
@@ -110,12 +208,87 @@ nv50_instobj_rd32(struct nvkm_memory *memory, u64 offset)
 	return ioread32_native(nv50_instobj(memory)->map + offset);
 }
 
+static void
+nv50_instobj_wr(struct nvkm_memory *memory, u64 offset,
+		const void *data, u32 size)
+{
+	memcpy_toio(nv50_instobj(memory)->map + offset, data, size);
+}
+
+static void
+nv50_instobj_rd(struct nvkm_memory *memory, u64 offset, void *data, u32 size)
+{
+	memcpy_fromio(data, nv50_instobj(memory)->map + offset, size);
+}
+
+static void
+nv50_instobj_fill(struct nvkm_memory *memory, u64 offset, u32 data, u32 size)
+{
+	nvkm_instobj_fill_io(nv50_instobj(memory)->map + offset, data, size);
+}
+
 static const struct nvkm_memory_ptrs
 nv50_instobj_fast = {
 	.rd32 = nv50_instobj_rd32,
 	.wr32 = nv50_instobj_wr32,
+	.rd = nv50_instobj_rd,
+	.wr = nv50_instobj_wr,
+	.fill = nv50_instobj_fill,
 };
 
+/* Accesses after which a mapping is considered hot, and is only evicted
+ * if there's nothing else available.
+ */
+#define NV50_INSTOBJ_HOT 16
+#define NV50_INSTOBJ_HITS_MAX 0x10000
+
+/* Number of mappings from the cold end of the LRU considered per pick. */
+#define NV50_INSTMEM_EVICT_SCAN 16
+
+/* Number of mappings evicted each time the lock is taken. */
+#define NV50_INSTMEM_EVICT_BATCH 8
+
+static struct nv50_instobj *
+nv50_instmem_evict_lru(struct nv50_instmem *imem, u64 size)
+{
+	return list_first_entry_or_null(&imem->lru, struct nv50_instobj, lru);
+}
+
+/* Pick the coldest of the least-recently used mappings, weighting each by
+ * how much of the request it'd satisfy so that one large eviction will be
+ * preferred over several small ones.  Hot mappings are passed over, but
+ * their access counts decay each time so they'll eventually be evicted.
+ */
+static struct nv50_instobj *
+nv50_instmem_evict_size(struct nv50_instmem *imem, u64 size)
+{
+	struct nv50_instobj *iobj, *best = NULL, *hot = NULL;
+	u64 score, best_score = 0;
+	int scan = NV50_INSTMEM_EVICT_SCAN;
+
+	list_for_each_entry(iobj, &imem->lru, lru) {
+		u64 weight = nvkm_memory_size(&iobj->base.memory);
+
+		if (!scan--)
+			break;
+
+		if (iobj->hits >= NV50_INSTOBJ_HOT) {
+			iobj->hits >>= 1;
+			if (!hot)
+				hot = iobj;
+			continue;
+		}
+
+		score = div_u64(min(weight, size), iobj->hits + 1);
+		if (!best || score > best_score) {
+			best_score = score;
+			best = iobj;
+		}
+	}
+
+	return best ? best : hot;
+}
+
 static void
 nv50_instobj_kmap(struct nv50_instobj *iobj, struct nvkm_vmm *vmm)
 {
@@ -124,10 +297,13 @@ nv50_instobj_kmap(struct nv50_instobj *iobj, struct nvkm_vmm *vmm)
 	struct nvkm_memory *memory = &iobj->base.memory;
 	struct nvkm_subdev *subdev = &imem->base.subdev;
 	struct nvkm_device *device = subdev->device;
-	struct nvkm_vma *bar = NULL, *ebar;
-	u64 size = nvkm_memory_size(memory);
-	void *emap;
-	int ret;
+	struct nvkm_vma *bar = NULL;
+	struct {
+		struct nvkm_vma *bar;
+		void *map;
+	} evict[NV50_INSTMEM_EVICT_BATCH];
+	u64 size = nvkm_memory_size(memory), freed;
+	int ret, nr, i;
 
 	/* Attempt to allocate BAR2 address-space and map the object
 	 * into it.  The lock has to be dropped while doing this due
@@ -136,26 +312,40 @@ nv50_instobj_kmap(struct nv50_instobj *iobj, struct nvkm_vmm *vmm)
 	mutex_unlock(&subdev->mutex);
 	while ((ret = nvkm_vmm_get(vmm, 12, size, &bar))) {
 		/* Evict unused mappings, and keep retrying until we either
-		 * succeed,or there's no more objects left on the LRU.
+		 * succeed, or there's no more objects left on the LRU.
+		 *
+		 * Enough mappings to (probably) satisfy the request are
+		 * evicted in one go, to avoid bouncing the lock.
 		 */
 		mutex_lock(&subdev->mutex);
-		eobj = list_first_entry_or_null(&imem->lru, typeof(*eobj), lru);
-		if (eobj) {
+		for (nr = 0, freed = 0; nr < ARRAY_SIZE(evict) && freed < size;
+		     nr++) {
+			if (!(eobj = imem->evict(imem, size - freed)))
+				break;
+
 			nvkm_debug(subdev, "evict %016llx %016llx @ %016llx\n",
 				   nvkm_memory_addr(&eobj->base.memory),
 				   nvkm_memory_size(&eobj->base.memory),
 				   eobj->bar->addr);
 			list_del_init(&eobj->lru);
-			ebar = eobj->bar;
+			evict[nr].bar = eobj->bar;
 			eobj->bar = NULL;
-			emap = eobj->map;
+			evict[nr].map = eobj->map;
 			eobj->map = NULL;
+			eobj->hits = 0;
+
+			freed += nvkm_memory_size(&eobj->base.memory);
+			imem->stats.evict++;
 		}
+		imem->stats.evict_bytes += freed;
 		mutex_unlock(&subdev->mutex);
-		if (!eobj)
+		if (!nr)
 			break;
-		iounmap(emap);
-		nvkm_vmm_put(vmm, &ebar);
+
+		for (i = 0; i < nr; i++) {
+			iounmap(evict[i].map);
+			nvkm_vmm_put(vmm, &evict[i].bar);
+		}
 	}
 
 	if (ret == 0)
@@ -235,9 +425,16 @@ nv50_instobj_acquire(struct nvkm_memory *memory)
 
 	/* Attempt to get a direct CPU mapping of the object. */
 	if ((vmm = nvkm_bar_bar2_vmm(imem->subdev.device))) {
-		if (!iobj->map)
+		if (!iobj->map) {
+			iobj->imem->stats.miss++;
 			nv50_instobj_kmap(iobj, vmm);
+		} else {
+			iobj->imem->stats.hit++;
+		}
 		map = iobj->map;
+
+		if (iobj->hits < NV50_INSTOBJ_HITS_MAX)
+			iobj->hits++;
 	}
 
 	if (!refcount_inc_not_zero(&iobj->maps)) {
@@ -349,7 +546,7 @@ nv50_instobj_func = {
 
 static int
 nv50_instobj_new(struct nvkm_instmem *base, u32 size, u32 align, bool zero,
-		 struct nvkm_memory **pmemory)
+		 enum nvkm_memory_target target, struct nvkm_memory **pmemory)
 {
 	struct nv50_instmem *imem = nv50_instmem(base);
 	struct nv50_instobj *iobj;
@@ -360,7 +557,7 @@ nv50_instobj_new(struct nvkm_instmem *base, u32 size, u32 align, bool zero,
 		return -ENOMEM;
 	*pmemory = &iobj->base.memory;
 
-	nvkm_instobj_ctor(&nv50_instobj_func, &imem->base, &iobj->base);
+	nvkm_instobj_ctor(&nv50_instobj_func, &imem->base, target, &iobj->base);
 	iobj->imem = imem;
 	refcount_set(&iobj->maps, 0);
 	INIT_LIST_HEAD(&iobj->lru);
@@ -375,7 +572,13 @@ nv50_instobj_new(struct nvkm_instmem *base, u32 size, u32 align, bool zero,
 static void
 nv50_instmem_fini(struct nvkm_instmem *base)
 {
-	nv50_instmem(base)->addr = ~0ULL;
+	struct nv50_instmem *imem = nv50_instmem(base);
+
+	nvkm_debug(&imem->base.subdev, "BAR2 mappings: %llu hit, %llu miss, "
+				       "%llu evicted (%llu bytes)\n",
+		   imem->stats.hit, imem->stats.miss,
+		   imem->stats.evict, imem->stats.evict_bytes);
+	imem->addr = ~0ULL;
 }
 
 static const struct nvkm_instmem_func
@@ -395,6 +598,10 @@ nv50_instmem_new(struct nvkm_device *device, int index,
 		return -ENOMEM;
 	nvkm_instmem_ctor(&nv50_instmem, device, index, &imem->base);
 	INIT_LIST_HEAD(&imem->lru);
+	if (nvkm_boolopt(device->cfgopt, "NvInstLRU", false))
+		imem->evict = nv50_instmem_evict_lru;
+	else
+		imem->evict = nv50_instmem_evict_size;
 	*pimem = &imem->base;
 	return 0;
 }
@@ -11,7 +11,8 @@ struct nvkm_instmem_func {
 	u32  (*rd32)(struct nvkm_instmem *, u32 addr);
 	void (*wr32)(struct nvkm_instmem *, u32 addr, u32 data);
 	int (*memory_new)(struct nvkm_instmem *, u32 size, u32 align,
-			  bool zero, struct nvkm_memory **);
+			  bool zero, enum nvkm_memory_target,
+			  struct nvkm_memory **);
 	bool zero;
 };
 
@@ -24,10 +25,25 @@ void nvkm_instmem_boot(struct nvkm_instmem *);
 struct nvkm_instobj {
 	struct nvkm_memory memory;
 	struct list_head head;
+	bool preserve; /* Contents must survive suspend/resume. */
 	u32 *suspend;
 };
 
+/* Fill for backends with a CPU mapping of the object through a BAR. */
+static inline void
+nvkm_instobj_fill_io(void __iomem *map, u32 data, u32 size)
+{
+	if (!data) {
+		memset_io(map, 0x00, size);
+		return;
+	}
+
+	for (; size; size -= 4, map += 4)
+		iowrite32_native(data, map);
+}
+
 void nvkm_instobj_ctor(const struct nvkm_memory_func *func,
-		       struct nvkm_instmem *, struct nvkm_instobj *);
+		       struct nvkm_instmem *, enum nvkm_memory_target,
+		       struct nvkm_instobj *);
 void nvkm_instobj_dtor(struct nvkm_instmem *, struct nvkm_instobj *);
 #endif
@@ -42,6 +42,41 @@ nvkm_uvmm_search(struct nvkm_client *client, u64 handle)
 	return nvkm_uvmm(object)->vmm;
 }
 
+/* Lock the address range covered by the VMA at addr (including regions
+ * split from it by map(), if requested), returning with vmm->mutex held.
+ */
+static struct nvkm_vma *
+nvkm_uvmm_range_lock(struct nvkm_vmm *vmm, struct nvkm_vmm_range *range,
+		     u64 addr, bool parts)
+{
+	struct nvkm_vma *vma;
+	u64 size, real;
+
+	mutex_lock(&vmm->mutex);
+	do {
+		vma = nvkm_vmm_node_search(vmm, addr);
+		if (vma && vma->addr == addr)
+			size = parts ? nvkm_vmm_node_extent(vmm, vma) : vma->size;
+		else
+			size = 1;
+		mutex_unlock(&vmm->mutex);
+
+		nvkm_vmm_range_lock(vmm, range, addr, size);
+		mutex_lock(&vmm->mutex);
+
+		/* The VMA may have been modified while we were waiting. */
+		vma = nvkm_vmm_node_search(vmm, addr);
+		if (!vma || vma->addr != addr)
+			break;
+
+		real = parts ? nvkm_vmm_node_extent(vmm, vma) : vma->size;
+		if (real != size)
+			nvkm_vmm_range_unlock(vmm, range);
+	} while (real != size);
+
+	return vma;
+}
+
 static int
 nvkm_uvmm_mthd_pfnclr(struct nvkm_uvmm *uvmm, void *argv, u32 argc)
 {
@@ -50,6 +85,7 @@ nvkm_uvmm_mthd_pfnclr(struct nvkm_uvmm *uvmm, void *argv, u32 argc)
 		struct nvif_vmm_pfnclr_v0 v0;
 	} *args = argv;
 	struct nvkm_vmm *vmm = uvmm->vmm;
+	struct nvkm_vmm_range range;
 	int ret = -ENOSYS;
 	u64 addr, size;
 
@@ -63,9 +99,11 @@ nvkm_uvmm_mthd_pfnclr(struct nvkm_uvmm *uvmm, void *argv, u32 argc)
 		return -ENOENT;
 
 	if (size) {
+		nvkm_vmm_range_lock(vmm, &range, addr, size);
 		mutex_lock(&vmm->mutex);
 		ret = nvkm_vmm_pfn_unmap(vmm, addr, size);
 		mutex_unlock(&vmm->mutex);
+		nvkm_vmm_range_unlock(vmm, &range);
 	}
 
 	return ret;
@@ -79,6 +117,7 @@ nvkm_uvmm_mthd_pfnmap(struct nvkm_uvmm *uvmm, void *argv, u32 argc)
 		struct nvif_vmm_pfnmap_v0 v0;
 	} *args = argv;
 	struct nvkm_vmm *vmm = uvmm->vmm;
+	struct nvkm_vmm_range range;
 	int ret = -ENOSYS;
 	u64 addr, size, *phys;
 	u8  page;
@@ -97,9 +136,11 @@ nvkm_uvmm_mthd_pfnmap(struct nvkm_uvmm *uvmm, void *argv, u32 argc)
 		return -ENOENT;
 
 	if (size) {
+		nvkm_vmm_range_lock(vmm, &range, addr, size);
 		mutex_lock(&vmm->mutex);
 		ret = nvkm_vmm_pfn_map(vmm, page, addr, size, phys);
 		mutex_unlock(&vmm->mutex);
+		nvkm_vmm_range_unlock(vmm, &range);
 	}
 
 	return ret;
@@ -113,6 +154,7 @@ nvkm_uvmm_mthd_unmap(struct nvkm_uvmm *uvmm, void *argv, u32 argc)
 		struct nvif_vmm_unmap_v0 v0;
 	} *args = argv;
 	struct nvkm_vmm *vmm = uvmm->vmm;
+	struct nvkm_vmm_range range;
 	struct nvkm_vma *vma;
 	int ret = -ENOSYS;
 	u64 addr;
@@ -122,8 +164,7 @@ nvkm_uvmm_mthd_unmap(struct nvkm_uvmm *uvmm, void *argv, u32 argc)
 	} else
 		return ret;
 
-	mutex_lock(&vmm->mutex);
-	vma = nvkm_vmm_node_search(vmm, addr);
+	vma = nvkm_uvmm_range_lock(vmm, &range, addr, false);
 	if (ret = -ENOENT, !vma || vma->addr != addr) {
 		VMM_DEBUG(vmm, "lookup %016llx: %016llx",
 			  addr, vma ? vma->addr : ~0ULL);
@@ -145,6 +186,7 @@ nvkm_uvmm_mthd_unmap(struct nvkm_uvmm *uvmm, void *argv, u32 argc)
 	ret = 0;
 done:
 	mutex_unlock(&vmm->mutex);
+	nvkm_vmm_range_unlock(vmm, &range);
 	return ret;
 }
 
@@ -157,6 +199,7 @@ nvkm_uvmm_mthd_map(struct nvkm_uvmm *uvmm, void *argv, u32 argc)
 	} *args = argv;
 	u64 addr, size, handle, offset;
 	struct nvkm_vmm *vmm = uvmm->vmm;
+	struct nvkm_vmm_range range;
 	struct nvkm_vma *vma;
 	struct nvkm_memory *memory;
 	int ret = -ENOSYS;
@@ -175,6 +218,7 @@ nvkm_uvmm_mthd_map(struct nvkm_uvmm *uvmm, void *argv, u32 argc)
 		return PTR_ERR(memory);
 	}
 
+	nvkm_vmm_range_lock(vmm, &range, addr, size);
 	mutex_lock(&vmm->mutex);
 	if (ret = -ENOENT, !(vma = nvkm_vmm_node_search(vmm, addr))) {
 		VMM_DEBUG(vmm, "lookup %016llx", addr);
@@ -214,6 +258,7 @@ nvkm_uvmm_mthd_map(struct nvkm_uvmm *uvmm, void *argv, u32 argc)
 	ret = nvkm_memory_map(memory, offset, vmm, vma, argv, argc);
 	if (ret == 0) {
 		/* Successful map will clear vma->busy. */
+		nvkm_vmm_range_unlock(vmm, &range);
 		nvkm_memory_unref(&memory);
 		return 0;
 	}
@@ -223,6 +268,7 @@ nvkm_uvmm_mthd_map(struct nvkm_uvmm *uvmm, void *argv, u32 argc)
 	nvkm_vmm_unmap_region(vmm, vma);
 fail:
 	mutex_unlock(&vmm->mutex);
+	nvkm_vmm_range_unlock(vmm, &range);
 	nvkm_memory_unref(&memory);
 	return ret;
 }
@@ -235,6 +281,7 @@ nvkm_uvmm_mthd_put(struct nvkm_uvmm *uvmm, void *argv, u32 argc)
 		struct nvif_vmm_put_v0 v0;
 	} *args = argv;
 	struct nvkm_vmm *vmm = uvmm->vmm;
+	struct nvkm_vmm_range range;
 	struct nvkm_vma *vma;
 	int ret = -ENOSYS;
 	u64 addr;
@@ -244,8 +291,7 @@ nvkm_uvmm_mthd_put(struct nvkm_uvmm *uvmm, void *argv, u32 argc)
 	} else
 		return ret;
 
-	mutex_lock(&vmm->mutex);
-	vma = nvkm_vmm_node_search(vmm, args->v0.addr);
+	vma = nvkm_uvmm_range_lock(vmm, &range, addr, true);
 	if (ret = -ENOENT, !vma || vma->addr != addr || vma->part) {
 		VMM_DEBUG(vmm, "lookup %016llx: %016llx %d", addr,
 			  vma ? vma->addr : ~0ULL, vma ? vma->part : 0);
@@ -262,6 +308,7 @@ nvkm_uvmm_mthd_put(struct nvkm_uvmm *uvmm, void *argv, u32 argc)
 	ret = 0;
 done:
 	mutex_unlock(&vmm->mutex);
+	nvkm_vmm_range_unlock(vmm, &range);
 	return ret;
 }
 
@@ -535,6 +535,8 @@ nvkm_vmm_iter(struct nvkm_vmm *vmm, const struct nvkm_vmm_page *page,
 		const u32 ptei = it.pte[0];
 		const u32 ptes = min_t(u64, it.cnt, pten - ptei);
 
+		mutex_lock(&vmm->ptes);
+
 		/* Walk down the tree, finding page tables for each level. */
 		for (; it.lvl; it.lvl--) {
 			const u32 pdei = it.pte[it.lvl];
@@ -559,9 +561,23 @@ nvkm_vmm_iter(struct nvkm_vmm *vmm, const struct nvkm_vmm_page *page,
 			}
 		}
 
-		/* Handle PTE updates. */
-		if (!REF_PTES || REF_PTES(&it, pfn, ptei, ptes)) {
+		/* Handle PTE updates.
+		 *
+		 * Range locks keep other operations away from these PTEs, and
+		 * as long as we hold references to them, the PT can't go away
+		 * either, so the writes themselves are done without vmm->ptes.
+		 * That's not the case when dropping references, nor when the
+		 * backend (NV44) packs PTEs into words shared with neighbours
+		 * and updates them with a read-modify-write.
+		 */
+		if (REF_PTES && !REF_PTES(&it, pfn, ptei, ptes)) {
+			mutex_unlock(&vmm->ptes);
+		} else {
 			struct nvkm_mmu_pt *pt = pgt->pt[type];
+			const bool locked = vmm->func->packed ||
+					    (REF_PTES && !ref);
+			if (!locked)
+				mutex_unlock(&vmm->ptes);
 			if (MAP_PTES || CLR_PTES) {
 				if (MAP_PTES)
 					MAP_PTES(vmm, pt, ptei, ptes, map);
@@ -569,6 +585,8 @@ nvkm_vmm_iter(struct nvkm_vmm *vmm, const struct nvkm_vmm_page *page,
 					CLR_PTES(vmm, pt, ptei, ptes);
 				nvkm_vmm_flush_mark(&it);
 			}
+			if (locked)
+				mutex_unlock(&vmm->ptes);
 		}
 
 		/* Walk back up the tree to the next position. */
@@ -586,6 +604,8 @@ nvkm_vmm_iter(struct nvkm_vmm *vmm, const struct nvkm_vmm_page *page,
 	return ~0ULL;
 
 fail:
+	mutex_unlock(&vmm->ptes);
+
 	/* Reconstruct the failure address so the caller is able to
 	 * reverse any partially completed operations.
 	 */
@@ -948,6 +968,55 @@ nvkm_vmm_node_split(struct nvkm_vmm *vmm,
 	return vma;
 }
 
+u64
+nvkm_vmm_node_extent(struct nvkm_vmm *vmm, struct nvkm_vma *vma)
+{
+	u64 size = vma->size;
+	while ((vma = node(vma, next)) && vma->part)
+		size += vma->size;
+	return size;
+}
+
+static bool
+nvkm_vmm_range_try(struct nvkm_vmm *vmm, struct nvkm_vmm_range *range)
+{
+	struct nvkm_vmm_range *busy;
+
+	spin_lock(&vmm->range.lock);
+	list_for_each_entry(busy, &vmm->range.list, head) {
+		if (range->addr - busy->addr < busy->size ||
+		    busy->addr - range->addr < range->size) {
+			spin_unlock(&vmm->range.lock);
+			return false;
+		}
+	}
+	list_add_tail(&range->head, &vmm->range.list);
+	spin_unlock(&vmm->range.lock);
+	return true;
+}
+
+void
+nvkm_vmm_range_unlock(struct nvkm_vmm *vmm, struct nvkm_vmm_range *range)
+{
+	spin_lock(&vmm->range.lock);
+	list_del(&range->head);
+	spin_unlock(&vmm->range.lock);
+	wake_up_all(&vmm->range.wait);
+}
+
+/* Range locks serialise operations on overlapping areas of the address
+ * space, while allowing operations on disjoint areas to update their page
+ * tables in parallel.  They must be taken before vmm->mutex.
+ */
+void
+nvkm_vmm_range_lock(struct nvkm_vmm *vmm, struct nvkm_vmm_range *range,
+		    u64 addr, u64 size)
+{
+	range->addr = addr;
+	range->size = size;
+	wait_event(vmm->range.wait, nvkm_vmm_range_try(vmm, range));
+}
+
 static void
 nvkm_vma_dump(struct nvkm_vma *vma)
 {
@@ -1049,6 +1118,10 @@ nvkm_vmm_ctor(const struct nvkm_vmm_func *func, struct nvkm_mmu *mmu,
 	kref_init(&vmm->kref);
 
 	__mutex_init(&vmm->mutex, "&vmm->mutex", key ? key : &_key);
+	mutex_init(&vmm->ptes);
+	spin_lock_init(&vmm->range.lock);
+	INIT_LIST_HEAD(&vmm->range.list);
+	init_waitqueue_head(&vmm->range.wait);
 
 	/* Locate the smallest page size supported by the backend, it will
 	 * have the the deepest nesting of page tables.
@@ -1154,14 +1227,21 @@ nvkm_vmm_pfn_split_merge(struct nvkm_vmm *vmm, struct nvkm_vma *vma,
 	struct nvkm_vma *prev = NULL;
 	struct nvkm_vma *next = NULL;
 
+	/* Mapped regions are only merged with neighbours of the same page
+	 * size, so that unmap knows what granularity the PTEs are at, and
+	 * never with runs, which need to be torn down as a whole, nor with
+	 * busy regions that another thread is in the middle of mapping.
+	 */
 	if (vma->addr == addr && vma->part && (prev = node(vma, prev))) {
-		if (prev->memory || prev->mapped != map)
+		if (prev->memory || prev->mapped != map || prev->pfn ||
+		    prev->busy || (map && prev->refd != page))
 			prev = NULL;
 	}
 
 	if (vma->addr + vma->size == addr + size && (next = node(vma, next))) {
-		if (!next->part ||
-		    next->memory || next->mapped != map)
+		if (!next->part || next->busy ||
+		    next->memory || next->mapped != map || next->pfn ||
+		    (map && next->refd != page))
 			next = NULL;
 	}
 
@@ -1170,6 +1250,424 @@ nvkm_vmm_pfn_split_merge(struct nvkm_vmm *vmm, struct nvkm_vma *vma,
 	return nvkm_vmm_node_split(vmm, vma, addr, size);
 }
 
+/* Determine whether the PFNs at the start of pfn[] (pn entries of the
+ * given shift) can be mapped at addr with a single PTE of the larger
+ * page size.  This requires a physically contiguous run with identical
+ * flags, aligned both in the VMM and in the backing memory.
+ */
+static bool
+nvkm_vmm_pfn_fits(const struct nvkm_vmm_page *page, u8 shift,
+		  u64 addr, u64 *pfn, u64 pn)
+{
+	const u64 mask = (1ULL << page->shift) - 1;
+	u64 nr, i;
+
+	if (!page->desc->func->pfn || page->shift <= shift)
+		return false;
+
+	if ((nr = 1ULL << (page->shift - shift)) > pn)
+		return false;
+
+	if ((addr & mask) || ((pfn[0] & NVKM_VMM_PFN_ADDR) & mask))
+		return false;
+
+	if (pfn[0] & NVKM_VMM_PFN_VRAM) {
+		if (!(page->type & NVKM_VMM_PAGE_VRAM))
+			return false;
+	} else {
+		if (!(page->type & NVKM_VMM_PAGE_HOST))
+			return false;
+	}
+
+	/* Flags live below the address, so a contiguous run with the
+	 * same flags is simply an arithmetic sequence.
+	 */
+	for (i = 1; i < nr; i++) {
+		if (pfn[i] != pfn[0] + (i << shift))
+			return false;
+	}
+
+	return true;
+}
+
+static const struct nvkm_vmm_page *
+nvkm_vmm_pfn_large(struct nvkm_vmm *vmm, const struct nvkm_vmm_page *base,
+		   u64 addr, u64 *pfn, u64 pn)
+{
+	const struct nvkm_vmm_page *page;
+
+	for (page = vmm->func->page; page < base; page++) {
+		if (nvkm_vmm_pfn_fits(page, base->shift, addr, pfn, pn))
+			return page;
+	}
+
+	return NULL;
+}
+
+/* Shortest run of host memory worth a VMA and DMA mapping of its own.
+ * Below this, splitting the VMA costs more than the dma_map_page() calls
+ * it saves.
+ */
+#define NVKM_VMM_PFN_HOST_RUN 16
+
+/* Pick the page size to map the first PFNs of a window with, and narrow
+ * the window to the PFNs that get mapped the same way.
+ *
+ * Physically contiguous runs are mapped as a whole, with the largest page
+ * size they're aligned to.  Anything else, including VRAM that can't use
+ * large pages, is mapped a small page at a time.
+ */
+static const struct nvkm_vmm_page *
+nvkm_vmm_pfn_page(struct nvkm_vmm *vmm, const struct nvkm_vmm_page *base,
+		  u64 addr, u64 *pfn, u64 *psize, bool *prun)
+{
+	const struct nvkm_vmm_page *page;
+	const u8 shift = base->shift;
+	u64 pn = *psize >> shift, nr, i, j;
+
+	for (nr = 1; nr < pn; nr++) {
+		if (pfn[nr] != pfn[0] + (nr << shift))
+			break;
+	}
+
+	if ((page = nvkm_vmm_pfn_large(vmm, base, addr, pfn, pn))) {
+		/* Cover as many large pages of the run as possible. */
+		i = nr & ~((1ULL << (page->shift - shift)) - 1);
+		*psize = i << shift;
+		*prun = true;
+		return page;
+	}
+
+	if (nr >= NVKM_VMM_PFN_HOST_RUN && !(pfn[0] & NVKM_VMM_PFN_VRAM)) {
+		/* A run of host memory, up until a large page could begin. */
+		for (i = 1; i < nr; i++) {
+			if (nvkm_vmm_pfn_large(vmm, base, addr + (i << shift),
+					       &pfn[i], nr - i))
+				break;
+		}
+		*psize = i << shift;
+		*prun = true;
+		return base;
+	}
+
+	/* Otherwise, a page at a time, up until a run could begin.  Runs
+	 * of host memory begin where the contiguous stretch of pages being
+	 * looked at (from j) becomes long enough.
+	 */
+	for (i = 1, j = 0; i < pn; i++) {
+		if (pfn[i] != pfn[i - 1] + (1ULL << shift)) {
+			j = i;
+		} else
+		if (!(pfn[j] & NVKM_VMM_PFN_VRAM) &&
+		    i - j + 1 == NVKM_VMM_PFN_HOST_RUN) {
+			i = j;
+			break;
+		}
+
+		/* Large pages can only begin where the next size up would. */
+		if (base == vmm->func->page ||
+		    (((addr >> shift) + i) &
+		     ((1ULL << (base[-1].shift - shift)) - 1)))
+			continue;
+		if (nvkm_vmm_pfn_large(vmm, base, addr + (i << shift),
+				       &pfn[i], pn - i))
+			break;
+	}
+
+	*psize = i << shift;
+	*prun = false;
+	return base;
+}
+
+/* Give a run of host memory a single DMA mapping, and fill in dma[] with
+ * the address of each of its pages.
+ */
+static int
+nvkm_vmm_pfn_dma_map(struct nvkm_vmm *vmm, u64 pfn, u64 size, dma_addr_t *dma)
+{
+	struct device *dev = vmm->mmu->subdev.device->dev;
+	dma_addr_t addr;
+	u64 i;
+
+	addr = dma_map_page(dev, pfn_to_page(pfn >> NVKM_VMM_PFN_ADDR_SHIFT),
+			    0, size, DMA_BIDIRECTIONAL);
+	if (dma_mapping_error(dev, addr))
+		return -EFAULT;
+
+	for (i = 0; i < size >> PAGE_SHIFT; i++)
+		dma[i] = addr + (i << PAGE_SHIFT);
+	return 0;
+}
+
+static void
+nvkm_vmm_pfn_dma_unmap(struct nvkm_vmm *vmm, u64 pfn, dma_addr_t dma, u64 size)
+{
+	struct device *dev = vmm->mmu->subdev.device->dev;
+
+	if (!(pfn & NVKM_VMM_PFN_VRAM))
+		dma_unmap_page(dev, dma, size, DMA_BIDIRECTIONAL);
+}
+
+/* Map a physically contiguous run of memory, along with any runs that
+ * follow it at the same page size, in a single pass over the page tables.
+ *
+ * Each run gets a VMA of its own to keep track of it, and host memory a
+ * single DMA mapping for the entire run.  On return, *psize covers the
+ * runs that were mapped, and *pvma is the VMA of the last of them.
+ */
+static int
+nvkm_vmm_pfn_map_runs(struct nvkm_vmm *vmm, struct nvkm_vma **pvma,
+		      const struct nvkm_vmm_page *base,
+		      const struct nvkm_vmm_page *page,
+		      u64 addr, u64 *psize, u64 span, u64 *pfn)
+{
+	const u64 type = pfn[0] & NVKM_VMM_PFN_VRAM;
+	struct nvkm_vma *vma = *pvma, *head = NULL;
+	struct nvkm_vmm_map args = {};
+	dma_addr_t *dma = NULL;
+	u64 size = *psize;
+	u64 end = addr;
+	int ret = 0;
+
+	if (!type) {
+		dma = kvmalloc_array(span >> PAGE_SHIFT, sizeof(*dma),
+				     GFP_KERNEL);
+		if (!dma)
+			return -ENOMEM;
+	}
+
+	for (;;) {
+		const u64 i = (end - addr) >> PAGE_SHIFT;
+		bool run;
+
+		/* Carry on with the next run, if it's mapped the same way. */
+		if (end > addr) {
+			if ((size = addr + span - end) == 0)
+				break;
+			if (nvkm_vmm_pfn_page(vmm, base, end, &pfn[i], &size,
+					      &run) != page || !run ||
+			    (pfn[i] & NVKM_VMM_PFN_VRAM) != type)
+				break;
+			vma = node(vma, next);
+		}
+
+		if (dma && (ret = nvkm_vmm_pfn_dma_map(vmm, pfn[i], size,
+						       &dma[i])))
+			break;
+
+		if (WARN_ON(!(vma = nvkm_vmm_node_split(vmm, vma, end, size)))) {
+			if (dma)
+				nvkm_vmm_pfn_dma_unmap(vmm, pfn[i], dma[i], size);
+			ret = -ENOMEM;
+			break;
+		}
+
+		if (!head)
+			head = vma;
+		vma->pfn = pfn[i];
+		vma->dma = dma ? dma[i] : 0;
+		*pvma = vma;
+		end += size;
+	}
+
+	if (end == addr) {
+		kvfree(dma);
+		return ret;
+	}
+
+	args.page = page;
+	args.pfn = pfn;
+	args.dma = dma;
+	ret = nvkm_vmm_ptes_get_map(vmm, page, addr, end - addr, &args,
+				    page->desc->func->pfn);
+
+	for (vma = head; vma; vma = node(vma, next)) {
+		if (ret) {
+			nvkm_vmm_pfn_dma_unmap(vmm, vma->pfn, vma->dma,
+					       vma->size);
+			vma->pfn = 0;
+			vma->dma = 0;
+		} else {
+			vma->mapped = true;
+			vma->refd = page - vmm->func->page;
+		}
+		if (vma == *pvma)
+			break;
+	}
+
+	*psize = end - addr;
+	kvfree(dma);
+	return ret;
+}
+
+/* Point the (already referenced) PTEs of part of a run of host memory at a
+ * new DMA mapping of its own, which is returned in *pdma.
+ */
+static int
+nvkm_vmm_pfn_remap(struct nvkm_vmm *vmm, const struct nvkm_vmm_page *page,
+		   u64 addr, u64 size, u64 pfn, dma_addr_t *pdma)
+{
+	const u64 nr = size >> PAGE_SHIFT;
+	struct nvkm_vmm_map args = {};
+	dma_addr_t *dma;
+	u64 *pfns, i;
+	int ret;
+
+	pfns = kvmalloc_array(nr, sizeof(*pfns) + sizeof(*dma), GFP_KERNEL);
+	if (!pfns)
+		return -ENOMEM;
+	dma = (dma_addr_t *)&pfns[nr];
+
+	for (i = 0; i < nr; i++)
+		pfns[i] = pfn + (i << PAGE_SHIFT);
+
+	if (!(ret = nvkm_vmm_pfn_dma_map(vmm, pfn, size, dma))) {
+		*pdma = dma[0];
+		args.page = page;
+		args.pfn = pfns;
+		args.dma = dma;
+		nvkm_vmm_ptes_map(vmm, page, addr, size, &args,
+				  page->desc->func->pfn);
+	}
+
+	kvfree(pfns);
+	return ret;
+}
+
+/* Map what's left of a large page at the edge of a window with small pages.
+ * Should that fail, those pages will simply be faulted back in on demand.
+ */
+static void
+nvkm_vmm_pfn_map_rest(struct nvkm_vmm *vmm, const struct nvkm_vmm_page *base,
+		      u64 addr, u64 size, u64 pfn)
+{
+	const u64 nr = size >> PAGE_SHIFT;
+	struct nvkm_vma *vma;
+	u64 *pfns, i;
+
+	if (!(pfns = kvmalloc_array(nr, sizeof(*pfns), GFP_KERNEL)))
+		return;
+
+	for (i = 0; i < nr; i++)
+		pfns[i] = pfn + (i << PAGE_SHIFT);
+
+	vma = nvkm_vmm_node_search(vmm, addr);
+	nvkm_vmm_pfn_map_runs(vmm, &vma, base, base, addr, &size, size, pfns);
+	kvfree(pfns);
+}
+
+/* Tear down part of a run.  What's left of it stays mapped: large pages
+ * that straddle the edges of the window are replaced by small pages, and
+ * what remains of a run of host memory is moved to new DMA mappings, so
+ * the original one can be released as a whole.
+ *
+ * Returns the VMA containing the end of the window.
+ */
+static struct nvkm_vma *
+nvkm_vmm_pfn_unmap_run(struct nvkm_vmm *vmm, struct nvkm_vma *vma,
+		       u64 addr, u64 size)
+{
+	const struct nvkm_vmm_page *page = &vmm->func->page[vma->refd];
+	const struct nvkm_vmm_page *base = page;
+	const bool host = !(vma->pfn & NVKM_VMM_PFN_VRAM);
+	const u64 start = vma->addr, limit = vma->addr + vma->size;
+	const u64 pfn = vma->pfn;
+	const dma_addr_t dma = vma->dma;
+	u64 head = ALIGN_DOWN(addr, 1ULL << page->shift);
+	u64 tail = ALIGN(addr + size, 1ULL << page->shift);
+	dma_addr_t head_dma = 0, tail_dma = 0;
+	struct nvkm_vma *tmp;
+
+	while (base[1].shift)
+		base++;
+
+	/* Move the rest of the run off the DMA mapping first, the PTEs are
+	 * rewritten in place, so the GPU never sees them go invalid.  If
+	 * that's not possible, the rest of the run goes too.
+	 */
+	if (host && head > start &&
+	    nvkm_vmm_pfn_remap(vmm, page, start, head - start,
+			       pfn, &head_dma))
+		head = start;
+	if (host && tail < limit &&
+	    nvkm_vmm_pfn_remap(vmm, page, tail, limit - tail,
+			       pfn + (tail - start), &tail_dma))
+		tail = limit;
+
+	nvkm_vmm_ptes_unmap_put(vmm, page, head, tail - head, false, false);
+	nvkm_vmm_pfn_dma_unmap(vmm, pfn, dma, limit - start);
+
+	tmp = nvkm_vmm_pfn_split_merge(vmm, vma, head, tail - head, 0, false);
+	if (WARN_ON(!tmp))
+		return vma;
+	tmp->refd = NVKM_VMA_PAGE_NONE;
+	tmp->mapped = false;
+	tmp->pfn = 0;
+	tmp->dma = 0;
+
+	if (head > start) {
+		tmp = nvkm_vmm_node_search(vmm, start);
+		tmp->pfn = pfn;
+		tmp->dma = head_dma;
+	}
+
+	if (tail < limit) {
+		tmp = nvkm_vmm_node_search(vmm, tail);
+		tmp->pfn = pfn + (tail - start);
+		tmp->dma = tail_dma;
+	}
+
+	if (head < addr)
+		nvkm_vmm_pfn_map_rest(vmm, base, head, addr - head,
+				      pfn + (head - start));
+	if (tail > addr + size)
+		nvkm_vmm_pfn_map_rest(vmm, base, addr + size,
+				      tail - (addr + size),
+				      pfn + (addr + size - start));
+
+	return nvkm_vmm_node_search(vmm, addr + size - 1);
+}
+
+/* Tear down the runs that lie entirely below limit, starting at vma and
+ * using the same page size, in a single pass over the page tables.
+ *
+ * Returns the VMA of the last run.
+ */
+static struct nvkm_vma *
+nvkm_vmm_pfn_unmap_runs(struct nvkm_vmm *vmm, struct nvkm_vma *vma,
+			u64 limit)
+{
+	const struct nvkm_vmm_page *page = &vmm->func->page[vma->refd];
+	struct nvkm_vma *next, *last = vma;
+
+	while ((next = node(last, next)) && next->mapped && next->pfn &&
+	       next->refd == vma->refd && next->addr + next->size <= limit)
+		last = next;
+
+	nvkm_vmm_ptes_unmap_put(vmm, page, vma->addr,
+				last->addr + last->size - vma->addr,
+				false, false);
+
+	do {
+		struct nvkm_vma *tmp;
+
+		next = vma != last ? node(vma, next) : NULL;
+		nvkm_vmm_pfn_dma_unmap(vmm, vma->pfn, vma->dma, vma->size);
+		vma->pfn = 0;
+		vma->dma = 0;
+
+		tmp = nvkm_vmm_pfn_split_merge(vmm, vma, vma->addr, vma->size,
+					       0, false);
+		if (!WARN_ON(!tmp)) {
+			vma = tmp;
+			vma->refd = NVKM_VMA_PAGE_NONE;
+			vma->mapped = false;
+		}
+	} while (next && (vma = next));
+
+	return vma;
+}
+
 int
 nvkm_vmm_pfn_unmap(struct nvkm_vmm *vmm, u64 addr, u64 size)
 {
@@ -1187,6 +1685,14 @@ nvkm_vmm_pfn_unmap(struct nvkm_vmm *vmm, u64 addr, u64 size)
 
 		size = min(limit - start, vma->size - (start - vma->addr));
 
+		if (vma->pfn) {
+			if (start == vma->addr && size == vma->size)
+				vma = nvkm_vmm_pfn_unmap_runs(vmm, vma, limit);
+			else
+				vma = nvkm_vmm_pfn_unmap_run(vmm, vma, start, size);
+			continue;
+		}
+
 		nvkm_vmm_ptes_unmap_put(vmm, &vmm->func->page[vma->refd],
 					start, size, false, true);
 
@@ -1204,7 +1710,6 @@ nvkm_vmm_pfn_unmap(struct nvkm_vmm *vmm, u64 addr, u64 size)
 /*TODO:
  * - Avoid PT readback (for dma_unmap etc), this might end up being dealt
  *   with inside HMM, which would be a lot nicer for us to deal with.
- * - Multiple page sizes (particularly for huge page support).
  * - Support for systems without a 4KiB page size.
  */
 int
@@ -1220,8 +1725,8 @@ nvkm_vmm_pfn_map(struct nvkm_vmm *vmm, u8 shift, u64 addr, u64 size, u64 *pfn)
 	/* Only support mapping where the page size of the incoming page
 	 * array matches a page size available for direct mapping.
 	 */
-	while (page->shift && page->shift != shift &&
-	       page->desc->func->pfn == NULL)
+	while (page->shift && (page->shift != shift ||
+			       page->desc->func->pfn == NULL))
 		page++;
 
 	if (!page->shift || !IS_ALIGNED(addr, 1ULL << shift) ||
@@ -1236,11 +1741,14 @@ nvkm_vmm_pfn_map(struct nvkm_vmm *vmm, u8 shift, u64 addr, u64 size, u64 *pfn)
 		return -ENOENT;
 
 	do {
+		const struct nvkm_vmm_page *used = page;
 		bool map = !!(pfn[pi] & NVKM_VMM_PFN_V);
 		bool mapped = vma->mapped;
 		u64 size = limit - start;
 		u64 addr = start;
+		bool run = false;
 		int pn, ret = 0;
+		u64 span;
 
 		/* Narrow the operation window to cover a single action (page
 		 * should be mapped or not) within a single VMA.
@@ -1260,52 +1768,64 @@ nvkm_vmm_pfn_map(struct nvkm_vmm *vmm, u8 shift, u64 addr, u64 size, u64 *pfn)
 			goto next;
 		}
 
+		/* Physically contiguous runs are mapped as a whole, further
+		 * narrowing the window to a single run (and those following
+		 * it that can be mapped along with it), or to the pages
+		 * before the next one.
+		 */
+		span = size;
+		if (map) {
+			used = nvkm_vmm_pfn_page(vmm, page, addr, &pfn[pi],
+						 &size, &run);
+		}
+
+		/* Existing mappings need to be torn down first, as writing
+		 * new PTEs over them would lose track of their DMA mappings.
+		 */
+		if (mapped) {
+			nvkm_vmm_pfn_unmap(vmm, addr, size);
+			if (!(vma = nvkm_vmm_node_search(vmm, addr)))
+				return -ENOENT;
+			continue;
+		}
+
+		if (run) {
+			ret = nvkm_vmm_pfn_map_runs(vmm, &vma, page, used, addr,
+						    &size, span, &pfn[pi]);
+			goto next;
+		}
+
 		/* In order to both properly refcount GPU page tables, and
 		 * prevent "normal" mappings and these direct mappings from
 		 * interfering with each other, we need to track contiguous
 		 * ranges that have been mapped with this interface.
 		 *
 		 * Here we attempt to either split an existing VMA so we're
-		 * able to flag the region as either unmapped/mapped, or to
-		 * merge with adjacent VMAs that are already compatible.
+		 * able to flag the region as mapped, or to merge with adjacent
+		 * VMAs that are already compatible.
 		 *
-		 * If the region is already compatible, nothing is required.
+		 * An unmapped region that's to stay that way needs nothing.
 		 */
-		if (map != mapped) {
+		if (map) {
+			struct nvkm_vmm_map args = {};
+
 			tmp = nvkm_vmm_pfn_split_merge(vmm, vma, addr, size,
-						       page -
+						       used -
 						       vmm->func->page, map);
 			if (WARN_ON(!tmp)) {
 				ret = -ENOMEM;
 				goto next;
 			}
 
-			if ((tmp->mapped = map))
-				tmp->refd = page - vmm->func->page;
-			else
-				tmp->refd = NVKM_VMA_PAGE_NONE;
+			tmp->mapped = true;
+			tmp->refd = used - vmm->func->page;
 			vma = tmp;
-		}
 
-		/* Update HW page tables. */
-		if (map) {
-			struct nvkm_vmm_map args;
-			args.page = page;
+			/* Update HW page tables. */
+			args.page = used;
 			args.pfn = &pfn[pi];
-
-			if (!mapped) {
-				ret = nvkm_vmm_ptes_get_map(vmm, page, addr,
-							    size, &args, page->
-							    desc->func->pfn);
-			} else {
-				nvkm_vmm_ptes_map(vmm, page, addr, size, &args,
-						  page->desc->func->pfn);
-			}
-		} else {
-			if (mapped) {
-				nvkm_vmm_ptes_unmap_put(vmm, page, addr, size,
-							false, true);
-			}
+			ret = nvkm_vmm_ptes_get_map(vmm, used, addr, size,
+						    &args, used->desc->func->pfn);
 		}
 
 next:
@@ -1339,26 +1859,40 @@ nvkm_vmm_unmap_region(struct nvkm_vmm *vmm, struct nvkm_vma *vma)
 	nvkm_memory_tags_put(vma->memory, vmm->mmu->subdev.device, &vma->tags);
 	nvkm_memory_unref(&vma->memory);
 	vma->mapped = false;
+	vma->pfn = 0;
+	vma->dma = 0;
 
-	if (vma->part && (prev = node(vma, prev)) && prev->mapped)
+	/* Busy neighbours may be in the middle of being mapped by another
+	 * thread, and must not be merged away from under it.
+	 */
+	if (vma->part && (prev = node(vma, prev)) &&
+	    (prev->mapped || prev->busy))
 		prev = NULL;
-	if ((next = node(vma, next)) && (!next->part || next->mapped))
+	if ((next = node(vma, next)) &&
+	    (!next->part || next->mapped || next->busy))
 		next = NULL;
 	nvkm_vmm_node_merge(vmm, prev, vma, next, vma->size);
 }
 
+/* Page tables are updated without holding vmm->mutex, which is dropped
+ * and retaken here.  The VMA is marked busy in the meantime.
+ */
 void
 nvkm_vmm_unmap_locked(struct nvkm_vmm *vmm, struct nvkm_vma *vma, bool pfn)
 {
 	const struct nvkm_vmm_page *page = &vmm->func->page[vma->refd];
 
-	if (vma->mapref) {
+	vma->busy = true;
+	mutex_unlock(&vmm->mutex);
+	if (vma->mapref)
 		nvkm_vmm_ptes_unmap_put(vmm, page, vma->addr, vma->size, vma->sparse, pfn);
-		vma->refd = NVKM_VMA_PAGE_NONE;
-	} else {
+	else
 		nvkm_vmm_ptes_unmap(vmm, page, vma->addr, vma->size, vma->sparse, pfn);
-	}
+	mutex_lock(&vmm->mutex);
+	vma->busy = false;
 
+	if (vma->mapref)
+		vma->refd = NVKM_VMA_PAGE_NONE;
 	nvkm_vmm_unmap_region(vmm, vma);
 }
 
@@ -1487,15 +2021,24 @@ nvkm_vmm_map_locked(struct nvkm_vmm *vmm, struct nvkm_vma *vma,
 		func = map->page->desc->func->dma;
 	}
 
-	/* Perform the map. */
+	/* Perform the map.
+	 *
+	 * Page tables are updated without holding vmm->mutex, the VMA is
+	 * marked busy in the meantime, and the caller is expected to clear
+	 * the flag again.
+	 */
+	vma->busy = true;
+	mutex_unlock(&vmm->mutex);
 	if (vma->refd == NVKM_VMA_PAGE_NONE) {
 		ret = nvkm_vmm_ptes_get_map(vmm, map->page, vma->addr, vma->size, map, func);
+		mutex_lock(&vmm->mutex);
 		if (ret)
 			return ret;
 
 		vma->refd = map->page - vmm->func->page;
 	} else {
 		nvkm_vmm_ptes_map(vmm, map->page, vma->addr, vma->size, map, func);
+		mutex_lock(&vmm->mutex);
 	}
 
 	nvkm_memory_tags_put(vma->memory, vmm->mmu->subdev.device, &vma->tags);
@@ -1537,29 +2080,38 @@ nvkm_vmm_put_region(struct nvkm_vmm *vmm, struct nvkm_vma *vma)
 	nvkm_vmm_free_insert(vmm, vma);
 }
 
+/* Page tables are updated without holding vmm->mutex, which is dropped
+ * and retaken here.  The VMA is marked busy in the meantime.
+ */
 void
 nvkm_vmm_put_locked(struct nvkm_vmm *vmm, struct nvkm_vma *vma)
 {
 	const struct nvkm_vmm_page *page = vmm->func->page;
 	struct nvkm_vma *next = vma;
+	bool more;
 
 	BUG_ON(vma->part);
+	vma->busy = true;
 
 	if (vma->mapref || !vma->sparse) {
 		do {
+			struct nvkm_vma *head = next;
 			const bool mem = next->memory != NULL;
 			const bool map = next->mapped;
 			const u8  refd = next->refd;
 			const u64 addr = next->addr;
+			const bool pfn = next->pfn != 0;
 			u64 size = next->size;
 
 			/* Merge regions that are in the same state. */
 			while ((next = node(next, next)) && next->part &&
 			       (next->mapped == map) &&
 			       (next->memory != NULL) == mem &&
-			       (next->refd == refd))
+			       (next->refd == refd) && (next->pfn != 0) == pfn)
 				size += next->size;
+			more = next && next->part;
 
+			mutex_unlock(&vmm->mutex);
 			if (map) {
 				/* Region(s) are mapped, merge the unmap
 				 * and dereference into a single walk of
@@ -1567,46 +2119,67 @@ nvkm_vmm_put_locked(struct nvkm_vmm *vmm, struct nvkm_vma *vma)
 				 */
 				nvkm_vmm_ptes_unmap_put(vmm, &page[refd], addr,
 							size, vma->sparse,
-							!mem);
+							!mem && !pfn);
 			} else
 			if (refd != NVKM_VMA_PAGE_NONE) {
 				/* Drop allocation-time PTE references. */
 				nvkm_vmm_ptes_put(vmm, &page[refd], addr, size);
 			}
-		} while (next && next->part);
+			mutex_lock(&vmm->mutex);
+
+			/* Runs mapped by nvkm_vmm_pfn_map() may each have a
+			 * DMA mapping of their own to release.
+			 */
+			for (; map && pfn && head != next;
+			     head = node(head, next)) {
+				nvkm_vmm_pfn_dma_unmap(vmm, head->pfn, head->dma,
+						       head->size);
+			}
+		} while (more);
 	}
 
 	/* Merge any mapped regions that were split from the initial
 	 * address-space allocation back into the allocated VMA, and
 	 * release memory/compression resources.
+	 *
+	 * The VMA itself mustn't look busy to nvkm_vmm_unmap_region() here,
+	 * or its parts won't be merged back into it.
 	 */
+	vma->busy = false;
 	next = vma;
 	do {
 		if (next->mapped)
 			nvkm_vmm_unmap_region(vmm, next);
 	} while ((next = node(vma, next)) && next->part);
 
-	if (vma->sparse && !vma->mapref) {
-		/* Sparse region that was allocated with a fixed page size,
-		 * meaning all relevant PTEs were referenced once when the
-		 * region was allocated, and remained that way, regardless
-		 * of whether memory was mapped into it afterwards.
-		 *
-		 * The process of unmapping, unsparsing, and dereferencing
-		 * PTEs can be done in a single page tree walk.
-		 */
-		nvkm_vmm_ptes_sparse_put(vmm, &page[vma->refd], vma->addr, vma->size);
-	} else
 	if (vma->sparse) {
-		/* Sparse region that wasn't allocated with a fixed page size,
-		 * PTE references were taken both at allocation time (to make
-		 * the GPU see the region as sparse), and when mapping memory
-		 * into the region.
-		 *
-		 * The latter was handled above, and the remaining references
-		 * are dealt with here.
-		 */
-		nvkm_vmm_ptes_sparse(vmm, vma->addr, vma->size, false);
+		vma->busy = true;
+		mutex_unlock(&vmm->mutex);
+		if (!vma->mapref) {
+			/* Sparse region that was allocated with a fixed page
+			 * size, meaning all relevant PTEs were referenced once
+			 * when the region was allocated, and remained that way,
+			 * regardless of whether memory was mapped into it
+			 * afterwards.
+			 *
+			 * The process of unmapping, unsparsing, and
+			 * dereferencing PTEs can be done in a single page tree
+			 * walk.
+			 */
+			nvkm_vmm_ptes_sparse_put(vmm, &page[vma->refd],
+						 vma->addr, vma->size);
+		} else {
+			/* Sparse region that wasn't allocated with a fixed
+			 * page size, PTE references were taken both at
+			 * allocation time (to make the GPU see the region as
+			 * sparse), and when mapping memory into the region.
+			 *
+			 * The latter was handled above, and the remaining
+			 * references are dealt with here.
+			 */
+			nvkm_vmm_ptes_sparse(vmm, vma->addr, vma->size, false);
+		}
+		mutex_lock(&vmm->mutex);
 	}
 
 	/* Remove VMA from the list of allocated nodes. */
@@ -1617,6 +2190,7 @@ nvkm_vmm_put_locked(struct nvkm_vmm *vmm, struct nvkm_vma *vma)
 	vma->refd = NVKM_VMA_PAGE_NONE;
 	vma->used = false;
 	vma->user = false;
+	vma->busy = false;
 	nvkm_vmm_put_region(vmm, vma);
 }
 
@@ -1746,16 +2320,26 @@ nvkm_vmm_get_locked(struct nvkm_vmm *vmm, bool getref, bool mapref, bool sparse,
 		nvkm_vmm_free_insert(vmm, tmp);
 	}
 
-	/* Pre-allocate page tables and/or setup sparse mappings. */
-	if (sparse && getref)
-		ret = nvkm_vmm_ptes_sparse_get(vmm, page, vma->addr, vma->size);
-	else if (sparse)
-		ret = nvkm_vmm_ptes_sparse(vmm, vma->addr, vma->size, true);
-	else if (getref)
-		ret = nvkm_vmm_ptes_get(vmm, page, vma->addr, vma->size);
-	else
-		ret = 0;
+	/* Pre-allocate page tables and/or setup sparse mappings.
+	 *
+	 * The VMA isn't in either tree at this point, so nobody else can
+	 * find it while vmm->mutex is dropped, but it needs to be marked
+	 * as used to prevent it being merged into a neighbouring free VMA.
+	 */
+	ret = 0;
+	if (sparse || getref) {
+		vma->used = true;
+		mutex_unlock(&vmm->mutex);
+		if (sparse && getref)
+			ret = nvkm_vmm_ptes_sparse_get(vmm, page, vma->addr, vma->size);
+		else if (sparse)
+			ret = nvkm_vmm_ptes_sparse(vmm, vma->addr, vma->size, true);
+		else
+			ret = nvkm_vmm_ptes_get(vmm, page, vma->addr, vma->size);
+		mutex_lock(&vmm->mutex);
+	}
 	if (ret) {
+		vma->used = false;
 		nvkm_vmm_put_region(vmm, vma);
 		return ret;
 	}
@@ -1785,7 +2369,9 @@ nvkm_vmm_part(struct nvkm_vmm *vmm, struct nvkm_memory *inst)
 {
 	if (inst && vmm && vmm->func->part) {
 		mutex_lock(&vmm->mutex);
+		mutex_lock(&vmm->ptes);
 		vmm->func->part(vmm, inst);
+		mutex_unlock(&vmm->ptes);
 		mutex_unlock(&vmm->mutex);
 	}
 }
@@ -1796,7 +2382,9 @@ nvkm_vmm_join(struct nvkm_vmm *vmm, struct nvkm_memory *inst)
 	int ret = 0;
 	if (vmm->func->join) {
 		mutex_lock(&vmm->mutex);
+		mutex_lock(&vmm->ptes);
 		ret = vmm->func->join(vmm, inst);
+		mutex_unlock(&vmm->ptes);
 		mutex_unlock(&vmm->mutex);
 	}
 	return ret;
@@ -1807,7 +2395,15 @@ nvkm_vmm_boot_ptes(struct nvkm_vmm_iter *it, bool pfn, u32 ptei, u32 ptes)
 {
 	const struct nvkm_vmm_desc *desc = it->desc;
 	const int type = desc->type == SPT;
+
+	/* Mapping the PT into the VMM it belongs to walks the page tree
+	 * again, which would deadlock on vmm->ptes.  Nothing else can see
+	 * the VMM yet, and the references taken by nvkm_vmm_boot() keep the
+	 * tree alive.
+	 */
+	mutex_unlock(&it->vmm->ptes);
 	nvkm_memory_boot(it->pt[0]->pt[type]->memory, it->vmm);
+	mutex_lock(&it->vmm->ptes);
 	return false;
 }
 
@@ -150,6 +150,7 @@ struct nvkm_vmm_func {
 
 	void (*invalidate_pdb)(struct nvkm_vmm *, u64 addr);
 
+	bool packed; /* PTEs share words, and are updated with an RMW. */
 	u64 page_block;
 	const struct nvkm_vmm_page page[];
 };
@@ -169,6 +170,7 @@ int nvkm_vmm_ctor(const struct nvkm_vmm_func *, struct nvkm_mmu *,
 struct nvkm_vma *nvkm_vmm_node_search(struct nvkm_vmm *, u64 addr);
 struct nvkm_vma *nvkm_vmm_node_split(struct nvkm_vmm *, struct nvkm_vma *,
 				     u64 addr, u64 size);
+u64 nvkm_vmm_node_extent(struct nvkm_vmm *, struct nvkm_vma *);
 int nvkm_vmm_get_locked(struct nvkm_vmm *, bool getref, bool mapref,
 			bool sparse, u8 page, u8 align, u64 size,
 			struct nvkm_vma **pvma);
@@ -176,6 +178,16 @@ void nvkm_vmm_put_locked(struct nvkm_vmm *, struct nvkm_vma *);
 void nvkm_vmm_unmap_locked(struct nvkm_vmm *, struct nvkm_vma *, bool pfn);
 void nvkm_vmm_unmap_region(struct nvkm_vmm *, struct nvkm_vma *);
 
+struct nvkm_vmm_range {
+	struct list_head head;
+	u64 addr;
+	u64 size;
+};
+
+void nvkm_vmm_range_lock(struct nvkm_vmm *, struct nvkm_vmm_range *,
+			 u64 addr, u64 size);
+void nvkm_vmm_range_unlock(struct nvkm_vmm *, struct nvkm_vmm_range *);
+
 #define NVKM_VMM_PFN_ADDR                                 0xfffffffffffff000ULL
 #define NVKM_VMM_PFN_ADDR_SHIFT                                              12
 #define NVKM_VMM_PFN_APER                                 0x00000000000000f0ULL
@@ -76,8 +76,16 @@ gp100_vmm_pgt_pfn(struct nvkm_vmm *vmm, struct nvkm_mmu_pt *pt,
 		  u32 ptei, u32 ptes, struct nvkm_vmm_map *map)
 {
 	struct device *dev = vmm->mmu->subdev.device->dev;
+	const u64 size = 1ULL << map->page->shift;
+	const u32 pfns = size >> PAGE_SHIFT;
 	dma_addr_t addr;
 
+	/* Each PTE covers a physically contiguous run of "pfns" entries,
+	 * nvkm_vmm_pfn_map() only selects large pages where that holds.
+	 * Host memory that's part of a longer run comes with the address
+	 * of each page in map->dma, anything else gets DMA-mapped here, a
+	 * page at a time.
+	 */
 	nvkm_kmap(pt->memory);
 	while (ptes--) {
 		u64 data = 0;
@@ -85,9 +93,13 @@ gp100_vmm_pgt_pfn(struct nvkm_vmm *vmm, struct nvkm_mmu_pt *pt,
 			data |= BIT_ULL(6); /* RO. */
 
 		if (!(*map->pfn & NVKM_VMM_PFN_VRAM)) {
-			addr = *map->pfn >> NVKM_VMM_PFN_ADDR_SHIFT;
-			addr = dma_map_page(dev, pfn_to_page(addr), 0,
-					    PAGE_SIZE, DMA_BIDIRECTIONAL);
+			if (!map->dma) {
+				addr = *map->pfn >> NVKM_VMM_PFN_ADDR_SHIFT;
+				addr = dma_map_page(dev, pfn_to_page(addr), 0,
+						    PAGE_SIZE, DMA_BIDIRECTIONAL);
+			} else {
+				addr = *map->dma;
+			}
 			if (!WARN_ON(dma_mapping_error(dev, addr))) {
 				data |= addr >> 4;
 				data |= 2ULL << 1; /* SYSTEM_COHERENT_MEMORY. */
@@ -100,7 +112,9 @@ gp100_vmm_pgt_pfn(struct nvkm_vmm *vmm, struct nvkm_mmu_pt *pt,
 		}
 
 		VMM_WO064(pt, vmm, ptei++ * 8, data);
-		map->pfn++;
+		map->pfn += pfns;
+		if (map->dma)
+			map->dma += pfns;
 	}
 	nvkm_done(pt->memory);
 }
@@ -186,6 +200,7 @@ gp100_vmm_desc_lpt = {
 	.unmap = gf100_vmm_pgt_unmap,
 	.sparse = gp100_vmm_pgt_sparse,
 	.mem = gp100_vmm_pgt_mem,
+	.pfn = gp100_vmm_pgt_pfn,
 };
 
 static inline void
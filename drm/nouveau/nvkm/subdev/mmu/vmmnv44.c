@@ -198,6 +198,7 @@ static const struct nvkm_vmm_func
 nv44_vmm = {
 	.valid = nv04_vmm_valid,
 	.flush = nv44_vmm_flush,
+	.packed = true,
 	.page = {
 		{ 12, &nv44_vmm_desc_12[0], NVKM_VMM_PAGE_HOST },
 		{}
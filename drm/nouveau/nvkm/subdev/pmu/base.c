@@ -85,6 +85,9 @@ nvkm_pmu_fini(struct nvkm_subdev *subdev, bool suspend)
 		pmu->func->fini(pmu);
 
 	flush_work(&pmu->recv.work);
+
+	/* PMU state is lost, and register state may change behind our back. */
+	nvkm_memx_cache_fini(pmu);
 	return 0;
 }
 
@@ -144,6 +147,7 @@ static void *
 nvkm_pmu_dtor(struct nvkm_subdev *subdev)
 {
 	struct nvkm_pmu *pmu = nvkm_pmu(subdev);
+	nvkm_memx_cache_fini(pmu);
 	nvkm_msgqueue_del(&pmu->queue);
 	nvkm_falcon_del(&pmu->falcon);
 	return nvkm_pmu(subdev);
@@ -167,6 +171,8 @@ nvkm_pmu_ctor(const struct nvkm_pmu_func *func, struct nvkm_device *device,
 	pmu->func = func;
 	INIT_WORK(&pmu->recv.work, nvkm_pmu_recv);
 	init_waitqueue_head(&pmu->recv.wait);
+	mutex_init(&pmu->memx.mutex);
+	INIT_LIST_HEAD(&pmu->memx.cache);
 	return 0;
 }
 
@@ -3,6 +3,21 @@
 #define __NVKM_PMU_MEMX_H__
 #include "priv.h"
 
+/* Maximum number of compiled scripts kept around for reuse. */
+#define NVKM_MEMX_CACHE 8
+
+struct nvkm_memx_script {
+	struct list_head head;
+	struct nvkm_memx_key key;
+	u32 *data;
+	u32 size;
+	/* Register values the script was generated against. */
+	u32 (*reads)[2];
+	u32 reads_nr;
+	u64 hits;
+	s64 build;
+};
+
 struct nvkm_memx {
 	struct nvkm_pmu *pmu;
 	u32 base;
@@ -12,18 +27,36 @@ struct nvkm_memx {
 		u32 size;
 		u32 data[64];
 	} c;
+
+	/* The script is assembled on the host and uploaded in one go. */
+	u32 *data;
+	u32 data_nr;
+	bool overflow;
+
+	struct {
+		u32 data[256][2];
+		u32 nr;
+	} reads;
+
+	struct nvkm_memx_key key;
+	bool keyed;
+	struct nvkm_memx_script *script;
+	s64 time;
 };
 
 static void
 memx_out(struct nvkm_memx *memx)
 {
-	struct nvkm_device *device = memx->pmu->subdev.device;
-	int i;
-
 	if (memx->c.mthd) {
-		nvkm_wr32(device, 0x10a1c4, (memx->c.size << 16) | memx->c.mthd);
-		for (i = 0; i < memx->c.size; i++)
-			nvkm_wr32(device, 0x10a1c4, memx->c.data[i]);
+		if (memx->data_nr + 1 + memx->c.size > memx->size / 4) {
+			memx->overflow = true;
+		} else {
+			memx->data[memx->data_nr++] =
+				(memx->c.size << 16) | memx->c.mthd;
+			memcpy(&memx->data[memx->data_nr], memx->c.data,
+			       memx->c.size * sizeof(memx->c.data[0]));
+			memx->data_nr += memx->c.size;
+		}
 		memx->c.mthd = 0;
 		memx->c.size = 0;
 	}
@@ -40,10 +73,142 @@ memx_cmd(struct nvkm_memx *memx, u32 mthd, u32 size, u32 data[])
 	memx->c.mthd  = mthd;
 }
 
+static void
+memx_script_del(struct nvkm_memx_script **pscript)
+{
+	struct nvkm_memx_script *script = *pscript;
+
+	if (script) {
+		list_del(&script->head);
+		kfree(script->reads);
+		kfree(script->data);
+		kfree(*pscript);
+		*pscript = NULL;
+	}
+}
+
+/* Must be called with the cache mutex held. */
+static void
+memx_script_drop(struct nvkm_pmu *pmu, const struct nvkm_memx_key *key)
+{
+	struct nvkm_memx_script *script, *temp;
+
+	list_for_each_entry_safe(script, temp, &pmu->memx.cache, head) {
+		if (!memcmp(&script->key, key, sizeof(*key))) {
+			memx_script_del(&script);
+			pmu->memx.cache_nr--;
+		}
+	}
+}
+
+static void
+memx_script_new(struct nvkm_memx *memx, s64 build)
+{
+	struct nvkm_pmu *pmu = memx->pmu;
+	struct nvkm_memx_script *script;
+
+	if (!(script = kzalloc(sizeof(*script), GFP_KERNEL)))
+		return;
+
+	script->key = memx->key;
+	script->size = memx->data_nr;
+	script->reads_nr = memx->reads.nr;
+	script->build = build;
+	script->data = kmemdup(memx->data, memx->data_nr * 4, GFP_KERNEL);
+	script->reads = kmemdup(memx->reads.data, memx->reads.nr * 8,
+				GFP_KERNEL);
+	if (!script->data || (!script->reads && script->reads_nr)) {
+		kfree(script->reads);
+		kfree(script->data);
+		kfree(script);
+		return;
+	}
+
+	mutex_lock(&pmu->memx.mutex);
+	memx_script_drop(pmu, &script->key);
+	if (pmu->memx.cache_nr == NVKM_MEMX_CACHE) {
+		struct nvkm_memx_script *last =
+			list_last_entry(&pmu->memx.cache, typeof(*last), head);
+		memx_script_del(&last);
+		pmu->memx.cache_nr--;
+	}
+	list_add(&script->head, &pmu->memx.cache);
+	pmu->memx.cache_nr++;
+	mutex_unlock(&pmu->memx.mutex);
+}
+
+/* Look for a previously compiled script for the given transition.  If one
+ * exists, and the registers it was generated from still hold the same
+ * values, it's loaded and the caller can skip generating the script.
+ * Otherwise, the script the caller generates will be cached on execution.
+ */
+bool
+nvkm_memx_cache(struct nvkm_memx *memx, const struct nvkm_memx_key *key)
+{
+	struct nvkm_pmu *pmu = memx->pmu;
+	struct nvkm_subdev *subdev = &pmu->subdev;
+	struct nvkm_device *device = subdev->device;
+	struct nvkm_memx_script *script;
+	u32 i;
+
+	memx->key = *key;
+	memx->keyed = true;
+
+	mutex_lock(&pmu->memx.mutex);
+	list_for_each_entry(script, &pmu->memx.cache, head) {
+		if (memcmp(&script->key, key, sizeof(*key)))
+			continue;
+
+		for (i = 0; i < script->reads_nr; i++) {
+			const u32 addr = script->reads[i][0];
+			if (nvkm_rd32(device, addr) != script->reads[i][1]) {
+				nvkm_debug(subdev, "memx: R[%06x] changed, "
+						   "dropping cached script\n",
+					   addr);
+				memx_script_del(&script);
+				pmu->memx.cache_nr--;
+				mutex_unlock(&pmu->memx.mutex);
+				return false;
+			}
+		}
+
+		/* Replaced by whatever the caller builds instead. */
+		if (script->size > memx->size / 4)
+			break;
+
+		memcpy(memx->data, script->data, script->size * 4);
+		memx->data_nr = script->size;
+		memx->script = script;
+		script->hits++;
+		list_move(&script->head, &pmu->memx.cache);
+		mutex_unlock(&pmu->memx.mutex);
+		return true;
+	}
+	mutex_unlock(&pmu->memx.mutex);
+	return false;
+}
+
+void
+nvkm_memx_cache_fini(struct nvkm_pmu *pmu)
+{
+	struct nvkm_memx_script *script, *temp;
+
+	mutex_lock(&pmu->memx.mutex);
+	list_for_each_entry_safe(script, temp, &pmu->memx.cache, head) {
+		nvkm_debug(&pmu->subdev, "memx: %d->%d kHz (T%d/%08x): "
+					 "%d words, build %lldus, %llu hits\n",
+			   script->key.from, script->key.to, script->key.temp,
+			   script->key.data, script->size, script->build,
+			   script->hits);
+		memx_script_del(&script);
+	}
+	pmu->memx.cache_nr = 0;
+	mutex_unlock(&pmu->memx.mutex);
+}
+
 int
 nvkm_memx_init(struct nvkm_pmu *pmu, struct nvkm_memx **pmemx)
 {
-	struct nvkm_device *device = pmu->subdev.device;
 	struct nvkm_memx *memx;
 	u32 reply[2];
 	int ret;
@@ -59,12 +224,15 @@ nvkm_memx_init(struct nvkm_pmu *pmu, struct nvkm_memx **pmemx)
 	memx->pmu = pmu;
 	memx->base = reply[0];
 	memx->size = reply[1];
+	memx->time = ktime_to_us(ktime_get());
+
+	memx->data = kmalloc(memx->size, GFP_KERNEL);
+	if (!memx->data) {
+		kfree(memx);
+		*pmemx = NULL;
+		return -ENOMEM;
+	}
 
-	/* acquire data segment access */
-	do {
-		nvkm_wr32(device, 0x10a580, 0x00000003);
-	} while (nvkm_rd32(device, 0x10a580) != 0x00000003);
-	nvkm_wr32(device, 0x10a1c0, 0x01000000 | memx->base);
 	return 0;
 }
 
@@ -75,25 +243,79 @@ nvkm_memx_fini(struct nvkm_memx **pmemx, bool exec)
 	struct nvkm_pmu *pmu = memx->pmu;
 	struct nvkm_subdev *subdev = &pmu->subdev;
 	struct nvkm_device *device = subdev->device;
-	u32 finish, reply[2];
+	u32 finish, reply[2], i;
+	s64 time, build;
+	int ret = 0;
 
 	/* flush the cache... */
 	memx_out(memx);
 
-	/* release data segment access */
-	finish = nvkm_rd32(device, 0x10a1c0) & 0x00ffffff;
-	nvkm_wr32(device, 0x10a580, 0x00000000);
+	time = ktime_to_us(ktime_get());
+	build = time - memx->time;
+
+	if (memx->overflow) {
+		nvkm_error(subdev, "memx script exceeds %d bytes\n",
+			   memx->size);
+		ret = -ENOSPC;
+		exec = false;
+	}
 
 	/* call MEMX process to execute the script, and wait for reply */
 	if (exec) {
+		/* acquire data segment access, and upload the script */
+		do {
+			nvkm_wr32(device, 0x10a580, 0x00000003);
+		} while (nvkm_rd32(device, 0x10a580) != 0x00000003);
+		nvkm_wr32(device, 0x10a1c0, 0x01000000 | memx->base);
+		for (i = 0; i < memx->data_nr; i++)
+			nvkm_wr32(device, 0x10a1c4, memx->data[i]);
+
+		/* release data segment access */
+		finish = nvkm_rd32(device, 0x10a1c0) & 0x00ffffff;
+		nvkm_wr32(device, 0x10a580, 0x00000000);
+
 		nvkm_pmu_send(pmu, reply, PROC_MEMX, MEMX_MSG_EXEC,
 			      memx->base, finish);
 		nvkm_debug(subdev, "Exec took %uns, PMU_IN %08x\n",
 			   reply[0], reply[1]);
+
+		if (memx->keyed) {
+			nvkm_debug(subdev, "memx: %d->%d kHz (T%d/%08x): %s, "
+					   "%d words, build %lldus, "
+					   "upload+exec %lldus\n",
+				   memx->key.from, memx->key.to,
+				   memx->key.temp, memx->key.data,
+				   memx->script ? "cached" : "built",
+				   memx->data_nr, build,
+				   ktime_to_us(ktime_get()) - time);
+
+			if (!memx->script &&
+			    memx->reads.nr <= ARRAY_SIZE(memx->reads.data))
+				memx_script_new(memx, build);
+		}
 	}
 
+	kfree(memx->data);
 	kfree(memx);
-	return 0;
+	*pmemx = NULL;
+	return ret;
+}
+
+u32
+nvkm_memx_rd32(struct nvkm_memx *memx, u32 addr)
+{
+	struct nvkm_device *device = memx->pmu->subdev.device;
+	u32 data = nvkm_rd32(device, addr);
+
+	/* Track what the script depends on, for cache validation.  Running
+	 * out of space makes the script uncacheable.
+	 */
+	if (memx->reads.nr < ARRAY_SIZE(memx->reads.data)) {
+		memx->reads.data[memx->reads.nr][0] = addr;
+		memx->reads.data[memx->reads.nr][1] = data;
+	}
+	memx->reads.nr++;
+	return data;
 }
 
 void
@@ -9,6 +9,7 @@ int nvkm_pmu_ctor(const struct nvkm_pmu_func *, struct nvkm_device *,
 		  int index, struct nvkm_pmu *);
 int nvkm_pmu_new_(const struct nvkm_pmu_func *, struct nvkm_device *,
 		  int index, struct nvkm_pmu **);
+void nvkm_memx_cache_fini(struct nvkm_pmu *);
 
 struct nvkm_pmu_func {
 	struct {
@@ -65,3 +65,42 @@ release_firmware(const struct firmware *fw)
 	free(fw->data);
 	free((void *)fw);
 }
+
+/* Written to a temporary file alongside, then renamed over the original,
+ * so a reader never sees a partially-written cache.
+ */
+int
+firmware_cache_write(const char *name, const void *data, size_t size)
+{
+	ssize_t ret;
+	char *path;
+	int fd;
+
+	if (!(path = malloc(strlen(name) + 8)))
+		return -ENOMEM;
+	sprintf(path, "%s.XXXXXX", name);
+
+	fd = mkstemp(path);
+	if (fd < 0) {
+		ret = -errno;
+		goto done;
+	}
+
+	ret = pwrite(fd, data, size, 0);
+	if (ret != size || fchmod(fd, 0644) || fsync(fd)) {
+		close(fd);
+		unlink(path);
+		ret = -EIO;
+		goto done;
+	}
+	close(fd);
+
+	ret = 0;
+	if (rename(path, name)) {
+		ret = -errno;
+		unlink(path);
+	}
+done:
+	free(path);
+	return ret;
+}
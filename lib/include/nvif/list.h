@@ -216,6 +216,12 @@ list_del_init(struct list_head *entry)
     INIT_LIST_HEAD(entry);
 }
 
+static inline void list_move(struct list_head *list, struct list_head *head)
+{
+	__list_del(list->prev, list->next);
+	list_add(list, head);
+}
+
 static inline void list_move_tail(struct list_head *list,
 				  struct list_head *head)
 {
@@ -237,6 +243,20 @@ list_empty(struct list_head *head)
     return head->next == head;
 }
 
+/**
+ * Check if the list contains exactly one element.
+ *
+ * Example:
+ * list_is_singular(&bar->list_of_foos);
+ *
+ * @return True if the list contains exactly one element or False otherwise.
+ */
+static inline bool
+list_is_singular(struct list_head *head)
+{
+    return !list_empty(head) && head->next == head->prev;
+}
+
 /**
  * Returns a pointer to the container of this list element.
  *
@@ -70,6 +70,7 @@ typedef dma_addr_t resource_size_t;
 #define max_t(t,a,b) max((t)(a), (t)(b))
 #define min_t(t,a,b) min((t)(a), (t)(b))
 #define clamp(a,b,c) min(max((a), (b)), (c))
+#define clamp_t(t,a,b,c) clamp((t)(a), (t)(b), (t)(c))
 #define roundup(a,b) ((((a) + ((b) - 1)) / (b)) * (b))
 #define round_up(a,b) roundup((a), (b))
 #define rounddown(a,b) ((a) / (b) * (b))
@@ -88,8 +89,9 @@ typedef dma_addr_t resource_size_t;
 }							\
 )
 #define do_div(a,b) (a) = (a) / (b)
-#define div_u64(a,b) (a) / (b)
-#define div64_s64(a,b) (a) / (b)
+#define div_u64(a,b) ((a) / (b))
+#define div64_s64(a,b) ((a) / (b))
+#define div64_u64(a,b) ((a) / (b))
 #define likely(a) (a)
 #define unlikely(a) (a)
 #define BIT(a) (1UL << (a))
@@ -386,6 +388,8 @@ typedef struct atomic {
 #define atomic_or(a,b) (void) __sync_fetch_and_or(&(b)->value, (a));
 #define atomic_xchg(a,b) \
 	__atomic_exchange_n(&(a)->value, (b), __ATOMIC_SEQ_CST)
+#define atomic_cmpxchg(a,b,c) \
+	__sync_val_compare_and_swap(&(a)->value, (b), (c))
 
 static inline bool
 atomic_inc_not_zero(atomic_t *a)
@@ -408,6 +412,7 @@ typedef struct refcount {
 } refcount_t;
 
 #define refcount_set(a,b) atomic_set(&(a)->atomic, (b))
+#define refcount_read(a) atomic_read(&(a)->atomic)
 #define refcount_inc(a) atomic_inc(&(a)->atomic)
 #define refcount_inc_not_zero(a) atomic_inc_not_zero(&(a)->atomic)
 #define refcount_dec_and_test(a) atomic_dec_and_test(&(a)->atomic)
@@ -430,6 +435,7 @@ struct kref {
 };
 
 #define kref_init(a) refcount_set(&(a)->refcount, 1)
+#define kref_read(a) refcount_read(&(a)->refcount)
 #define kref_get(a) refcount_inc(&(a)->refcount)
 #define kref_put(a,b) if (refcount_dec_and_test(&(a)->refcount)) b(a)
 
@@ -546,6 +552,15 @@ kmemdup(const void *src, size_t len, gfp_t gfp)
 	return dst;
 }
 
+static inline void *
+memset32(u32 *s, u32 v, size_t count)
+{
+	u32 *p = s;
+	while (count--)
+		*p++ = v;
+	return s;
+}
+
 struct page {
 };
 
@@ -560,22 +575,23 @@ __free_page(struct page *page)
 {
 }
 
+/* There's no memmap, a struct page pointer is just the PFN it's for. */
 static inline dma_addr_t
-page_to_phys(struct page *page)
+page_to_pfn(struct page *page)
 {
-	return 0;
+	return (uintptr_t)page;
 }
 
-static inline struct page *
-pfn_to_page(dma_addr_t pfn)
+static inline dma_addr_t
+page_to_phys(struct page *page)
 {
-	return NULL;
+	return page_to_pfn(page) << PAGE_SHIFT;
 }
 
-static inline dma_addr_t
-page_to_pfn(struct page *page)
+static inline struct page *
+pfn_to_page(dma_addr_t pfn)
 {
-	return 0;
+	return (struct page *)(uintptr_t)pfn;
 }
 
 static inline unsigned long
@@ -1041,24 +1057,29 @@ iommu_unmap(struct iommu_domain *domain, unsigned long iova, size_t size)
  * DMA
  *****************************************************************************/
 #define DMA_BIT_MASK(a) (((a) == 64) ? ~0ULL : ((1ULL << (a)) - 1))
+#define DMA_MAPPING_ERROR (~(dma_addr_t)0)
+
+dma_addr_t nvos_dma_map(u64 phys, u64 size);
+void nvos_dma_unmap(dma_addr_t addr, u64 size);
 
 static inline dma_addr_t
-dma_map_page(struct device *pdev, struct page *page, int offset,
-	     int length, unsigned flags)
+dma_map_page(struct device *pdev, struct page *page, size_t offset,
+	     size_t length, unsigned flags)
 {
-	return 0;
+	return nvos_dma_map(page_to_phys(page) + offset, length);
 }
 
-
 static inline bool
 dma_mapping_error(struct device *pdev, dma_addr_t addr)
 {
-	return true;
+	return addr == DMA_MAPPING_ERROR;
 }
 
 static inline void
-dma_unmap_page(struct device *pdev, dma_addr_t addr, int size, unsigned flags)
+dma_unmap_page(struct device *pdev, dma_addr_t addr, size_t size,
+	       unsigned flags)
 {
+	nvos_dma_unmap(addr, size);
 }
 
 static inline int
@@ -1321,6 +1342,7 @@ struct sg_table {
  *****************************************************************************/
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/stat.h>
 
 struct firmware {
 	size_t size;
@@ -1331,6 +1353,12 @@ int request_firmware(const struct firmware **, const char *, struct device *);
 void release_firmware(const struct firmware *);
 #define firmware_request_nowarn request_firmware
 
+/* Allows regenerable data (such as GR's golden context) to be kept in
+ * a local cache file across runs.
+ */
+#define CONFIG_NOUVEAU_FIRMWARE_CACHE
+int firmware_cache_write(const char *, const void *, size_t);
+
 #define MODULE_FIRMWARE(a)
 
 /******************************************************************************
@@ -1362,9 +1390,11 @@ struct work_struct {
 #define INIT_WORK(a,b) ((a)->func = (b), (a)->nvos = NULL)
 #define schedule_work(a) BUG_ON(!nvos_work_init((a)->exec, (a), &(a)->nvos))
 #define flush_work(a) nvos_work_fini(&(a)->nvos)
+#define cancel_work_sync(a) nvos_work_cancel(&(a)->nvos)
 
 bool nvos_work_init(void (*)(void *), void *, struct nvos_work **);
 void nvos_work_fini(struct nvos_work **);
+void nvos_work_cancel(struct nvos_work **);
 
 static inline void
 queue_work(struct workqueue_struct *wq, struct work_struct *work)
@@ -1434,6 +1464,12 @@ wait_for_completion_timeout(struct completion *c, unsigned long timeout)
 	return 1;
 }
 
+static inline bool
+completion_done(struct completion *c)
+{
+	return c->done;
+}
+
 static inline void
 complete(struct completion *c)
 {
@@ -1576,6 +1612,15 @@ extern const struct i2c_algorithm i2c_bit_algo;
 #define msleep(a) usleep((a) * 1000)
 #define usleep_range(a,b) usleep((a))
 
+/* usleep() takes far longer than asked for short delays, spin instead. */
+static inline void
+ndelay(unsigned long nsecs)
+{
+	const s64 end = ktime_to_ns(ktime_get()) + nsecs;
+	while (ktime_to_ns(ktime_get()) < end)
+		;
+}
+
 /******************************************************************************
  * reboot
  *****************************************************************************/
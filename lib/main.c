@@ -42,6 +42,9 @@ static int os_client_nr = 0;
 bool os_device_detect = true;
 bool os_device_mmio = true;
 u64  os_device_subdev = ~0ULL;
+void __iomem *(*os_ioremap_sim)(u64 addr, u64 size);
+dma_addr_t (*os_dma_map_sim)(u64 phys, u64 size);
+void (*os_dma_unmap_sim)(dma_addr_t addr, u64 size);
 
 /******************************************************************************
  * horrific stuff to implement linux's ioremap interface on top of pciaccess
@@ -106,6 +109,9 @@ nvos_ioremap(u64 addr, u64 size)
 		}
 	}
 
+	/* Nothing to unmap for these, nvos_iounmap() will ignore them. */
+	if (os_ioremap_sim)
+		return os_ioremap_sim(addr, size);
 	return NULL;
 }
 
@@ -130,6 +136,24 @@ nvos_iounmap(void __iomem *ptr)
 	mutex_unlock(&os_ioremap_mutex);
 }
 
+/******************************************************************************
+ * DMA, which fails unless a tool simulates an IOMMU
+ *****************************************************************************/
+dma_addr_t
+nvos_dma_map(u64 phys, u64 size)
+{
+	if (os_dma_map_sim)
+		return os_dma_map_sim(phys, size);
+	return DMA_MAPPING_ERROR;
+}
+
+void
+nvos_dma_unmap(dma_addr_t addr, u64 size)
+{
+	if (os_dma_unmap_sim)
+		os_dma_unmap_sim(addr, size);
+}
+
 /******************************************************************************
  * client interfaces
  *****************************************************************************/
@@ -17,4 +17,13 @@ struct os_device {
 extern bool os_device_detect;
 extern bool os_device_mmio;
 extern u64  os_device_subdev;
+
+/* Backs ioremap() of addresses outside any PCI device, for tools that
+ * simulate one.
+ */
+extern void __iomem *(*os_ioremap_sim)(u64 addr, u64 size);
+
+/* Back dma_map_page()/dma_unmap_page(), for tools that simulate an IOMMU. */
+extern dma_addr_t (*os_dma_map_sim)(u64 phys, u64 size);
+extern void (*os_dma_unmap_sim)(dma_addr_t addr, u64 size);
 #endif
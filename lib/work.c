@@ -52,12 +52,14 @@ nvos_work(void *data)
 	return NULL;
 }
 
-void
-nvos_work_fini(struct nvos_work **pwork)
+static void
+nvos_work_stop(struct nvos_work **pwork, bool cancel)
 {
 	struct nvos_work *work = *pwork;
 	if (work) {
 		pthread_mutex_lock(&work->mutex);
+		if (cancel)
+			work->priv = NULL;
 		work->done = true;
 		pthread_cond_signal(&work->cond);
 		pthread_mutex_unlock(&work->mutex);
@@ -70,6 +72,18 @@ nvos_work_fini(struct nvos_work **pwork)
 	}
 }
 
+void
+nvos_work_fini(struct nvos_work **pwork)
+{
+	nvos_work_stop(pwork, false);
+}
+
+void
+nvos_work_cancel(struct nvos_work **pwork)
+{
+	nvos_work_stop(pwork, true);
+}
+
 bool
 nvos_work_init(void (*func)(void *), void *priv, struct nvos_work **pwork)
 {